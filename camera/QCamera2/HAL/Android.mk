@@ -6,6 +6,7 @@ LOCAL_SRC_FILES := \
         QCamera2Hal.cpp \
         QCamera2HWI.cpp \
         QCameraMem.cpp \
+        QCameraDumpWriter.cpp \
         ../util/QCameraQueue.cpp \
         ../util/QCameraCmdThread.cpp \
         QCameraStateMachine.cpp \
@@ -17,6 +18,13 @@ LOCAL_SRC_FILES := \
         QCameraThermalAdapter.cpp \
         wrapper/QualcommCamera.cpp
 
+# NEON paths of the image kernels, arm64 always builds them
+ifeq ($(TARGET_ARCH),arm)
+LOCAL_SRC_FILES += ../util/QCameraImgKernels.cpp.neon
+else
+LOCAL_SRC_FILES += ../util/QCameraImgKernels.cpp
+endif
+
 LOCAL_CFLAGS = -Wall -Werror -DDEFAULT_DENOISE_MODE_ON
 #Debug logs are enabled
 #LOCAL_CFLAGS += -DDISABLE_DEBUG_LOG
@@ -62,4 +70,4 @@ LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
 
-#include $(LOCAL_PATH)/test/Android.mk
+include $(LOCAL_PATH)/test/Android.mk
@@ -32,6 +32,7 @@
 #include <cutils/properties.h>
 #include <hardware/camera.h>
 #include <stdlib.h>
+#include <fcntl.h>
 #include <utils/Errors.h>
 #include <gralloc_priv.h>
 #include <gui/Surface.h>
@@ -953,6 +954,10 @@ QCamera2HardwareInterface::QCamera2HardwareInterface(int cameraId)
       m_bShutterSoundPlayed(false),
       m_bPreviewStarted(false),
       m_bRecordStarted(false),
+      m_openTime(0),
+      m_bPoolPrewarmed(false),
+      m_bPreviewCbCopy(false),
+      mPreviewCbMem(NULL),
       m_currentFocusState(CAM_AF_SCANNING),
       m_pPowerModule(NULL),
       mDumpFrmCnt(0),
@@ -971,7 +976,8 @@ QCamera2HardwareInterface::QCamera2HardwareInterface(int cameraId)
       mSnapshotJob(-1),
       mPostviewJob(-1),
       mMetadataJob(-1),
-      mReprocJob(-1)
+      mReprocJob(-1),
+      mPrewarmJob(-1)
 {
     mCameraDevice.common.tag = HARDWARE_DEVICE_TAG;
     mCameraDevice.common.version = HARDWARE_DEVICE_API_VERSION(1, 0);
@@ -1045,12 +1051,29 @@ int QCamera2HardwareInterface::openCamera(struct hw_device_t **hw_device)
         return PERMISSION_DENIED;
     }
     ALOGE("[KPI Perf] %s: E PROFILE_OPEN_CAMERA camera id %d", __func__,mCameraId);
+    m_openTime = systemTime();
     rc = openCamera();
     if (rc == NO_ERROR){
         *hw_device = &mCameraDevice.common;
         if (m_thermalAdapter.init(this) != 0) {
           ALOGE("Init thermal adapter failed");
         }
+
+        // allocate the buffers of the last session while the app
+        // configures the camera, up to the pool high-water mark
+        char value[PROPERTY_VALUE_MAX];
+        m_bPoolPrewarmed = false;
+        property_get("persist.camera.mem.prewarm", value, "0");
+        if (atoi(value) > 0) {
+            DefferWorkArgs args;
+            memset(&args, 0, sizeof(args));
+            mPrewarmJob = queueDefferedWork(CMD_DEFF_PREWARM_POOL, args);
+        }
+
+        // pack preview callbacks into dedicated buffers instead of
+        // lending display buffers to the app
+        property_get("persist.camera.preview.cbbuf", value, "0");
+        m_bPreviewCbCopy = atoi(value) > 0;
     }
     else
         *hw_device = NULL;
@@ -1182,6 +1205,10 @@ int QCamera2HardwareInterface::openCamera()
 
     mParameters.init(gCamCapability[mCameraId], mCameraHandle, this, this);
 
+    if (m_dumpWriter.init(mCameraId) != NO_ERROR) {
+        ALOGE("Init dump writer failed, debug dumps are disabled");
+    }
+
     rc = m_thermalAdapter.init(this);
     if (rc != 0) {
         ALOGE("Init thermal adapter failed");
@@ -1240,6 +1267,22 @@ int QCamera2HardwareInterface::closeCamera()
         }
     }
 
+    // write out pending debug dumps
+    m_dumpWriter.deinit();
+
+    // notifier exit has returned all callback buffers by now
+    if (mPreviewCbMem != NULL) {
+        mPreviewCbMem->deallocate();
+        delete mPreviewCbMem;
+        mPreviewCbMem = NULL;
+    }
+
+    // remember the buffers of this session for the next open
+    waitDefferedWork(mPrewarmJob);
+    char path[64];
+    snprintf(path, sizeof(path), QCAMERA_POOL_USAGE_PATH, mCameraId);
+    m_memoryPool.saveUsage(path);
+
     rc = mCameraHandle->ops->close_camera(mCameraHandle->camera_handle);
     mCameraHandle = NULL;
 
@@ -1984,6 +2027,19 @@ int QCamera2HardwareInterface::stopPreview()
 
     // delete all channels from preparePreview
     unpreparePreview();
+
+    if (mm_camera_trace_enabled()) {
+        char path[64];
+        snprintf(path, sizeof(path), QCAMERA_FRAME_TRACE_PATH, mCameraId);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0660);
+        if (fd >= 0) {
+            mm_camera_trace_dump(fd);
+            close(fd);
+            ALOGD("%s: frame trace written to %s", __func__, path);
+        } else {
+            ALOGE("%s: cannot open %s for frame trace", __func__, path);
+        }
+    }
     ALOGD("%s: X", __func__);
     return NO_ERROR;
 }
@@ -3129,10 +3185,14 @@ int QCamera2HardwareInterface::release()
  *              NO_ERROR  -- success
  *              none-zero failure code
  *==========================================================================*/
-int QCamera2HardwareInterface::dump(int /*fd*/)
+int QCamera2HardwareInterface::dump(int fd)
 {
-    ALOGE("%s: not supported yet", __func__);
-    return INVALID_OPERATION;
+    m_memoryPool.dump(fd);
+    if (mPreviewCbMem != NULL) {
+        mPreviewCbMem->dump(fd);
+    }
+    m_dumpWriter.dump(fd);
+    return NO_ERROR;
 }
 
 /*===========================================================================
@@ -3262,6 +3322,7 @@ void QCamera2HardwareInterface::jpegEvtHandle(jpeg_job_status_t status,
             if (p_output != NULL) {
                 payload->out_data = *p_output;
             }
+            obj->m_postprocessor.traceJpegDone(jobId);
             obj->processUFDumps(payload);
             obj->processEvt(QCAMERA_SM_EVT_JPEG_EVT_NOTIFY, payload);
         }
@@ -4742,6 +4803,9 @@ int32_t QCamera2HardwareInterface::preparePreview()
 {
     int32_t rc = NO_ERROR;
 
+    // let the pool prewarm finish instead of allocating the same set twice
+    waitDefferedWork(mPrewarmJob);
+
     if (mParameters.isZSLMode() && mParameters.getRecordingHintValue() !=true) {
         rc = addChannel(QCAMERA_CH_TYPE_ZSL);
         if (rc != NO_ERROR) {
@@ -5949,9 +6013,9 @@ void *QCamera2HardwareInterface::defferedWorkRoutine(void *obj)
 
     do {
         do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            ret = cmdThread->waitCmd();
             if (ret != 0 && errno != EINVAL) {
-                ALOGE("%s: cam_sem_wait error (%s)",
+                ALOGE("%s: waitCmd error (%s)",
                         __func__, strerror(errno));
                 return NULL;
             }
@@ -5968,7 +6032,7 @@ void *QCamera2HardwareInterface::defferedWorkRoutine(void *obj)
             ALOGD("%s: stop data proc", __func__);
             is_active = FALSE;
             // signal cmd is completed
-            cam_sem_post(&cmdThread->sync_sem);
+            cmdThread->signalSync();
             break;
         case CAMERA_CMD_TYPE_DO_NEXT_JOB:
             {
@@ -6036,6 +6100,21 @@ void *QCamera2HardwareInterface::defferedWorkRoutine(void *obj)
                         }
                     }
                     break;
+                case CMD_DEFF_PREWARM_POOL:
+                    {
+                        char path[64];
+                        snprintf(path, sizeof(path), QCAMERA_POOL_USAGE_PATH,
+                                 pme->mCameraId);
+                        pme->m_bPoolPrewarmed =
+                            pme->m_memoryPool.prewarm(path) == NO_ERROR;
+                        {
+                            Mutex::Autolock l(pme->mDeffLock);
+                            pme->mDeffOngoingJobs[dw->id] = false;
+                            delete dw;
+                            pme->mDeffCond.signal();
+                        }
+                    }
+                    break;
                 default:
                     ALOGE("%s[%d]:  Incorrect command : %d",
                           __func__,
@@ -46,6 +46,7 @@
 #include "QCameraPostProc.h"
 #include "QCameraThermalAdapter.h"
 #include "QCameraMem.h"
+#include "QCameraDumpWriter.h"
 
 extern "C" {
 #include <mm_camera_interface.h>
@@ -101,12 +102,15 @@ typedef struct {
 #define QCAMERA_DUMP_FRM_THUMBNAIL  (1<<3)
 #define QCAMERA_DUMP_FRM_RAW        (1<<4)
 #define QCAMERA_DUMP_FRM_JPEG       (1<<5)
+#define QCAMERA_DUMP_FRM_HALF       (1<<7) // YUV dumps at half width and height
 
 #define QCAMERA_DUMP_FRM_MASK_ALL    0x000000ff
 
 #define QCAMERA_ION_USE_CACHE   true
 #define QCAMERA_ION_USE_NOCACHE false
 #define MAX_ONGOING_JOBS 25
+#define QCAMERA_POOL_USAGE_PATH "/data/misc/camera/mem_pool_%d.txt"
+#define QCAMERA_FRAME_TRACE_PATH "/data/misc/camera/frame_trace_%d.json"
 
 /** IMG_SWAP
  *  @a: input a
@@ -334,10 +338,14 @@ private:
     bool needScaleReprocess();
     void debugShowVideoFPS();
     void debugShowPreviewFPS();
+    QCameraPreviewCbMemory *getPreviewCbMemory();
+    int32_t sendPreviewCallbackCopy(QCameraStream *stream,
+                                    mm_camera_buf_def_t *frame);
     void dumpJpegToFile(const void *data, uint32_t size, int index);
-    void dumpFrameToFile(QCameraStream *stream,
+    bool dumpFrameToFile(QCameraStream *stream,
                          mm_camera_buf_def_t *frame,
-                         int dump_type);
+                         int dump_type,
+                         bool canHold = false);
     void dumpMetadataToFile(QCameraStream *stream,
                             mm_camera_buf_def_t *frame,char *type);
     void releaseSuperBuf(mm_camera_super_buf_t *super_buf);
@@ -507,6 +515,7 @@ private:
     pthread_cond_t m_cond;
     qcamera_api_result_t m_apiResult;
     QCameraMemoryPool m_memoryPool;
+    QCameraDumpWriter m_dumpWriter;
 
     pthread_mutex_t m_evtLock;
     pthread_cond_t m_evtCond;
@@ -519,6 +528,10 @@ private:
     bool m_bShutterSoundPlayed;         // if shutter sound had been played
     bool m_bPreviewStarted;             //flag indicates first preview frame callback is received
     bool m_bRecordStarted;             //flag indicates Recording is started for first time
+    nsecs_t m_openTime;                 // open time, reset once first preview frame is logged
+    bool m_bPoolPrewarmed;              // memory pool prewarmed on open
+    bool m_bPreviewCbCopy;              // serve preview callbacks from mPreviewCbMem
+    QCameraPreviewCbMemory *mPreviewCbMem; // callback buffers, created on first use
 
 
     // if auto focus is running, in other words, when auto_focus is called from service,
@@ -550,6 +563,7 @@ private:
     enum DefferedWorkCmd {
         CMD_DEFF_ALLOCATE_BUFF,
         CMD_DEFF_PPROC_START,
+        CMD_DEFF_PREWARM_POOL,
         CMD_DEFF_MAX
     };
 
@@ -594,6 +608,7 @@ private:
     int32_t mPostviewJob;
     int32_t mMetadataJob;
     int32_t mReprocJob;
+    int32_t mPrewarmJob;
     int32_t mOutputCount;
 };
 
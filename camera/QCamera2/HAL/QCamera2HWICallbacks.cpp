@@ -34,6 +34,7 @@
 #include <utils/Errors.h>
 #include <utils/Timers.h>
 #include "QCamera2HWI.h"
+#include "QCameraImgKernels.h"
 
 namespace qcamera {
 
@@ -415,6 +416,7 @@ void QCamera2HardwareInterface::preview_stream_cb_routine(mm_camera_super_buf_t
         free(super_frame);
         return;
     }
+    mm_camera_trace_stamp(CAM_TRACE_HAL_CB, frame->stream_id, frame->frame_idx);
 
     if (!pme->needProcessPreviewFrame()) {
         ALOGE("%s: preview is not running, no need to process", __func__);
@@ -434,10 +436,26 @@ void QCamera2HardwareInterface::preview_stream_cb_routine(mm_camera_super_buf_t
        ALOGE("[KPI Perf] %s : PROFILE_FIRST_PREVIEW_FRAME", __func__);
        pme->m_bPreviewStarted = false ;
     }
+    if (pme->m_openTime != 0) {
+        ALOGE("[KPI Perf] %s : PROFILE_OPEN_TO_FIRST_PREVIEW_FRAME %lld ms, pool prewarm %d",
+              __func__, (long long)ns2ms(systemTime() - pme->m_openTime),
+              pme->m_bPoolPrewarmed);
+        pme->m_openTime = 0;
+    }
+
+    // Pack the preview callback before the display owns the frame, any
+    // failure falls back to the callback below
+    bool cbSent = false;
+    if (pme->m_bPreviewCbCopy &&
+        pme->mDataCb != NULL &&
+        pme->msgTypeEnabledWithLock(CAMERA_MSG_PREVIEW_FRAME) > 0) {
+        cbSent = (pme->sendPreviewCallbackCopy(stream, frame) == NO_ERROR);
+    }
 
     // Display the buffer.
     ALOGV("%p displayBuffer %d E", pme, idx);
     int dequeuedIdx = memory->displayBuffer(idx);
+    mm_camera_trace_stamp(CAM_TRACE_DISPLAY_ENQUEUE, frame->stream_id, frame->frame_idx);
     if (dequeuedIdx < 0 || dequeuedIdx >= memory->getCnt()) {
         ALOGD("%s: Invalid dequeued buffer index %d from display",
               __func__, dequeuedIdx);
@@ -450,7 +468,8 @@ void QCamera2HardwareInterface::preview_stream_cb_routine(mm_camera_super_buf_t
     }
 
     // Handle preview data callback
-    if (pme->mDataCb != NULL && pme->msgTypeEnabledWithLock(CAMERA_MSG_PREVIEW_FRAME) > 0) {
+    if (!cbSent && pme->mDataCb != NULL &&
+        pme->msgTypeEnabledWithLock(CAMERA_MSG_PREVIEW_FRAME) > 0) {
         camera_memory_t *previewMem = NULL;
         camera_memory_t *data = NULL;
         int previewBufSize;
@@ -546,6 +565,7 @@ void QCamera2HardwareInterface::nodisplay_preview_stream_cb_routine(
         free(super_frame);
         return;
     }
+    mm_camera_trace_stamp(CAM_TRACE_HAL_CB, frame->stream_id, frame->frame_idx);
 
     if (!pme->needProcessPreviewFrame()) {
         ALOGD("%s: preview is not running, no need to process", __func__);
@@ -558,6 +578,13 @@ void QCamera2HardwareInterface::nodisplay_preview_stream_cb_routine(
         pme->debugShowPreviewFPS();
     }
 
+    if (pme->m_openTime != 0) {
+        ALOGE("[KPI Perf] %s : PROFILE_OPEN_TO_FIRST_PREVIEW_FRAME %lld ms, pool prewarm %d",
+              __func__, (long long)ns2ms(systemTime() - pme->m_openTime),
+              pme->m_bPoolPrewarmed);
+        pme->m_openTime = 0;
+    }
+
     QCameraMemory *previewMemObj = (QCameraMemory *)frame->mem_info;
     camera_memory_t *preview_mem = NULL;
     if (previewMemObj != NULL) {
@@ -582,6 +609,11 @@ void QCamera2HardwareInterface::nodisplay_preview_stream_cb_routine(
             if (rc != NO_ERROR) {
                 ALOGE("%s: fail sending data notify", __func__);
                 stream->bufDone(frame->buf_idx);
+            } else if (pme->m_bPreviewCbCopy) {
+                QCameraPreviewCbMemory *cbMem = pme->getPreviewCbMemory();
+                if (cbMem != NULL) {
+                    cbMem->countZeroCopy();
+                }
             }
         } else {
             stream->bufDone(frame->buf_idx);
@@ -635,14 +667,18 @@ void QCamera2HardwareInterface::postview_stream_cb_routine(mm_camera_super_buf_t
     }
 
     QCameraMemory *memObj = (QCameraMemory *)frame->mem_info;
+    bool dumpHeld = false;
     if (NULL != memObj) {
-        pme->dumpFrameToFile(stream, frame, QCAMERA_DUMP_FRM_THUMBNAIL);
+        dumpHeld = pme->dumpFrameToFile(stream, frame,
+                QCAMERA_DUMP_FRM_THUMBNAIL, true);
     }
 
-    // Return buffer back to driver
-    err = stream->bufDone(frame->buf_idx);
-    if ( err < 0) {
-        ALOGE("stream bufDone failed %d", err);
+    // Return buffer back to driver, unless the dump writer returns it
+    if (!dumpHeld) {
+        err = stream->bufDone(frame->buf_idx);
+        if ( err < 0) {
+            ALOGE("stream bufDone failed %d", err);
+        }
     }
 
     free(super_frame);
@@ -683,6 +719,7 @@ void QCamera2HardwareInterface::video_stream_cb_routine(mm_camera_super_buf_t *s
         return;
     }
     mm_camera_buf_def_t *frame = super_frame->bufs[0];
+    mm_camera_trace_stamp(CAM_TRACE_HAL_CB, frame->stream_id, frame->frame_idx);
 
     if (pme->needDebugFps()) {
         pme->debugShowVideoFPS();
@@ -873,10 +910,14 @@ void QCamera2HardwareInterface::preview_raw_stream_cb_routine(mm_camera_super_bu
     for ( i= 0 ; i < super_frame->num_bufs ; i++ ) {
         if ( super_frame->bufs[i]->stream_type == CAM_STREAM_TYPE_RAW ) {
             mm_camera_buf_def_t * raw_frame = super_frame->bufs[i];
+            bool dumpHeld = false;
             if ( NULL != stream && (dump_raw) ) {
-                pme->dumpFrameToFile(stream, raw_frame, QCAMERA_DUMP_FRM_RAW);
+                dumpHeld = pme->dumpFrameToFile(stream, raw_frame,
+                        QCAMERA_DUMP_FRM_RAW, true);
+            }
+            if (!dumpHeld) {
+                stream->bufDone(super_frame->bufs[i]->buf_idx);
             }
-            stream->bufDone(super_frame->bufs[i]->buf_idx);
             break;
         }
     }
@@ -926,10 +967,14 @@ void QCamera2HardwareInterface::snapshot_raw_stream_cb_routine(mm_camera_super_b
     for ( i= 0 ; i < super_frame->num_bufs ; i++ ) {
         if ( super_frame->bufs[i]->stream_type == CAM_STREAM_TYPE_RAW ) {
             mm_camera_buf_def_t * raw_frame = super_frame->bufs[i];
+            bool dumpHeld = false;
             if ( NULL != stream && (dump_raw) ) {
-                pme->dumpFrameToFile(stream, raw_frame, QCAMERA_DUMP_FRM_RAW);
+                dumpHeld = pme->dumpFrameToFile(stream, raw_frame,
+                        QCAMERA_DUMP_FRM_RAW, true);
+            }
+            if (!dumpHeld) {
+                stream->bufDone(super_frame->bufs[i]->buf_idx);
             }
-            stream->bufDone(super_frame->bufs[i]->buf_idx);
             break;
         }
     }
@@ -1264,13 +1309,13 @@ void QCamera2HardwareInterface::dumpJpegToFile(const void *data,
             if (mDumpFrmCnt >= 0 && mDumpFrmCnt <= frm_num) {
                 snprintf(buf, sizeof(buf), "/data/misc/camera/%d_%d.jpg", mDumpFrmCnt, index);
 
-                int file_fd = open(buf, O_RDWR | O_CREAT, 0777);
-                if (file_fd > 0) {
-                    int written_len = write(file_fd, data, size);
-                    ALOGD("%s: written number of bytes %d\n", __func__, written_len);
-                    close(file_fd);
+                // the jpeg buffer is reused once we return, write a copy
+                void *staging = m_dumpWriter.getStagingBuffer(size);
+                if (staging != NULL) {
+                    memcpy(staging, data, size);
+                    m_dumpWriter.queueStaged(buf, staging, size);
                 } else {
-                    ALOGE("%s: fail t open file for image dumping", __func__);
+                    ALOGE("%s: dump queue full, dropping %s", __func__, buf);
                 }
                 mDumpFrmCnt++;
             }
@@ -1321,39 +1366,46 @@ void QCamera2HardwareInterface::dumpMetadataToFile(QCameraStream *stream,
             snprintf(buf, sizeof(buf), "%dm_%s_%d.bin",
                                          mDumpFrmCnt,type,frame->frame_idx);
             filePath.append(buf);
-            int file_fd = open(filePath.string(), O_RDWR | O_CREAT, 0777);
-            if (file_fd > 0) {
-                int written_len = 0;
-                metadata->tuning_params.tuning_data_version = TUNING_DATA_VERSION;
-                void *data = (void *)((uint8_t *)&metadata->tuning_params.tuning_data_version);
-                written_len += write(file_fd, data, sizeof(uint32_t));
-                data = (void *)((uint8_t *)&metadata->tuning_params.tuning_sensor_data_size);
-                ALOGE("tuning_sensor_data_size %d",(int)(*(int *)data));
-                written_len += write(file_fd, data, sizeof(uint32_t));
-                data = (void *)((uint8_t *)&metadata->tuning_params.tuning_vfe_data_size);
-                ALOGE("tuning_vfe_data_size %d",(int)(*(int *)data));
-                written_len += write(file_fd, data, sizeof(uint32_t));
-                data = (void *)((uint8_t *)&metadata->tuning_params.tuning_cpp_data_size);
-                ALOGE("tuning_cpp_data_size %d",(int)(*(int *)data));
-                written_len += write(file_fd, data, sizeof(uint32_t));
-                data = (void *)((uint8_t *)&metadata->tuning_params.tuning_cac_data_size);
-                ALOGE("tuning_cac_data_size %d",(int)(*(int *)data));
-                written_len += write(file_fd, data, sizeof(uint32_t));
-                int total_size = metadata->tuning_params.tuning_sensor_data_size;
-                data = (void *)((uint8_t *)&metadata->tuning_params.data);
-                written_len += write(file_fd, data, total_size);
-                total_size = metadata->tuning_params.tuning_vfe_data_size;
-                data = (void *)((uint8_t *)&metadata->tuning_params.data[TUNING_VFE_DATA_OFFSET]);
-                written_len += write(file_fd, data, total_size);
-                total_size = metadata->tuning_params.tuning_cpp_data_size;
-                data = (void *)((uint8_t *)&metadata->tuning_params.data[TUNING_CPP_DATA_OFFSET]);
-                written_len += write(file_fd, data, total_size);
-                total_size = metadata->tuning_params.tuning_cac_data_size;
-                data = (void *)((uint8_t *)&metadata->tuning_params.data[TUNING_CAC_DATA_OFFSET]);
-                written_len += write(file_fd, data, total_size);
-                close(file_fd);
-            }else {
-                ALOGE("%s: fail t open file for image dumping", __func__);
+
+            // version, the four section sizes, then the sections
+            tuning_params_t *tuning = &metadata->tuning_params;
+            tuning->tuning_data_version = TUNING_DATA_VERSION;
+            ALOGE("tuning_sensor_data_size %d", (int)tuning->tuning_sensor_data_size);
+            ALOGE("tuning_vfe_data_size %d", (int)tuning->tuning_vfe_data_size);
+            ALOGE("tuning_cpp_data_size %d", (int)tuning->tuning_cpp_data_size);
+            ALOGE("tuning_cac_data_size %d", (int)tuning->tuning_cac_data_size);
+            uint32_t header[5] = {
+                tuning->tuning_data_version,
+                tuning->tuning_sensor_data_size,
+                tuning->tuning_vfe_data_size,
+                tuning->tuning_cpp_data_size,
+                tuning->tuning_cac_data_size };
+            struct {
+                const uint8_t *data;
+                uint32_t size;
+            } sections[4] = {
+                { &tuning->data[0], tuning->tuning_sensor_data_size },
+                { &tuning->data[TUNING_VFE_DATA_OFFSET], tuning->tuning_vfe_data_size },
+                { &tuning->data[TUNING_CPP_DATA_OFFSET], tuning->tuning_cpp_data_size },
+                { &tuning->data[TUNING_CAC_DATA_OFFSET], tuning->tuning_cac_data_size } };
+            uint32_t total_size = sizeof(header);
+            for (int i = 0; i < 4; i++) {
+                total_size += sections[i].size;
+            }
+
+            // the metadata buffer goes back to the stream, write a copy
+            uint8_t *staging = (uint8_t *)m_dumpWriter.getStagingBuffer(total_size);
+            if (staging != NULL) {
+                uint8_t *pos = staging;
+                memcpy(pos, header, sizeof(header));
+                pos += sizeof(header);
+                for (int i = 0; i < 4; i++) {
+                    memcpy(pos, sections[i].data, sections[i].size);
+                    pos += sections[i].size;
+                }
+                m_dumpWriter.queueStaged(filePath.string(), staging, total_size);
+            } else {
+                ALOGE("%s: dump queue full, dropping %s", __func__, filePath.string());
             }
             mDumpFrmCnt++;
         }
@@ -1364,6 +1416,8 @@ void QCamera2HardwareInterface::dumpMetadataToFile(QCameraStream *stream,
  * FUNCTION   : dumpFrameToFile
  *
  * DESCRIPTION: helper function to dump frame into file for debug purpose.
+ *              YUV frames are dumped at half size when
+ *              QCAMERA_DUMP_FRM_HALF is set in persist.camera.dumpimg.
  *
  * PARAMETERS :
  *    @data : data ptr
@@ -1372,13 +1426,19 @@ void QCamera2HardwareInterface::dumpMetadataToFile(QCameraStream *stream,
  *    @dump_type : type of the frame to be dumped. Only such
  *                 dump type is enabled, the frame will be
  *                 dumped into a file.
+ *    @canHold : the caller returns the frame itself, so the dump writer
+ *               may keep it until written instead of copying it
  *
- * RETURN     : None
+ * RETURN     : true  -- the frame is held by the dump writer, which returns
+ *                       it to the stream once written
+ *              false -- the frame still belongs to the caller
  *==========================================================================*/
-void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
+bool QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                                                 mm_camera_buf_def_t *frame,
-                                                int dump_type)
+                                                int dump_type,
+                                                bool canHold)
 {
+    bool held = false;
     char value[PROPERTY_VALUE_MAX];
     property_get("persist.camera.dumpimg", value, "0");
     int32_t enabled = atoi(value);
@@ -1426,6 +1486,15 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                     memset(&offset, 0, sizeof(cam_frame_len_offset_t));
                     stream->getFrameOffset(offset);
 
+                    // planar and semi planar YUV can be dumped halved
+                    bool half = (enabled & QCAMERA_DUMP_FRM_HALF) &&
+                            (dump_type != QCAMERA_DUMP_FRM_RAW) &&
+                            (offset.num_planes == 2 || offset.num_planes == 3);
+                    if (half) {
+                        dim.width /= 2;
+                        dim.height /= 2;
+                    }
+
                     strftime (timeBuf, sizeof(timeBuf),"/data/misc/camera/%Y%m%d%H%M%S", timeinfo);
                     String8 filePath(timeBuf);
                     switch (dump_type) {
@@ -1463,31 +1532,80 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                     default:
                         ALOGE("%s: Not supported for dumping stream type %d",
                               __func__, dump_type);
-                        return;
+                        return false;
                     }
 
                     filePath.append(buf);
-                    int file_fd = open(filePath.string(), O_RDWR | O_CREAT, 0777);
-                    if (file_fd > 0) {
-                        void *data = NULL;
-                        int written_len = 0;
 
+                    uint32_t width[VIDEO_MAX_PLANES];
+                    uint32_t height[VIDEO_MAX_PLANES];
+                    uint32_t frame_size = 0;
+                    for (int i = 0; i < offset.num_planes; i++) {
+                        width[i] = offset.mp[i].width;
+                        height[i] = offset.mp[i].height / (half ? 2 : 1);
+                        if (half) {
+                            // semi planar chroma keeps whole UV pairs
+                            width[i] = (offset.num_planes == 2 && i == 1) ?
+                                    (width[i] / 4) * 2 : width[i] / 2;
+                        }
+                        frame_size += width[i] * height[i];
+                    }
+
+                    // a full size frame the caller can spare is written in
+                    // place, the writer drops the stride padding
+                    if (canHold && !half &&
+                        offset.num_planes <= QCAMERA_DUMP_MAX_PLANES) {
+                        qcamera_dump_plane_t planes[QCAMERA_DUMP_MAX_PLANES];
                         for (int i = 0; i < offset.num_planes; i++) {
                             uint32_t index = offset.mp[i].offset;
                             if (i > 0) {
                                 index += offset.mp[i-1].len;
                             }
-                            for (int j = 0; j < offset.mp[i].height; j++) {
-                                data = (void *)((uint8_t *)frame->buffer + index);
-                                written_len += write(file_fd, data, offset.mp[i].width);
-                                index += offset.mp[i].stride;
-                            }
+                            planes[i].base = (uint8_t *)frame->buffer + index;
+                            planes[i].width = width[i];
+                            planes[i].stride = offset.mp[i].stride;
+                            planes[i].height = height[i];
                         }
-
-                        ALOGD("%s: written number of bytes %d\n", __func__, written_len);
-                        close(file_fd);
+                        // released even when the job is dropped
+                        stream->holdDumpBuf();
+                        m_dumpWriter.queueDump(filePath.string(),
+                                planes, offset.num_planes,
+                                QCameraStream::releaseDumpBuf,
+                                (void *)(intptr_t)frame->buf_idx, stream);
+                        held = true;
                     } else {
-                        ALOGE("%s: fail t open file for image dumping", __func__);
+                        // the frame goes back to the stream, write a copy
+                        // without the stride padding
+                        uint8_t *staging =
+                            (uint8_t *)m_dumpWriter.getStagingBuffer(frame_size);
+                        if (staging != NULL) {
+                            uint8_t *pos = staging;
+                            for (int i = 0; i < offset.num_planes; i++) {
+                                uint32_t index = offset.mp[i].offset;
+                                if (i > 0) {
+                                    index += offset.mp[i-1].len;
+                                }
+                                const uint8_t *src = (uint8_t *)frame->buffer + index;
+                                if (!half) {
+                                    QCameraImgKernels::copyPlane(pos, width[i],
+                                            src, offset.mp[i].stride,
+                                            width[i], height[i]);
+                                } else if (offset.num_planes == 2 && i == 1) {
+                                    QCameraImgKernels::downscale2xUV(pos, width[i],
+                                            src, offset.mp[i].stride,
+                                            width[i] / 2, height[i]);
+                                } else {
+                                    QCameraImgKernels::downscale2x(pos, width[i],
+                                            src, offset.mp[i].stride,
+                                            width[i], height[i]);
+                                }
+                                pos += width[i] * height[i];
+                            }
+                            m_dumpWriter.queueStaged(filePath.string(), staging, frame_size);
+                        } else {
+                            ALOGE("%s: dump queue full, dropping %s",
+                                  __func__, filePath.string());
+                        }
                     }
                     mDumpFrmCnt++;
                 }
@@ -1498,6 +1616,7 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
         mDumpFrmCnt = 0;
     }
     stream->mDumpFrame = mDumpFrmCnt;
+    return held;
 }
 
 /*===========================================================================
@@ -1552,6 +1671,125 @@ void QCamera2HardwareInterface::debugShowPreviewFPS()
     }
 }
 
+/*===========================================================================
+ * FUNCTION   : getPreviewCbMemory
+ *
+ * DESCRIPTION: get the preview callback buffer set, creating it on first
+ *              use. Buffers are allocated by sendPreviewCallbackCopy once
+ *              the frame size is known.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : ptr to preview callback memory
+ *              NULL if app memory callbacks are not set yet
+ *==========================================================================*/
+QCameraPreviewCbMemory *QCamera2HardwareInterface::getPreviewCbMemory()
+{
+    if (mPreviewCbMem == NULL && mGetMemory != NULL) {
+        mPreviewCbMem = new QCameraPreviewCbMemory(mGetMemory, &m_memoryPool);
+    }
+    return mPreviewCbMem;
+}
+
+/*===========================================================================
+ * FUNCTION   : sendPreviewCallbackCopy
+ *
+ * DESCRIPTION: send a preview data callback from a dedicated callback
+ *              buffer. The frame is packed into the app's layout before it
+ *              is queued to the display, and the callback buffer returns
+ *              to the free set when the notifier releases it.
+ *
+ * PARAMETERS :
+ *   @stream  : preview stream
+ *   @frame   : preview frame, still owned by the HAL
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- callback sent or skipped on purpose
+ *              NAME_NOT_FOUND -- preview format has no packed layout
+ *              none-zero failure code
+ *              the caller sends the legacy callback on any error
+ *==========================================================================*/
+int32_t QCamera2HardwareInterface::sendPreviewCallbackCopy(QCameraStream *stream,
+                                                           mm_camera_buf_def_t *frame)
+{
+    cam_dimension_t dim;
+    cam_format_t fmt;
+    cam_frame_len_offset_t offset;
+    int size;
+
+    stream->getFrameDimension(dim);
+    stream->getFormat(fmt);
+    stream->getFrameOffset(offset);
+    if (fmt == CAM_FORMAT_YUV_420_YV12) {
+        size = PAD_TO_SIZE(dim.width, 16) * dim.height +
+               PAD_TO_SIZE(dim.width / 2, 16) * dim.height;
+    } else if (fmt == CAM_FORMAT_YUV_420_NV21 || fmt == CAM_FORMAT_YUV_420_NV12) {
+        size = dim.width * dim.height * 3 / 2;
+    } else {
+        return NAME_NOT_FOUND;
+    }
+
+    QCameraPreviewCbMemory *cbMem = getPreviewCbMemory();
+    if (cbMem == NULL) {
+        return NO_MEMORY;
+    }
+    if (cbMem->getBufSize() != size) {
+        if (!cbMem->isIdle()) {
+            // app still holds frames of the previous size
+            ALOGD("%s: callback buffers busy, skip frame %d",
+                  __func__, frame->frame_idx);
+            return NO_ERROR;
+        }
+        if (cbMem->getBufSize() != 0) {
+            cbMem->deallocate();
+        }
+        if (cbMem->allocate(QCAMERA_PREVIEW_CB_BUF_CNT, size) != NO_ERROR) {
+            ALOGE("%s: allocation of preview callback buffers failed", __func__);
+            return NO_MEMORY;
+        }
+    }
+
+    int idx = cbMem->acquireBuffer();
+    if (idx < 0) {
+        ALOGD("%s: all callback buffers held by app, skip frame %d",
+              __func__, frame->frame_idx);
+        return NO_ERROR;
+    }
+    // the app gets NV21 for "yuv420sp" whatever the stream runs at
+    cam_format_t cbFmt = fmt;
+    const char *previewFmt = mParameters.getPreviewFormat();
+    if (fmt == CAM_FORMAT_YUV_420_NV12 && previewFmt != NULL &&
+            strcmp(previewFmt, QCameraParameters::PIXEL_FORMAT_YUV420SP) == 0) {
+        cbFmt = CAM_FORMAT_YUV_420_NV21;
+    }
+    int32_t rc = cbMem->fillBuffer(idx, frame->buffer, offset, fmt, cbFmt);
+    if (rc != NO_ERROR) {
+        cbMem->releaseBuffer(idx);
+        return rc;
+    }
+
+    qcamera_callback_argm_t cbArg;
+    memset(&cbArg, 0, sizeof(qcamera_callback_argm_t));
+    cbArg.cb_type = QCAMERA_DATA_CALLBACK;
+    cbArg.msg_type = CAMERA_MSG_PREVIEW_FRAME;
+    cbArg.data = cbMem->getMemory(idx, false);
+    cbArg.user_data = (void *)idx;
+    cbArg.cookie = cbMem;
+    cbArg.release_cb = QCameraPreviewCbMemory::releaseCallback;
+    rc = m_cbNotifier.notifyCallback(cbArg);
+    if (rc != NO_ERROR) {
+        ALOGE("%s: fail sending notification", __func__);
+        cbMem->releaseBuffer(idx);
+    }
+
+    float copies, zeroCopies;
+    if (needDebugFps() && cbMem->getCopyRate(copies, zeroCopies)) {
+        ALOGE("[KPI Perf] %s: PROFILE_PREVIEW_CB_COPIES_PER_SECOND : %.4f, zero copy %.4f",
+              __func__, copies, zeroCopies);
+    }
+    return rc;
+}
+
 /*===========================================================================
  * FUNCTION   : ~QCameraCbNotifier
  *
@@ -1654,9 +1892,9 @@ void * QCameraCbNotifier::cbNotifyRoutine(void * data)
     ALOGV("%s: E", __func__);
     do {
         do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            ret = cmdThread->waitCmd();
             if (ret != 0 && errno != EINVAL) {
-                ALOGV("%s: cam_sem_wait error (%s)",
+                ALOGV("%s: waitCmd error (%s)",
                            __func__, strerror(errno));
                 return NULL;
             }
@@ -0,0 +1,738 @@
+/* Copyright (c) 2014, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_TAG "QCameraDumpWriter"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utils/Errors.h>
+#include <utils/Log.h>
+#include <cutils/properties.h>
+#include "QCameraDumpWriter.h"
+
+using namespace android;
+
+namespace qcamera {
+
+/*===========================================================================
+ * FUNCTION   : QCameraDumpWriter
+ *
+ * DESCRIPTION: constructor of QCameraDumpWriter
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraDumpWriter::QCameraDumpWriter()
+    : mDataQ(releaseJob, this),
+      mActive(false),
+      mMaxJobs(0),
+      mMaxBytes(0),
+      mPendingJobs(0),
+      mPendingBytes(0),
+      mContainerFd(-1),
+      mContainerSize(0),
+      mContainerOffset(0)
+{
+    memset(&mStats, 0, sizeof(mStats));
+    pthread_mutex_init(&mLock, NULL);
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraDumpWriter
+ *
+ * DESCRIPTION: deconstructor of QCameraDumpWriter
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraDumpWriter::~QCameraDumpWriter()
+{
+    deinit();
+    mDataQ.flush();
+    pthread_mutex_destroy(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : init
+ *
+ * DESCRIPTION: read the dump writer settings and launch the writer thread
+ *
+ * PARAMETERS :
+ *   @cameraId : camera Id, used to name the container file
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraDumpWriter::init(int cameraId)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    if (mActive) {
+        return NO_ERROR;
+    }
+
+    property_get("persist.camera.dump.queue.jobs", value, "32");
+    mMaxJobs = atoi(value);
+    property_get("persist.camera.dump.queue.mb", value, "64");
+    mMaxBytes = (uint64_t)atoi(value) << 20;
+    property_get("persist.camera.dump.container.mb", value, "0");
+    mContainerSize = (uint64_t)atoi(value) << 20;
+    mContainerOffset = 0;
+
+    if (mContainerSize > 0) {
+        char path[64];
+        snprintf(path, sizeof(path), QCAMERA_DUMP_CONTAINER_PATH, cameraId);
+        mContainerFd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0660);
+        if (mContainerFd < 0 || ftruncate(mContainerFd, mContainerSize) != 0) {
+            ALOGE("%s: cannot set up container %s (%s), dumping to files",
+                  __func__, path, strerror(errno));
+            if (mContainerFd >= 0) {
+                close(mContainerFd);
+                mContainerFd = -1;
+            }
+        }
+    }
+
+    int32_t rc = mProcTh.launch(dumpRoutine, this);
+    if (rc != NO_ERROR) {
+        ALOGE("%s: cannot launch dump thread", __func__);
+        if (mContainerFd >= 0) {
+            close(mContainerFd);
+            mContainerFd = -1;
+        }
+        return rc;
+    }
+
+    pthread_mutex_lock(&mLock);
+    mActive = true;
+    pthread_mutex_unlock(&mLock);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : deinit
+ *
+ * DESCRIPTION: write the pending dumps and stop the writer thread
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::deinit()
+{
+    pthread_mutex_lock(&mLock);
+    bool active = mActive;
+    mActive = false;
+    pthread_mutex_unlock(&mLock);
+    if (!active) {
+        return;
+    }
+
+    // the writer thread drains the queue before it exits
+    mProcTh.exit();
+
+    if (mContainerFd >= 0) {
+        if (ftruncate(mContainerFd, mContainerOffset) != 0) {
+            ALOGE("%s: cannot trim container (%s)", __func__, strerror(errno));
+        }
+        close(mContainerFd);
+        mContainerFd = -1;
+    }
+
+    if (mStats.dropped || mStats.failed) {
+        ALOGE("%s: %u dumps written, %u dropped, %u failed",
+              __func__, mStats.written, mStats.dropped, mStats.failed);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : reserveLocked
+ *
+ * DESCRIPTION: account a new job against the queue bounds. Must be called
+ *              with mLock held.
+ *
+ * PARAMETERS :
+ *   @size    : payload bytes of the job
+ *
+ * RETURN     : true if the job fits, false if it is dropped
+ *==========================================================================*/
+bool QCameraDumpWriter::reserveLocked(uint32_t size)
+{
+    if (!mActive ||
+        mPendingJobs >= mMaxJobs ||
+        mPendingBytes + size > mMaxBytes) {
+        mStats.dropped++;
+        return false;
+    }
+    mPendingJobs++;
+    mPendingBytes += size;
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : queueDump
+ *
+ * DESCRIPTION: queue a dump of data owned by the caller, such as a stream
+ *              buffer. The data must stay valid until release is called,
+ *              which happens after it is written, or right away if the
+ *              dump is dropped.
+ *
+ * PARAMETERS :
+ *   @name     : file path of the dump
+ *   @planes   : data to be written, in order
+ *   @planecnt : number of planes, up to QCAMERA_DUMP_MAX_PLANES
+ *   @release : function returning the data, may be NULL
+ *   @data    : first argument of release
+ *   @cookie  : second argument of release
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraDumpWriter::queueDump(const char *name,
+                                     const qcamera_dump_plane_t *planes,
+                                     int planecnt,
+                                     dump_release_fn release,
+                                     void *data,
+                                     void *cookie)
+{
+    uint32_t size = 0;
+
+    if (NULL == name || NULL == planes ||
+        planecnt <= 0 || planecnt > QCAMERA_DUMP_MAX_PLANES) {
+        if (release) {
+            release(data, cookie);
+        }
+        return BAD_VALUE;
+    }
+    for (int i = 0; i < planecnt; i++) {
+        size += planes[i].width * planes[i].height;
+    }
+
+    pthread_mutex_lock(&mLock);
+    bool reserved = reserveLocked(size);
+    pthread_mutex_unlock(&mLock);
+    if (!reserved) {
+        if (release) {
+            release(data, cookie);
+        }
+        return NO_MEMORY;
+    }
+
+    qcamera_dump_job_t *job = (qcamera_dump_job_t *)malloc(sizeof(qcamera_dump_job_t));
+    if (NULL == job) {
+        pthread_mutex_lock(&mLock);
+        mPendingJobs--;
+        mPendingBytes -= size;
+        mStats.dropped++;
+        pthread_mutex_unlock(&mLock);
+        if (release) {
+            release(data, cookie);
+        }
+        return NO_MEMORY;
+    }
+    memset(job, 0, sizeof(qcamera_dump_job_t));
+    job->hdr.magic = QCAMERA_DUMP_MAGIC;
+    job->hdr.size = size;
+    strlcpy(job->hdr.name, name, sizeof(job->hdr.name));
+    memcpy(job->planes, planes, planecnt * sizeof(qcamera_dump_plane_t));
+    job->planecnt = planecnt;
+    job->release = release;
+    job->data = data;
+    job->cookie = cookie;
+    return submit(job);
+}
+
+/*===========================================================================
+ * FUNCTION   : getStagingBuffer
+ *
+ * DESCRIPTION: allocate a buffer for data the caller cannot hold on to,
+ *              reserving its queue slot first so that nothing is copied
+ *              when the dump would be dropped anyway. Hand the buffer to
+ *              queueStaged once filled.
+ *
+ * PARAMETERS :
+ *   @size    : buffer size
+ *
+ * RETURN     : ptr to the buffer
+ *              NULL if the queue is full or out of memory
+ *==========================================================================*/
+void *QCameraDumpWriter::getStagingBuffer(uint32_t size)
+{
+    pthread_mutex_lock(&mLock);
+    bool reserved = reserveLocked(size);
+    pthread_mutex_unlock(&mLock);
+    if (!reserved) {
+        return NULL;
+    }
+
+    void *buf = malloc(size);
+    if (NULL == buf) {
+        pthread_mutex_lock(&mLock);
+        mPendingJobs--;
+        mPendingBytes -= size;
+        mStats.dropped++;
+        pthread_mutex_unlock(&mLock);
+    }
+    return buf;
+}
+
+/*===========================================================================
+ * FUNCTION   : queueStaged
+ *
+ * DESCRIPTION: queue a dump of a buffer from getStagingBuffer. The writer
+ *              frees the buffer.
+ *
+ * PARAMETERS :
+ *   @name    : file path of the dump
+ *   @buf     : buffer from getStagingBuffer
+ *   @size    : size passed to getStagingBuffer
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraDumpWriter::queueStaged(const char *name, void *buf, uint32_t size)
+{
+    qcamera_dump_job_t *job = (qcamera_dump_job_t *)malloc(sizeof(qcamera_dump_job_t));
+    if (NULL == job) {
+        pthread_mutex_lock(&mLock);
+        mPendingJobs--;
+        mPendingBytes -= size;
+        mStats.dropped++;
+        pthread_mutex_unlock(&mLock);
+        free(buf);
+        return NO_MEMORY;
+    }
+    memset(job, 0, sizeof(qcamera_dump_job_t));
+    job->hdr.magic = QCAMERA_DUMP_MAGIC;
+    job->hdr.size = size;
+    strlcpy(job->hdr.name, name, sizeof(job->hdr.name));
+    job->planes[0].base = buf;
+    job->planes[0].width = size;
+    job->planes[0].stride = size;
+    job->planes[0].height = 1;
+    job->planecnt = 1;
+    job->release = freeStaging;
+    job->data = buf;
+    return submit(job);
+}
+
+/*===========================================================================
+ * FUNCTION   : submit
+ *
+ * DESCRIPTION: hand a reserved job to the writer thread
+ *
+ * PARAMETERS :
+ *   @job     : job to be written
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraDumpWriter::submit(qcamera_dump_job_t *job)
+{
+    if (!mDataQ.enqueue((void *)job)) {
+        ALOGE("%s: Error adding dump into queue", __func__);
+        pthread_mutex_lock(&mLock);
+        mStats.dropped++;
+        pthread_mutex_unlock(&mLock);
+        finishJob(job);
+        free(job);
+        return UNKNOWN_ERROR;
+    }
+    return mProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+}
+
+/*===========================================================================
+ * FUNCTION   : finishJob
+ *
+ * DESCRIPTION: release the data of a job and free its queue slot. The
+ *              job itself is freed by the caller.
+ *
+ * PARAMETERS :
+ *   @job     : written or dropped job
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::finishJob(qcamera_dump_job_t *job)
+{
+    if (job->release) {
+        job->release(job->data, job->cookie);
+    }
+    pthread_mutex_lock(&mLock);
+    mPendingJobs--;
+    mPendingBytes -= job->hdr.size;
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseJob
+ *
+ * DESCRIPTION: queue release callback for jobs flushed without writing,
+ *              the queue frees the job afterwards
+ *
+ * PARAMETERS :
+ *   @data      : job
+ *   @user_data : QCameraDumpWriter object
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::releaseJob(void *data, void *user_data)
+{
+    QCameraDumpWriter *pme = (QCameraDumpWriter *)user_data;
+    qcamera_dump_job_t *job = (qcamera_dump_job_t *)data;
+    if (NULL != pme && NULL != job) {
+        pthread_mutex_lock(&pme->mLock);
+        pme->mStats.dropped++;
+        pthread_mutex_unlock(&pme->mLock);
+        pme->finishJob(job);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : freeStaging
+ *
+ * DESCRIPTION: release function of staged dumps
+ *
+ * PARAMETERS :
+ *   @data    : staging buffer
+ *   @cookie  : unused
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::freeStaging(void *data, void */*cookie*/)
+{
+    free(data);
+}
+
+/*===========================================================================
+ * FUNCTION   : writeFull
+ *
+ * DESCRIPTION: writev that retries on short writes and EINTR. The iovec
+ *              array is consumed.
+ *
+ * PARAMETERS :
+ *   @fd      : file descriptor
+ *   @iov     : data to be written
+ *   @iovcnt  : number of entries in iov
+ *
+ * RETURN     : 0 on success, -1 on error
+ *==========================================================================*/
+int QCameraDumpWriter::writeFull(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t len = writev(fd, iov, iovcnt);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (iovcnt > 0 && (size_t)len >= iov->iov_len) {
+            len -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + len;
+            iov->iov_len -= len;
+        }
+    }
+    return 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : appendJob
+ *
+ * DESCRIPTION: add the rows of a job to an iovec array, writing the array
+ *              out whenever it is full. Planes without padding take one
+ *              entry.
+ *
+ * PARAMETERS :
+ *   @fd         : file descriptor
+ *   @job        : job to be written
+ *   @withHeader : write the container record header first
+ *   @iov        : array of QCAMERA_DUMP_IOV_CNT entries
+ *   @iovcnt     : [in/out] entries in use
+ *
+ * RETURN     : 0 on success, -1 on error
+ *==========================================================================*/
+int QCameraDumpWriter::appendJob(int fd, qcamera_dump_job_t *job,
+                                 bool withHeader,
+                                 struct iovec *iov, int &iovcnt)
+{
+    if (withHeader) {
+        iov[iovcnt].iov_base = &job->hdr;
+        iov[iovcnt].iov_len = sizeof(qcamera_dump_record_t);
+        iovcnt++;
+    }
+    for (int i = 0; i < job->planecnt; i++) {
+        const qcamera_dump_plane_t &plane = job->planes[i];
+        const uint8_t *row = (const uint8_t *)plane.base;
+        uint32_t rows = plane.height;
+        size_t len = plane.width;
+        if (plane.stride == plane.width) {
+            rows = 1;
+            len = (size_t)plane.width * plane.height;
+        }
+        for (uint32_t j = 0; j < rows; j++) {
+            if (iovcnt == QCAMERA_DUMP_IOV_CNT) {
+                if (writeFull(fd, iov, iovcnt) != 0) {
+                    return -1;
+                }
+                iovcnt = 0;
+            }
+            iov[iovcnt].iov_base = (void *)row;
+            iov[iovcnt].iov_len = len;
+            iovcnt++;
+            row += plane.stride;
+        }
+    }
+    return 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : writeBatch
+ *
+ * DESCRIPTION: write dequeued jobs, each to its own file unless a
+ *              container is set up
+ *
+ * PARAMETERS :
+ *   @jobs    : jobs to be written
+ *   @cnt     : number of jobs
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::writeBatch(qcamera_dump_job_t **jobs, int cnt)
+{
+    if (mContainerFd >= 0) {
+        writeContainer(jobs, cnt);
+        return;
+    }
+
+    for (int i = 0; i < cnt; i++) {
+        qcamera_dump_job_t *job = jobs[i];
+        bool written = false;
+        int fd = open(job->hdr.name, O_RDWR | O_CREAT, 0777);
+        if (fd >= 0) {
+            struct iovec iov[QCAMERA_DUMP_IOV_CNT];
+            int iovcnt = 0;
+            written = (appendJob(fd, job, false, iov, iovcnt) == 0 &&
+                       writeFull(fd, iov, iovcnt) == 0);
+            close(fd);
+        }
+        if (!written) {
+            ALOGE("%s: fail to write %s (%s)",
+                  __func__, job->hdr.name, strerror(errno));
+        }
+
+        pthread_mutex_lock(&mLock);
+        if (written) {
+            mStats.written++;
+            mStats.bytesWritten += job->hdr.size;
+        } else {
+            mStats.failed++;
+        }
+        pthread_mutex_unlock(&mLock);
+        finishJob(job);
+        free(job);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : writeContainer
+ *
+ * DESCRIPTION: append dequeued jobs to the container, with one writev
+ *              unless padded rows need more entries. Jobs that do not fit
+ *              the remaining space are dropped.
+ *
+ * PARAMETERS :
+ *   @jobs    : jobs to be written
+ *   @cnt     : number of jobs
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::writeContainer(qcamera_dump_job_t **jobs, int cnt)
+{
+    struct iovec iov[QCAMERA_DUMP_IOV_CNT];
+    bool fits[QCAMERA_DUMP_BATCH];
+    int iovcnt = 0;
+    uint64_t total = 0;
+    uint32_t dropped = 0;
+
+    for (int i = 0; i < cnt; i++) {
+        uint64_t len = sizeof(qcamera_dump_record_t) + jobs[i]->hdr.size;
+        fits[i] = (mContainerOffset + total + len <= mContainerSize);
+        if (!fits[i]) {
+            dropped++;
+            continue;
+        }
+        total += len;
+    }
+
+    bool written = true;
+    if (total > 0) {
+        written = (lseek(mContainerFd, mContainerOffset, SEEK_SET) >= 0);
+        for (int i = 0; written && i < cnt; i++) {
+            if (fits[i]) {
+                written = (appendJob(mContainerFd, jobs[i], true, iov, iovcnt) == 0);
+            }
+        }
+        if (written) {
+            written = (writeFull(mContainerFd, iov, iovcnt) == 0);
+        }
+        if (written) {
+            mContainerOffset += total;
+        } else {
+            ALOGE("%s: fail to write container (%s)", __func__, strerror(errno));
+        }
+    }
+
+    pthread_mutex_lock(&mLock);
+    mStats.dropped += dropped;
+    for (int i = 0; i < cnt; i++) {
+        if (!fits[i]) {
+            continue;
+        }
+        if (written) {
+            mStats.written++;
+            mStats.bytesWritten += jobs[i]->hdr.size;
+        } else {
+            mStats.failed++;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+
+    for (int i = 0; i < cnt; i++) {
+        finishJob(jobs[i]);
+        free(jobs[i]);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : dumpRoutine
+ *
+ * DESCRIPTION: writer thread, writes queued jobs in batches
+ *
+ * PARAMETERS :
+ *   @data    : QCameraDumpWriter object
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void *QCameraDumpWriter::dumpRoutine(void *data)
+{
+    int running = 1;
+    int ret;
+    QCameraDumpWriter *pme = (QCameraDumpWriter *)data;
+    QCameraCmdThread *cmdThread = &pme->mProcTh;
+    qcamera_dump_job_t *jobs[QCAMERA_DUMP_BATCH];
+
+    ALOGV("%s: E", __func__);
+    do {
+        do {
+            ret = cmdThread->waitCmd();
+            if (ret != 0 && errno != EINVAL) {
+                ALOGE("%s: waitCmd error (%s)",
+                           __func__, strerror(errno));
+                return NULL;
+            }
+        } while (ret != 0);
+
+        camera_cmd_type_t cmd = cmdThread->getCmd();
+        switch (cmd) {
+        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
+        case CAMERA_CMD_TYPE_EXIT:
+            {
+                // one command per job, but take whatever is queued
+                int cnt;
+                do {
+                    cnt = 0;
+                    while (cnt < QCAMERA_DUMP_BATCH) {
+                        jobs[cnt] = (qcamera_dump_job_t *)pme->mDataQ.dequeue();
+                        if (NULL == jobs[cnt]) {
+                            break;
+                        }
+                        cnt++;
+                    }
+                    if (cnt > 0) {
+                        pme->writeBatch(jobs, cnt);
+                    }
+                } while (cnt == QCAMERA_DUMP_BATCH);
+
+                if (cmd == CAMERA_CMD_TYPE_EXIT) {
+                    running = 0;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    } while (running);
+    ALOGV("%s: X", __func__);
+
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : dump
+ *
+ * DESCRIPTION: print dump writer statistics
+ *
+ * PARAMETERS :
+ *   @fd      : file descriptor to write to
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraDumpWriter::dump(int fd)
+{
+    pthread_mutex_lock(&mLock);
+    dprintf(fd, "QCameraDumpWriter:\n");
+    dprintf(fd, "  written %u (%llu bytes), dropped %u, failed %u\n",
+            mStats.written, (unsigned long long)mStats.bytesWritten,
+            mStats.dropped, mStats.failed);
+    dprintf(fd, "  pending %u jobs, %llu bytes, limits %u jobs, %llu bytes\n",
+            mPendingJobs, (unsigned long long)mPendingBytes,
+            mMaxJobs, (unsigned long long)mMaxBytes);
+    if (mContainerFd >= 0) {
+        dprintf(fd, "  container %llu of %llu bytes used\n",
+                (unsigned long long)mContainerOffset,
+                (unsigned long long)mContainerSize);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+}; // namespace qcamera
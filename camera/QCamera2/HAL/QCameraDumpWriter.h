@@ -0,0 +1,136 @@
+/* Copyright (c) 2014, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_DUMP_WRITER_H__
+#define __QCAMERA_DUMP_WRITER_H__
+
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "QCameraQueue.h"
+#include "QCameraCmdThread.h"
+
+namespace qcamera {
+
+#define QCAMERA_DUMP_MAX_PLANES   16
+#define QCAMERA_DUMP_NAME_LEN     120
+#define QCAMERA_DUMP_BATCH        8
+#define QCAMERA_DUMP_IOV_CNT      (QCAMERA_DUMP_BATCH * (QCAMERA_DUMP_MAX_PLANES + 1))
+#define QCAMERA_DUMP_MAGIC        0x504d4451 // "QDMP"
+#define QCAMERA_DUMP_CONTAINER_PATH "/data/misc/camera/dump_%d.bin"
+
+typedef void (*dump_release_fn)(void *data, void *cookie);
+
+// record header in the container file, followed by size payload bytes
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    char name[QCAMERA_DUMP_NAME_LEN];
+} qcamera_dump_record_t;
+
+// width bytes of each of height rows, stride bytes apart
+typedef struct {
+    const void *base;
+    uint32_t width;
+    uint32_t stride;
+    uint32_t height;
+} qcamera_dump_plane_t;
+
+typedef struct {
+    qcamera_dump_record_t hdr;       // hdr.name is the file path
+    qcamera_dump_plane_t planes[QCAMERA_DUMP_MAX_PLANES];
+    int planecnt;
+    dump_release_fn release;         // called once written or dropped
+    void *data;
+    void *cookie;
+} qcamera_dump_job_t;
+
+// Writes debug dumps from a background thread so that the stream
+// callback threads never block on file I/O. Jobs hold a reference to
+// their data until written; the release function returns it. Data is
+// given as strided planes, so stream buffers are written as they are,
+// without their padding. The queue is bounded in jobs and bytes, and
+// jobs over the bound are dropped and released at once. Up to
+// QCAMERA_DUMP_BATCH jobs are written per wakeup; with
+// persist.camera.dump.container.mb set they are appended to one
+// container file sized up front, otherwise each job goes to its own
+// file. Rows are gathered into writev calls of up to
+// QCAMERA_DUMP_IOV_CNT entries.
+class QCameraDumpWriter {
+public:
+    QCameraDumpWriter();
+    virtual ~QCameraDumpWriter();
+
+    int32_t init(int cameraId);
+    void deinit();
+
+    int32_t queueDump(const char *name,
+                      const qcamera_dump_plane_t *planes, int planecnt,
+                      dump_release_fn release, void *data, void *cookie);
+    void *getStagingBuffer(uint32_t size);
+    int32_t queueStaged(const char *name, void *buf, uint32_t size);
+    void dump(int fd);
+
+private:
+    struct QCameraDumpStats {
+        uint32_t written;
+        uint32_t dropped;               // queue full
+        uint32_t failed;                // open or write error
+        uint64_t bytesWritten;
+    };
+
+    static void *dumpRoutine(void *data);
+    static void releaseJob(void *data, void *user_data);
+    static void freeStaging(void *data, void *cookie);
+    static int writeFull(int fd, struct iovec *iov, int iovcnt);
+    static int appendJob(int fd, qcamera_dump_job_t *job, bool withHeader,
+                         struct iovec *iov, int &iovcnt);
+    bool reserveLocked(uint32_t size);
+    void writeBatch(qcamera_dump_job_t **jobs, int cnt);
+    void writeContainer(qcamera_dump_job_t **jobs, int cnt);
+    int32_t submit(qcamera_dump_job_t *job);
+    void finishJob(qcamera_dump_job_t *job);
+
+    QCameraQueue mDataQ;
+    QCameraCmdThread mProcTh;
+    pthread_mutex_t mLock;
+    bool mActive;
+    uint32_t mMaxJobs;
+    uint64_t mMaxBytes;
+    uint32_t mPendingJobs;              // queued or staged, not yet released
+    uint64_t mPendingBytes;
+    int mContainerFd;
+    uint64_t mContainerSize;
+    uint64_t mContainerOffset;
+    QCameraDumpStats mStats;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_DUMP_WRITER_H__ */
@@ -30,13 +30,18 @@
 #define LOG_TAG "QCameraHWI_Mem"
 
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <utils/Errors.h>
+#include <utils/Timers.h>
+#include <cutils/properties.h>
 #include <gralloc_priv.h>
 #include <QComOMXMetadata.h>
 #include "QCamera2HWI.h"
 #include "QCameraMem.h"
+#include "QCameraImgKernels.h"
 
 extern "C" {
 #include <mm_camera_interface.h>
@@ -419,8 +424,20 @@ void QCameraMemory::deallocOneBuffer(QCameraMemInfo &memInfo)
  * RETURN     : None
  *==========================================================================*/
 QCameraMemoryPool::QCameraMemoryPool()
+    : mBucketCnt(0),
+      mLruHead(NULL),
+      mLruTail(NULL),
+      mHighWaterMark(0)
 {
+    char value[PROPERTY_VALUE_MAX];
+
+    memset(mBuckets, 0, sizeof(mBuckets));
+    memset(&mStats, 0, sizeof(mStats));
+    memset(mUsage, 0, sizeof(mUsage));
     pthread_mutex_init(&mLock, NULL);
+
+    property_get("persist.camera.mem.pool.hwm", value, "0");
+    setHighWaterMark((uint32_t)atoi(value) * 1024 * 1024);
 }
 
 
@@ -439,6 +456,179 @@ QCameraMemoryPool::~QCameraMemoryPool()
     pthread_mutex_destroy(&mLock);
 }
 
+/*===========================================================================
+ * FUNCTION   : getSizeClass
+ *
+ * DESCRIPTION: size class of a buffer size, i.e. log2 of the size above
+ *              one page, clamped to the available classes
+ *
+ * PARAMETERS :
+ *   @size    : size of the buffer
+ *
+ * RETURN     : size class index
+ *==========================================================================*/
+int QCameraMemoryPool::getSizeClass(uint32_t size)
+{
+    int sizeClass = 0;
+
+    size >>= 12;
+    while (size > 1 && sizeClass < QCAMERA_POOL_SIZE_CLASSES - 1) {
+        size >>= 1;
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+/*===========================================================================
+ * FUNCTION   : getBucketLocked
+ *
+ * DESCRIPTION: find the bucket of cached buffers of one heap type
+ *
+ * PARAMETERS :
+ *   @heap_id : type of heap
+ *   @cached  : whether the buffers are cached
+ *   @create  : whether to add the bucket if it does not exist yet
+ *
+ * RETURN     : ptr to the bucket, NULL if not found
+ *==========================================================================*/
+QCameraMemoryPool::QCameraPoolBucket *QCameraMemoryPool::getBucketLocked(
+        int heap_id, bool cached, bool create)
+{
+    for (int i = 0; i < mBucketCnt; i++) {
+        if (mBuckets[i].heap_id == heap_id && mBuckets[i].cached == cached) {
+            return &mBuckets[i];
+        }
+    }
+
+    if (!create || mBucketCnt >= QCAMERA_POOL_MAX_HEAPS) {
+        return NULL;
+    }
+
+    QCameraPoolBucket *bucket = &mBuckets[mBucketCnt++];
+    memset(bucket, 0, sizeof(*bucket));
+    bucket->heap_id = heap_id;
+    bucket->cached = cached;
+    return bucket;
+}
+
+/*===========================================================================
+ * FUNCTION   : removeEntryLocked
+ *
+ * DESCRIPTION: take a cached buffer out of its size class and the LRU list
+ *
+ * PARAMETERS :
+ *   @entry   : entry of the cached buffer
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraMemoryPool::removeEntryLocked(QCameraPoolEntry *entry)
+{
+    QCameraPoolBucket *bucket = getBucketLocked(entry->memInfo.heap_id,
+                                                entry->memInfo.cached,
+                                                false);
+    if (bucket != NULL) {
+        QCameraPoolEntry **link =
+            &bucket->classes[getSizeClass(entry->memInfo.size)];
+        while (*link != NULL && *link != entry) {
+            link = &(*link)->next;
+        }
+        if (*link != NULL) {
+            *link = entry->next;
+        }
+    }
+
+    if (entry->lruPrev != NULL) {
+        entry->lruPrev->lruNext = entry->lruNext;
+    } else {
+        mLruHead = entry->lruNext;
+    }
+    if (entry->lruNext != NULL) {
+        entry->lruNext->lruPrev = entry->lruPrev;
+    } else {
+        mLruTail = entry->lruPrev;
+    }
+
+    mStats.bytesHeld -= entry->memInfo.size;
+}
+
+/*===========================================================================
+ * FUNCTION   : evictLocked
+ *
+ * DESCRIPTION: free least recently released buffers until the pool holds
+ *              no more than the given number of bytes
+ *
+ * PARAMETERS :
+ *   @limit   : bytes the pool may keep holding
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraMemoryPool::evictLocked(uint64_t limit)
+{
+    while (mLruHead != NULL && mStats.bytesHeld > limit) {
+        QCameraPoolEntry *entry = mLruHead;
+        removeEntryLocked(entry);
+        ALOGD("%s : Evicting buffer %lx size %d",
+                __func__, (unsigned long)entry->memInfo.handle,
+                entry->memInfo.size);
+        QCameraMemory::deallocOneBuffer(entry->memInfo);
+        delete entry;
+        mStats.evictions++;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : cacheBufferLocked
+ *
+ * DESCRIPTION: add a buffer to its size class and the LRU list, freeing
+ *              least recently released buffers above the high-water mark
+ *
+ * PARAMETERS :
+ *   @memInfo : reference to struct that stores additional memory allocation info
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraMemoryPool::cacheBufferLocked(
+        struct QCameraMemory::QCameraMemInfo &memInfo)
+{
+    QCameraPoolBucket *bucket = getBucketLocked(memInfo.heap_id,
+                                                memInfo.cached,
+                                                true);
+    QCameraPoolEntry *entry = NULL;
+    if (bucket != NULL) {
+        entry = new QCameraPoolEntry;
+    }
+    if (entry == NULL) {
+        ALOGE("%s : Cannot cache buffer %lx, freeing it",
+                __func__, (unsigned long)memInfo.handle);
+        QCameraMemory::deallocOneBuffer(memInfo);
+        return;
+    }
+
+    entry->memInfo = memInfo;
+
+    // keep the size class sorted by size for best fit lookup
+    QCameraPoolEntry **link = &bucket->classes[getSizeClass(memInfo.size)];
+    while (*link != NULL && (*link)->memInfo.size < memInfo.size) {
+        link = &(*link)->next;
+    }
+    entry->next = *link;
+    *link = entry;
+
+    entry->lruNext = NULL;
+    entry->lruPrev = mLruTail;
+    if (mLruTail != NULL) {
+        mLruTail->lruNext = entry;
+    } else {
+        mLruHead = entry;
+    }
+    mLruTail = entry;
+
+    mStats.bytesHeld += memInfo.size;
+    if (mHighWaterMark > 0) {
+        evictLocked(mHighWaterMark);
+    }
+}
+
 /*===========================================================================
  * FUNCTION   : releaseBuffer
  *
@@ -456,7 +646,10 @@ void QCameraMemoryPool::releaseBuffer(
 {
     pthread_mutex_lock(&mLock);
 
-    mPools[streamType].push_back(memInfo);
+    if (mUsage[streamType].outstanding > 0) {
+        mUsage[streamType].outstanding--;
+    }
+    cacheBufferLocked(memInfo);
 
     pthread_mutex_unlock(&mLock);
 }
@@ -474,22 +667,223 @@ void QCameraMemoryPool::clear()
 {
     pthread_mutex_lock(&mLock);
 
-    for (int i = CAM_STREAM_TYPE_DEFAULT; i < CAM_STREAM_TYPE_MAX; i++ ) {
-        List<struct QCameraMemory::QCameraMemInfo>::iterator it = mPools[i].begin();
-        for( ; it != mPools[i].end() ; it++) {
-            QCameraMemory::deallocOneBuffer(*it);
+    evictLocked(0);
+    mBucketCnt = 0;
+
+    ALOGD("%s : hits %u misses %u evictions %u wasted %llu bytes",
+            __func__, mStats.hits, mStats.misses, mStats.evictions,
+            (unsigned long long)mStats.bytesWasted);
+
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : setHighWaterMark
+ *
+ * DESCRIPTION: set the number of bytes above which least recently released
+ *              buffers are freed
+ *
+ * PARAMETERS :
+ *   @bytes   : high-water mark in bytes, 0 for no limit
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraMemoryPool::setHighWaterMark(uint32_t bytes)
+{
+    pthread_mutex_lock(&mLock);
+
+    mHighWaterMark = bytes;
+    if (mHighWaterMark > 0) {
+        evictLocked(mHighWaterMark);
+    }
+
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : dump
+ *
+ * DESCRIPTION: write pool statistics and cached buffers to a fd
+ *
+ * PARAMETERS :
+ *   @fd      : fd to write to
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraMemoryPool::dump(int fd)
+{
+    pthread_mutex_lock(&mLock);
+
+    dprintf(fd, "QCameraMemoryPool:\n");
+    dprintf(fd, "  hits %u misses %u evictions %u\n",
+            mStats.hits, mStats.misses, mStats.evictions);
+    dprintf(fd, "  bytes held %llu, high-water mark %llu, "
+            "bytes wasted by oversizing %llu\n",
+            (unsigned long long)mStats.bytesHeld,
+            (unsigned long long)mHighWaterMark,
+            (unsigned long long)mStats.bytesWasted);
+    for (int i = CAM_STREAM_TYPE_DEFAULT; i < CAM_STREAM_TYPE_MAX; i++) {
+        if (mStats.streamHits[i] || mStats.streamMisses[i]) {
+            dprintf(fd, "  stream type %d: hits %u misses %u\n",
+                    i, mStats.streamHits[i], mStats.streamMisses[i]);
+        }
+    }
+    for (int i = 0; i < mBucketCnt; i++) {
+        for (int j = 0; j < QCAMERA_POOL_SIZE_CLASSES; j++) {
+            int count = 0;
+            uint64_t bytes = 0;
+            for (QCameraPoolEntry *entry = mBuckets[i].classes[j];
+                    entry != NULL; entry = entry->next) {
+                count++;
+                bytes += entry->memInfo.size;
+            }
+            if (count > 0) {
+                dprintf(fd, "  heap 0x%x %s < %u KB: %d buffers, %llu bytes\n",
+                        mBuckets[i].heap_id,
+                        mBuckets[i].cached ? "cached" : "uncached",
+                        4U << (j + 1), count, (unsigned long long)bytes);
+            }
         }
+    }
+
+    pthread_mutex_unlock(&mLock);
+}
 
-        mPools[i].clear();
+/*===========================================================================
+ * FUNCTION   : saveUsage
+ *
+ * DESCRIPTION: persist the buffer set used by each stream type, for
+ *              prewarm() in the next session
+ *
+ * PARAMETERS :
+ *   @path    : file to write the usage to
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int QCameraMemoryPool::saveUsage(const char *path)
+{
+    QCameraPoolUsage usage[CAM_STREAM_TYPE_MAX];
+    int cnt = 0;
+
+    pthread_mutex_lock(&mLock);
+    memcpy(usage, mUsage, sizeof(usage));
+    pthread_mutex_unlock(&mLock);
+
+    for (int i = CAM_STREAM_TYPE_DEFAULT; i < CAM_STREAM_TYPE_MAX; i++) {
+        if (usage[i].peak > 0) {
+            cnt++;
+        }
+    }
+    if (cnt == 0) {
+        // keep the usage of the last session that streamed
+        return NAME_NOT_FOUND;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        ALOGE("%s : Cannot open %s: %s", __func__, path, strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+    for (int i = CAM_STREAM_TYPE_DEFAULT; i < CAM_STREAM_TYPE_MAX; i++) {
+        if (usage[i].peak > 0) {
+            fprintf(fp, "%d %d %u %d %u\n", i, usage[i].heap_id,
+                    usage[i].size, usage[i].cached ? 1 : 0, usage[i].peak);
+        }
     }
+    fclose(fp);
+
+    ALOGD("%s : Saved %d stream types to %s", __func__, cnt, path);
+    return NO_ERROR;
+}
 
+/*===========================================================================
+ * FUNCTION   : prewarm
+ *
+ * DESCRIPTION: allocate the buffer set saved by saveUsage() into the cache,
+ *              so that the streams of the next configuration hit the pool.
+ *              Only done with a high-water mark set, and stops at it.
+ *              Allocation is done outside the pool lock, so streams may
+ *              allocate concurrently.
+ *
+ * PARAMETERS :
+ *   @path    : file to read the usage from
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int QCameraMemoryPool::prewarm(const char *path)
+{
+    int streamType, heap_id, cached;
+    unsigned int size, count;
+    int bufCnt = 0;
+    uint64_t bytes = 0;
+    nsecs_t start = systemTime();
+
+    pthread_mutex_lock(&mLock);
+    bool unbounded = mHighWaterMark == 0;
     pthread_mutex_unlock(&mLock);
+    if (unbounded) {
+        ALOGD("%s : No high-water mark set, not prewarming", __func__);
+        return NO_INIT;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        ALOGD("%s : No usage saved in %s", __func__, path);
+        return NAME_NOT_FOUND;
+    }
+
+    while (fscanf(fp, "%d %d %u %d %u",
+                  &streamType, &heap_id, &size, &cached, &count) == 5) {
+        if (streamType < CAM_STREAM_TYPE_DEFAULT ||
+                streamType >= CAM_STREAM_TYPE_MAX ||
+                count > MM_CAMERA_MAX_NUM_FRAMES) {
+            ALOGE("%s : Invalid usage entry for stream type %d",
+                    __func__, streamType);
+            continue;
+        }
+
+        for (unsigned int i = 0; i < count; i++) {
+            struct QCameraMemory::QCameraMemInfo memInfo;
+            memset(&memInfo, 0, sizeof(memInfo));
+
+            pthread_mutex_lock(&mLock);
+            bool full = mHighWaterMark > 0 &&
+                        mStats.bytesHeld + size > mHighWaterMark;
+            pthread_mutex_unlock(&mLock);
+            if (full) {
+                break;
+            }
+
+            if (QCameraMemory::allocOneBuffer(memInfo, heap_id, size,
+                                              cached != 0) != OK) {
+                ALOGE("%s : Prewarm allocation failed", __func__);
+                break;
+            }
+
+            pthread_mutex_lock(&mLock);
+            cacheBufferLocked(memInfo);
+            pthread_mutex_unlock(&mLock);
+
+            bufCnt++;
+            bytes += size;
+        }
+    }
+
+    fclose(fp);
+    ALOGD("[KPI Perf] %s : %d buffers, %llu bytes in %lld ms",
+            __func__, bufCnt, (unsigned long long)bytes,
+            (long long)ns2ms(systemTime() - start));
+    return NO_ERROR;
 }
 
 /*===========================================================================
  * FUNCTION   : findBufferLocked
  *
- * DESCRIPTION: search for a appropriate cached buffer
+ * DESCRIPTION: search for the smallest cached buffer that fits
  *
  * PARAMETERS :
  *   @memInfo : reference to struct that stores additional memory allocation info
@@ -509,27 +903,51 @@ int QCameraMemoryPool::findBufferLocked(
         bool cached,
         cam_stream_type_t streamType)
 {
-    int rc = NAME_NOT_FOUND;
+    QCameraPoolBucket *bucket = getBucketLocked(heap_id, cached, false);
+    QCameraPoolEntry *found = NULL;
+
+    // buffers are allocated in whole pages
+    size = (size + 4095) & (~4095);
+
+    if (bucket != NULL) {
+        // size classes are sorted, so the first fit is the best fit
+        for (int i = getSizeClass(size);
+                i < QCAMERA_POOL_SIZE_CLASSES && found == NULL; i++) {
+            for (QCameraPoolEntry *entry = bucket->classes[i];
+                    entry != NULL; entry = entry->next) {
+                if (entry->memInfo.size >= size) {
+                    found = entry;
+                    break;
+                }
+            }
+        }
+    }
 
-    if (mPools[streamType].empty()) {
-        return NAME_NOT_FOUND;
+    if (found != NULL &&
+            (uint64_t)found->memInfo.size >
+            (uint64_t)size * QCAMERA_POOL_MAX_OVERSIZE) {
+        ALOGD("%s : Buffer %lx size %d too large for %d",
+                __func__, (unsigned long)found->memInfo.handle,
+                found->memInfo.size, size);
+        found = NULL;
     }
 
-    List<struct QCameraMemory::QCameraMemInfo>::iterator it = mPools[streamType].begin();
-    for( ; it != mPools[streamType].end() ; it++) {
-        if( ((*it).size >= size) &&
-            ((*it).heap_id == heap_id) &&
-            ((*it).cached == cached) ) {
-            memInfo = *it;
-            ALOGE("%s : Found buffer %lx size %d",
-                    __func__, (unsigned long)memInfo.handle, memInfo.size);
-            mPools[streamType].erase(it);
-            rc = NO_ERROR;
-            break;
-        }
+    if (found == NULL) {
+        mStats.misses++;
+        mStats.streamMisses[streamType]++;
+        return NAME_NOT_FOUND;
     }
 
-    return rc;
+    removeEntryLocked(found);
+    memInfo = found->memInfo;
+    delete found;
+
+    mStats.hits++;
+    mStats.streamHits[streamType]++;
+    mStats.bytesWasted += memInfo.size - size;
+    ALOGD("%s : Found buffer %lx size %d for %d",
+            __func__, (unsigned long)memInfo.handle, memInfo.size, size);
+    return NO_ERROR;
 }
 
 /*===========================================================================
@@ -562,10 +980,32 @@ int QCameraMemoryPool::allocateBuffer(
 
     rc = findBufferLocked(memInfo, heap_id, size, cached, streamType);
     if (NAME_NOT_FOUND == rc ) {
-        ALOGE("%s : Buffer not found!", __func__);
+        ALOGD("%s : Buffer not found!", __func__);
         rc = QCameraMemory::allocOneBuffer(memInfo, heap_id, size, cached);
     }
 
+    if (rc == NO_ERROR) {
+        // a stream type starting over with a new buffer set replaces the
+        // usage recorded for it
+        QCameraPoolUsage *usage = &mUsage[streamType];
+        uint32_t alignedSize = ((uint32_t)size + 4095) & (~4095);
+        if (usage->outstanding == 0 &&
+                (usage->size != alignedSize ||
+                 usage->heap_id != heap_id ||
+                 usage->cached != cached)) {
+            usage->heap_id = heap_id;
+            usage->size = alignedSize;
+            usage->cached = cached;
+            usage->peak = 0;
+        } else if (usage->size < alignedSize) {
+            usage->size = alignedSize;
+        }
+        usage->outstanding++;
+        if (usage->outstanding > usage->peak) {
+            usage->peak = usage->outstanding;
+        }
+    }
+
     pthread_mutex_unlock(&mLock);
 
     return rc;
@@ -1226,6 +1666,362 @@ int QCameraVideoMemory::getMatchBufIndex(const void *opaque,
     return index;
 }
 
+/*===========================================================================
+ * FUNCTION   : QCameraPreviewCbMemory
+ *
+ * DESCRIPTION: constructor of QCameraPreviewCbMemory
+ *
+ * PARAMETERS :
+ *   @getMemory : camera memory request ops table
+ *   @pool      : memory pool the ion buffers are taken from
+ *
+ * RETURN     : none
+ *==========================================================================*/
+QCameraPreviewCbMemory::QCameraPreviewCbMemory(camera_request_memory getMemory,
+        QCameraMemoryPool *pool)
+    :QCameraStreamMemory(getMemory, true, pool, CAM_STREAM_TYPE_DEFAULT),
+     mBufSize(0)
+{
+    memset(mRefCnt, 0, sizeof(mRefCnt));
+    memset(&mStats, 0, sizeof(mStats));
+    pthread_mutex_init(&mLock, NULL);
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraPreviewCbMemory
+ *
+ * DESCRIPTION: deconstructor of QCameraPreviewCbMemory
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+QCameraPreviewCbMemory::~QCameraPreviewCbMemory()
+{
+    pthread_mutex_destroy(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : allocate
+ *
+ * DESCRIPTION: allocate callback buffers. The camera memory handed to the
+ *              app covers exactly the packed frame, not the page aligned
+ *              ion buffer behind it.
+ *
+ * PARAMETERS :
+ *   @count   : number of buffers to be allocated
+ *   @size    : packed frame size in the app's preview format
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int QCameraPreviewCbMemory::allocate(int count, int size)
+{
+    int heap_mask = 0x1 << ION_IOMMU_HEAP_ID;
+    int rc = alloc(count, size, heap_mask);
+    if (rc < 0)
+        return rc;
+
+    for (int i = 0; i < count; i ++) {
+        mCameraMemory[i] = mGetMemory(mMemInfo[i].fd, size, 1, this);
+        if (!mCameraMemory[i] || !mCameraMemory[i]->data) {
+            ALOGE("%s: mapping of callback buffer %d failed", __func__, i);
+            for (int j = 0; j <= i; j ++) {
+                if (mCameraMemory[j]) {
+                    mCameraMemory[j]->release(mCameraMemory[j]);
+                    mCameraMemory[j] = NULL;
+                }
+            }
+            dealloc();
+            return NO_MEMORY;
+        }
+    }
+
+    pthread_mutex_lock(&mLock);
+    memset(mRefCnt, 0, sizeof(mRefCnt));
+    mBufferCount = count;
+    mBufSize = size;
+    pthread_mutex_unlock(&mLock);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : deallocate
+ *
+ * DESCRIPTION: deallocate callback buffers. Caller makes sure that none
+ *              of them is held by a pending callback, see isIdle().
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraPreviewCbMemory::deallocate()
+{
+    QCameraStreamMemory::deallocate();
+    mBufSize = 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : isIdle
+ *
+ * DESCRIPTION: query if no callback buffer is held by the app
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : true if all buffers are free
+ *==========================================================================*/
+bool QCameraPreviewCbMemory::isIdle()
+{
+    bool idle = true;
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < mBufferCount; i++) {
+        if (mRefCnt[i] != 0) {
+            idle = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+    return idle;
+}
+
+/*===========================================================================
+ * FUNCTION   : acquireBuffer
+ *
+ * DESCRIPTION: take a reference on a free callback buffer
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : index of the buffer
+ *              -1 if all buffers are held by the app
+ *==========================================================================*/
+int QCameraPreviewCbMemory::acquireBuffer()
+{
+    int index = -1;
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < mBufferCount; i++) {
+        if (mRefCnt[i] == 0) {
+            mRefCnt[i]++;
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        mStats.starved++;
+    }
+    pthread_mutex_unlock(&mLock);
+    return index;
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseBuffer
+ *
+ * DESCRIPTION: drop a reference taken by acquireBuffer
+ *
+ * PARAMETERS :
+ *   @index   : index of the buffer
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraPreviewCbMemory::releaseBuffer(int index)
+{
+    pthread_mutex_lock(&mLock);
+    if (index >= 0 && index < mBufferCount && mRefCnt[index] > 0) {
+        mRefCnt[index]--;
+    } else {
+        ALOGE("%s: invalid release of callback buffer %d", __func__, index);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseCallback
+ *
+ * DESCRIPTION: notifier release callback, returns a callback buffer once
+ *              the app is done with it
+ *
+ * PARAMETERS :
+ *   @data    : buffer index
+ *   @cookie  : QCameraPreviewCbMemory object
+ *   @cbStatus: callback status
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraPreviewCbMemory::releaseCallback(void *data,
+                                             void *cookie,
+                                             int32_t /*cbStatus*/)
+{
+    QCameraPreviewCbMemory *mem = (QCameraPreviewCbMemory *)cookie;
+    if (NULL != mem) {
+        mem->releaseBuffer((int)data);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : fillBuffer
+ *
+ * DESCRIPTION: pack a preview frame into a callback buffer, dropping the
+ *              stride and scanline padding of the stream buffer. YV12
+ *              rows keep the 16 byte alignment of the API layout. An NV12
+ *              frame going to an app that asked for NV21 gets its chroma
+ *              pairs swapped on the way.
+ *
+ * PARAMETERS :
+ *   @index   : index of the callback buffer
+ *   @src     : mapped preview frame
+ *   @offset  : plane layout of the preview frame
+ *   @fmt     : preview stream format
+ *   @cbFmt   : format the app expects in the callback
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int QCameraPreviewCbMemory::fillBuffer(int index, const void *src,
+        const cam_frame_len_offset_t &offset, cam_format_t fmt,
+        cam_format_t cbFmt)
+{
+    if (index < 0 || index >= mBufferCount || NULL == src) {
+        return BAD_VALUE;
+    }
+
+    uint8_t *dst = (uint8_t *)mCameraMemory[index]->data;
+    uint32_t planeStart = 0;
+    uint32_t written = 0;
+    for (int i = 0; i < offset.num_planes; i++) {
+        const cam_mp_len_offset_t &plane = offset.mp[i];
+        uint32_t dstStride = (fmt == CAM_FORMAT_YUV_420_YV12) ?
+                PAD_TO_SIZE(plane.width, 16) : plane.width;
+        if (written + dstStride * plane.height > (uint32_t)mBufSize) {
+            ALOGE("%s: frame does not fit callback buffer of %d bytes",
+                  __func__, mBufSize);
+            return BAD_VALUE;
+        }
+        const uint8_t *srcPlane =
+                (const uint8_t *)src + planeStart + plane.offset;
+        if (i == 1 && fmt == CAM_FORMAT_YUV_420_NV12 &&
+                cbFmt == CAM_FORMAT_YUV_420_NV21) {
+            QCameraImgKernels::swapUV(dst + written, dstStride,
+                    srcPlane, plane.stride, plane.width / 2, plane.height);
+        } else {
+            QCameraImgKernels::copyPlane(dst + written, dstStride,
+                    srcPlane, plane.stride, plane.width, plane.height);
+        }
+        written += dstStride * plane.height;
+        planeStart += plane.len;
+    }
+
+    pthread_mutex_lock(&mLock);
+    mStats.copies++;
+    mStats.windowCopies++;
+    mStats.bytesCopied += written;
+    updateRateLocked();
+    pthread_mutex_unlock(&mLock);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : countZeroCopy
+ *
+ * DESCRIPTION: account a preview callback served by lending the stream
+ *              buffer itself
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraPreviewCbMemory::countZeroCopy()
+{
+    pthread_mutex_lock(&mLock);
+    mStats.zeroCopies++;
+    mStats.windowZeroCopies++;
+    updateRateLocked();
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : updateRateLocked
+ *
+ * DESCRIPTION: close the current one second window of the copy counters.
+ *              Must be called with mLock held.
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraPreviewCbMemory::updateRateLocked()
+{
+    nsecs_t now = systemTime();
+    if (mStats.windowStart == 0) {
+        mStats.windowStart = now;
+        return;
+    }
+    nsecs_t diff = now - mStats.windowStart;
+    if (diff >= s2ns(1)) {
+        mStats.copiesPerSec = (mStats.windowCopies * float(s2ns(1))) / diff;
+        mStats.zeroCopiesPerSec =
+                (mStats.windowZeroCopies * float(s2ns(1))) / diff;
+        mStats.windowCopies = 0;
+        mStats.windowZeroCopies = 0;
+        mStats.windowStart = now;
+        mStats.rateUpdated = true;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getCopyRate
+ *
+ * DESCRIPTION: query the per second copy counters of the last full window
+ *
+ * PARAMETERS :
+ *   @copiesPerSec     : frames copied into callback buffers per second
+ *   @zeroCopiesPerSec : stream buffers lent to the app per second
+ *
+ * RETURN     : true if a new window completed since the last query
+ *==========================================================================*/
+bool QCameraPreviewCbMemory::getCopyRate(float &copiesPerSec,
+                                         float &zeroCopiesPerSec)
+{
+    pthread_mutex_lock(&mLock);
+    bool updated = mStats.rateUpdated;
+    copiesPerSec = mStats.copiesPerSec;
+    zeroCopiesPerSec = mStats.zeroCopiesPerSec;
+    mStats.rateUpdated = false;
+    pthread_mutex_unlock(&mLock);
+    return updated;
+}
+
+/*===========================================================================
+ * FUNCTION   : dump
+ *
+ * DESCRIPTION: print callback buffer statistics
+ *
+ * PARAMETERS :
+ *   @fd      : file descriptor to write to
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraPreviewCbMemory::dump(int fd)
+{
+    pthread_mutex_lock(&mLock);
+    int held = 0;
+    for (int i = 0; i < mBufferCount; i++) {
+        if (mRefCnt[i] != 0) {
+            held++;
+        }
+    }
+    dprintf(fd, "QCameraPreviewCbMemory:\n");
+    dprintf(fd, "  %d buffers of %d bytes, %d held by the app\n",
+            mBufferCount, mBufSize, held);
+    dprintf(fd, "  copies %llu (%.1f/s), %llu bytes, zero copies %llu (%.1f/s), "
+            "starved %llu\n",
+            (unsigned long long)mStats.copies, mStats.copiesPerSec,
+            (unsigned long long)mStats.bytesCopied,
+            (unsigned long long)mStats.zeroCopies, mStats.zeroCopiesPerSec,
+            (unsigned long long)mStats.starved);
+    pthread_mutex_unlock(&mLock);
+}
+
 /*===========================================================================
  * FUNCTION   : QCameraGrallocMemory
  *
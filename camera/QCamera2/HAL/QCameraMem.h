@@ -32,7 +32,7 @@
 
 #include <hardware/camera.h>
 #include <utils/Mutex.h>
-#include <utils/List.h>
+#include <utils/Timers.h>
 
 extern "C" {
 #include <sys/types.h>
@@ -101,6 +101,23 @@ protected:
     cam_stream_type_t mStreamType;
 };
 
+// Cache of released ion buffers, shared by the streams of one camera.
+// Buffers are bucketed per (heap_id, cached) into power of two size
+// classes kept sorted by size, so that a request is served by the
+// smallest cached buffer that fits (best fit), whatever stream type
+// released it. Buffers more than QCAMERA_POOL_MAX_OVERSIZE times the
+// requested size are not handed out. When the bytes held exceed the
+// high-water mark, least recently released buffers are freed first.
+//
+// The pool also tracks, per stream type, the peak number of buffers
+// outstanding and their size. saveUsage() persists that set when the
+// camera is closed, and prewarm() allocates it into the cache, up to the
+// high-water mark, ahead of the next session so that the first stream
+// configuration hits the pool.
+#define QCAMERA_POOL_SIZE_CLASSES 20
+#define QCAMERA_POOL_MAX_HEAPS    8
+#define QCAMERA_POOL_MAX_OVERSIZE 2
+
 class QCameraMemoryPool {
 
 public:
@@ -116,16 +133,62 @@ public:
     void releaseBuffer(struct QCameraMemory::QCameraMemInfo &memInfo,
                        cam_stream_type_t streamType);
     void clear();
+    void setHighWaterMark(uint32_t bytes);
+    void dump(int fd);
+    int saveUsage(const char *path);
+    int prewarm(const char *path);
 
 protected:
 
+    struct QCameraPoolEntry {
+        struct QCameraMemory::QCameraMemInfo memInfo;
+        QCameraPoolEntry *next;         // next larger in the size class
+        QCameraPoolEntry *lruPrev;      // released earlier
+        QCameraPoolEntry *lruNext;      // released later
+    };
+
+    struct QCameraPoolBucket {
+        int heap_id;
+        bool cached;
+        QCameraPoolEntry *classes[QCAMERA_POOL_SIZE_CLASSES];
+    };
+
+    struct QCameraPoolStats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t evictions;
+        uint64_t bytesHeld;
+        uint64_t bytesWasted;           // oversize handed out on hits
+        uint32_t streamHits[CAM_STREAM_TYPE_MAX];
+        uint32_t streamMisses[CAM_STREAM_TYPE_MAX];
+    };
+
+    struct QCameraPoolUsage {
+        int heap_id;
+        uint32_t size;                  // page aligned request size
+        bool cached;
+        uint32_t outstanding;           // buffers currently allocated
+        uint32_t peak;                  // most buffers allocated at once
+    };
+
     int findBufferLocked(struct QCameraMemory::QCameraMemInfo &memInfo,
                          int heap_id,
                          uint32_t size,
                          bool cached,
                          cam_stream_type_t streamType);
-
-    android::List<QCameraMemory::QCameraMemInfo> mPools[CAM_STREAM_TYPE_MAX];
+    QCameraPoolBucket *getBucketLocked(int heap_id, bool cached, bool create);
+    void removeEntryLocked(QCameraPoolEntry *entry);
+    void evictLocked(uint64_t limit);
+    void cacheBufferLocked(struct QCameraMemory::QCameraMemInfo &memInfo);
+    static int getSizeClass(uint32_t size);
+
+    QCameraPoolBucket mBuckets[QCAMERA_POOL_MAX_HEAPS];
+    int mBucketCnt;
+    QCameraPoolEntry *mLruHead;         // least recently released
+    QCameraPoolEntry *mLruTail;         // most recently released
+    uint64_t mHighWaterMark;            // 0 means no limit
+    QCameraPoolStats mStats;
+    QCameraPoolUsage mUsage[CAM_STREAM_TYPE_MAX];
     pthread_mutex_t mLock;
 };
 
@@ -191,6 +254,57 @@ private:
 };
 ;
 
+// Callback buffers for CAMERA_MSG_PREVIEW_FRAME when the preview stream
+// buffers belong to the display. A frame is packed into a free buffer
+// once, before it is queued to the display, and the buffer is held by
+// the callback until the notifier releases it. Stream buffers are never
+// handed to the app on this path.
+#define QCAMERA_PREVIEW_CB_BUF_CNT 4
+
+class QCameraPreviewCbMemory : public QCameraStreamMemory {
+public:
+    QCameraPreviewCbMemory(camera_request_memory getMemory,
+                           QCameraMemoryPool *pool = NULL);
+    virtual ~QCameraPreviewCbMemory();
+
+    virtual int allocate(int count, int size);
+    virtual void deallocate();
+
+    int getBufSize() const { return mBufSize; }
+    bool isIdle();
+    int acquireBuffer();
+    void releaseBuffer(int index);
+    int fillBuffer(int index, const void *src,
+                   const cam_frame_len_offset_t &offset, cam_format_t fmt,
+                   cam_format_t cbFmt);
+    void countZeroCopy();
+    bool getCopyRate(float &copiesPerSec, float &zeroCopiesPerSec);
+    void dump(int fd);
+
+    static void releaseCallback(void *data, void *cookie, int32_t cbStatus);
+
+private:
+    struct QCameraPreviewCbStats {
+        uint64_t copies;                // frames packed into a callback buffer
+        uint64_t zeroCopies;            // stream buffers lent to the app
+        uint64_t starved;               // callbacks skipped, all buffers held
+        uint64_t bytesCopied;
+        uint32_t windowCopies;
+        uint32_t windowZeroCopies;
+        nsecs_t windowStart;
+        float copiesPerSec;
+        float zeroCopiesPerSec;
+        bool rateUpdated;
+    };
+
+    void updateRateLocked();
+
+    int mBufSize;
+    uint8_t mRefCnt[MM_CAMERA_MAX_NUM_FRAMES];
+    QCameraPreviewCbStats mStats;
+    pthread_mutex_t mLock;
+};
+
 // Gralloc Memory is acquired from preview window
 class QCameraGrallocMemory : public QCameraMemory {
     enum {
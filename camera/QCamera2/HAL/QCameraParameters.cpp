@@ -39,6 +39,13 @@
 #include "QCameraParameters.h"
 
 #define ASPECT_TOLERANCE 0.001
+// persist.camera.param.diff default: 0 full update, 1 changed keys only,
+// 2 changed keys checked against the full update. The key checks cost
+// more than the setters they skip (QCameraParametersDiffTest), so the
+// full update is the default.
+#ifndef QCAMERA_PARAM_DIFF_DEFAULT
+#define QCAMERA_PARAM_DIFF_DEFAULT "0"
+#endif
 #define FLIP_V_H (FLIP_H | FLIP_V)
 
 namespace qcamera {
@@ -596,6 +603,93 @@ const QCameraParameters::QCameraMap QCameraParameters::CDS_MODES_MAP[] = {
     { CDS_MODE_AUTO, CAM_CDS_MODE_AUTO}
 };
 
+// Setters in the order updateParameters applies them. Setters that read
+// system properties or internal state are listed without keys and are
+// applied on every update.
+const QCameraParameters::QCameraParamSetter QCameraParameters::PARAM_SETTERS_MAP[] = {
+    { &QCameraParameters::setPreviewSize,          { KEY_PREVIEW_SIZE } },
+    { &QCameraParameters::setVideoSize,            { KEY_VIDEO_SIZE, KEY_PREVIEW_SIZE } },
+    { &QCameraParameters::setPictureSize,          { KEY_PICTURE_SIZE } },
+    { &QCameraParameters::setPreviewFormat,        { KEY_PREVIEW_FORMAT } },
+    { &QCameraParameters::setPictureFormat,        { KEY_PICTURE_FORMAT } },
+    { &QCameraParameters::setJpegThumbnailSize,    { KEY_JPEG_THUMBNAIL_WIDTH,
+                                                     KEY_JPEG_THUMBNAIL_HEIGHT } },
+    { &QCameraParameters::setJpegQuality,          { KEY_JPEG_QUALITY,
+                                                     KEY_JPEG_THUMBNAIL_QUALITY } },
+    { &QCameraParameters::setOrientation,          { KEY_QC_ORIENTATION } },
+    { &QCameraParameters::setRotation,             { KEY_ROTATION } },
+    { &QCameraParameters::setVideoRotation,        { KEY_QC_VIDEO_ROTATION } },
+    { &QCameraParameters::setNoDisplayMode,        { NULL } },
+    { &QCameraParameters::setZslMode,              { KEY_QC_ZSL } },
+    { &QCameraParameters::setZslAttributes,        { NULL } },
+    { &QCameraParameters::setCameraMode,           { KEY_QC_CAMERA_MODE } },
+    { &QCameraParameters::setRecordingHint,        { KEY_RECORDING_HINT } },
+
+    { &QCameraParameters::setPreviewFrameRate,     { KEY_PREVIEW_FRAME_RATE } },
+    { &QCameraParameters::setPreviewFpsRange,      { NULL } },
+    { &QCameraParameters::setAutoExposure,         { KEY_QC_AUTO_EXPOSURE } },
+    { &QCameraParameters::setEffect,               { NULL } },
+    { &QCameraParameters::setBrightness,           { KEY_QC_BRIGHTNESS } },
+    { &QCameraParameters::setZoom,                 { KEY_ZOOM } },
+    { &QCameraParameters::setSharpness,            { KEY_QC_SHARPNESS } },
+    { &QCameraParameters::setSaturation,           { KEY_QC_SATURATION } },
+    { &QCameraParameters::setContrast,             { KEY_QC_CONTRAST } },
+    { &QCameraParameters::setFocusMode,            { KEY_FOCUS_MODE, KEY_SCENE_MODE } },
+    { &QCameraParameters::setISOValue,             { KEY_QC_ISO_MODE } },
+    { &QCameraParameters::setExposureTime,         { KEY_QC_EXPOSURE_TIME } },
+    { &QCameraParameters::setSkinToneEnhancement,  { KEY_QC_SCE_FACTOR } },
+    { &QCameraParameters::setFlash,                { KEY_FLASH_MODE } },
+    { &QCameraParameters::setAecLock,              { KEY_AUTO_EXPOSURE_LOCK } },
+    { &QCameraParameters::setAwbLock,              { KEY_AUTO_WHITEBALANCE_LOCK } },
+    { &QCameraParameters::setLensShadeValue,       { KEY_QC_LENSSHADE } },
+    { &QCameraParameters::setMCEValue,             { KEY_QC_MEMORY_COLOR_ENHANCEMENT } },
+    { &QCameraParameters::setDISValue,             { KEY_QC_DIS } },
+    { &QCameraParameters::setAntibanding,          { KEY_ANTIBANDING } },
+    { &QCameraParameters::setExposureCompensation, { KEY_EXPOSURE_COMPENSATION } },
+    { &QCameraParameters::setWhiteBalance,         { KEY_WHITE_BALANCE } },
+    { &QCameraParameters::setWBManualCCT,          { KEY_WHITE_BALANCE, KEY_QC_WB_MANUAL_CCT } },
+    { &QCameraParameters::setSceneMode,            { KEY_SCENE_MODE } },
+    { &QCameraParameters::setFocusAreas,           { KEY_FOCUS_AREAS } },
+    { &QCameraParameters::setFocusPosition,        { KEY_FOCUS_MODE,
+                                                     KEY_QC_MANUAL_FOCUS_POSITION,
+                                                     KEY_QC_MANUAL_FOCUS_POS_TYPE } },
+    { &QCameraParameters::setMeteringAreas,        { KEY_METERING_AREAS } },
+    { &QCameraParameters::setSelectableZoneAf,     { KEY_QC_SELECTABLE_ZONE_AF } },
+    { &QCameraParameters::setRedeyeReduction,      { KEY_QC_REDEYE_REDUCTION } },
+    { &QCameraParameters::setAEBracket,            { NULL } },
+    { &QCameraParameters::setAutoHDR,              { NULL } },
+    { &QCameraParameters::setGpsLocation,          { KEY_GPS_PROCESSING_METHOD,
+                                                     KEY_GPS_LATITUDE,
+                                                     KEY_QC_GPS_LATITUDE_REF,
+                                                     KEY_GPS_LONGITUDE,
+                                                     KEY_QC_GPS_LONGITUDE_REF,
+                                                     KEY_QC_GPS_ALTITUDE_REF,
+                                                     KEY_GPS_ALTITUDE,
+                                                     KEY_QC_GPS_STATUS,
+                                                     KEY_GPS_TIMESTAMP } },
+    { &QCameraParameters::setWaveletDenoise,       { NULL } },
+    { &QCameraParameters::setFaceRecognition,      { KEY_QC_FACE_RECOGNITION,
+                                                     KEY_QC_MAX_NUM_REQUESTED_FACES } },
+    { &QCameraParameters::setFlip,                 { KEY_QC_PREVIEW_FLIP,
+                                                     KEY_QC_VIDEO_FLIP,
+                                                     KEY_QC_SNAPSHOT_PICTURE_FLIP } },
+    { &QCameraParameters::setVideoHDR,             { KEY_QC_VIDEO_HDR } },
+    { &QCameraParameters::setSnapshotHDR,          { NULL } },
+    { &QCameraParameters::setVtEnable,             { KEY_QC_VT_ENABLE } },
+    { &QCameraParameters::setBurstNum,             { NULL } },
+    { &QCameraParameters::setSnapshotFDReq,        { NULL } },
+    { &QCameraParameters::setTintlessValue,        { NULL } },
+    { &QCameraParameters::setCDSMode,              { NULL } },
+
+    // update live snapshot size after all other parameters are set
+    { &QCameraParameters::setLiveSnapshotSize,     { NULL } },
+    { &QCameraParameters::setStatsDebugMask,       { NULL } },
+    { &QCameraParameters::setMobicat,              { NULL } },
+    { &QCameraParameters::setAFBracket,            { KEY_QC_AF_BRACKET } },
+    { &QCameraParameters::setChromaFlash,          { KEY_QC_CHROMA_FLASH } },
+    { &QCameraParameters::setOptiZoom,             { KEY_QC_OPTI_ZOOM } }
+};
+
 #define DEFAULT_CAMERA_AREA "(0, 0, 0, 0, 0)"
 #define DATA_PTR(MEM_OBJ,INDEX) MEM_OBJ->getPtr( INDEX )
 #define MIN_PP_BUF_CNT 1
@@ -655,7 +749,10 @@ QCameraParameters::QCameraParameters()
       m_bOptiZoomOn(false),
       m_bHfrMode(false),
       mHfrMode(CAM_HFR_MODE_OFF),
-      m_bDisplayFrame(true)
+      m_bDisplayFrame(true),
+      m_bParamDiffEnabled(true),
+      m_bParamDiffVerify(false),
+      m_bLastParamsValid(false)
 {
     char value[PROPERTY_VALUE_MAX];
     // TODO: may move to parameter instead of sysprop
@@ -676,6 +773,11 @@ QCameraParameters::QCameraParameters()
         m_ThermalMode = QCAMERA_THERMAL_ADJUST_FPS;
     }
 
+    // apply only the setters whose keys changed since the last update
+    property_get("persist.camera.param.diff", value, QCAMERA_PARAM_DIFF_DEFAULT);
+    m_bParamDiffEnabled = atoi(value) > 0 ? true : false;
+    m_bParamDiffVerify = atoi(value) > 1 ? true : false;
+
     memset(&m_LiveSnapshotSize, 0, sizeof(m_LiveSnapshotSize));
     memset(&m_default_fps_range, 0, sizeof(m_default_fps_range));
     memset(&m_hfrFpsRange, 0, sizeof(m_hfrFpsRange));
@@ -730,7 +832,10 @@ QCameraParameters::QCameraParameters(const String8 &params)
     m_bChromaFlashOn(false),
     m_bOptiZoomOn(false),
     m_bHfrMode(false),
-    mHfrMode(CAM_HFR_MODE_OFF)
+    mHfrMode(CAM_HFR_MODE_OFF),
+    m_bParamDiffEnabled(false),
+    m_bParamDiffVerify(false),
+    m_bLastParamsValid(false)
 {
     memset(&m_LiveSnapshotSize, 0, sizeof(m_LiveSnapshotSize));
     m_pTorch = NULL;
@@ -2263,13 +2368,14 @@ int32_t QCameraParameters::setAntibanding(const QCameraParameters& params)
  * DESCRIPTION: get the value from persist file in Stats module that will
  *              control funtionality in the module
  *
- * PARAMETERS : none
+ * PARAMETERS :
+ *   @params  : user setting parameters, unused
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
  *              none-zero failure code
  *==========================================================================*/
-int32_t QCameraParameters::setStatsDebugMask()
+int32_t QCameraParameters::setStatsDebugMask(const QCameraParameters& )
 {
     uint32_t mask = 0;
     char value[PROPERTY_VALUE_MAX];
@@ -3649,86 +3755,140 @@ int32_t QCameraParameters::updateParameters(QCameraParameters& params,
 {
     int32_t final_rc = NO_ERROR;
     int32_t rc;
+    int skipped = 0;
+    int num_setters = sizeof(PARAM_SETTERS_MAP) / sizeof(QCameraParamSetter);
+    nsecs_t startTime = systemTime();
+    nsecs_t copyTime = 0;
     m_bNeedRestart = false;
 
     if(initBatchUpdate(m_pParamBuf) < 0 ) {
         ALOGE("%s:Failed to initialize group update table",__func__);
         rc = BAD_TYPE;
+        m_bLastParamsValid = false;
         goto UPDATE_PARAM_DONE;
     }
 
-    if ((rc = setPreviewSize(params)))                  final_rc = rc;
-    if ((rc = setVideoSize(params)))                    final_rc = rc;
-    if ((rc = setPictureSize(params)))                  final_rc = rc;
-    if ((rc = setPreviewFormat(params)))                final_rc = rc;
-    if ((rc = setPictureFormat(params)))                final_rc = rc;
-    if ((rc = setJpegThumbnailSize(params)))            final_rc = rc;
-    if ((rc = setJpegQuality(params)))                  final_rc = rc;
-    if ((rc = setOrientation(params)))                  final_rc = rc;
-    if ((rc = setRotation(params)))                     final_rc = rc;
-    if ((rc = setVideoRotation(params)))                final_rc = rc;
-    if ((rc = setNoDisplayMode(params)))                final_rc = rc;
-    if ((rc = setZslMode(params)))                      final_rc = rc;
-    if ((rc = setZslAttributes(params)))                final_rc = rc;
-    if ((rc = setCameraMode(params)))                   final_rc = rc;
-    if ((rc = setRecordingHint(params)))                final_rc = rc;
-
-    if ((rc = setPreviewFrameRate(params)))             final_rc = rc;
-    if ((rc = setPreviewFpsRange(params)))              final_rc = rc;
-    if ((rc = setAutoExposure(params)))                 final_rc = rc;
-    if ((rc = setEffect(params)))                       final_rc = rc;
-    if ((rc = setBrightness(params)))                   final_rc = rc;
-    if ((rc = setZoom(params)))                         final_rc = rc;
-    if ((rc = setSharpness(params)))                    final_rc = rc;
-    if ((rc = setSaturation(params)))                   final_rc = rc;
-    if ((rc = setContrast(params)))                     final_rc = rc;
-    if ((rc = setFocusMode(params)))                    final_rc = rc;
-    if ((rc = setISOValue(params)))                     final_rc = rc;
-    if ((rc = setExposureTime(params)))                 final_rc = rc;
-    if ((rc = setSkinToneEnhancement(params)))          final_rc = rc;
-    if ((rc = setFlash(params)))                        final_rc = rc;
-    if ((rc = setAecLock(params)))                      final_rc = rc;
-    if ((rc = setAwbLock(params)))                      final_rc = rc;
-    if ((rc = setLensShadeValue(params)))               final_rc = rc;
-    if ((rc = setMCEValue(params)))                     final_rc = rc;
-    if ((rc = setDISValue(params)))                     final_rc = rc;
-    if ((rc = setAntibanding(params)))                  final_rc = rc;
-    if ((rc = setExposureCompensation(params)))         final_rc = rc;
-    if ((rc = setWhiteBalance(params)))                 final_rc = rc;
-    if ((rc = setWBManualCCT(params)))                  final_rc = rc;
-    if ((rc = setSceneMode(params)))                    final_rc = rc;
-    if ((rc = setFocusAreas(params)))                   final_rc = rc;
-    if ((rc = setFocusPosition(params)))                final_rc = rc;
-    if ((rc = setMeteringAreas(params)))                final_rc = rc;
-    if ((rc = setSelectableZoneAf(params)))             final_rc = rc;
-    if ((rc = setRedeyeReduction(params)))              final_rc = rc;
-    if ((rc = setAEBracket(params)))                    final_rc = rc;
-    if ((rc = setAutoHDR(params)))                      final_rc = rc;
-    if ((rc = setGpsLocation(params)))                  final_rc = rc;
-    if ((rc = setWaveletDenoise(params)))               final_rc = rc;
-    if ((rc = setFaceRecognition(params)))              final_rc = rc;
-    if ((rc = setFlip(params)))                         final_rc = rc;
-    if ((rc = setVideoHDR(params)))                     final_rc = rc;
-    if ((rc = setSnapshotHDR(params)))                     final_rc = rc;
-    if ((rc = setVtEnable(params)))                     final_rc = rc;
-    if ((rc = setBurstNum(params)))                     final_rc = rc;
-    if ((rc = setSnapshotFDReq(params)))                final_rc = rc;
-    if ((rc = setTintlessValue(params)))                final_rc = rc;
-    if ((rc = setCDSMode(params)))                      final_rc = rc;
+    for (int i = 0; i < num_setters; i++) {
+        if (!isParamSetterDirty(params, i)) {
+            skipped++;
+            if (m_bParamDiffVerify) {
+                // run it anyway, the batch must come out the same
+                if ((rc = verifyParamSetterSkip(params, i))) final_rc = rc;
+            }
+            continue;
+        }
+        if ((rc = (this->*PARAM_SETTERS_MAP[i].setter)(params))) final_rc = rc;
+    }
 
-    // update live snapshot size after all other parameters are set
-    if ((rc = setLiveSnapshotSize(params)))             final_rc = rc;
-    if ((rc = setStatsDebugMask()))                     final_rc = rc;
-    if ((rc = setMobicat(params)))                      final_rc = rc;
-    if ((rc = setAFBracket(params)))                    final_rc = rc;
-    if ((rc = setChromaFlash(params)))                  final_rc = rc;
-    if ((rc = setOptiZoom(params)))                     final_rc = rc;
+    // only a set applied without error can serve as base for the next diff,
+    // otherwise the failing setters are re-run on the next update
+    if (m_bParamDiffEnabled && final_rc == NO_ERROR) {
+        nsecs_t copyStart = systemTime();
+        m_lastParams = params;
+        copyTime = systemTime() - copyStart;
+        m_bLastParamsValid = true;
+    } else {
+        m_bLastParamsValid = false;
+    }
+    ALOGV("%s: skipped %d of %d setters in %lld us, params copy %lld us",
+          __func__, skipped, num_setters,
+          (long long)ns2us(systemTime() - startTime),
+          (long long)ns2us(copyTime));
 
 UPDATE_PARAM_DONE:
     needRestart = m_bNeedRestart;
     return final_rc;
 }
 
+/*===========================================================================
+ * FUNCTION   : isParamSetterDirty
+ *
+ * DESCRIPTION: check if a setter of updateParameters needs to be applied.
+ *              A setter is skipped only if none of its keys differs from
+ *              the applied parameters or from the last set applied without
+ *              error, in which case applying it would be a no-op.
+ *
+ * PARAMETERS :
+ *   @params  : user setting parameters
+ *   @index   : index of the setter in PARAM_SETTERS_MAP
+ *
+ * RETURN     : true  -- setter needs to be applied
+ *              false -- setter can be skipped
+ *==========================================================================*/
+bool QCameraParameters::isParamSetterDirty(const QCameraParameters& params, int index)
+{
+    const char *const *keys = PARAM_SETTERS_MAP[index].keys;
+
+    if (!m_bLastParamsValid || keys[0] == NULL) {
+        return true;
+    }
+
+    for (int i = 0; i < QCAMERA_PARAM_SETTER_MAX_KEYS && keys[i] != NULL; i++) {
+        const char *str = params.get(keys[i]);
+        const char *cur_str = get(keys[i]);
+        const char *last_str = m_lastParams.get(keys[i]);
+
+        if (str == NULL) {
+            if (cur_str != NULL || last_str != NULL) {
+                return true;
+            }
+        } else if (cur_str == NULL || strcmp(str, cur_str) != 0 ||
+                   last_str == NULL || strcmp(str, last_str) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*===========================================================================
+ * FUNCTION   : verifyParamSetterSkip
+ *
+ * DESCRIPTION: debug check of the changed keys path. Applies a setter that
+ *              isParamSetterDirty would skip and makes sure it leaves the
+ *              batch, the parameters and the restart flag untouched, which
+ *              means both paths send the same batch. A setter that changes
+ *              anything is missing a key in PARAM_SETTERS_MAP.
+ *
+ * PARAMETERS :
+ *   @params  : user setting parameters
+ *   @index   : index of the setter in PARAM_SETTERS_MAP
+ *
+ * RETURN     : int32_t type of status of the setter
+ *==========================================================================*/
+int32_t QCameraParameters::verifyParamSetterSkip(const QCameraParameters& params,
+                                                 int index)
+{
+    parm_buffer_new_t *param_buf = (parm_buffer_new_t *)m_pParamBuf;
+    uint32_t num_entry = param_buf->num_entry;
+    uint32_t curr_size = param_buf->curr_size;
+    bool needRestart = m_bNeedRestart;
+    String8 flattened = flatten();
+    char *entries = NULL;
+
+    if (curr_size > 0) {
+        entries = (char *)malloc(curr_size);
+        if (entries == NULL) {
+            ALOGE("%s: no mem to verify setter %d", __func__, index);
+            return (this->*PARAM_SETTERS_MAP[index].setter)(params);
+        }
+        memcpy(entries, &param_buf->entry[0], curr_size);
+    }
+
+    int32_t rc = (this->*PARAM_SETTERS_MAP[index].setter)(params);
+
+    if (param_buf->num_entry != num_entry ||
+        param_buf->curr_size != curr_size ||
+        (curr_size > 0 && memcmp(entries, &param_buf->entry[0], curr_size) != 0)) {
+        ALOGE("%s: setter %d skipped but changed the batch", __func__, index);
+    } else if (m_bNeedRestart != needRestart) {
+        ALOGE("%s: setter %d skipped but needs restart", __func__, index);
+    } else if (flattened != flatten()) {
+        ALOGE("%s: setter %d skipped but changed parameters", __func__, index);
+    }
+    free(entries);
+    return rc;
+}
+
 /*===========================================================================
  * FUNCTION   : commitParameters
  *
@@ -4377,6 +4537,7 @@ int32_t QCameraParameters::init(cam_capability_t *capabilities,
 
     initDefaultParameters();
 
+    m_bLastParamsValid = false;
     m_bInited = true;
 
     goto TRANS_INIT_DONE;
@@ -4430,6 +4591,7 @@ void QCameraParameters::deinit()
     m_AdjustFPS = NULL;
 
     m_tempMap.clear();
+    m_bLastParamsValid = false;
 
     m_bInited = false;
 }
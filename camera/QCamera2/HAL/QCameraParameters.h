@@ -43,6 +43,7 @@ static const char ExifUndefinedPrefix[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 #define GPS_PROCESSING_METHOD_SIZE       101
 #define EXIF_ASCII_PREFIX_SIZE           8   //(sizeof(ExifAsciiPrefix))
 #define FOCAL_LENGTH_DECIMAL_PRECISION   1000
+#define QCAMERA_PARAM_SETTER_MAX_KEYS    10
 
 class QCameraTorchInterface
 {
@@ -668,11 +669,13 @@ private:
     int32_t setFlip(const QCameraParameters& );
     int32_t setBurstNum(const QCameraParameters& params);
     int32_t setSnapshotFDReq(const QCameraParameters& );
-    int32_t setStatsDebugMask();
+    int32_t setStatsDebugMask(const QCameraParameters& );
     int32_t setTintlessValue(const QCameraParameters& params);
     int32_t setCDSMode(const QCameraParameters& params);
     int32_t setMobicat(const QCameraParameters& params);
     bool UpdateHFRFrameRate(const QCameraParameters& params);
+    bool isParamSetterDirty(const QCameraParameters& params, int index);
+    int32_t verifyParamSetterSkip(const QCameraParameters& params, int index);
 
     int32_t setAutoExposure(const char *autoExp);
     int32_t setPreviewFpsRange(int min_fps,int max_fps,
@@ -783,6 +786,15 @@ private:
     static const QCameraMap OPTI_ZOOM_MODES_MAP[];
     static const QCameraMap CDS_MODES_MAP[];
 
+    // setter applied by updateParameters and the keys it depends on;
+    // an empty key list means the setter is applied on every update
+    typedef int32_t (QCameraParameters::*param_setter_t)(const QCameraParameters& );
+    typedef struct {
+        param_setter_t setter;
+        const char *keys[QCAMERA_PARAM_SETTER_MAX_KEYS];
+    } QCameraParamSetter;
+    static const QCameraParamSetter PARAM_SETTERS_MAP[];
+
     cam_capability_t *m_pCapability;
     mm_camera_vtbl_t *m_pCamOpsTbl;
     QCameraHeapMemory *m_pParamHeap;
@@ -838,6 +850,10 @@ private:
     bool m_bHfrMode;
     int32_t mHfrMode;
     bool m_bDisplayFrame;
+    bool m_bParamDiffEnabled;         // apply only setters whose keys changed
+    bool m_bParamDiffVerify;          // check skipped setters are no-ops
+    bool m_bLastParamsValid;          // if m_lastParams holds a fully applied set
+    CameraParameters m_lastParams;    // last parameters applied without error
 };
 
 }; // namespace qcamera
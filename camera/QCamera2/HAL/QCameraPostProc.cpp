@@ -84,6 +84,8 @@ QCameraPostProcessor::QCameraPostProcessor(QCamera2HardwareInterface *cam_ctrl)
 {
     memset(&mJpegHandle, 0, sizeof(mJpegHandle));
     memset(&m_pJpegOutputMem, 0, sizeof(m_pJpegOutputMem));
+    memset(&m_jpegTrace, 0, sizeof(m_jpegTrace));
+    pthread_mutex_init(&m_jpegTraceLock, NULL);
 }
 
 /*===========================================================================
@@ -107,6 +109,7 @@ QCameraPostProcessor::~QCameraPostProcessor()
         delete m_pReprocChannel;
         m_pReprocChannel = NULL;
     }
+    pthread_mutex_destroy(&m_jpegTraceLock);
 }
 
 /*===========================================================================
@@ -626,6 +629,11 @@ int32_t QCameraPostProcessor::processData(mm_camera_super_buf_t *frame)
         return UNKNOWN_ERROR;
     }
 
+    if (NULL != frame && frame->num_bufs > 0 && NULL != frame->bufs[0]) {
+        mm_camera_trace_stamp(CAM_TRACE_POSTPROC_INPUT,
+                              frame->bufs[0]->stream_id, frame->bufs[0]->frame_idx);
+    }
+
     if (m_parent->needReprocess()) {
         if ((!m_parent->isLongshotEnabled() &&
              !m_parent->m_stateMachine.isNonZSLCaptureRunning()) ||
@@ -1450,6 +1458,7 @@ int32_t QCameraPostProcessor::encodeData(qcamera_jpeg_data_t *jpeg_job_data,
     cam_rect_t crop;
     cam_stream_parm_buffer_t param;
     cam_stream_img_prop_t imgProp;
+    uint8_t traced = FALSE;
 
     // find channel
     QCameraChannel *pChannel = m_parent->getChannelByHandle(recvd_frame->ch_id);
@@ -1708,11 +1717,33 @@ int32_t QCameraPostProcessor::encodeData(qcamera_jpeg_data_t *jpeg_job_data,
     }
 
     ALOGE("[KPI Perf] %s : PROFILE_JPEG_JOB_START", __func__);
+    traced = mm_camera_trace_enabled();
+    if (traced) {
+        // held over start_job so that the jpeg callback finds the job
+        pthread_mutex_lock(&m_jpegTraceLock);
+        mm_camera_trace_stamp(CAM_TRACE_JPEG_START,
+                              main_frame->stream_id, main_frame->frame_idx);
+    }
     ret = mJpegHandle.start_job(&jpg_job, &jobId);
     if (ret == NO_ERROR) {
         // remember job info
         jpeg_job_data->jobId = jobId;
     }
+    if (traced) {
+        if (ret == NO_ERROR) {
+            qcamera_jpeg_trace_t *entry = &m_jpegTrace[jobId % MAX_JPEG_TRACE_JOBS];
+            for (int i = 0; i < MAX_JPEG_TRACE_JOBS; i++) {
+                if (m_jpegTrace[i].jobId == 0) {
+                    entry = &m_jpegTrace[i];
+                    break;
+                }
+            }
+            entry->jobId = jobId;
+            entry->stream_id = main_frame->stream_id;
+            entry->frame_idx = main_frame->frame_idx;
+        }
+        pthread_mutex_unlock(&m_jpegTraceLock);
+    }
 
     return ret;
 }
@@ -1869,9 +1900,9 @@ void *QCameraPostProcessor::dataSaveRoutine(void *data)
     ALOGV("%s: E", __func__);
     do {
         do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            ret = cmdThread->waitCmd();
             if (ret != 0 && errno != EINVAL) {
-                ALOGE("%s: cam_sem_wait error (%s)",
+                ALOGE("%s: waitCmd error (%s)",
                            __func__, strerror(errno));
                 return NULL;
             }
@@ -1893,7 +1924,7 @@ void *QCameraPostProcessor::dataSaveRoutine(void *data)
                 pme->m_inputSaveQ.flush();
 
                 // signal cmd is completed
-                cam_sem_post(&cmdThread->sync_sem);
+                cmdThread->signalSync();
             }
             break;
         case CAMERA_CMD_TYPE_DO_NEXT_JOB:
@@ -2000,9 +2031,9 @@ void *QCameraPostProcessor::dataProcessRoutine(void *data)
     ALOGV("%s: E", __func__);
     do {
         do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            ret = cmdThread->waitCmd();
             if (ret != 0 && errno != EINVAL) {
-                ALOGE("%s: cam_sem_wait error (%s)",
+                ALOGE("%s: waitCmd error (%s)",
                            __func__, strerror(errno));
                 return NULL;
             }
@@ -2073,7 +2104,7 @@ void *QCameraPostProcessor::dataProcessRoutine(void *data)
                 pme->m_inputRawQ.flush();
 
                 // signal cmd is completed
-                cam_sem_post(&cmdThread->sync_sem);
+                cmdThread->signalSync();
 
                 pme->mNewJpegSessionNeeded = true;
             }
@@ -2338,6 +2369,36 @@ bool QCameraPostProcessor::matchJobId(void *data, void *, void *match_data)
   return job->jobId == job_id;
 }
 
+/*===========================================================================
+ * FUNCTION   : traceJpegDone
+ *
+ * DESCRIPTION: stamp the end of a jpeg job for the frame it encoded, called
+ *              from the jpeg completion callback
+ *
+ * PARAMETERS :
+ *   @jobId   : job Id of the finished job
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraPostProcessor::traceJpegDone(uint32_t jobId)
+{
+    if (!mm_camera_trace_enabled() || jobId == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_jpegTraceLock);
+    for (int i = 0; i < MAX_JPEG_TRACE_JOBS; i++) {
+        if (m_jpegTrace[i].jobId == jobId) {
+            mm_camera_trace_stamp(CAM_TRACE_JPEG_DONE,
+                                  m_jpegTrace[i].stream_id,
+                                  m_jpegTrace[i].frame_idx);
+            m_jpegTrace[i].jobId = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_jpegTraceLock);
+}
+
 /*===========================================================================
  * FUNCTION   : getJpegMemory
  *
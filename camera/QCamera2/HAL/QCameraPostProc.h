@@ -37,6 +37,7 @@ extern "C" {
 #include "QCamera2HWI.h"
 
 #define MAX_JPEG_BURST 2
+#define MAX_JPEG_TRACE_JOBS 8
 
 namespace qcamera {
 
@@ -59,6 +60,12 @@ typedef struct {
     mm_camera_super_buf_t *src_frame;// source frame (need to be returned back to kernel after done)
 } qcamera_pp_data_t;
 
+typedef struct {
+    uint32_t jobId;                  // jpeg job ID, 0 if the entry is free
+    uint32_t stream_id;              // stream handle of the encoded frame
+    uint32_t frame_idx;              // frame sequence number of the encoded frame
+} qcamera_jpeg_trace_t;
+
 typedef struct {
     mm_camera_super_buf_t *frame;    // source frame that needs post process
 } qcamera_pp_request_t;
@@ -122,6 +129,7 @@ public:
     bool getMultipleStages() { return mMultipleStages; };
     void setMultipleStages(bool stages) { mMultipleStages = stages; };
     inline bool getJpegMemOpt() {return mJpegMemOpt;}
+    void traceJpegDone(uint32_t jobId);
 
 private:
     int32_t sendDataNotify(int32_t msg_type,
@@ -196,6 +204,8 @@ private:
     uint8_t mNewJpegSessionNeeded;
     bool mMultipleStages;               // multiple stages are present
     uint32_t   m_JpegOutputMemCount;
+    qcamera_jpeg_trace_t m_jpegTrace[MAX_JPEG_TRACE_JOBS]; // frames of traced jpeg jobs
+    pthread_mutex_t m_jpegTraceLock;
 };
 
 }; // namespace qcamera
@@ -354,6 +354,7 @@ int32_t QCameraStateMachine::procEvtPreviewStoppedState(qcamera_sm_evt_enum_t ev
             rc = m_parent->updateParameters((char*)payload, needRestart);
             if (needRestart) {
                 // Clear memory pools
+                m_parent->waitDefferedWork(m_parent->mPrewarmJob);
                 m_parent->m_memoryPool.clear();
             }
             if (rc == NO_ERROR) {
@@ -675,6 +676,7 @@ int32_t QCameraStateMachine::procEvtPreviewReadyState(qcamera_sm_evt_enum_t evt,
                     // need restart preview for parameters to take effect
                     m_parent->unpreparePreview();
                     // Clear memory pools
+                    m_parent->waitDefferedWork(m_parent->mPrewarmJob);
                     m_parent->m_memoryPool.clear();
                     // commit parameter changes to server
                     m_parent->commitParameterChanges();
@@ -960,6 +962,7 @@ int32_t QCameraStateMachine::procEvtPreviewingState(qcamera_sm_evt_enum_t evt,
                     // stop preview
                     m_parent->stopPreview();
                     // Clear memory pools
+                    m_parent->waitDefferedWork(m_parent->mPrewarmJob);
                     m_parent->m_memoryPool.clear();
                     // commit parameter changes to server
                     m_parent->commitParameterChanges();
@@ -2533,6 +2536,7 @@ int32_t QCameraStateMachine::procEvtPreviewPicTakingState(qcamera_sm_evt_enum_t
                     // stop preview
                     m_parent->stopPreview();
                     // Clear memory pools
+                    m_parent->waitDefferedWork(m_parent->mPrewarmJob);
                     m_parent->m_memoryPool.clear();
                     // commit parameter changes to server
                     m_parent->commitParameterChanges();
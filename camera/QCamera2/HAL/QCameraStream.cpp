@@ -234,7 +234,7 @@ QCameraStream::QCameraStream(QCameraAllocator &allocator,
         mNumBufsNeedAlloc(0),
         mDataCB(NULL),
         mUserData(NULL),
-        mDataQ(releaseFrameData, this),
+        mDataQ(releaseFrameData, this, MM_CAMERA_MAX_NUM_FRAMES),
         mStreamInfoBuf(NULL),
         mStreamBufs(NULL),
         mAllocator(allocator),
@@ -243,6 +243,7 @@ QCameraStream::QCameraStream(QCameraAllocator &allocator,
         m_bActive(false),
         mDynBufAlloc(false),
         mBufAllocPid(0),
+        mDumpBufs(0),
         mDefferedAllocation(deffered),
         wait_for_cond(false)
 {
@@ -264,6 +265,8 @@ QCameraStream::QCameraStream(QCameraAllocator &allocator,
     memset(&m_ImgProp, 0, sizeof(cam_stream_parm_buffer_t));
     pthread_mutex_init(&mCropLock, NULL);
     pthread_mutex_init(&mParameterLock, NULL);
+    pthread_mutex_init(&mDumpLock, NULL);
+    pthread_cond_init(&mDumpCond, NULL);
 }
 
 /*===========================================================================
@@ -279,6 +282,8 @@ QCameraStream::~QCameraStream()
 {
     pthread_mutex_destroy(&mCropLock);
     pthread_mutex_destroy(&mParameterLock);
+    pthread_mutex_destroy(&mDumpLock);
+    pthread_cond_destroy(&mDumpCond);
 
     if (mDefferedAllocation) {
         mStreamBufsAcquired = false;
@@ -542,7 +547,8 @@ int32_t QCameraStream::start()
 /*===========================================================================
  * FUNCTION   : stop
  *
- * DESCRIPTION: stop stream. Will stop main stream thread
+ * DESCRIPTION: stop stream. Will stop main stream thread, and wait for
+ *              the buffers held by the dump writer to come back
  *
  * PARAMETERS : none
  *
@@ -555,9 +561,64 @@ int32_t QCameraStream::stop()
     int32_t rc = 0;
     m_bActive = false;
     rc = mProcTh.exit();
+
+    // the stream is still on, so the writer can return them with qbuf
+    pthread_mutex_lock(&mDumpLock);
+    while (mDumpBufs > 0) {
+        ALOGD("%s: wait for %d buffers held by dumps", __func__, mDumpBufs);
+        pthread_cond_wait(&mDumpCond, &mDumpLock);
+    }
+    pthread_mutex_unlock(&mDumpLock);
     return rc;
 }
 
+/*===========================================================================
+ * FUNCTION   : holdDumpBuf
+ *
+ * DESCRIPTION: count a stream buffer lent to the dump writer. The writer
+ *              hands it back through releaseDumpBuf.
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraStream::holdDumpBuf()
+{
+    pthread_mutex_lock(&mDumpLock);
+    mDumpBufs++;
+    pthread_mutex_unlock(&mDumpLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseDumpBuf
+ *
+ * DESCRIPTION: dump writer release function of a stream buffer, returns
+ *              the buffer to kernel once it is written or dropped
+ *
+ * PARAMETERS :
+ *   @data    : buffer index
+ *   @cookie  : stream object
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraStream::releaseDumpBuf(void *data, void *cookie)
+{
+    QCameraStream *pme = (QCameraStream *)cookie;
+    if (NULL == pme) {
+        return;
+    }
+
+    int32_t rc = pme->bufDone((int)(intptr_t)data);
+    if (rc != NO_ERROR) {
+        ALOGE("%s: bufDone of dumped buffer %d failed %d",
+              __func__, (int)(intptr_t)data, rc);
+    }
+    pthread_mutex_lock(&pme->mDumpLock);
+    pme->mDumpBufs--;
+    pthread_cond_signal(&pme->mDumpCond);
+    pthread_mutex_unlock(&pme->mDumpLock);
+}
+
 /*===========================================================================
  * FUNCTION   : syncRuntimeParams
  *
@@ -657,7 +718,11 @@ int32_t QCameraStream::processDataNotify(mm_camera_super_buf_t *frame)
 {
     ALOGV("%s:\n", __func__);
     if (m_bActive) {
-        mDataQ.enqueue((void *)frame);
+        if (!mDataQ.enqueue((void *)frame)) {
+            bufDone(frame->bufs[0]->buf_idx);
+            free(frame);
+            return NO_MEMORY;
+        }
         return mProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
     } else {
         ALOGV("%s: Stream thread is not active, no ops here", __func__);
@@ -724,9 +789,9 @@ void *QCameraStream::dataProcRoutine(void *data)
     ALOGV("%s: E", __func__);
     do {
         do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            ret = cmdThread->waitCmd();
             if (ret != 0 && errno != EINVAL) {
-                ALOGE("%s: cam_sem_wait error (%s)",
+                ALOGE("%s: waitCmd error (%s)",
                       __func__, strerror(errno));
                 return NULL;
             }
@@ -741,6 +806,9 @@ void *QCameraStream::dataProcRoutine(void *data)
                 mm_camera_super_buf_t *frame =
                     (mm_camera_super_buf_t *)pme->mDataQ.dequeue();
                 if (NULL != frame) {
+                    mm_camera_trace_stamp(CAM_TRACE_HAL_DATA_PROC,
+                                          frame->bufs[0]->stream_id,
+                                          frame->bufs[0]->frame_idx);
                     if (pme->mDataCB != NULL) {
                         pme->mDataCB(frame, pme, pme->mUserData);
                     } else {
@@ -99,6 +99,8 @@ public:
     cam_stream_parm_buffer_t getImgProp() { return m_ImgProp;};
 
     static void releaseFrameData(void *data, void *user_data);
+    void holdDumpBuf();
+    static void releaseDumpBuf(void *data, void *cookie);
     int32_t configStream();
     bool isDeffered() const { return mDefferedAllocation; }
     void deleteStream();
@@ -123,7 +125,7 @@ private:
     stream_cb_routine mDataCB;
     void *mUserData;
 
-    QCameraQueue     mDataQ;
+    QCameraQueue     mDataQ;    // single producer: mm-camera-intf cb thread
     QCameraCmdThread mProcTh; // thread for dataCB
 
     QCameraHeapMemory *mStreamInfoBuf;
@@ -135,6 +137,9 @@ private:
     cam_rect_t mCropInfo;
     pthread_mutex_t mCropLock; // lock to protect crop info
     pthread_mutex_t mParameterLock; // lock to sync access to parameters
+    pthread_mutex_t mDumpLock;
+    pthread_cond_t mDumpCond;
+    int mDumpBufs; // buffers held by the dump writer
     bool mStreamBufsAcquired;
     bool m_bActive; // if stream mProcTh is active
     bool mDynBufAlloc; // allow buf allocation in 2 steps
@@ -0,0 +1,118 @@
+# HAL unit tests and benchmarks, run on target against the HAL library
+OLD_LOCAL_PATH := $(LOCAL_PATH)
+QCAMERA2_HAL_TEST_PATH := $(call my-dir)
+
+QCAMERA2_HAL_TEST_C_INCLUDES := \
+        $(QCAMERA2_HAL_TEST_PATH)/.. \
+        $(QCAMERA2_HAL_TEST_PATH)/../../stack/common \
+        $(QCAMERA2_HAL_TEST_PATH)/../../util \
+        frameworks/native/include/media/openmax \
+        $(call project-path-for,qcom-media)/libstagefrighthw \
+        $(QCAMERA2_HAL_TEST_PATH)/../../../mm-image-codec/qexif \
+        $(QCAMERA2_HAL_TEST_PATH)/../../../mm-image-codec/qomx_core \
+        $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include \
+        $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include/media
+
+ifeq ($(call is-platform-sdk-version-at-least,20),true)
+QCAMERA2_HAL_TEST_C_INCLUDES += system/media/camera/include
+endif
+
+ifeq ($(TARGET_USE_VENDOR_CAMERA_EXT),true)
+QCAMERA2_HAL_TEST_C_INCLUDES += $(call project-path-for,qcom-display)/msm8974/libgralloc
+else
+QCAMERA2_HAL_TEST_C_INCLUDES += $(call project-path-for,qcom-display)/libgralloc
+endif
+
+#memory pool test
+include $(CLEAR_VARS)
+LOCAL_PATH := $(QCAMERA2_HAL_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_C_INCLUDES := $(QCAMERA2_HAL_TEST_C_INCLUDES)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+LOCAL_SRC_FILES := QCameraMemoryPoolTest.cpp
+
+LOCAL_MODULE           := QCameraMemoryPoolTest
+LOCAL_PRELINK_MODULE   := false
+LOCAL_SHARED_LIBRARIES := libcutils libutils liblog camera.$(TARGET_BOARD_PLATFORM)
+
+include $(BUILD_EXECUTABLE)
+
+#queue test
+include $(CLEAR_VARS)
+LOCAL_PATH := $(QCAMERA2_HAL_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_C_INCLUDES := $(QCAMERA2_HAL_TEST_C_INCLUDES)
+
+LOCAL_SRC_FILES := \
+        QCameraQueueTest.cpp \
+        ../../util/QCameraQueue.cpp
+
+LOCAL_MODULE           := QCameraQueueTest
+LOCAL_PRELINK_MODULE   := false
+LOCAL_SHARED_LIBRARIES := libcutils libutils liblog
+
+include $(BUILD_EXECUTABLE)
+
+#cmd thread test
+include $(CLEAR_VARS)
+LOCAL_PATH := $(QCAMERA2_HAL_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_C_INCLUDES := $(QCAMERA2_HAL_TEST_C_INCLUDES)
+
+LOCAL_SRC_FILES := \
+        QCameraCmdThreadTest.cpp \
+        ../../util/QCameraCmdThread.cpp
+
+LOCAL_MODULE           := QCameraCmdThreadTest
+LOCAL_PRELINK_MODULE   := false
+LOCAL_SHARED_LIBRARIES := libcutils libutils liblog
+
+include $(BUILD_EXECUTABLE)
+
+#image kernels test
+include $(CLEAR_VARS)
+LOCAL_PATH := $(QCAMERA2_HAL_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_C_INCLUDES := $(QCAMERA2_HAL_TEST_C_INCLUDES)
+
+LOCAL_SRC_FILES := QCameraImgKernelsTest.cpp
+ifeq ($(TARGET_ARCH),arm)
+LOCAL_SRC_FILES += ../../util/QCameraImgKernels.cpp.neon
+else
+LOCAL_SRC_FILES += ../../util/QCameraImgKernels.cpp
+endif
+
+LOCAL_MODULE           := QCameraImgKernelsTest
+LOCAL_PRELINK_MODULE   := false
+LOCAL_SHARED_LIBRARIES := libcutils libutils liblog
+
+include $(BUILD_EXECUTABLE)
+
+#parameters changed keys update test
+include $(CLEAR_VARS)
+LOCAL_PATH := $(QCAMERA2_HAL_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_C_INCLUDES := $(QCAMERA2_HAL_TEST_C_INCLUDES)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+LOCAL_SRC_FILES := QCameraParametersDiffTest.cpp
+
+LOCAL_MODULE           := QCameraParametersDiffTest
+LOCAL_PRELINK_MODULE   := false
+LOCAL_SHARED_LIBRARIES := libcamera_client libcutils libutils liblog \
+                          camera.$(TARGET_BOARD_PLATFORM)
+
+include $(BUILD_EXECUTABLE)
+
+LOCAL_PATH := $(OLD_LOCAL_PATH)
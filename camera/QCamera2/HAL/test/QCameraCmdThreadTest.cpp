@@ -0,0 +1,198 @@
+/* Copyright (c) 2015, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Checks QCameraCmdThread:
+   - testOrder: three times QCAMERA_CMD_RING_SIZE commands queued before
+     the thread runs grow the ring, priority commands still come first,
+     and a synchronous command, woken through the futex, returns only
+     once the commands ahead of it are done
+   - testEventFd: the eventfd turns readable when the ring goes non-empty
+     and getCmd() drains it
+   Then times a synchronous command round trip and an asynchronous send.
+   Usage: QCameraCmdThreadTest [round trips] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+#include "QCameraCmdThread.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define TEST_MAX_CMDS 512
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+struct TestRoutine {
+    QCameraCmdThread thread;
+    camera_cmd_type_t cmds[TEST_MAX_CMDS];
+    int cmdCnt;
+};
+
+// the loop the HAL threads run: STOP is answered as a synchronous
+// command, EXIT ends the thread
+static void *cmdRoutine(void *data)
+{
+    TestRoutine *routine = (TestRoutine *)data;
+    QCameraCmdThread *cmdThread = &routine->thread;
+    bool running = true;
+
+    while (running) {
+        if (cmdThread->waitCmd() != 0) {
+            break;
+        }
+        camera_cmd_type_t cmd = cmdThread->getCmd();
+        if (routine->cmdCnt < TEST_MAX_CMDS) {
+            routine->cmds[routine->cmdCnt++] = cmd;
+        }
+        switch (cmd) {
+        case CAMERA_CMD_TYPE_STOP_DATA_PROC:
+            cmdThread->signalSync();
+            break;
+        case CAMERA_CMD_TYPE_EXIT:
+            running = false;
+            break;
+        default:
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void testOrder()
+{
+    TestRoutine *routine = new TestRoutine();
+
+    // more than the inline ring holds, queued before the thread runs
+    for (int i = 0; i < 3 * QCAMERA_CMD_RING_SIZE; i++) {
+        CHECK(routine->thread.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0) ==
+              NO_ERROR);
+    }
+    CHECK(routine->thread.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, 0, 1) ==
+          NO_ERROR);
+    CHECK(routine->thread.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 1) ==
+          NO_ERROR);
+
+    routine->thread.launch(cmdRoutine, routine);
+    // a synchronous command returns once the ones ahead of it are done
+    CHECK(routine->thread.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, 1, 0) ==
+          NO_ERROR);
+    CHECK(routine->cmdCnt == 3 * QCAMERA_CMD_RING_SIZE + 3);
+    routine->thread.exit();
+
+    // priority commands first, latest first, then the rest in order
+    int total = 3 * QCAMERA_CMD_RING_SIZE + 4;
+    CHECK(routine->cmdCnt == total);
+    CHECK(routine->cmds[0] == CAMERA_CMD_TYPE_DO_NEXT_JOB);
+    CHECK(routine->cmds[1] == CAMERA_CMD_TYPE_START_DATA_PROC);
+    int jobs = 0;
+    for (int i = 2; i < total - 2; i++) {
+        if (routine->cmds[i] == CAMERA_CMD_TYPE_DO_NEXT_JOB) {
+            jobs++;
+        }
+    }
+    CHECK(jobs == 3 * QCAMERA_CMD_RING_SIZE);
+    CHECK(routine->cmds[total - 2] == CAMERA_CMD_TYPE_STOP_DATA_PROC);
+    CHECK(routine->cmds[total - 1] == CAMERA_CMD_TYPE_EXIT);
+
+    delete routine;
+}
+
+static void testEventFd()
+{
+    QCameraCmdThread thread;
+    struct pollfd pfd;
+
+    memset(&pfd, 0, sizeof(pfd));
+    pfd.fd = thread.getEventFd();
+    pfd.events = POLLIN;
+    CHECK(pfd.fd >= 0);
+    CHECK(poll(&pfd, 1, 0) == 0);
+
+    // readable once the ring turns non-empty, drained by getCmd()
+    CHECK(thread.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0) == NO_ERROR);
+    CHECK(thread.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, 0, 0) == NO_ERROR);
+    CHECK(poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN));
+    CHECK(thread.waitCmd() == 0);
+    CHECK(thread.getCmd() == CAMERA_CMD_TYPE_DO_NEXT_JOB);
+    CHECK(thread.getCmd() == CAMERA_CMD_TYPE_STOP_DATA_PROC);
+    CHECK(thread.getCmd() == CAMERA_CMD_TYPE_NONE);
+}
+
+static void bench(int rounds)
+{
+    TestRoutine *routine = new TestRoutine();
+    routine->thread.launch(cmdRoutine, routine);
+
+    nsecs_t start = systemTime();
+    for (int i = 0; i < rounds; i++) {
+        routine->thread.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, 1, 0);
+    }
+    nsecs_t syncNsec = (systemTime() - start) / rounds;
+
+    start = systemTime();
+    for (int i = 0; i < rounds; i++) {
+        routine->thread.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+    }
+    nsecs_t asyncNsec = (systemTime() - start) / rounds;
+    routine->thread.exit();
+    delete routine;
+
+    printf("bench: %d synchronous commands, %lld ns round trip, "
+           "%lld ns per asynchronous send\n",
+           rounds, (long long)syncNsec, (long long)asyncNsec);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+    if (rounds < 1) {
+        fprintf(stderr, "usage: %s [round trips]\n", argv[0]);
+        return 1;
+    }
+
+    testOrder();
+    testEventFd();
+    bench(rounds);
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
@@ -0,0 +1,491 @@
+/* Copyright (c) 2015, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Checks the QCameraImgKernels output against per pixel reference
+   implementations, over widths that exercise both the vector body and the
+   scalar tail, and against a few hand worked goldens. Times the kernels
+   against the references on a 1080p frame, in ns per megapixel. On a
+   NEON build this compares the NEON path with the scalar one.
+   Usage: QCameraImgKernelsTest [rounds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <utils/Timers.h>
+#include "QCameraImgKernels.h"
+
+using namespace qcamera;
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+#define GUARD_BYTE 0xa5
+
+static void fillRandom(uint8_t *buf, uint32_t size, uint32_t seed)
+{
+    for (uint32_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+// The references are kept out of line, so that the bench times them as it
+// times the kernels: called with sizes only known at run time
+#define REF_KERNEL static __attribute__((noinline)) void
+
+REF_KERNEL refCrop(uint8_t *dst, uint32_t dstStride,
+                   const uint8_t *src, uint32_t srcStride,
+                   uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+                   uint32_t bytesPerPixel)
+{
+    for (uint32_t r = 0; r < height; r++) {
+        for (uint32_t c = 0; c < width * bytesPerPixel; c++) {
+            dst[r * dstStride + c] =
+                src[(y + r) * srcStride + x * bytesPerPixel + c];
+        }
+    }
+}
+
+REF_KERNEL refSwapUV(uint8_t *dst, uint32_t dstStride,
+                     const uint8_t *src, uint32_t srcStride,
+                     uint32_t pairs, uint32_t height)
+{
+    for (uint32_t r = 0; r < height; r++) {
+        for (uint32_t i = 0; i < pairs; i++) {
+            uint8_t u = src[r * srcStride + 2 * i];
+            uint8_t v = src[r * srcStride + 2 * i + 1];
+            dst[r * dstStride + 2 * i] = v;
+            dst[r * dstStride + 2 * i + 1] = u;
+        }
+    }
+}
+
+REF_KERNEL refInterleaveUV(uint8_t *dst, uint32_t dstStride,
+                           const uint8_t *first, uint32_t firstStride,
+                           const uint8_t *second, uint32_t secondStride,
+                           uint32_t pairs, uint32_t height)
+{
+    for (uint32_t r = 0; r < height; r++) {
+        for (uint32_t i = 0; i < pairs; i++) {
+            dst[r * dstStride + 2 * i] = first[r * firstStride + i];
+            dst[r * dstStride + 2 * i + 1] = second[r * secondStride + i];
+        }
+    }
+}
+
+REF_KERNEL refDeinterleaveUV(uint8_t *first, uint32_t firstStride,
+                             uint8_t *second, uint32_t secondStride,
+                             const uint8_t *src, uint32_t srcStride,
+                             uint32_t pairs, uint32_t height)
+{
+    for (uint32_t r = 0; r < height; r++) {
+        for (uint32_t i = 0; i < pairs; i++) {
+            first[r * firstStride + i] = src[r * srcStride + 2 * i];
+            second[r * secondStride + i] = src[r * srcStride + 2 * i + 1];
+        }
+    }
+}
+
+REF_KERNEL refDownscale2x(uint8_t *dst, uint32_t dstStride,
+                          const uint8_t *src, uint32_t srcStride,
+                          uint32_t dstWidth, uint32_t dstHeight)
+{
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const uint8_t *row0 = src + 2 * y * srcStride;
+        const uint8_t *row1 = row0 + srcStride;
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            uint32_t sum = row0[2 * x] + row0[2 * x + 1] +
+                           row1[2 * x] + row1[2 * x + 1];
+            dst[y * dstStride + x] = (uint8_t)((sum + 2) / 4);
+        }
+    }
+}
+
+REF_KERNEL refDownscale2xUV(uint8_t *dst, uint32_t dstStride,
+                            const uint8_t *src, uint32_t srcStride,
+                            uint32_t dstPairs, uint32_t dstHeight)
+{
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const uint8_t *row0 = src + 2 * y * srcStride;
+        const uint8_t *row1 = row0 + srcStride;
+        for (uint32_t x = 0; x < dstPairs; x++) {
+            for (uint32_t c = 0; c < 2; c++) {
+                uint32_t sum = row0[4 * x + c] + row0[4 * x + 2 + c] +
+                               row1[4 * x + c] + row1[4 * x + 2 + c];
+                dst[y * dstStride + 2 * x + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// compares the rows of a kernel output with the reference, and checks
+// that the stride padding after each row was left alone
+static bool samePlane(const uint8_t *out, const uint8_t *ref,
+                      uint32_t stride, uint32_t width, uint32_t height)
+{
+    for (uint32_t y = 0; y < height; y++) {
+        if (memcmp(out + y * stride, ref + y * stride, width) != 0) {
+            return false;
+        }
+        for (uint32_t x = width; x < stride; x++) {
+            if (out[y * stride + x] != GUARD_BYTE) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void testCopyPlane()
+{
+    const uint32_t width = 37, height = 5, srcStride = 48;
+    uint8_t src[srcStride * height];
+    uint8_t out[srcStride * height];
+    fillRandom(src, sizeof(src), 1);
+
+    // strided
+    memset(out, GUARD_BYTE, sizeof(out));
+    QCameraImgKernels::copyPlane(out, 40, src, srcStride, width, height);
+    for (uint32_t y = 0; y < height; y++) {
+        CHECK(memcmp(out + y * 40, src + y * srcStride, width) == 0);
+        CHECK(out[y * 40 + width] == GUARD_BYTE);
+    }
+
+    // packed on both sides
+    memset(out, GUARD_BYTE, sizeof(out));
+    QCameraImgKernels::copyPlane(out, srcStride, src, srcStride,
+                                 srcStride, height);
+    CHECK(memcmp(out, src, sizeof(src)) == 0);
+}
+
+// 0..15 bytes of tail after 0..2 blocks of 64 and 16 bytes, at every
+// alignment of the crop rectangle
+static void testCrop()
+{
+    const uint32_t srcStride = 256, srcHeight = 8;
+    uint8_t src[srcStride * srcHeight];
+    uint8_t out[200 * 3];
+    uint8_t ref[200 * 3];
+    fillRandom(src, sizeof(src), 3);
+
+    for (uint32_t bpp = 1; bpp <= 2; bpp++) {
+        for (uint32_t width = 1; width <= 180 / bpp; width++) {
+            uint32_t x = width % 7, y = width % 5;
+            const uint32_t height = 3, dstStride = width * bpp + 9;
+            memset(out, GUARD_BYTE, sizeof(out));
+            memset(ref, GUARD_BYTE, sizeof(ref));
+            QCameraImgKernels::cropPlane(out, dstStride, src, srcStride,
+                                         x, y, width, height, bpp);
+            refCrop(ref, dstStride, src, srcStride, x, y, width, height, bpp);
+            CHECK(samePlane(out, ref, dstStride, width * bpp, height));
+        }
+    }
+
+    // golden: the 2x2 chroma pairs at pixel (1, 1) of a 3x2 pair plane
+    const uint8_t uv[2 * 12] = { 0, 1, 2, 3, 4, 5,
+                                 6, 7, 8, 9, 10, 11,
+                                 12, 13, 14, 15, 16, 17,
+                                 18, 19, 20, 21, 22, 23 };
+    uint8_t crop[8];
+    QCameraImgKernels::cropPlane(crop, 4, uv, 6, 1, 1, 2, 2, 2);
+    const uint8_t cropGolden[8] = { 8, 9, 10, 11, 14, 15, 16, 17 };
+    CHECK(memcmp(crop, cropGolden, sizeof(crop)) == 0);
+}
+
+// out of place and in place, 0..15 pairs of tail after 0..2 vector blocks
+static void testSwapUV()
+{
+    for (uint32_t pairs = 1; pairs <= 40; pairs++) {
+        const uint32_t height = 3;
+        const uint32_t srcStride = 2 * pairs + 6;
+        const uint32_t dstStride = 2 * pairs + 4;
+        uint8_t src[(2 * 40 + 6) * 3];
+        uint8_t out[(2 * 40 + 6) * 3];
+        uint8_t ref[(2 * 40 + 6) * 3];
+        fillRandom(src, sizeof(src), pairs);
+
+        memset(out, GUARD_BYTE, sizeof(out));
+        memset(ref, GUARD_BYTE, sizeof(ref));
+        QCameraImgKernels::swapUV(out, dstStride, src, srcStride,
+                                  pairs, height);
+        refSwapUV(ref, dstStride, src, srcStride, pairs, height);
+        CHECK(samePlane(out, ref, dstStride, 2 * pairs, height));
+
+        // in place keeps the padding of the source stride too
+        memset(out, GUARD_BYTE, sizeof(out));
+        for (uint32_t r = 0; r < height; r++) {
+            memcpy(out + r * srcStride, src + r * srcStride, 2 * pairs);
+        }
+        memset(ref, GUARD_BYTE, sizeof(ref));
+        refSwapUV(ref, srcStride, src, srcStride, pairs, height);
+        QCameraImgKernels::swapUV(out, srcStride, out, srcStride,
+                                  pairs, height);
+        CHECK(samePlane(out, ref, srcStride, 2 * pairs, height));
+
+        // swapping twice gives the source back
+        QCameraImgKernels::swapUV(out, srcStride, out, srcStride,
+                                  pairs, height);
+        for (uint32_t r = 0; r < height; r++) {
+            CHECK(memcmp(out + r * srcStride, src + r * srcStride,
+                         2 * pairs) == 0);
+        }
+    }
+
+    // golden: NV12 chroma U0 V0 U1 V1 becomes NV21 V0 U0 V1 U1
+    uint8_t uv[4] = { 0x10, 0xf0, 0x20, 0xe0 };
+    const uint8_t vu[4] = { 0xf0, 0x10, 0xe0, 0x20 };
+    QCameraImgKernels::swapUV(uv, 4, uv, 4, 2, 1);
+    CHECK(memcmp(uv, vu, sizeof(uv)) == 0);
+}
+
+static void testInterleave()
+{
+    for (uint32_t pairs = 1; pairs <= 40; pairs++) {
+        const uint32_t height = 3;
+        const uint32_t planeStride = pairs + 3;
+        const uint32_t spStride = 2 * pairs + 5;
+        uint8_t u[(40 + 3) * 3], v[(40 + 3) * 3];
+        uint8_t out[(2 * 40 + 5) * 3], ref[(2 * 40 + 5) * 3];
+        fillRandom(u, sizeof(u), 2 * pairs);
+        fillRandom(v, sizeof(v), 2 * pairs + 1);
+
+        memset(out, GUARD_BYTE, sizeof(out));
+        memset(ref, GUARD_BYTE, sizeof(ref));
+        QCameraImgKernels::interleaveUV(out, spStride, v, planeStride,
+                                        u, planeStride, pairs, height);
+        refInterleaveUV(ref, spStride, v, planeStride,
+                        u, planeStride, pairs, height);
+        CHECK(samePlane(out, ref, spStride, 2 * pairs, height));
+
+        // and back
+        uint8_t first[(40 + 3) * 3], second[(40 + 3) * 3];
+        uint8_t refFirst[(40 + 3) * 3], refSecond[(40 + 3) * 3];
+        memset(first, GUARD_BYTE, sizeof(first));
+        memset(second, GUARD_BYTE, sizeof(second));
+        memset(refFirst, GUARD_BYTE, sizeof(refFirst));
+        memset(refSecond, GUARD_BYTE, sizeof(refSecond));
+        QCameraImgKernels::deinterleaveUV(first, planeStride,
+                                          second, planeStride,
+                                          out, spStride, pairs, height);
+        refDeinterleaveUV(refFirst, planeStride, refSecond, planeStride,
+                          out, spStride, pairs, height);
+        CHECK(samePlane(first, refFirst, planeStride, pairs, height));
+        CHECK(samePlane(second, refSecond, planeStride, pairs, height));
+        for (uint32_t r = 0; r < height; r++) {
+            CHECK(memcmp(first + r * planeStride, v + r * planeStride,
+                         pairs) == 0);
+            CHECK(memcmp(second + r * planeStride, u + r * planeStride,
+                         pairs) == 0);
+        }
+    }
+
+    // golden: V then U planes make NV21 chroma
+    const uint8_t vPlane[2] = { 0xf0, 0xe0 };
+    const uint8_t uPlane[2] = { 0x10, 0x20 };
+    const uint8_t vu[4] = { 0xf0, 0x10, 0xe0, 0x20 };
+    uint8_t sp[4];
+    QCameraImgKernels::interleaveUV(sp, 4, vPlane, 2, uPlane, 2, 2, 1);
+    CHECK(memcmp(sp, vu, sizeof(sp)) == 0);
+}
+
+static void testDownscale()
+{
+    // 0..3 pixels of scalar tail after 0..2 vector blocks
+    for (uint32_t dstWidth = 1; dstWidth <= 35; dstWidth++) {
+        const uint32_t dstHeight = 3;
+        const uint32_t srcStride = 2 * dstWidth + 7;
+        const uint32_t dstStride = dstWidth + 5;
+        uint8_t *src = (uint8_t *)malloc(srcStride * 2 * dstHeight);
+        uint8_t *out = (uint8_t *)malloc(dstStride * dstHeight);
+        uint8_t *ref = (uint8_t *)malloc(dstStride * dstHeight);
+        if (src == NULL || out == NULL || ref == NULL) {
+            CHECK(!"allocation failed");
+            free(src);
+            free(out);
+            free(ref);
+            return;
+        }
+        fillRandom(src, srcStride * 2 * dstHeight, dstWidth);
+
+        memset(out, GUARD_BYTE, dstStride * dstHeight);
+        memset(ref, GUARD_BYTE, dstStride * dstHeight);
+        QCameraImgKernels::downscale2x(out, dstStride, src, srcStride,
+                                       dstWidth, dstHeight);
+        refDownscale2x(ref, dstStride, src, srcStride, dstWidth, dstHeight);
+        CHECK(samePlane(out, ref, dstStride, dstWidth, dstHeight));
+
+        // the same sizes in UV pairs, the row is twice as long
+        uint32_t dstPairs = dstWidth / 2;
+        if (dstPairs > 0) {
+            memset(out, GUARD_BYTE, dstStride * dstHeight);
+            memset(ref, GUARD_BYTE, dstStride * dstHeight);
+            QCameraImgKernels::downscale2xUV(out, dstStride, src, srcStride,
+                                             dstPairs, dstHeight);
+            refDownscale2xUV(ref, dstStride, src, srcStride,
+                             dstPairs, dstHeight);
+            CHECK(samePlane(out, ref, dstStride, 2 * dstPairs, dstHeight));
+        }
+
+        free(src);
+        free(out);
+        free(ref);
+    }
+
+    // rounding: 1+1+1+2 rounds up, 1+1+1+0 rounds down
+    uint8_t src[8] = { 1, 1, 1, 0,
+                       1, 2, 1, 0 };
+    uint8_t out[2];
+    QCameraImgKernels::downscale2x(out, 2, src, 4, 2, 1);
+    CHECK(out[0] == 1 && out[1] == 1);
+    src[5] = 3;
+    QCameraImgKernels::downscale2x(out, 2, src, 4, 2, 1);
+    CHECK(out[0] == 2);
+}
+
+// ns per megapixel of the plane a kernel reads, one call per round
+#define BENCH(result, mp, call) \
+    do { \
+        nsecs_t start = systemTime(); \
+        for (int i = 0; i < rounds; i++) { \
+            call; \
+        } \
+        result = (systemTime() - start) / (rounds * (mp)); \
+    } while (0)
+
+// on a 1080p NV21 frame with padded strides
+static void bench(int rounds)
+{
+    const uint32_t width = 1920, height = 1080;
+    const uint32_t stride = 1920 + 64;
+    const uint32_t pairs = width / 2, uvHeight = height / 2;
+    uint8_t *src = (uint8_t *)malloc(stride * height);
+    uint8_t *dst = (uint8_t *)malloc(stride * height);
+    uint8_t *u = (uint8_t *)malloc(pairs * uvHeight);
+    uint8_t *v = (uint8_t *)malloc(pairs * uvHeight);
+    if (src == NULL || dst == NULL || u == NULL || v == NULL) {
+        CHECK(!"allocation failed");
+        free(src);
+        free(dst);
+        free(u);
+        free(v);
+        return;
+    }
+    fillRandom(src, stride * height, 7);
+    fillRandom(u, pairs * uvHeight, 8);
+    fillRandom(v, pairs * uvHeight, 9);
+    // luma plane, and the chroma plane in pixels it covers
+    const double mp = width * height / 1e6;
+    double kernel, ref;
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    const char *path = "neon";
+#else
+    const char *path = "scalar";
+#endif
+    printf("bench: %s build, 1080p, ns per MP, kernel (reference)\n", path);
+
+    BENCH(kernel, mp, QCameraImgKernels::copyPlane(dst, width, src, stride,
+                                                   width, height));
+    printf("bench:   copyPlane %.0f\n", kernel);
+
+    // the centre 1280x720 of the luma plane
+    const double mpCrop = 1280 * 720 / 1e6;
+    BENCH(kernel, mpCrop, QCameraImgKernels::cropPlane(dst, 1280, src, stride,
+                                                       321, 180, 1280, 720, 1));
+    BENCH(ref, mpCrop, refCrop(dst, 1280, src, stride, 321, 180, 1280, 720, 1));
+    printf("bench:   cropPlane %.0f (%.0f)\n", kernel, ref);
+
+    BENCH(kernel, mp, QCameraImgKernels::swapUV(dst, width, src, stride,
+                                                pairs, uvHeight));
+    BENCH(ref, mp, refSwapUV(dst, width, src, stride, pairs, uvHeight));
+    printf("bench:   swapUV %.0f (%.0f)\n", kernel, ref);
+    BENCH(kernel, mp, QCameraImgKernels::swapUV(src, stride, src, stride,
+                                                pairs, uvHeight));
+    BENCH(ref, mp, refSwapUV(src, stride, src, stride, pairs, uvHeight));
+    printf("bench:   swapUV in place %.0f (%.0f)\n", kernel, ref);
+
+    BENCH(kernel, mp, QCameraImgKernels::interleaveUV(dst, width, v, pairs,
+                                                      u, pairs, pairs,
+                                                      uvHeight));
+    BENCH(ref, mp, refInterleaveUV(dst, width, v, pairs, u, pairs,
+                                   pairs, uvHeight));
+    printf("bench:   interleaveUV %.0f (%.0f)\n", kernel, ref);
+    BENCH(kernel, mp, QCameraImgKernels::deinterleaveUV(v, pairs, u, pairs,
+                                                        src, stride, pairs,
+                                                        uvHeight));
+    BENCH(ref, mp, refDeinterleaveUV(v, pairs, u, pairs, src, stride,
+                                     pairs, uvHeight));
+    printf("bench:   deinterleaveUV %.0f (%.0f)\n", kernel, ref);
+
+    BENCH(kernel, mp, QCameraImgKernels::downscale2x(dst, width / 2, src,
+                                                     stride, width / 2,
+                                                     height / 2));
+    BENCH(ref, mp, refDownscale2x(dst, width / 2, src, stride,
+                                  width / 2, height / 2));
+    printf("bench:   downscale2x %.0f (%.0f)\n", kernel, ref);
+    BENCH(kernel, mp, QCameraImgKernels::downscale2xUV(dst, width / 2, src,
+                                                       stride, pairs / 2,
+                                                       uvHeight / 2));
+    BENCH(ref, mp, refDownscale2xUV(dst, width / 2, src, stride,
+                                    pairs / 2, uvHeight / 2));
+    printf("bench:   downscale2xUV %.0f (%.0f)\n", kernel, ref);
+
+    free(src);
+    free(dst);
+    free(u);
+    free(v);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 100;
+    if (rounds < 1) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    testCopyPlane();
+    testCrop();
+    testSwapUV();
+    testInterleave();
+    testDownscale();
+    bench(rounds);
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/* Copyright (c) 2015, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Checks the lookup, eviction and prewarm rules of QCameraMemoryPool on
+   real ion buffers, and times a pool hit against an ion allocation.
+   Usage: QCameraMemoryPoolTest [rounds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+#include "QCameraMem.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define TEST_HEAP ION_HEAP(ION_SYSTEM_HEAP_ID)
+#define TEST_KB   1024
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+// QCameraMemInfo is only visible to QCameraMemory and its subclasses
+class QCameraMemoryPoolTest : public QCameraMemory {
+public:
+    typedef QCameraMemInfo MemInfo;
+    static int allocBuffer(MemInfo &memInfo, int heap_id, int size,
+                           bool cached) {
+        return allocOneBuffer(memInfo, heap_id, size, cached);
+    }
+    static void deallocBuffer(MemInfo &memInfo) { deallocOneBuffer(memInfo); }
+};
+typedef QCameraMemoryPoolTest::MemInfo MemInfo;
+
+struct PoolStats {
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+    unsigned long long bytesHeld;
+};
+
+// the counters as QCameraMemoryPool::dump() prints them
+static PoolStats getStats(QCameraMemoryPool &pool)
+{
+    PoolStats stats;
+    char line[256];
+    unsigned long long hwm = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    FILE *fp = tmpfile();
+    if (fp == NULL) {
+        return stats;
+    }
+    pool.dump(fileno(fp));
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        sscanf(line, "  hits %u misses %u evictions %u",
+               &stats.hits, &stats.misses, &stats.evictions);
+        sscanf(line, "  bytes held %llu, high-water mark %llu",
+               &stats.bytesHeld, &hwm);
+    }
+    fclose(fp);
+    return stats;
+}
+
+static bool alloc(QCameraMemoryPool &pool, MemInfo &memInfo, int size,
+                  bool cached = false,
+                  cam_stream_type_t type = CAM_STREAM_TYPE_PREVIEW)
+{
+    memset(&memInfo, 0, sizeof(memInfo));
+    return pool.allocateBuffer(memInfo, TEST_HEAP, size, cached, type) ==
+           NO_ERROR;
+}
+
+static void testBestFit()
+{
+    QCameraMemoryPool pool;
+    MemInfo small, large, mid, got;
+
+    pool.setHighWaterMark(0);
+    CHECK(alloc(pool, small, 64 * TEST_KB));
+    CHECK(alloc(pool, large, 128 * TEST_KB));
+    CHECK(alloc(pool, mid, 96 * TEST_KB));
+    int midFd = mid.fd;
+    int smallFd = small.fd;
+    pool.releaseBuffer(small, CAM_STREAM_TYPE_PREVIEW);
+    pool.releaseBuffer(large, CAM_STREAM_TYPE_PREVIEW);
+    pool.releaseBuffer(mid, CAM_STREAM_TYPE_PREVIEW);
+
+    // smallest buffer that fits, whatever stream type released it
+    CHECK(alloc(pool, got, 90 * TEST_KB, false, CAM_STREAM_TYPE_SNAPSHOT));
+    CHECK(got.fd == midFd);
+    pool.releaseBuffer(got, CAM_STREAM_TYPE_SNAPSHOT);
+
+    // an exact fit is a hit too
+    CHECK(alloc(pool, got, 64 * TEST_KB));
+    CHECK(got.fd == smallFd);
+    pool.releaseBuffer(got, CAM_STREAM_TYPE_PREVIEW);
+
+    PoolStats stats = getStats(pool);
+    CHECK(stats.hits == 2 && stats.misses == 3);
+    CHECK(stats.bytesHeld == 288 * TEST_KB);
+}
+
+static void testNoMatch()
+{
+    QCameraMemoryPool pool;
+    MemInfo big, got;
+
+    pool.setHighWaterMark(0);
+    CHECK(alloc(pool, big, 1024 * TEST_KB));
+    int bigFd = big.fd;
+    pool.releaseBuffer(big, CAM_STREAM_TYPE_SNAPSHOT);
+
+    // more than QCAMERA_POOL_MAX_OVERSIZE times too large
+    CHECK(alloc(pool, got, 100 * TEST_KB));
+    CHECK(got.fd != bigFd);
+    pool.releaseBuffer(got, CAM_STREAM_TYPE_PREVIEW);
+
+    // cached and uncached buffers are not mixed
+    CHECK(alloc(pool, got, 1024 * TEST_KB, true));
+    CHECK(got.fd != bigFd);
+    pool.releaseBuffer(got, CAM_STREAM_TYPE_PREVIEW);
+
+    PoolStats stats = getStats(pool);
+    CHECK(stats.hits == 0 && stats.misses == 3);
+}
+
+static void testHighWaterMark()
+{
+    QCameraMemoryPool pool;
+    MemInfo buf[4], got;
+    int fds[4];
+
+    pool.setHighWaterMark(256 * TEST_KB);
+    for (int i = 0; i < 4; i++) {
+        CHECK(alloc(pool, buf[i], 128 * TEST_KB));
+        fds[i] = buf[i].fd;
+    }
+    for (int i = 0; i < 4; i++) {
+        pool.releaseBuffer(buf[i], CAM_STREAM_TYPE_PREVIEW);
+    }
+
+    // the two released first are freed
+    PoolStats stats = getStats(pool);
+    CHECK(stats.evictions == 2);
+    CHECK(stats.bytesHeld == 256 * TEST_KB);
+    CHECK(alloc(pool, got, 128 * TEST_KB));
+    CHECK(got.fd == fds[2] || got.fd == fds[3]);
+    pool.releaseBuffer(got, CAM_STREAM_TYPE_PREVIEW);
+
+    // lowering the mark frees at once
+    pool.setHighWaterMark(128 * TEST_KB);
+    stats = getStats(pool);
+    CHECK(stats.evictions == 3 && stats.bytesHeld == 128 * TEST_KB);
+
+    pool.clear();
+    stats = getStats(pool);
+    CHECK(stats.bytesHeld == 0);
+}
+
+static void testPrewarm()
+{
+    char path[] = "/data/local/tmp/QCameraMemoryPoolTest.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "%s: cannot create %s\n", __func__, path);
+        gFailures++;
+        return;
+    }
+    close(fd);
+
+    QCameraMemoryPool pool;
+    MemInfo buf[6];
+
+    pool.setHighWaterMark(0);
+    // no stream has run yet, so there is nothing to save
+    CHECK(pool.saveUsage(path) == NAME_NOT_FOUND);
+    for (int i = 0; i < 6; i++) {
+        CHECK(alloc(pool, buf[i], 100 * TEST_KB));
+    }
+    for (int i = 0; i < 6; i++) {
+        pool.releaseBuffer(buf[i], CAM_STREAM_TYPE_PREVIEW);
+    }
+    CHECK(pool.saveUsage(path) == NO_ERROR);
+    pool.clear();
+
+    // without a high-water mark nothing is prewarmed
+    QCameraMemoryPool unbounded;
+    unbounded.setHighWaterMark(0);
+    CHECK(unbounded.prewarm(path) == NO_INIT);
+    PoolStats stats = getStats(unbounded);
+    CHECK(stats.bytesHeld == 0);
+
+    QCameraMemoryPool next;
+    next.setHighWaterMark(4096 * TEST_KB);
+    CHECK(next.prewarm(path) == NO_ERROR);
+    for (int i = 0; i < 6; i++) {
+        CHECK(alloc(next, buf[i], 100 * TEST_KB));
+    }
+    stats = getStats(next);
+    CHECK(stats.hits == 6 && stats.misses == 0);
+    for (int i = 0; i < 6; i++) {
+        next.releaseBuffer(buf[i], CAM_STREAM_TYPE_PREVIEW);
+    }
+    next.clear();
+
+    // prewarm stops at the high-water mark
+    QCameraMemoryPool capped;
+    capped.setHighWaterMark(300 * TEST_KB);
+    CHECK(capped.prewarm(path) == NO_ERROR);
+    stats = getStats(capped);
+    CHECK(stats.bytesHeld <= 300 * TEST_KB && stats.evictions == 0);
+    capped.clear();
+
+    unlink(path);
+    QCameraMemoryPool missing;
+    missing.setHighWaterMark(4096 * TEST_KB);
+    CHECK(missing.prewarm(path) == NAME_NOT_FOUND);
+}
+
+// a preview restart: the same buffer set freed and allocated again
+static void bench(int rounds)
+{
+    const int count = 7;
+    const int size = 1920 * 1088 * 3 / 2;
+    MemInfo buf[count];
+
+    QCameraMemoryPool pool;
+    pool.setHighWaterMark(0);
+    nsecs_t start = systemTime();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) {
+            alloc(pool, buf[i], size);
+        }
+        for (int i = 0; i < count; i++) {
+            pool.releaseBuffer(buf[i], CAM_STREAM_TYPE_PREVIEW);
+        }
+    }
+    nsecs_t poolNsec = (systemTime() - start) / ((nsecs_t)rounds * count);
+    PoolStats stats = getStats(pool);
+    pool.clear();
+
+    start = systemTime();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) {
+            memset(&buf[i], 0, sizeof(buf[i]));
+            QCameraMemoryPoolTest::allocBuffer(buf[i], TEST_HEAP, size,
+                                               false);
+        }
+        for (int i = 0; i < count; i++) {
+            QCameraMemoryPoolTest::deallocBuffer(buf[i]);
+        }
+    }
+    nsecs_t ionNsec = (systemTime() - start) / ((nsecs_t)rounds * count);
+
+    printf("bench: %d rounds of %d x %d bytes, pool %lld us per buffer "
+           "(%u hits, %u misses), ion %lld us per buffer\n",
+           rounds, count, size, (long long)(poolNsec / 1000),
+           stats.hits, stats.misses, (long long)(ionNsec / 1000));
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 50;
+    if (rounds < 1) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    testBestFit();
+    testNoMatch();
+    testHighWaterMark();
+    testPrewarm();
+    bench(rounds);
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
@@ -0,0 +1,473 @@
+/* Copyright (c) 2015, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Applies the same setParameters sequence to a QCameraParameters on the
+   full update (persist.camera.param.diff 0) and one on the changed keys
+   update (1), over a fake backend that records every committed batch.
+   Checks both send the same parm_buffer entries, report the same
+   needRestart and status and end up with the same parameters. Then
+   times a one key setParameters on each path.
+   Usage: QCameraParametersDiffTest [rounds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+#include <cutils/properties.h>
+#include <utils/Errors.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+#include "QCameraParameters.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define FULL_HANDLE      1
+#define DIFF_HANDLE      2
+#define BATCH_LOG_SIZE   (64 * 1024)
+#define MAX_STEP_EDITS   4
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+// entries of the batches a handle committed since the last reset, as
+// type, size and value, leaving out the alignment padding
+struct TestBatchLog {
+    char data[BATCH_LOG_SIZE];
+    uint32_t len;
+    int commits;
+    bool overflow;
+};
+
+static TestBatchLog gBatchLog[2];
+
+static TestBatchLog &batchLog(uint32_t handle)
+{
+    return gBatchLog[handle == FULL_HANDLE ? 0 : 1];
+}
+
+static void batchLogAppend(TestBatchLog &log, const void *data, uint32_t len)
+{
+    if (log.len + len > BATCH_LOG_SIZE) {
+        log.overflow = true;
+        return;
+    }
+    memcpy(log.data + log.len, data, len);
+    log.len += len;
+}
+
+static int32_t testMapBuf(uint32_t, uint8_t, int, uint32_t)
+{
+    return 0;
+}
+
+static int32_t testUnmapBuf(uint32_t, uint8_t)
+{
+    return 0;
+}
+
+static int32_t testSetParms(uint32_t handle, void *parms)
+{
+    parm_buffer_new_t *buf = (parm_buffer_new_t *)parms;
+    parm_entry_type_new_t *entry = (parm_entry_type_new_t *)&buf->entry[0];
+    TestBatchLog &log = batchLog(handle);
+
+    for (uint32_t i = 0; i < buf->num_entry; i++) {
+        batchLogAppend(log, &entry->entry_type, sizeof(entry->entry_type));
+        batchLogAppend(log, &entry->size, sizeof(entry->size));
+        batchLogAppend(log, &entry->data[0], entry->size);
+        entry = GET_NEXT_PARAM(entry, parm_entry_type_new_t);
+    }
+    log.commits++;
+    // the daemon posts once it has consumed the batch
+    sem_post(&buf->cam_sync_sem);
+    return 0;
+}
+
+static int32_t testGetParms(uint32_t, void *)
+{
+    return 0;
+}
+
+// capabilities of a plain rear sensor, enough for every setter the
+// sequences below reach to find its value supported
+static void initTestCapability(cam_capability_t *cap)
+{
+    static const cam_dimension_t previewSizes[] = {
+        { 1920, 1080 }, { 1280, 720 }, { 640, 480 }, { 320, 240 }
+    };
+    static const cam_dimension_t pictureSizes[] = {
+        { 4160, 3120 }, { 1920, 1080 }, { 1280, 720 }, { 640, 480 }
+    };
+
+    memset(cap, 0, sizeof(cam_capability_t));
+    cap->position = CAM_POSITION_BACK;
+
+    cap->preview_sizes_tbl_cnt = sizeof(previewSizes) / sizeof(previewSizes[0]);
+    memcpy(cap->preview_sizes_tbl, previewSizes, sizeof(previewSizes));
+    cap->video_sizes_tbl_cnt = cap->preview_sizes_tbl_cnt;
+    memcpy(cap->video_sizes_tbl, previewSizes, sizeof(previewSizes));
+    cap->livesnapshot_sizes_tbl_cnt = cap->preview_sizes_tbl_cnt;
+    memcpy(cap->livesnapshot_sizes_tbl, previewSizes, sizeof(previewSizes));
+    cap->picture_sizes_tbl_cnt = sizeof(pictureSizes) / sizeof(pictureSizes[0]);
+    memcpy(cap->picture_sizes_tbl, pictureSizes, sizeof(pictureSizes));
+    cap->raw_dim = pictureSizes[0];
+
+    cap->fps_ranges_tbl_cnt = 2;
+    cap->fps_ranges_tbl[0].min_fps = 7.5;
+    cap->fps_ranges_tbl[0].max_fps = 30.0;
+    cap->fps_ranges_tbl[0].video_min_fps = 7.5;
+    cap->fps_ranges_tbl[0].video_max_fps = 30.0;
+    cap->fps_ranges_tbl[1].min_fps = 30.0;
+    cap->fps_ranges_tbl[1].max_fps = 30.0;
+    cap->fps_ranges_tbl[1].video_min_fps = 30.0;
+    cap->fps_ranges_tbl[1].video_max_fps = 30.0;
+
+    cap->supported_preview_fmt_cnt = 3;
+    cap->supported_preview_fmts[0] = CAM_FORMAT_YUV_420_NV21;
+    cap->supported_preview_fmts[1] = CAM_FORMAT_YUV_420_YV12;
+    cap->supported_preview_fmts[2] = CAM_FORMAT_YUV_420_NV12;
+
+    cap->supported_focus_modes_cnt = 4;
+    cap->supported_focus_modes[0] = CAM_FOCUS_MODE_AUTO;
+    cap->supported_focus_modes[1] = CAM_FOCUS_MODE_MACRO;
+    cap->supported_focus_modes[2] = CAM_FOCUS_MODE_INFINITY;
+    cap->supported_focus_modes[3] = CAM_FOCUS_MODE_CONTINOUS_PICTURE;
+    cap->max_num_focus_areas = 1;
+    cap->max_num_metering_areas = 1;
+    cap->max_num_roi = 5;
+
+    cap->supported_white_balances_cnt = 3;
+    cap->supported_white_balances[0] = CAM_WB_MODE_AUTO;
+    cap->supported_white_balances[1] = CAM_WB_MODE_DAYLIGHT;
+    cap->supported_white_balances[2] = CAM_WB_MODE_INCANDESCENT;
+    cap->supported_effects_cnt = 2;
+    cap->supported_effects[0] = CAM_EFFECT_MODE_OFF;
+    cap->supported_effects[1] = CAM_EFFECT_MODE_MONO;
+    cap->supported_scene_modes_cnt = 3;
+    cap->supported_scene_modes[0] = CAM_SCENE_MODE_OFF;
+    cap->supported_scene_modes[1] = CAM_SCENE_MODE_NIGHT;
+    cap->supported_scene_modes[2] = CAM_SCENE_MODE_LANDSCAPE;
+    cap->supported_antibandings_cnt = 3;
+    cap->supported_antibandings[0] = CAM_ANTIBANDING_MODE_OFF;
+    cap->supported_antibandings[1] = CAM_ANTIBANDING_MODE_50HZ;
+    cap->supported_antibandings[2] = CAM_ANTIBANDING_MODE_AUTO;
+    cap->supported_flash_modes_cnt = 3;
+    cap->supported_flash_modes[0] = CAM_FLASH_MODE_OFF;
+    cap->supported_flash_modes[1] = CAM_FLASH_MODE_AUTO;
+    cap->supported_flash_modes[2] = CAM_FLASH_MODE_ON;
+    cap->supported_iso_modes_cnt = 3;
+    cap->supported_iso_modes[0] = CAM_ISO_MODE_AUTO;
+    cap->supported_iso_modes[1] = CAM_ISO_MODE_100;
+    cap->supported_iso_modes[2] = CAM_ISO_MODE_400;
+    cap->supported_aec_modes_cnt = 2;
+    cap->supported_aec_modes[0] = CAM_AEC_MODE_FRAME_AVERAGE;
+    cap->supported_aec_modes[1] = CAM_AEC_MODE_CENTER_WEIGHTED;
+    cap->supported_focus_algos_cnt = 1;
+    cap->supported_focus_algos[0] = CAM_FOCUS_ALGO_AUTO;
+
+    cap->zoom_supported = 1;
+    cap->zoom_ratio_tbl_cnt = 4;
+    for (int i = 0; i < cap->zoom_ratio_tbl_cnt; i++) {
+        cap->zoom_ratio_tbl[i] = 100 + 50 * i;
+    }
+
+    cap->exposure_compensation_min = -12;
+    cap->exposure_compensation_max = 12;
+    cap->exposure_compensation_step = 1.0f / 6;
+
+    cap->brightness_ctrl.max_value = 6;
+    cap->brightness_ctrl.step = 1;
+    cap->brightness_ctrl.def_value = 3;
+    cap->sharpness_ctrl.max_value = 36;
+    cap->sharpness_ctrl.step = 6;
+    cap->sharpness_ctrl.def_value = 12;
+    cap->contrast_ctrl.max_value = 10;
+    cap->contrast_ctrl.step = 1;
+    cap->contrast_ctrl.def_value = 5;
+    cap->saturation_ctrl.max_value = 10;
+    cap->saturation_ctrl.step = 1;
+    cap->saturation_ctrl.def_value = 5;
+    cap->sce_ctrl.min_value = -100;
+    cap->sce_ctrl.max_value = 100;
+    cap->sce_ctrl.step = 10;
+
+    cap->focal_length = 3.5f;
+    cap->hor_view_angle = 60.0f;
+    cap->ver_view_angle = 45.0f;
+}
+
+// one QCameraParameters on the fake backend, built with the update mode
+// the constructor picks up from persist.camera.param.diff
+struct TestParams {
+    const char *name;
+    uint32_t handle;
+    mm_camera_ops_t ops;
+    mm_camera_vtbl_t vtbl;
+    cam_capability_t *cap;
+    QCameraParameters *params;
+};
+
+static bool initTestParams(TestParams &t, const char *name, uint32_t handle,
+                           const char *diffMode)
+{
+    // needs root, without it both would run the default update
+    if (property_set("persist.camera.param.diff", diffMode) != 0) {
+        fprintf(stderr, "%s: cannot set persist.camera.param.diff\n", name);
+        return false;
+    }
+
+    t.name = name;
+    t.handle = handle;
+    memset(&t.ops, 0, sizeof(t.ops));
+    t.ops.map_buf = testMapBuf;
+    t.ops.unmap_buf = testUnmapBuf;
+    t.ops.set_parms = testSetParms;
+    t.ops.get_parms = testGetParms;
+    t.vtbl.camera_handle = handle;
+    t.vtbl.ops = &t.ops;
+
+    t.cap = (cam_capability_t *)malloc(sizeof(cam_capability_t));
+    if (t.cap == NULL) {
+        return false;
+    }
+    initTestCapability(t.cap);
+
+    t.params = new QCameraParameters();
+    if (t.params->init(t.cap, &t.vtbl, NULL, NULL) != NO_ERROR) {
+        fprintf(stderr, "%s: init failed\n", name);
+        delete t.params;
+        free(t.cap);
+        return false;
+    }
+    return true;
+}
+
+static void deinitTestParams(TestParams &t)
+{
+    t.params->deinit();
+    delete t.params;
+    free(t.cap);
+}
+
+// what QCameraStateMachine does on QCAMERA_SM_EVT_SET_PARAMS
+static int32_t applyParams(TestParams &t, const String8 &str, bool &needRestart)
+{
+    QCameraParameters param(str);
+    needRestart = false;
+    int32_t rc = t.params->updateParameters(param, needRestart);
+    if (rc == NO_ERROR) {
+        rc = t.params->commitParameters();
+    }
+    return rc;
+}
+
+struct ParamEdit {
+    const char *key;
+    const char *value;   // NULL removes the key
+};
+
+struct ParamStep {
+    const char *name;
+    ParamEdit edits[MAX_STEP_EDITS];
+};
+
+// edits the app makes one after the other to the parameters it keeps,
+// every step sends the whole set
+static const ParamStep PARAM_STEPS[] = {
+    { "unchanged", { { NULL, NULL } } },
+    { "zoom", { { QCameraParameters::KEY_ZOOM, "2" } } },
+    { "zoom again", { { QCameraParameters::KEY_ZOOM, "2" } } },
+    { "preview size", { { QCameraParameters::KEY_PREVIEW_SIZE, "640x480" } } },
+    { "picture size and quality",
+      { { QCameraParameters::KEY_PICTURE_SIZE, "1920x1080" },
+        { QCameraParameters::KEY_JPEG_QUALITY, "95" } } },
+    { "focus mode", { { QCameraParameters::KEY_FOCUS_MODE,
+                        QCameraParameters::FOCUS_MODE_MACRO } } },
+    { "effect", { { QCameraParameters::KEY_EFFECT,
+                    QCameraParameters::EFFECT_MONO } } },
+    { "scene mode", { { QCameraParameters::KEY_SCENE_MODE,
+                        QCameraParameters::SCENE_MODE_NIGHT } } },
+    // the focus mode waits for the auto scene, effects are reapplied
+    // on the update after it
+    { "focus mode in scene", { { QCameraParameters::KEY_FOCUS_MODE,
+                                 QCameraParameters::FOCUS_MODE_INFINITY } } },
+    { "scene back to auto", { { QCameraParameters::KEY_SCENE_MODE,
+                                QCameraParameters::SCENE_MODE_AUTO } } },
+    { "after auto scene", { { QCameraParameters::KEY_ZOOM, "1" } } },
+    { "white balance and exposure",
+      { { QCameraParameters::KEY_WHITE_BALANCE,
+          QCameraParameters::WHITE_BALANCE_DAYLIGHT },
+        { QCameraParameters::KEY_EXPOSURE_COMPENSATION, "3" } } },
+    { "focus areas", { { QCameraParameters::KEY_FOCUS_AREAS,
+                         "(-200,-200,200,200,1)" } } },
+    { "iso and antibanding",
+      { { QCameraParameters::KEY_QC_ISO_MODE, QCameraParameters::ISO_400 },
+        { QCameraParameters::KEY_ANTIBANDING,
+          QCameraParameters::ANTIBANDING_50HZ } } },
+    { "zsl", { { QCameraParameters::KEY_QC_ZSL, QCameraParameters::VALUE_ON } } },
+    { "recording hint", { { QCameraParameters::KEY_RECORDING_HINT,
+                            QCameraParameters::VALUE_TRUE } } },
+    { "gps",
+      { { QCameraParameters::KEY_GPS_LATITUDE, "37.42" },
+        { QCameraParameters::KEY_GPS_LONGITUDE, "-122.08" },
+        { QCameraParameters::KEY_GPS_ALTITUDE, "12" },
+        { QCameraParameters::KEY_GPS_TIMESTAMP, "1445244245" } } },
+    { "gps removed",
+      { { QCameraParameters::KEY_GPS_LATITUDE, NULL },
+        { QCameraParameters::KEY_GPS_LONGITUDE, NULL },
+        { QCameraParameters::KEY_GPS_ALTITUDE, NULL },
+        { QCameraParameters::KEY_GPS_TIMESTAMP, NULL } } },
+    { "bad preview size", { { QCameraParameters::KEY_PREVIEW_SIZE, "123x45" } } },
+    { "after failure", { { QCameraParameters::KEY_PREVIEW_SIZE, "1280x720" } } },
+    { "back to defaults",
+      { { QCameraParameters::KEY_SCENE_MODE, QCameraParameters::SCENE_MODE_AUTO },
+        { QCameraParameters::KEY_FOCUS_MODE, QCameraParameters::FOCUS_MODE_AUTO },
+        { QCameraParameters::KEY_EFFECT, QCameraParameters::EFFECT_NONE },
+        { QCameraParameters::KEY_ZOOM, "0" } } },
+};
+
+static void testDiffMatchesFull(TestParams &full, TestParams &diff)
+{
+    int steps = sizeof(PARAM_STEPS) / sizeof(PARAM_STEPS[0]);
+
+    // both start from the same defaults
+    CHECK(full.params->flatten() == diff.params->flatten());
+
+    // like an app, get the parameters once and keep editing them
+    QCameraParameters app(full.params->flatten());
+    for (int i = 0; i < steps; i++) {
+        const ParamStep &step = PARAM_STEPS[i];
+        for (int j = 0; j < MAX_STEP_EDITS && step.edits[j].key != NULL; j++) {
+            if (step.edits[j].value != NULL) {
+                app.set(step.edits[j].key, step.edits[j].value);
+            } else {
+                app.remove(step.edits[j].key);
+            }
+        }
+        String8 str = app.flatten();
+
+        memset(gBatchLog, 0, sizeof(gBatchLog));
+        bool fullRestart, diffRestart;
+        int32_t fullRc = applyParams(full, str, fullRestart);
+        int32_t diffRc = applyParams(diff, str, diffRestart);
+        TestBatchLog &fullLog = batchLog(full.handle);
+        TestBatchLog &diffLog = batchLog(diff.handle);
+
+        bool same = fullRc == diffRc && fullRestart == diffRestart &&
+                !fullLog.overflow && !diffLog.overflow &&
+                fullLog.commits == diffLog.commits &&
+                fullLog.len == diffLog.len &&
+                memcmp(fullLog.data, diffLog.data, fullLog.len) == 0 &&
+                full.params->flatten() == diff.params->flatten();
+        if (!same) {
+            fprintf(stderr, "step '%s': full rc %d restart %d batch %u bytes, "
+                    "diff rc %d restart %d batch %u bytes\n", step.name,
+                    fullRc, fullRestart, fullLog.len,
+                    diffRc, diffRestart, diffLog.len);
+        }
+        CHECK(same);
+    }
+
+    // the sequence must have reached both outcomes
+    bool needRestart;
+    app.set(QCameraParameters::KEY_PREVIEW_SIZE, "320x240");
+    CHECK(applyParams(diff, app.flatten(), needRestart) == NO_ERROR);
+    CHECK(needRestart);
+    app.set(QCameraParameters::KEY_PREVIEW_SIZE, "999x999");
+    CHECK(applyParams(diff, app.flatten(), needRestart) != NO_ERROR);
+}
+
+// setParameters with one key toggled per call, parsing included
+static nsecs_t benchSingleKey(TestParams &t, int rounds)
+{
+    QCameraParameters app(t.params->flatten());
+    String8 str[2];
+    bool needRestart;
+
+    app.set(QCameraParameters::KEY_ZOOM, "1");
+    str[0] = app.flatten();
+    app.set(QCameraParameters::KEY_ZOOM, "2");
+    str[1] = app.flatten();
+
+    // first call may still run the full path
+    applyParams(t, str[1], needRestart);
+
+    nsecs_t start = systemTime();
+    for (int i = 0; i < rounds; i++) {
+        if (applyParams(t, str[i & 1], needRestart) != NO_ERROR) {
+            gFailures++;
+        }
+    }
+    return (systemTime() - start) / rounds;
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+    char oldMode[PROPERTY_VALUE_MAX];
+    TestParams full, diff;
+
+    if (rounds <= 0) {
+        rounds = 200;
+    }
+
+    property_get("persist.camera.param.diff", oldMode, "");
+    bool ok = initTestParams(full, "full", FULL_HANDLE, "0");
+    if (ok && !initTestParams(diff, "diff", DIFF_HANDLE, "1")) {
+        deinitTestParams(full);
+        ok = false;
+    }
+    property_set("persist.camera.param.diff", oldMode);
+    if (!ok) {
+        printf("FAIL: no parameters\n");
+        return 1;
+    }
+
+    testDiffMatchesFull(full, diff);
+
+    nsecs_t fullNs = benchSingleKey(full, rounds);
+    nsecs_t diffNs = benchSingleKey(diff, rounds);
+    printf("bench: setParameters one key, full %lld us, diff %lld us\n",
+           (long long)ns2us(fullNs), (long long)ns2us(diffNs));
+
+    deinitTestParams(diff);
+    deinitTestParams(full);
+
+    printf("%s: %d failures\n", gFailures ? "FAIL" : "PASS", gFailures);
+    return gFailures ? 1 : 0;
+}
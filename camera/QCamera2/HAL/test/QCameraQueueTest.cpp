@@ -0,0 +1,297 @@
+/* Copyright (c) 2015, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Checks QCameraQueue in its mutex guarded list mode and in its single
+   producer/single consumer ring mode, and times the two.
+   Usage: QCameraQueueTest [entries] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <utils/Timers.h>
+#include "QCameraQueue.h"
+
+using namespace qcamera;
+
+static int gFailures;
+static int gReleased;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+static void releaseEntry(void * /*data*/, void * /*user_data*/)
+{
+    gReleased++;
+}
+
+static int *newEntry(int value)
+{
+    int *entry = (int *)malloc(sizeof(int));
+    if (entry != NULL) {
+        *entry = value;
+    }
+    return entry;
+}
+
+static int takeEntry(void *data)
+{
+    int value = *(int *)data;
+    free(data);
+    return value;
+}
+
+static void testSpscBounds()
+{
+    QCameraQueue queue(releaseEntry, NULL, 5);
+
+    // the depth is rounded up to 8 slots
+    int queued = 0;
+    for (int i = 0; i < 9; i++) {
+        int *entry = newEntry(i);
+        if (queue.enqueue(entry)) {
+            queued++;
+        } else {
+            free(entry);
+        }
+    }
+    CHECK(queued == 8);
+    CHECK(!queue.isEmpty());
+
+    // no priority entries and no dequeue from the tail
+    int *entry = newEntry(100);
+    CHECK(!queue.enqueueWithPriority(entry));
+    free(entry);
+    CHECK(queue.dequeue(false) == NULL);
+
+    // FIFO, also across the wrap of the ring
+    int next = 0;
+    for (int i = 0; i < 4; i++) {
+        CHECK(takeEntry(queue.dequeue()) == next++);
+    }
+    for (int i = 8; i < 12; i++) {
+        CHECK(queue.enqueue(newEntry(i)));
+    }
+    for (int i = 0; i < 6; i++) {
+        CHECK(takeEntry(queue.dequeue()) == next++);
+    }
+
+    // flush releases what is left
+    gReleased = 0;
+    queue.flush();
+    CHECK(gReleased == 2);
+    CHECK(queue.isEmpty());
+    CHECK(queue.dequeue() == NULL);
+}
+
+static void testListOrder()
+{
+    QCameraQueue queue(releaseEntry, NULL);
+
+    // normal entries FIFO; priority entries ahead of them, latest first
+    CHECK(queue.enqueue(newEntry(1)));
+    CHECK(queue.enqueue(newEntry(2)));
+    CHECK(queue.enqueueWithPriority(newEntry(10)));
+    CHECK(queue.enqueue(newEntry(3)));
+    CHECK(queue.enqueueWithPriority(newEntry(11)));
+    CHECK(takeEntry(queue.dequeue()) == 11);
+    CHECK(takeEntry(queue.dequeue()) == 10);
+    CHECK(takeEntry(queue.dequeue()) == 1);
+
+    // from the tail, the normal entries go before the priority ones
+    CHECK(queue.enqueueWithPriority(newEntry(12)));
+    CHECK(takeEntry(queue.dequeue(false)) == 3);
+    CHECK(takeEntry(queue.dequeue(false)) == 2);
+    CHECK(takeEntry(queue.dequeue(false)) == 12);
+    CHECK(queue.dequeue(false) == NULL);
+    CHECK(queue.isEmpty());
+
+    // recycled nodes keep the order right over many rounds
+    int next = 0;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < round % 17; i++) {
+            CHECK(queue.enqueue(newEntry(next + i)));
+        }
+        for (int i = 0; i < round % 17; i++) {
+            CHECK(takeEntry(queue.dequeue()) == next++);
+        }
+    }
+    CHECK(queue.isEmpty());
+}
+
+static bool matchOdd(void *data, void * /*user_data*/)
+{
+    return (*(int *)data & 1) != 0;
+}
+
+static bool matchValue(void *data, void * /*user_data*/, void *match_data)
+{
+    return *(int *)data == *(int *)match_data;
+}
+
+static void testFlushNodes()
+{
+    QCameraQueue queue(releaseEntry, NULL);
+
+    for (int i = 0; i < 10; i++) {
+        CHECK(queue.enqueue(newEntry(i)));
+    }
+    CHECK(queue.enqueueWithPriority(newEntry(21)));
+    CHECK(queue.enqueueWithPriority(newEntry(22)));
+
+    // matches are released from both sublists, the rest keep their order
+    gReleased = 0;
+    queue.flushNodes(matchOdd);
+    CHECK(gReleased == 6);
+    int value = 4;
+    queue.flushNodes(matchValue, &value);
+    CHECK(gReleased == 7);
+
+    CHECK(takeEntry(queue.dequeue()) == 22);
+    CHECK(takeEntry(queue.dequeue()) == 0);
+    CHECK(takeEntry(queue.dequeue()) == 2);
+    CHECK(takeEntry(queue.dequeue()) == 6);
+
+    gReleased = 0;
+    queue.flush();
+    CHECK(gReleased == 1);
+    CHECK(queue.isEmpty());
+}
+
+struct ProducerArgs {
+    QCameraQueue *queue;
+    int count;
+};
+
+static void *producer(void *arg)
+{
+    ProducerArgs *args = (ProducerArgs *)arg;
+    for (int i = 0; i < args->count; i++) {
+        int *entry = newEntry(i);
+        while (!args->queue->enqueue(entry)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// entries through the queue from one thread to another, in order;
+// returns ns per entry
+static nsecs_t passEntries(QCameraQueue &queue, int count)
+{
+    ProducerArgs args = { &queue, count };
+    pthread_t thread;
+    int next = 0;
+    int outOfOrder = 0;
+
+    nsecs_t start = systemTime();
+    pthread_create(&thread, NULL, producer, &args);
+    while (next < count) {
+        void *data = queue.dequeue();
+        if (data == NULL) {
+            sched_yield();
+            continue;
+        }
+        if (takeEntry(data) != next) {
+            outOfOrder++;
+        }
+        next++;
+    }
+    pthread_join(thread, NULL);
+    nsecs_t elapsed = systemTime() - start;
+
+    CHECK(outOfOrder == 0);
+    CHECK(queue.isEmpty());
+    return elapsed / count;
+}
+
+// enqueue and dequeue on one thread; returns ns per pair
+static nsecs_t pairEntries(QCameraQueue &queue, int count)
+{
+    int entry = 0;
+    nsecs_t start = systemTime();
+    for (int i = 0; i < count; i++) {
+        queue.enqueue(&entry);
+        queue.dequeue();
+    }
+    return (systemTime() - start) / count;
+}
+
+// bursts of entries queued up and then drained, as frames pile up
+// behind a slow consumer; returns ns per entry
+static nsecs_t burstEntries(QCameraQueue &queue, int count, int burst)
+{
+    int entry = 0;
+    int rounds = count / burst;
+    nsecs_t start = systemTime();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < burst; i++) {
+            queue.enqueue(&entry);
+        }
+        while (queue.dequeue() != NULL) {
+        }
+    }
+    return (systemTime() - start) / ((nsecs_t)rounds * burst);
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (count < 1) {
+        fprintf(stderr, "usage: %s [entries]\n", argv[0]);
+        return 1;
+    }
+
+    testListOrder();
+    testFlushNodes();
+    testSpscBounds();
+
+    QCameraQueue spsc(releaseEntry, NULL, 32);
+    QCameraQueue list(releaseEntry, NULL);
+    nsecs_t spscPass = passEntries(spsc, count);
+    nsecs_t listPass = passEntries(list, count);
+    nsecs_t spscPair = pairEntries(spsc, count);
+    nsecs_t listPair = pairEntries(list, count);
+    printf("bench: %d entries between threads, spsc %lld ns, list %lld ns "
+           "per entry\n", count, (long long)spscPass, (long long)listPass);
+    printf("bench: enqueue+dequeue on one thread, spsc %lld ns, list %lld ns\n",
+           (long long)spscPair, (long long)listPair);
+    printf("bench: bursts of 16 on one thread, list %lld ns per entry\n",
+           (long long)burstEntries(list, count, 16));
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
@@ -687,4 +687,38 @@ int32_t mm_stream_calc_offset_postproc(cam_stream_info_t *stream_info,
         cam_padding_info_t *padding,
         cam_stream_buf_plane_info_t *buf_planes);
 
+/** cam_trace_stage_t: frame pipeline stages stamped by the frame tracer,
+*    in the order a frame goes through them
+**/
+typedef enum {
+    CAM_TRACE_POLL_WAKEUP,      /* poll thread woke up for the frame */
+    CAM_TRACE_STREAM_RCVD,      /* frame dequeued from kernel */
+    CAM_TRACE_SUPERBUF_MATCHED, /* superbuf of the frame completed */
+    CAM_TRACE_HAL_DATA_PROC,    /* HAL stream thread picked up the frame */
+    CAM_TRACE_HAL_CB,           /* HAL stream callback entered */
+    CAM_TRACE_DISPLAY_ENQUEUE,  /* frame queued to the display */
+    CAM_TRACE_POSTPROC_INPUT,   /* frame queued for postprocessing */
+    CAM_TRACE_JPEG_START,       /* jpeg encoding of the frame started */
+    CAM_TRACE_JPEG_DONE,        /* jpeg encoding of the frame done */
+    CAM_TRACE_STAGE_MAX
+} cam_trace_stage_t;
+
+/* frame tracer, enabled by persist.camera.trace
+ * (1: stamp into ring, 2: also emit systrace counters) */
+uint8_t mm_camera_trace_enabled();
+int64_t mm_camera_trace_now();
+void mm_camera_trace_stamp(cam_trace_stage_t stage,
+        uint32_t stream_id,
+        uint32_t frame_idx);
+void mm_camera_trace_stamp_at(cam_trace_stage_t stage,
+        uint32_t stream_id,
+        uint32_t frame_idx,
+        int64_t ts_ns);
+
+/* drop the stamps of earlier sessions, done on camera open */
+void mm_camera_trace_reset();
+
+/* write the traced stamps as Chrome trace JSON, returns number of stamps */
+int32_t mm_camera_trace_dump(int fd);
+
 #endif /*__MM_CAMERA_INTERFACE_H__*/
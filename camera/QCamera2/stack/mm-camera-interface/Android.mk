@@ -11,6 +11,7 @@ MM_CAM_FILES := \
         src/mm_camera_stream.c \
         src/mm_camera_thread.c \
         src/mm_camera_sock.c \
+        src/mm_camera_trace.c \
         src/cam_intf.c
 
 ifeq ($(strip $(TARGET_USES_ION)),true)
@@ -153,6 +153,7 @@ typedef struct {
     pthread_mutex_t mutex;
     pthread_cond_t cond_v;
     int32_t status;
+    int64_t wakeup_ts; /* last wakeup time, only set when tracing */
     //void *my_obj;
 } mm_camera_poll_thread_t;
 
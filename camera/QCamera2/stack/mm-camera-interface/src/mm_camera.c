@@ -309,6 +309,9 @@ int32_t mm_camera_open(mm_camera_obj_t *my_obj)
                                  MM_CAMERA_POLL_TYPE_EVT);
     mm_camera_evt_sub(my_obj, TRUE);
 
+    /* frame trace of this camera starts from an empty ring */
+    mm_camera_trace_reset();
+
     CDBG("%s:  end (rc = %d)\n", __func__, rc);
     /* we do not need to unlock cam_lock here before return
      * because for open, it's done within intf_lock */
@@ -1848,6 +1848,13 @@ int32_t mm_channel_superbuf_comp_and_enqueue(
             }
 
             if (super_buf->matched) {
+                if (mm_camera_trace_enabled()) {
+                    for (i = 0; i < super_buf->num_of_bufs; i++) {
+                        mm_camera_trace_stamp(CAM_TRACE_SUPERBUF_MATCHED,
+                                              super_buf->super_buf[i].stream_id,
+                                              super_buf->frame_idx);
+                    }
+                }
                 if(ch_obj->isFlashBracketingEnabled) {
                     queue->expected_frame_id =
                         queue->expected_frame_id_without_led;
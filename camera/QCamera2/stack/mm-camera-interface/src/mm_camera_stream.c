@@ -223,6 +223,14 @@ static void mm_stream_data_notify(void* user_data)
     }
     idx = buf_info.buf->buf_idx;
 
+    if (mm_camera_trace_enabled()) {
+        mm_camera_trace_stamp_at(CAM_TRACE_POLL_WAKEUP, my_obj->my_hdl,
+                                 buf_info.frame_idx,
+                                 my_obj->ch_obj->poll_thread[0].wakeup_ts);
+        mm_camera_trace_stamp(CAM_TRACE_STREAM_RCVD, my_obj->my_hdl,
+                              buf_info.frame_idx);
+    }
+
     pthread_mutex_lock(&my_obj->cb_lock);
     for (i = 0; i < MM_CAMERA_STREAM_BUF_CB_MAX; i++) {
         if(NULL != my_obj->buf_cb[i].cb) {
@@ -282,6 +282,9 @@ static void *mm_camera_poll_fn(mm_camera_poll_thread_t *poll_cb)
 
          rc = poll(poll_cb->poll_fds, poll_cb->num_fds, poll_cb->timeoutms);
          if(rc > 0) {
+            if (mm_camera_trace_enabled()) {
+                poll_cb->wakeup_ts = mm_camera_trace_now();
+            }
             if ((poll_cb->poll_fds[0].revents & POLLIN) &&
                 (poll_cb->poll_fds[0].revents & POLLRDNORM)) {
                 /* if we have data on pipe, we only process pipe in this iteration */
@@ -0,0 +1,277 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cutils/properties.h>
+#include <cutils/trace.h>
+
+#include "mm_camera_dbg.h"
+#include "mm_camera_interface.h"
+
+/* Frame tracer: every stage a frame goes through is stamped into a global
+ * ring. Writers claim a slot with an atomic increment and publish it with
+ * a sequence number, so stamping takes no lock. The ring is overwritten
+ * when it wraps; mm_camera_trace_dump() skips slots being rewritten. It is
+ * reset every time a camera is opened, so a dump holds the current session. */
+
+#define MM_CAMERA_TRACE_SIZE 8192 /* must be power of 2 */
+
+typedef struct {
+    uint32_t seq;           /* claim count + 1 once written, 0 while writing */
+    uint32_t stage;
+    uint32_t stream_id;
+    uint32_t frame_idx;
+    int64_t ts_ns;
+} mm_camera_trace_entry_t;
+
+static mm_camera_trace_entry_t g_trace_ring[MM_CAMERA_TRACE_SIZE];
+static uint32_t g_trace_pos = 0;
+static uint8_t g_trace_mode = 0; /* 0 off, 1 ring, 2 ring and systrace */
+static pthread_once_t g_trace_once = PTHREAD_ONCE_INIT;
+
+static const char *g_trace_stage_names[CAM_TRACE_STAGE_MAX] = {
+    "poll_wakeup",
+    "stream_rcvd",
+    "superbuf_matched",
+    "hal_data_proc",
+    "hal_cb",
+    "display_enqueue",
+    "postproc_input",
+    "jpeg_start",
+    "jpeg_done",
+};
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_init
+ *
+ * DESCRIPTION: read the trace mode from persist.camera.trace, once
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_trace_init(void)
+{
+    char prop[PROPERTY_VALUE_MAX];
+
+    property_get("persist.camera.trace", prop, "0");
+    g_trace_mode = (uint8_t)atoi(prop);
+    CDBG_HIGH("%s: frame trace mode %d", __func__, g_trace_mode);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_enabled
+ *
+ * DESCRIPTION: check if frame tracing is enabled
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : TRUE if enabled, FALSE otherwise
+ *==========================================================================*/
+uint8_t mm_camera_trace_enabled()
+{
+    pthread_once(&g_trace_once, mm_camera_trace_init);
+    return g_trace_mode > 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_now
+ *
+ * DESCRIPTION: monotonic timestamp used by the frame tracer
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : time in ns
+ *==========================================================================*/
+int64_t mm_camera_trace_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_stamp_at
+ *
+ * DESCRIPTION: record that a frame reached a pipeline stage at a given time
+ *
+ * PARAMETERS :
+ *   @stage     : pipeline stage
+ *   @stream_id : handle of the stream the frame belongs to
+ *   @frame_idx : frame sequence number
+ *   @ts_ns     : time from mm_camera_trace_now()
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void mm_camera_trace_stamp_at(cam_trace_stage_t stage,
+                              uint32_t stream_id,
+                              uint32_t frame_idx,
+                              int64_t ts_ns)
+{
+    mm_camera_trace_entry_t *entry;
+    uint32_t pos;
+
+    if (!mm_camera_trace_enabled() || stage >= CAM_TRACE_STAGE_MAX) {
+        return;
+    }
+
+    pos = __atomic_fetch_add(&g_trace_pos, 1, __ATOMIC_RELAXED);
+    entry = &g_trace_ring[pos & (MM_CAMERA_TRACE_SIZE - 1)];
+
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    entry->stage = stage;
+    entry->stream_id = stream_id;
+    entry->frame_idx = frame_idx;
+    entry->ts_ns = ts_ns;
+    __atomic_store_n(&entry->seq, pos + 1, __ATOMIC_RELEASE);
+
+    if (g_trace_mode > 1) {
+        ATRACE_INT(g_trace_stage_names[stage], frame_idx);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_stamp
+ *
+ * DESCRIPTION: record that a frame reached a pipeline stage now
+ *
+ * PARAMETERS :
+ *   @stage     : pipeline stage
+ *   @stream_id : handle of the stream the frame belongs to
+ *   @frame_idx : frame sequence number
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void mm_camera_trace_stamp(cam_trace_stage_t stage,
+                           uint32_t stream_id,
+                           uint32_t frame_idx)
+{
+    if (!mm_camera_trace_enabled()) {
+        return;
+    }
+    mm_camera_trace_stamp_at(stage, stream_id, frame_idx,
+                             mm_camera_trace_now());
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_reset
+ *
+ * DESCRIPTION: drop the stamps of earlier sessions from the ring. A stamp
+ *              still being written during the reset keeps its old
+ *              sequence number and is skipped by mm_camera_trace_dump()
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void mm_camera_trace_reset()
+{
+    uint32_t i;
+
+    if (!mm_camera_trace_enabled()) {
+        return;
+    }
+
+    __atomic_store_n(&g_trace_pos, 0, __ATOMIC_RELAXED);
+    for (i = 0; i < MM_CAMERA_TRACE_SIZE; i++) {
+        __atomic_store_n(&g_trace_ring[i].seq, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_trace_dump
+ *
+ * DESCRIPTION: write the stamps in the ring as Chrome trace JSON, one
+ *              instant event per stamp, with the stream handle as pid, the
+ *              stage as tid and the frame sequence number as argument
+ *
+ * PARAMETERS :
+ *   @fd : file descriptor to write to
+ *
+ * RETURN     : number of stamps written, -1 on failure
+ *==========================================================================*/
+int32_t mm_camera_trace_dump(int fd)
+{
+    mm_camera_trace_entry_t entry;
+    uint32_t end, start, pos, seq;
+    int32_t cnt = 0;
+    FILE *fp;
+
+    if (!mm_camera_trace_enabled()) {
+        return -1;
+    }
+
+    fp = fdopen(dup(fd), "w");
+    if (NULL == fp) {
+        CDBG_ERROR("%s: cannot open trace fd %d", __func__, fd);
+        return -1;
+    }
+
+    end = __atomic_load_n(&g_trace_pos, __ATOMIC_ACQUIRE);
+    start = (end > MM_CAMERA_TRACE_SIZE) ? end - MM_CAMERA_TRACE_SIZE : 0;
+
+    fprintf(fp, "{\"traceEvents\":[");
+    for (pos = start; pos != end; pos++) {
+        mm_camera_trace_entry_t *slot =
+            &g_trace_ring[pos & (MM_CAMERA_TRACE_SIZE - 1)];
+
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        entry = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != pos + 1 ||
+            __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            /* not written yet, or overwritten while reading */
+            continue;
+        }
+
+        fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"i\","
+                "\"s\":\"t\",\"ts\":%lld.%03lld,\"pid\":%u,\"tid\":%u,"
+                "\"args\":{\"frame\":%u}}",
+                cnt > 0 ? "," : "",
+                g_trace_stage_names[entry.stage],
+                (long long)(entry.ts_ns / 1000),
+                (long long)(entry.ts_ns % 1000),
+                entry.stream_id, entry.stage, entry.frame_idx);
+        cnt++;
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    return cnt;
+}
@@ -27,6 +27,11 @@
 *
 */
 
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include "QCameraCmdThread.h"
@@ -44,12 +49,19 @@ namespace qcamera {
  *
  * RETURN     : None
  *==========================================================================*/
-QCameraCmdThread::QCameraCmdThread() :
-    cmd_queue()
+QCameraCmdThread::QCameraCmdThread()
 {
     cmd_pid = 0;
-    cam_sem_init(&sync_sem, 0);
-    cam_sem_init(&cmd_sem, 0);
+    pthread_mutex_init(&cmd_lock, NULL);
+    cmd_ring = cmd_inline;
+    cmd_size = QCAMERA_CMD_RING_SIZE;
+    cmd_head = 0;
+    cmd_cnt = 0;
+    sync_val = 0;
+    cmd_fd = eventfd(0, EFD_CLOEXEC);
+    if (cmd_fd < 0) {
+        ALOGE("%s: eventfd failed (%s)", __func__, strerror(errno));
+    }
 }
 
 /*===========================================================================
@@ -63,8 +75,13 @@ QCameraCmdThread::QCameraCmdThread() :
  *==========================================================================*/
 QCameraCmdThread::~QCameraCmdThread()
 {
-    cam_sem_destroy(&sync_sem);
-    cam_sem_destroy(&cmd_sem);
+    if (cmd_fd >= 0) {
+        close(cmd_fd);
+    }
+    if (cmd_ring != cmd_inline) {
+        free(cmd_ring);
+    }
+    pthread_mutex_destroy(&cmd_lock);
 }
 
 /*===========================================================================
@@ -109,24 +126,48 @@ int32_t QCameraCmdThread::launch(void *(*start_routine)(void *),
  *==========================================================================*/
 int32_t QCameraCmdThread::sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8_t priority)
 {
-    camera_cmd_t *node = (camera_cmd_t *)malloc(sizeof(camera_cmd_t));
-    if (NULL == node) {
-        ALOGE("%s: No memory for camera_cmd_t", __func__);
-        return NO_MEMORY;
+    bool wake = false;
+
+    pthread_mutex_lock(&cmd_lock);
+    if (cmd_cnt == cmd_size) {
+        camera_cmd_type_t *ring = (camera_cmd_type_t *)
+            malloc(2 * cmd_size * sizeof(camera_cmd_type_t));
+        if (NULL == ring) {
+            pthread_mutex_unlock(&cmd_lock);
+            ALOGE("%s: No memory for %d cmds", __func__, 2 * cmd_size);
+            return NO_MEMORY;
+        }
+        for (uint32_t i = 0; i < cmd_cnt; i++) {
+            ring[i] = cmd_ring[(cmd_head + i) % cmd_size];
+        }
+        if (cmd_ring != cmd_inline) {
+            free(cmd_ring);
+        }
+        cmd_ring = ring;
+        cmd_size *= 2;
+        cmd_head = 0;
     }
-    memset(node, 0, sizeof(camera_cmd_t));
-    node->cmd = cmd;
 
     if (priority) {
-        cmd_queue.enqueueWithPriority((void *)node);
+        cmd_head = (cmd_head + cmd_size - 1) % cmd_size;
+        cmd_ring[cmd_head] = cmd;
     } else {
-        cmd_queue.enqueue((void *)node);
+        cmd_ring[(cmd_head + cmd_cnt) % cmd_size] = cmd;
+    }
+    wake = (cmd_cnt == 0);
+    cmd_cnt++;
+    pthread_mutex_unlock(&cmd_lock);
+
+    if (wake) {
+        uint64_t one = 1;
+        if (write(cmd_fd, &one, sizeof(one)) != sizeof(one)) {
+            ALOGE("%s: eventfd write failed (%s)", __func__, strerror(errno));
+        }
     }
-    cam_sem_post(&cmd_sem);
 
     /* if is a sync call, need to wait until it returns */
     if (sync_cmd) {
-        cam_sem_wait(&sync_sem);
+        waitSync();
     }
     return NO_ERROR;
 }
@@ -143,17 +184,93 @@ int32_t QCameraCmdThread::sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8
 camera_cmd_type_t QCameraCmdThread::getCmd()
 {
     camera_cmd_type_t cmd = CAMERA_CMD_TYPE_NONE;
-    camera_cmd_t *node = (camera_cmd_t *)cmd_queue.dequeue();
-    if (NULL == node) {
+
+    pthread_mutex_lock(&cmd_lock);
+    if (cmd_cnt > 0) {
+        cmd = cmd_ring[cmd_head];
+        cmd_head = (cmd_head + 1) % cmd_size;
+        cmd_cnt--;
+    }
+    pthread_mutex_unlock(&cmd_lock);
+
+    if (CAMERA_CMD_TYPE_NONE == cmd) {
         ALOGD("%s: No notify avail", __func__);
-        return CAMERA_CMD_TYPE_NONE;
-    } else {
-        cmd = node->cmd;
-        free(node);
     }
     return cmd;
 }
 
+/*===========================================================================
+ * FUNCTION   : waitCmd
+ *
+ * DESCRIPTION: block the cmd thread until a command is pending. Called by
+ *              the thread routine before each getCmd().
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : 0 -- a command is pending
+ *              -1 -- wait failed, errno is set
+ *==========================================================================*/
+int QCameraCmdThread::waitCmd()
+{
+    uint64_t cnt;
+
+    while (true) {
+        pthread_mutex_lock(&cmd_lock);
+        bool pending = cmd_cnt > 0;
+        pthread_mutex_unlock(&cmd_lock);
+        if (pending) {
+            return 0;
+        }
+
+        // eventfd is written when the ring turns non-empty, a stale
+        // count only costs one more pass
+        if (read(cmd_fd, &cnt, sizeof(cnt)) < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : signalSync
+ *
+ * DESCRIPTION: signal completion of a synchronized command to its sender
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCmdThread::signalSync()
+{
+    __atomic_add_fetch(&sync_val, 1, __ATOMIC_RELEASE);
+    syscall(__NR_futex, &sync_val, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/*===========================================================================
+ * FUNCTION   : waitSync
+ *
+ * DESCRIPTION: wait until the cmd thread signals completion of a
+ *              synchronized command
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCmdThread::waitSync()
+{
+    while (true) {
+        int32_t val = __atomic_load_n(&sync_val, __ATOMIC_ACQUIRE);
+        if (val > 0) {
+            if (__atomic_compare_exchange_n(&sync_val, &val, val - 1, false,
+                                            __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED)) {
+                return;
+            }
+            continue;
+        }
+        syscall(__NR_futex, &sync_val, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+    }
+}
+
 /*===========================================================================
  * FUNCTION   : exit
  *
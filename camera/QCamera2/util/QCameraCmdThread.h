@@ -52,6 +52,14 @@ typedef struct {
     camera_cmd_type_t cmd;
 } camera_cmd_t;
 
+#define QCAMERA_CMD_RING_SIZE 64
+
+// Commands are kept inline in a ring that grows when full, so sending a
+// command does not allocate. The thread routine blocks in waitCmd() on an
+// eventfd, which is written when the ring goes from empty to non-empty;
+// getEventFd() lets a routine poll it together with other fds, in which
+// case it calls getCmd() until it returns CAMERA_CMD_TYPE_NONE. Senders of
+// synchronous commands wait on a futex until the routine calls signalSync().
 class QCameraCmdThread {
 public:
     QCameraCmdThread();
@@ -61,11 +69,23 @@ public:
     int32_t exit();
     int32_t sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8_t priority);
     camera_cmd_type_t getCmd();
+    int waitCmd();
+    void signalSync();
+    int getEventFd() { return cmd_fd; };
 
-    QCameraQueue cmd_queue;      /* cmd queue */
     pthread_t cmd_pid;           /* cmd thread ID */
-    cam_semaphore_t cmd_sem;               /* semaphore for cmd thread */
-    cam_semaphore_t sync_sem;              /* semaphore for synchronized call signal */
+
+private:
+    void waitSync();
+
+    pthread_mutex_t cmd_lock;    /* protects the cmd ring */
+    camera_cmd_type_t *cmd_ring; /* pending cmds, cmd_head is the next one */
+    uint32_t cmd_size;
+    uint32_t cmd_head;
+    uint32_t cmd_cnt;
+    camera_cmd_type_t cmd_inline[QCAMERA_CMD_RING_SIZE];
+    int cmd_fd;                  /* eventfd signaled on new cmds */
+    int32_t sync_val;            /* futex for synchronized call signal */
 };
 
 }; // namespace qcamera
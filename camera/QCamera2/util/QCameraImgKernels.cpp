@@ -0,0 +1,459 @@
+/* Copyright (c) 2014, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "QCameraImgKernels.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define QCAMERA_IMG_NEON 1
+#endif
+
+namespace qcamera {
+
+/*===========================================================================
+ * FUNCTION   : copyPlane
+ *
+ * DESCRIPTION: copy a plane between buffers of different strides
+ *
+ * PARAMETERS :
+ *   @dst       : destination plane
+ *   @dstStride : destination stride in bytes
+ *   @src       : source plane
+ *   @srcStride : source stride in bytes
+ *   @width     : row length in bytes
+ *   @height    : number of rows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::copyPlane(uint8_t *dst, uint32_t dstStride,
+                                  const uint8_t *src, uint32_t srcStride,
+                                  uint32_t width, uint32_t height)
+{
+    if (dstStride == width && srcStride == width) {
+        memcpy(dst, src, width * height);
+        return;
+    }
+    for (uint32_t i = 0; i < height; i++) {
+        memcpy(dst, src, width);
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : cropPlane
+ *
+ * DESCRIPTION: copy a rectangle of a plane. For semi planar chroma pass
+ *              the chroma coordinates and 2 bytes per pixel.
+ *
+ * PARAMETERS :
+ *   @dst           : destination plane
+ *   @dstStride     : destination stride in bytes
+ *   @src           : source plane
+ *   @srcStride     : source stride in bytes
+ *   @x             : left of the rectangle in pixels
+ *   @y             : top of the rectangle in rows
+ *   @width         : width of the rectangle in pixels
+ *   @height        : height of the rectangle in rows
+ *   @bytesPerPixel : bytes per pixel of the plane
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::cropPlane(uint8_t *dst, uint32_t dstStride,
+                                  const uint8_t *src, uint32_t srcStride,
+                                  uint32_t x, uint32_t y,
+                                  uint32_t width, uint32_t height,
+                                  uint32_t bytesPerPixel)
+{
+    src += y * srcStride + x * bytesPerPixel;
+    for (uint32_t i = 0; i < height; i++) {
+        cropRow(dst, src, width * bytesPerPixel);
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : swapUV
+ *
+ * DESCRIPTION: swap the bytes of each chroma pair, converting NV12 chroma
+ *              to NV21 and back
+ *
+ * PARAMETERS :
+ *   @dst       : destination chroma plane, may be src
+ *   @dstStride : destination stride in bytes
+ *   @src       : source chroma plane
+ *   @srcStride : source stride in bytes
+ *   @pairs     : UV pairs per row
+ *   @height    : number of rows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::swapUV(uint8_t *dst, uint32_t dstStride,
+                               const uint8_t *src, uint32_t srcStride,
+                               uint32_t pairs, uint32_t height)
+{
+    for (uint32_t i = 0; i < height; i++) {
+        swapUVRow(dst, src, pairs);
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : interleaveUV
+ *
+ * DESCRIPTION: merge two chroma planes into one semi planar plane. Pass
+ *              V then U for NV21 output, U then V for NV12.
+ *
+ * PARAMETERS :
+ *   @dst          : destination semi planar chroma
+ *   @dstStride    : destination stride in bytes
+ *   @first        : plane written to even bytes
+ *   @firstStride  : stride of first in bytes
+ *   @second       : plane written to odd bytes
+ *   @secondStride : stride of second in bytes
+ *   @pairs        : UV pairs per row
+ *   @height       : number of rows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::interleaveUV(uint8_t *dst, uint32_t dstStride,
+                                     const uint8_t *first, uint32_t firstStride,
+                                     const uint8_t *second, uint32_t secondStride,
+                                     uint32_t pairs, uint32_t height)
+{
+    for (uint32_t i = 0; i < height; i++) {
+        interleaveRow(dst, first, second, pairs);
+        dst += dstStride;
+        first += firstStride;
+        second += secondStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : deinterleaveUV
+ *
+ * DESCRIPTION: split a semi planar chroma plane into two planes
+ *
+ * PARAMETERS :
+ *   @first        : plane receiving even bytes
+ *   @firstStride  : stride of first in bytes
+ *   @second       : plane receiving odd bytes
+ *   @secondStride : stride of second in bytes
+ *   @src          : source semi planar chroma
+ *   @srcStride    : source stride in bytes
+ *   @pairs        : UV pairs per row
+ *   @height       : number of rows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::deinterleaveUV(uint8_t *first, uint32_t firstStride,
+                                       uint8_t *second, uint32_t secondStride,
+                                       const uint8_t *src, uint32_t srcStride,
+                                       uint32_t pairs, uint32_t height)
+{
+    for (uint32_t i = 0; i < height; i++) {
+        deinterleaveRow(first, second, src, pairs);
+        first += firstStride;
+        second += secondStride;
+        src += srcStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : downscale2x
+ *
+ * DESCRIPTION: halve a plane in both directions, each output pixel is
+ *              the rounded mean of a 2x2 block
+ *
+ * PARAMETERS :
+ *   @dst       : destination plane
+ *   @dstStride : destination stride in bytes
+ *   @src       : source plane, at least 2*dstWidth x 2*dstHeight
+ *   @srcStride : source stride in bytes
+ *   @dstWidth  : destination width in pixels
+ *   @dstHeight : destination height in rows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::downscale2x(uint8_t *dst, uint32_t dstStride,
+                                    const uint8_t *src, uint32_t srcStride,
+                                    uint32_t dstWidth, uint32_t dstHeight)
+{
+    for (uint32_t i = 0; i < dstHeight; i++) {
+        downscaleRow(dst, src, src + srcStride, dstWidth);
+        dst += dstStride;
+        src += 2 * srcStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : downscale2xUV
+ *
+ * DESCRIPTION: halve a semi planar chroma plane in both directions, each
+ *              channel averaged separately
+ *
+ * PARAMETERS :
+ *   @dst       : destination chroma plane
+ *   @dstStride : destination stride in bytes
+ *   @src       : source chroma plane, at least 2*dstPairs x 2*dstHeight
+ *   @srcStride : source stride in bytes
+ *   @dstPairs  : destination UV pairs per row
+ *   @dstHeight : destination height in rows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::downscale2xUV(uint8_t *dst, uint32_t dstStride,
+                                      const uint8_t *src, uint32_t srcStride,
+                                      uint32_t dstPairs, uint32_t dstHeight)
+{
+    for (uint32_t i = 0; i < dstHeight; i++) {
+        downscaleUVRow(dst, src, src + srcStride, dstPairs);
+        dst += dstStride;
+        src += 2 * srcStride;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : cropRow
+ *
+ * DESCRIPTION: copy one row of a crop rectangle. The rectangle starts at
+ *              any pixel, so neither side is aligned.
+ *
+ * PARAMETERS :
+ *   @dst     : destination row
+ *   @src     : first byte of the rectangle in the source row
+ *   @bytes   : row length in bytes
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::cropRow(uint8_t *dst, const uint8_t *src,
+                                uint32_t bytes)
+{
+    size_t i = 0;
+#ifdef QCAMERA_IMG_NEON
+    for (; i + 64 <= bytes; i += 64) {
+        uint8x16_t a = vld1q_u8(src + i);
+        uint8x16_t b = vld1q_u8(src + i + 16);
+        uint8x16_t c = vld1q_u8(src + i + 32);
+        uint8x16_t d = vld1q_u8(src + i + 48);
+        vst1q_u8(dst + i, a);
+        vst1q_u8(dst + i + 16, b);
+        vst1q_u8(dst + i + 32, c);
+        vst1q_u8(dst + i + 48, d);
+    }
+    for (; i + 16 <= bytes; i += 16) {
+        vst1q_u8(dst + i, vld1q_u8(src + i));
+    }
+#endif
+    if (i < bytes) {
+        memcpy(dst + i, src + i, bytes - i);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : swapUVRow
+ *
+ * DESCRIPTION: swap the bytes of each pair in one row
+ *
+ * PARAMETERS :
+ *   @dst     : destination row, may be src
+ *   @src     : source row
+ *   @pairs   : number of pairs
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::swapUVRow(uint8_t *dst, const uint8_t *src,
+                                  uint32_t pairs)
+{
+    size_t i = 0;
+#ifdef QCAMERA_IMG_NEON
+    for (; i + 16 <= pairs; i += 16) {
+        uint8x16x2_t in = vld2q_u8(src + 2 * i);
+        uint8x16x2_t out;
+        out.val[0] = in.val[1];
+        out.val[1] = in.val[0];
+        vst2q_u8(dst + 2 * i, out);
+    }
+#endif
+    // four pairs per word; loaded whole before stored, so in place works
+    for (; i + 4 <= pairs; i += 4) {
+        uint64_t w;
+        memcpy(&w, src + 2 * i, sizeof(w));
+        w = ((w & 0x00ff00ff00ff00ffULL) << 8) |
+            ((w >> 8) & 0x00ff00ff00ff00ffULL);
+        memcpy(dst + 2 * i, &w, sizeof(w));
+    }
+    for (; i < pairs; i++) {
+        uint8_t first = src[2 * i];
+        dst[2 * i] = src[2 * i + 1];
+        dst[2 * i + 1] = first;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : interleaveRow
+ *
+ * DESCRIPTION: merge two rows into one row of pairs
+ *
+ * PARAMETERS :
+ *   @dst     : destination row
+ *   @first   : row written to even bytes
+ *   @second  : row written to odd bytes
+ *   @pairs   : number of pairs
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::interleaveRow(uint8_t *dst, const uint8_t *first,
+                                      const uint8_t *second, uint32_t pairs)
+{
+    size_t i = 0;
+#ifdef QCAMERA_IMG_NEON
+    for (; i + 16 <= pairs; i += 16) {
+        uint8x16x2_t out;
+        out.val[0] = vld1q_u8(first + i);
+        out.val[1] = vld1q_u8(second + i);
+        vst2q_u8(dst + 2 * i, out);
+    }
+#endif
+    for (; i < pairs; i++) {
+        dst[2 * i] = first[i];
+        dst[2 * i + 1] = second[i];
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : deinterleaveRow
+ *
+ * DESCRIPTION: split one row of pairs into two rows
+ *
+ * PARAMETERS :
+ *   @first   : row receiving even bytes
+ *   @second  : row receiving odd bytes
+ *   @src     : source row
+ *   @pairs   : number of pairs
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::deinterleaveRow(uint8_t *first, uint8_t *second,
+                                        const uint8_t *src, uint32_t pairs)
+{
+    size_t i = 0;
+#ifdef QCAMERA_IMG_NEON
+    for (; i + 16 <= pairs; i += 16) {
+        uint8x16x2_t in = vld2q_u8(src + 2 * i);
+        vst1q_u8(first + i, in.val[0]);
+        vst1q_u8(second + i, in.val[1]);
+    }
+#endif
+    for (; i < pairs; i++) {
+        first[i] = src[2 * i];
+        second[i] = src[2 * i + 1];
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : downscaleRow
+ *
+ * DESCRIPTION: produce one output row from two input rows, 2x2 box filter
+ *
+ * PARAMETERS :
+ *   @dst      : destination row
+ *   @row0     : upper source row
+ *   @row1     : lower source row
+ *   @dstWidth : destination pixels
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::downscaleRow(uint8_t *dst, const uint8_t *row0,
+                                     const uint8_t *row1, uint32_t dstWidth)
+{
+    size_t i = 0;
+#ifdef QCAMERA_IMG_NEON
+    for (; i + 16 <= dstWidth; i += 16) {
+        uint16x8_t lo = vaddq_u16(vpaddlq_u8(vld1q_u8(row0 + 2 * i)),
+                                  vpaddlq_u8(vld1q_u8(row1 + 2 * i)));
+        uint16x8_t hi = vaddq_u16(vpaddlq_u8(vld1q_u8(row0 + 2 * i + 16)),
+                                  vpaddlq_u8(vld1q_u8(row1 + 2 * i + 16)));
+        vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 2),
+                                      vrshrn_n_u16(hi, 2)));
+    }
+#endif
+    for (; i < dstWidth; i++) {
+        uint32_t sum = row0[2 * i] + row0[2 * i + 1] +
+                       row1[2 * i] + row1[2 * i + 1];
+        dst[i] = (uint8_t)((sum + 2) >> 2);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : downscaleUVRow
+ *
+ * DESCRIPTION: produce one output chroma row from two input rows, 2x2 box
+ *              filter per channel
+ *
+ * PARAMETERS :
+ *   @dst      : destination row
+ *   @row0     : upper source row
+ *   @row1     : lower source row
+ *   @dstPairs : destination UV pairs
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraImgKernels::downscaleUVRow(uint8_t *dst, const uint8_t *row0,
+                                       const uint8_t *row1, uint32_t dstPairs)
+{
+    size_t i = 0;
+#ifdef QCAMERA_IMG_NEON
+    for (; i + 8 <= dstPairs; i += 8) {
+        // lanes 0/1 hold the even pair of each 2x1 block, 2/3 the odd one
+        uint8x8x4_t a = vld4_u8(row0 + 4 * i);
+        uint8x8x4_t b = vld4_u8(row1 + 4 * i);
+        uint16x8_t first = vaddq_u16(vaddl_u8(a.val[0], a.val[2]),
+                                     vaddl_u8(b.val[0], b.val[2]));
+        uint16x8_t second = vaddq_u16(vaddl_u8(a.val[1], a.val[3]),
+                                      vaddl_u8(b.val[1], b.val[3]));
+        uint8x8x2_t out;
+        out.val[0] = vrshrn_n_u16(first, 2);
+        out.val[1] = vrshrn_n_u16(second, 2);
+        vst2_u8(dst + 2 * i, out);
+    }
+#endif
+    for (; i < dstPairs; i++) {
+        for (uint32_t c = 0; c < 2; c++) {
+            uint32_t sum = row0[4 * i + c] + row0[4 * i + 2 + c] +
+                           row1[4 * i + c] + row1[4 * i + 2 + c];
+            dst[2 * i + c] = (uint8_t)((sum + 2) >> 2);
+        }
+    }
+}
+
+}; // namespace qcamera
@@ -0,0 +1,92 @@
+/* Copyright (c) 2014, The Linux Foundataion. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_IMG_KERNELS_H__
+#define __QCAMERA_IMG_KERNELS_H__
+
+#include <stdint.h>
+
+namespace qcamera {
+
+// Row based kernels for 8 bit YUV planes. Strides are in bytes, widths
+// are in pixels for luma planes and in UV pairs for chroma planes. Each
+// kernel but copyPlane has a NEON path used when the compiler targets
+// NEON and a scalar path used elsewhere; both produce bit identical
+// output. copyPlane leaves the vector work to memcpy.
+class QCameraImgKernels {
+public:
+    // strided plane copy, and a rectangle of a plane
+    static void copyPlane(uint8_t *dst, uint32_t dstStride,
+                          const uint8_t *src, uint32_t srcStride,
+                          uint32_t width, uint32_t height);
+    static void cropPlane(uint8_t *dst, uint32_t dstStride,
+                          const uint8_t *src, uint32_t srcStride,
+                          uint32_t x, uint32_t y,
+                          uint32_t width, uint32_t height,
+                          uint32_t bytesPerPixel);
+
+    // NV12 <-> NV21 chroma; dst may be src for an in place swap
+    static void swapUV(uint8_t *dst, uint32_t dstStride,
+                       const uint8_t *src, uint32_t srcStride,
+                       uint32_t pairs, uint32_t height);
+
+    // planar <-> semi planar chroma, first goes to even bytes
+    static void interleaveUV(uint8_t *dst, uint32_t dstStride,
+                             const uint8_t *first, uint32_t firstStride,
+                             const uint8_t *second, uint32_t secondStride,
+                             uint32_t pairs, uint32_t height);
+    static void deinterleaveUV(uint8_t *first, uint32_t firstStride,
+                               uint8_t *second, uint32_t secondStride,
+                               const uint8_t *src, uint32_t srcStride,
+                               uint32_t pairs, uint32_t height);
+
+    // 2x2 box downscale with rounding, dst dimensions given
+    static void downscale2x(uint8_t *dst, uint32_t dstStride,
+                            const uint8_t *src, uint32_t srcStride,
+                            uint32_t dstWidth, uint32_t dstHeight);
+    static void downscale2xUV(uint8_t *dst, uint32_t dstStride,
+                              const uint8_t *src, uint32_t srcStride,
+                              uint32_t dstPairs, uint32_t dstHeight);
+
+private:
+    static void cropRow(uint8_t *dst, const uint8_t *src, uint32_t bytes);
+    static void swapUVRow(uint8_t *dst, const uint8_t *src, uint32_t pairs);
+    static void interleaveRow(uint8_t *dst, const uint8_t *first,
+                              const uint8_t *second, uint32_t pairs);
+    static void deinterleaveRow(uint8_t *first, uint8_t *second,
+                                const uint8_t *src, uint32_t pairs);
+    static void downscaleRow(uint8_t *dst, const uint8_t *row0,
+                             const uint8_t *row1, uint32_t dstWidth);
+    static void downscaleUVRow(uint8_t *dst, const uint8_t *row0,
+                               const uint8_t *row1, uint32_t dstPairs);
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_IMG_KERNELS_H__ */
@@ -27,6 +27,8 @@
 *
 */
 
+#include <time.h>
+#include <cutils/properties.h>
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include "QCameraQueue.h"
@@ -44,11 +46,7 @@ namespace qcamera {
  *==========================================================================*/
 QCameraQueue::QCameraQueue()
 {
-    pthread_mutex_init(&m_lock, NULL);
-    cam_list_init(&m_head.list);
-    m_size = 0;
-    m_dataFn = NULL;
-    m_userData = NULL;
+    init(NULL, NULL, 0);
 }
 
 /*===========================================================================
@@ -64,11 +62,28 @@ QCameraQueue::QCameraQueue()
  *==========================================================================*/
 QCameraQueue::QCameraQueue(release_data_fn data_rel_fn, void *user_data)
 {
-    pthread_mutex_init(&m_lock, NULL);
-    cam_list_init(&m_head.list);
-    m_size = 0;
-    m_dataFn = data_rel_fn;
-    m_userData = user_data;
+    init(data_rel_fn, user_data, 0);
+}
+
+/*===========================================================================
+ * FUNCTION   : QCameraQueue
+ *
+ * DESCRIPTION: constructor of a bounded single producer/single consumer
+ *              QCameraQueue. Slots are preallocated, enqueue and dequeue
+ *              take no lock and do no allocation.
+ *
+ * PARAMETERS :
+ *   @data_rel_fn : function ptr to release node data internal resource
+ *   @user_data   : user data ptr
+ *   @spscDepth   : max number of entries, rounded up to a power of two.
+ *                  0 gives a default mutex guarded queue.
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraQueue::QCameraQueue(release_data_fn data_rel_fn, void *user_data,
+                           uint32_t spscDepth)
+{
+    init(data_rel_fn, user_data, spscDepth);
 }
 
 /*===========================================================================
@@ -83,7 +98,275 @@ QCameraQueue::QCameraQueue(release_data_fn data_rel_fn, void *user_data)
 QCameraQueue::~QCameraQueue()
 {
     flush();
+
+    if (m_bStats && NULL == m_ring) {
+        logStats();
+    }
+    while (NULL != m_freeNodes) {
+        camera_q_node *node = m_freeNodes;
+        m_freeNodes = (NULL != node->list.next) ?
+            member_of(node->list.next, camera_q_node, list) : NULL;
+        free(node);
+    }
+
     pthread_mutex_destroy(&m_lock);
+    if (NULL != m_ring) {
+        free(m_ring);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : init
+ *
+ * DESCRIPTION: common part of the constructors
+ *
+ * PARAMETERS :
+ *   @data_rel_fn : function ptr to release node data internal resource
+ *   @user_data   : user data ptr
+ *   @spscDepth   : depth of the single producer/single consumer ring,
+ *                  0 for a mutex guarded queue
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraQueue::init(release_data_fn data_rel_fn, void *user_data,
+                        uint32_t spscDepth)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    pthread_mutex_init(&m_lock, NULL);
+    cam_list_init(&m_head.list);
+    cam_list_init(&m_prioHead.list);
+    m_size = 0;
+    m_dataFn = data_rel_fn;
+    m_userData = user_data;
+    m_freeNodes = NULL;
+    m_freeCnt = 0;
+    m_peakSize = 0;
+    memset(m_depthHist, 0, sizeof(m_depthHist));
+    memset(m_waitHist, 0, sizeof(m_waitHist));
+    m_ring = NULL;
+    m_ringMask = 0;
+    m_ringHead = 0;
+    m_ringTail = 0;
+
+    property_get("persist.camera.queue.stats", value, "0");
+    m_bStats = atoi(value) > 0;
+
+    if (spscDepth > 0) {
+        uint32_t slots = 1;
+        while (slots < spscDepth) {
+            slots <<= 1;
+        }
+        m_ring = (void **)calloc(slots, sizeof(void *));
+        if (NULL == m_ring) {
+            ALOGE("%s: No memory for %d slots, using a locked queue",
+                  __func__, slots);
+        } else {
+            m_ringMask = slots - 1;
+        }
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getHistBin
+ *
+ * DESCRIPTION: power of two histogram bin of a value
+ *
+ * PARAMETERS :
+ *   @value   : value to bin
+ *
+ * RETURN     : bin index, 0 for 0, n for [2^(n-1), 2^n)
+ *==========================================================================*/
+int QCameraQueue::getHistBin(uint64_t value)
+{
+    int bin = 0;
+    while (value > 0 && bin < QCAMERA_QUEUE_HIST_BINS - 1) {
+        value >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+/*===========================================================================
+ * FUNCTION   : getTimeUs
+ *
+ * DESCRIPTION: monotonic time in microseconds
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : time in us
+ *==========================================================================*/
+uint64_t QCameraQueue::getTimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*===========================================================================
+ * FUNCTION   : logStats
+ *
+ * DESCRIPTION: log the depth and wait time histograms. Bin n counts
+ *              values in [2^(n-1), 2^n), bin 0 counts zeros.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraQueue::logStats()
+{
+    char depth[QCAMERA_QUEUE_HIST_BINS * 11 + 1];
+    char wait[QCAMERA_QUEUE_HIST_BINS * 11 + 1];
+    int depthLen = 0;
+    int waitLen = 0;
+
+    for (int i = 0; i < QCAMERA_QUEUE_HIST_BINS; i++) {
+        depthLen += snprintf(depth + depthLen, sizeof(depth) - depthLen,
+                             " %u", m_depthHist[i]);
+        waitLen += snprintf(wait + waitLen, sizeof(wait) - waitLen,
+                            " %u", m_waitHist[i]);
+    }
+    ALOGD("%s: queue %p peak depth %d, free nodes %d", __func__,
+          this, m_peakSize, m_freeCnt);
+    ALOGD("%s: queue %p depth at enqueue:%s", __func__, this, depth);
+    ALOGD("%s: queue %p wait us at dequeue:%s", __func__, this, wait);
+}
+
+/*===========================================================================
+ * FUNCTION   : getNodeLocked
+ *
+ * DESCRIPTION: take a node from the freelist, or allocate one if the
+ *              queue has never been this deep before
+ *
+ * PARAMETERS :
+ *   @data    : data of the node
+ *
+ * RETURN     : node ptr. NULL if no memory.
+ *==========================================================================*/
+QCameraQueue::camera_q_node *QCameraQueue::getNodeLocked(void *data)
+{
+    camera_q_node *node = m_freeNodes;
+
+    if (NULL != node) {
+        m_freeNodes = (NULL != node->list.next) ?
+            member_of(node->list.next, camera_q_node, list) : NULL;
+        m_freeCnt--;
+    } else {
+        node = (camera_q_node *)malloc(sizeof(camera_q_node));
+        if (NULL == node) {
+            ALOGE("%s: No memory for camera_q_node", __func__);
+            return NULL;
+        }
+    }
+
+    cam_list_init(&node->list);
+    node->data = data;
+    node->enqueueTime = 0;
+
+    m_size++;
+    if (m_size > m_peakSize) {
+        m_peakSize = m_size;
+    }
+    if (m_bStats) {
+        m_depthHist[getHistBin(m_size - 1)]++;
+        node->enqueueTime = getTimeUs();
+    }
+    return node;
+}
+
+/*===========================================================================
+ * FUNCTION   : putNodeLocked
+ *
+ * DESCRIPTION: return an unlinked node to the freelist. The freelist is
+ *              bounded by the peak depth of the queue.
+ *
+ * PARAMETERS :
+ *   @node    : node ptr
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraQueue::putNodeLocked(camera_q_node *node)
+{
+    if (m_freeCnt >= m_peakSize) {
+        free(node);
+        return;
+    }
+    // freelist is singly linked through list.next
+    node->list.next = (NULL != m_freeNodes) ? &m_freeNodes->list : NULL;
+    m_freeNodes = node;
+    m_freeCnt++;
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseData
+ *
+ * DESCRIPTION: release a flushed data ptr and its internal resource
+ *
+ * PARAMETERS :
+ *   @data    : data ptr
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraQueue::releaseData(void *data)
+{
+    if (NULL != data) {
+        if (m_dataFn) {
+            m_dataFn(data, m_userData);
+        }
+        free(data);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : spscEnqueue
+ *
+ * DESCRIPTION: enqueue into the single producer/single consumer ring.
+ *              Must only be called from the producer thread.
+ *
+ * PARAMETERS :
+ *   @data    : data to be enqueued
+ *
+ * RETURN     : true -- success; false -- ring is full
+ *==========================================================================*/
+bool QCameraQueue::spscEnqueue(void *data)
+{
+    uint32_t tail = m_ringTail;
+    uint32_t head = __atomic_load_n(&m_ringHead, __ATOMIC_ACQUIRE);
+
+    if (tail - head > m_ringMask) {
+        ALOGE("%s: Queue full (%d entries)", __func__, m_ringMask + 1);
+        return false;
+    }
+
+    m_ring[tail & m_ringMask] = data;
+    // publish the slot before the new tail
+    __atomic_store_n(&m_ringTail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : spscDequeue
+ *
+ * DESCRIPTION: dequeue from the single producer/single consumer ring.
+ *              Must only be called from the consumer thread.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : data ptr. NULL if not any data in the queue.
+ *==========================================================================*/
+void* QCameraQueue::spscDequeue()
+{
+    uint32_t head = m_ringHead;
+    uint32_t tail = __atomic_load_n(&m_ringTail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return NULL;
+    }
+
+    void *data = m_ring[head & m_ringMask];
+    // hand the slot back to the producer after it has been read
+    __atomic_store_n(&m_ringHead, head + 1, __ATOMIC_RELEASE);
+    return data;
 }
 
 /*===========================================================================
@@ -98,6 +381,10 @@ QCameraQueue::~QCameraQueue()
 bool QCameraQueue::isEmpty()
 {
     bool flag = true;
+    if (NULL != m_ring) {
+        return __atomic_load_n(&m_ringHead, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&m_ringTail, __ATOMIC_ACQUIRE);
+    }
     pthread_mutex_lock(&m_lock);
     if (m_size > 0) {
         flag = false;
@@ -118,21 +405,17 @@ bool QCameraQueue::isEmpty()
  *==========================================================================*/
 bool QCameraQueue::enqueue(void *data)
 {
-    camera_q_node *node =
-        (camera_q_node *)malloc(sizeof(camera_q_node));
-    if (NULL == node) {
-        ALOGE("%s: No memory for camera_q_node", __func__);
-        return false;
+    if (NULL != m_ring) {
+        return spscEnqueue(data);
     }
 
-    memset(node, 0, sizeof(camera_q_node));
-    node->data = data;
-
     pthread_mutex_lock(&m_lock);
-    cam_list_add_tail_node(&node->list, &m_head.list);
-    m_size++;
+    camera_q_node *node = getNodeLocked(data);
+    if (NULL != node) {
+        cam_list_add_tail_node(&node->list, &m_head.list);
+    }
     pthread_mutex_unlock(&m_lock);
-    return true;
+    return NULL != node;
 }
 
 /*===========================================================================
@@ -148,33 +431,26 @@ bool QCameraQueue::enqueue(void *data)
  *==========================================================================*/
 bool QCameraQueue::enqueueWithPriority(void *data)
 {
-    camera_q_node *node =
-        (camera_q_node *)malloc(sizeof(camera_q_node));
-    if (NULL == node) {
-        ALOGE("%s: No memory for camera_q_node", __func__);
+    if (NULL != m_ring) {
+        ALOGE("%s: Not supported by single producer queue", __func__);
         return false;
     }
 
-    memset(node, 0, sizeof(camera_q_node));
-    node->data = data;
-
     pthread_mutex_lock(&m_lock);
-    struct cam_list *p_next = m_head.list.next;
-
-    m_head.list.next = &node->list;
-    p_next->prev = &node->list;
-    node->list.next = p_next;
-    node->list.prev = &m_head.list;
-
-    m_size++;
+    camera_q_node *node = getNodeLocked(data);
+    if (NULL != node) {
+        // latest priority entry is dequeued first
+        cam_list_insert_before_node(&node->list, m_prioHead.list.next);
+    }
     pthread_mutex_unlock(&m_lock);
-    return true;
+    return NULL != node;
 }
 
 /*===========================================================================
  * FUNCTION   : dequeue
  *
- * DESCRIPTION: dequeue data from the queue
+ * DESCRIPTION: dequeue data from the queue. Priority entries are ahead of
+ *              all normal entries.
  *
  * PARAMETERS :
  *   @bFromHead : if true, dequeue from the head
@@ -186,29 +462,112 @@ void* QCameraQueue::dequeue(bool bFromHead)
 {
     camera_q_node* node = NULL;
     void* data = NULL;
-    struct cam_list *head = NULL;
     struct cam_list *pos = NULL;
 
+    if (NULL != m_ring) {
+        if (!bFromHead) {
+            ALOGE("%s: Tail dequeue not supported by single producer queue",
+                  __func__);
+            return NULL;
+        }
+        return spscDequeue();
+    }
+
     pthread_mutex_lock(&m_lock);
-    head = &m_head.list;
     if (bFromHead) {
-        pos = head->next;
+        pos = m_prioHead.list.next;
+        if (pos == &m_prioHead.list) {
+            pos = m_head.list.next;
+        }
     } else {
-        pos = head->prev;
+        pos = m_head.list.prev;
+        if (pos == &m_head.list) {
+            pos = m_prioHead.list.prev;
+        }
     }
-    if (pos != head) {
+    if (pos != &m_head.list && pos != &m_prioHead.list) {
         node = member_of(pos, camera_q_node, list);
         cam_list_del_node(&node->list);
         m_size--;
+        data = node->data;
+        if (m_bStats) {
+            m_waitHist[getHistBin(getTimeUs() - node->enqueueTime)]++;
+        }
+        putNodeLocked(node);
     }
     pthread_mutex_unlock(&m_lock);
 
-    if (NULL != node) {
-        data = node->data;
-        free(node);
+    return data;
+}
+
+/*===========================================================================
+ * FUNCTION   : detachNodesLocked
+ *
+ * DESCRIPTION: move matching nodes of one sublist to a private list
+ *
+ * PARAMETERS :
+ *   @head    : dummy head of the sublist
+ *   @match   : matching function
+ *   @matchData : matching function with match data, takes precedence
+ *                over match. Nodes all match if both are NULL.
+ *   @spec_data : match data for matchData
+ *   @out     : private list to move the nodes to
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraQueue::detachNodesLocked(struct cam_list *head,
+                                     match_fn match,
+                                     match_fn_data matchData,
+                                     void *spec_data,
+                                     struct cam_list *out)
+{
+    struct cam_list *pos = head->next;
+
+    while (pos != head) {
+        camera_q_node *node = member_of(pos, camera_q_node, list);
+        pos = pos->next;
+
+        bool matched = true;
+        if (NULL != matchData) {
+            matched = matchData(node->data, m_userData, spec_data);
+        } else if (NULL != match) {
+            matched = match(node->data, m_userData);
+        }
+        if (matched) {
+            cam_list_del_node(&node->list);
+            cam_list_add_tail_node(&node->list, out);
+            m_size--;
+        }
     }
+}
 
-    return data;
+/*===========================================================================
+ * FUNCTION   : releaseNodes
+ *
+ * DESCRIPTION: release the data of detached nodes outside of the queue
+ *              lock, then give the nodes back to the freelist
+ *
+ * PARAMETERS :
+ *   @nodes   : private list of detached nodes
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraQueue::releaseNodes(struct cam_list *nodes)
+{
+    struct cam_list *pos;
+
+    for (pos = nodes->next; pos != nodes; pos = pos->next) {
+        releaseData(member_of(pos, camera_q_node, list)->data);
+    }
+
+    pthread_mutex_lock(&m_lock);
+    pos = nodes->next;
+    while (pos != nodes) {
+        camera_q_node *node = member_of(pos, camera_q_node, list);
+        pos = pos->next;
+        putNodeLocked(node);
+    }
+    pthread_mutex_unlock(&m_lock);
 }
 
 /*===========================================================================
@@ -222,31 +581,24 @@ void* QCameraQueue::dequeue(bool bFromHead)
  * RETURN     : None
  *==========================================================================*/
 void QCameraQueue::flush(){
-    camera_q_node* node = NULL;
-    struct cam_list *head = NULL;
-    struct cam_list *pos = NULL;
-
-    pthread_mutex_lock(&m_lock);
-    head = &m_head.list;
-    pos = head->next;
-
-    while(pos != head) {
-        node = member_of(pos, camera_q_node, list);
-        pos = pos->next;
-        cam_list_del_node(&node->list);
-        m_size--;
+    struct cam_list nodes;
 
-        if (NULL != node->data) {
-            if (m_dataFn) {
-                m_dataFn(node->data, m_userData);
-            }
-            free(node->data);
+    if (NULL != m_ring) {
+        void *data;
+        while ((data = spscDequeue()) != NULL) {
+            releaseData(data);
         }
-        free(node);
-
+        return;
     }
+
+    cam_list_init(&nodes);
+    pthread_mutex_lock(&m_lock);
+    detachNodesLocked(&m_prioHead.list, NULL, NULL, NULL, &nodes);
+    detachNodesLocked(&m_head.list, NULL, NULL, NULL, &nodes);
     m_size = 0;
     pthread_mutex_unlock(&m_lock);
+
+    releaseNodes(&nodes);
 }
 
 /*===========================================================================
@@ -261,35 +613,24 @@ void QCameraQueue::flush(){
  * RETURN     : None
  *==========================================================================*/
 void QCameraQueue::flushNodes(match_fn match){
-    camera_q_node* node = NULL;
-    struct cam_list *head = NULL;
-    struct cam_list *pos = NULL;
+    struct cam_list nodes;
 
     if ( NULL == match ) {
         return;
     }
 
-    pthread_mutex_lock(&m_lock);
-    head = &m_head.list;
-    pos = head->next;
-
-    while(pos != head) {
-        node = member_of(pos, camera_q_node, list);
-        pos = pos->next;
-        if ( match(node->data, m_userData) ) {
-            cam_list_del_node(&node->list);
-            m_size--;
-
-            if (NULL != node->data) {
-                if (m_dataFn) {
-                    m_dataFn(node->data, m_userData);
-                }
-                free(node->data);
-            }
-            free(node);
-        }
+    if (NULL != m_ring) {
+        ALOGE("%s: Not supported by single producer queue", __func__);
+        return;
     }
+
+    cam_list_init(&nodes);
+    pthread_mutex_lock(&m_lock);
+    detachNodesLocked(&m_prioHead.list, match, NULL, NULL, &nodes);
+    detachNodesLocked(&m_head.list, match, NULL, NULL, &nodes);
     pthread_mutex_unlock(&m_lock);
+
+    releaseNodes(&nodes);
 }
 
 /*===========================================================================
@@ -304,35 +645,24 @@ void QCameraQueue::flushNodes(match_fn match){
  * RETURN     : None
  *==========================================================================*/
 void QCameraQueue::flushNodes(match_fn_data match, void *match_data){
-    camera_q_node* node = NULL;
-    struct cam_list *head = NULL;
-    struct cam_list *pos = NULL;
+    struct cam_list nodes;
 
     if ( NULL == match ) {
         return;
     }
 
-    pthread_mutex_lock(&m_lock);
-    head = &m_head.list;
-    pos = head->next;
-
-    while(pos != head) {
-        node = member_of(pos, camera_q_node, list);
-        pos = pos->next;
-        if ( match(node->data, m_userData, match_data) ) {
-            cam_list_del_node(&node->list);
-            m_size--;
-
-            if (NULL != node->data) {
-                if (m_dataFn) {
-                    m_dataFn(node->data, m_userData);
-                }
-                free(node->data);
-            }
-            free(node);
-        }
+    if (NULL != m_ring) {
+        ALOGE("%s: Not supported by single producer queue", __func__);
+        return;
     }
+
+    cam_list_init(&nodes);
+    pthread_mutex_lock(&m_lock);
+    detachNodesLocked(&m_prioHead.list, NULL, match, match_data, &nodes);
+    detachNodesLocked(&m_head.list, NULL, match, match_data, &nodes);
     pthread_mutex_unlock(&m_lock);
+
+    releaseNodes(&nodes);
 }
 
 }; // namespace qcamera
@@ -33,18 +33,31 @@
 #include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "cam_list.h"
 
 namespace qcamera {
 
+#define QCAMERA_QUEUE_HIST_BINS 16
+
 typedef bool (*match_fn_data)(void *data, void *user_data, void *match_data);
 typedef void (*release_data_fn)(void* data, void *user_data);
 typedef bool (*match_fn)(void *data, void *user_data);
 
+// A queue is either a mutex guarded list (default), or, when constructed
+// with a depth, a bounded lock-free ring of preallocated slots that is
+// only safe with a single producer thread and a single consumer thread.
+// In that mode enqueue() fails when the ring is full, priority enqueue,
+// dequeue from the tail and flushNodes() are not supported, and flush()
+// must be called from the consumer thread.
+// The list keeps priority entries on their own sublist ahead of normal
+// entries, and recycles nodes through a freelist bounded by its peak depth.
 class QCameraQueue {
 public:
     QCameraQueue();
     QCameraQueue(release_data_fn data_rel_fn, void *user_data);
+    QCameraQueue(release_data_fn data_rel_fn, void *user_data,
+                 uint32_t spscDepth);
     virtual ~QCameraQueue();
     bool enqueue(void *data);
     bool enqueueWithPriority(void *data);
@@ -57,13 +70,50 @@ private:
     typedef struct {
         struct cam_list list;
         void* data;
+        uint64_t enqueueTime;   // us, only set when stats are enabled
     } camera_q_node;
 
-    camera_q_node m_head; // dummy head
+    void init(release_data_fn data_rel_fn, void *user_data,
+              uint32_t spscDepth);
+    camera_q_node *getNodeLocked(void *data);
+    void putNodeLocked(camera_q_node *node);
+    void detachNodesLocked(struct cam_list *head,
+                           match_fn match,
+                           match_fn_data matchData,
+                           void *spec_data,
+                           struct cam_list *out);
+    void releaseNodes(struct cam_list *nodes);
+    bool spscEnqueue(void *data);
+    void* spscDequeue();
+    void releaseData(void *data);
+    void logStats();
+    static int getHistBin(uint64_t value);
+    static uint64_t getTimeUs();
+
+    camera_q_node m_head; // dummy head of normal entries
+    camera_q_node m_prioHead; // dummy head of priority entries
     int m_size;
     pthread_mutex_t m_lock;
     release_data_fn m_dataFn;
     void * m_userData;
+
+    // nodes of dequeued entries, kept up to the peak depth
+    camera_q_node *m_freeNodes;
+    int m_freeCnt;
+    int m_peakSize;
+
+    // depth at enqueue and wait time at dequeue, power of two bins,
+    // enabled by persist.camera.queue.stats and logged on destruction
+    bool m_bStats;
+    uint32_t m_depthHist[QCAMERA_QUEUE_HIST_BINS];
+    uint32_t m_waitHist[QCAMERA_QUEUE_HIST_BINS];
+
+    // single producer/single consumer ring, NULL in list mode
+    void **m_ring;
+    uint32_t m_ringMask;
+    uint32_t m_ringHead;        // next slot to dequeue, owned by consumer
+    char m_ringPad[64];         // keep head and tail on own cache lines
+    uint32_t m_ringTail;        // next slot to enqueue, owned by producer
 };
 
 }; // namespace qcamera
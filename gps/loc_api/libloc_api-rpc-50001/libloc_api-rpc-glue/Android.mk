@@ -58,3 +58,5 @@ LOCAL_MODULE_OWNER := qcom
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(LOCAL_PATH)/test/Android.mk
@@ -36,6 +36,11 @@ extern "C"
 #include "loc_api_rpc_glue.h"
 #define LOC_SYNC_CALL_SLOTS_MAX 8
 
+/* Waiting slots are hashed on (client handle, ioctl type) so an incoming
+   callback goes straight to its waiter instead of visiting every slot */
+#define LOC_SYNC_CALL_BUCKETS   16
+#define LOC_SYNC_CALL_SLOT_NONE (-1)
+
 typedef struct {
    pthread_mutex_t                lock;
 
@@ -53,11 +58,19 @@ typedef struct {
    rpc_loc_ioctl_e_type           ioctl_type;                    /* ioctl to wait for */
    rpc_loc_event_payload_u_type   loc_cb_received_payload;       /* received payload */
    rpc_loc_event_mask_type        loc_cb_received_event_mask;    /* received event   */
+
+   /* Wait table linkage, protected by the array's table_lock */
+   int                            bucket;
+   int                            next_in_bucket;
 } loc_sync_call_slot_s_type;
 
 typedef struct {
    int                            num_of_slots;
    loc_sync_call_slot_s_type      slots[LOC_SYNC_CALL_SLOTS_MAX];
+
+   /* Keyed wait table: head slot index of each bucket */
+   pthread_mutex_t                table_lock;
+   int                            bucket_head[LOC_SYNC_CALL_BUCKETS];
 } loc_sync_call_slot_array_s_type;
 
 /* Init function */
@@ -81,17 +81,135 @@ CLIENT* loc_api_clnt = NULL;
 
 /* Callback ID and pointer */
 #define LOC_API_CB_MAX_CLIENTS 16
+
+/* cb_id layout: bits 0-7 table index, bits 8-15 generation, upper word pid.
+   The generation changes every time a slot is handed to a new client, so a
+   callback carrying the cb_id of a closed client is dropped instead of being
+   delivered to whoever owns the slot now. A cb_id of 0 marks a free slot. */
+#define LOC_GLUE_CB_INDEX(cb_id)       ((cb_id) & 0xFF)
+#define LOC_GLUE_CB_ID(pid, gen, idx)  ((uint32)(((pid) << 16) | (((gen) & 0xFF) << 8) | (idx)))
+
 typedef struct
 {
-    uint32 cb_id;                        /* same as rpc/types.h */
+    uint32 cb_id;                        /* same as rpc/types.h, 0 if free */
     loc_event_cb_f_type *cb_func;      /* callback func */
     loc_reset_notif_cb_f_type *rpc_cb; /* callback from RPC */
     rpc_loc_client_handle_type handle; /* stores handle for client closing */
     void* user;                        /* user's own data handle */
+    uint32 generation;                 /* bumped on every new owner */
+    int32 active;                      /* callbacks currently dispatched */
+    int32 closing;                     /* loc_clear() waits for them */
 } loc_glue_cb_entry_s_type;
 
 loc_glue_cb_entry_s_type loc_glue_callback_table[LOC_API_CB_MAX_CLIENTS];
 
+/* Serializes open/close; callback dispatch does not take it */
+static pthread_mutex_t loc_glue_cb_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signalled, under loc_glue_cb_mutex, when a callback of a closing
+   entry returns */
+static pthread_cond_t loc_glue_drain_cond = PTHREAD_COND_INITIALIZER;
+
+/* Set to (index + 1) while a thread is inside a client's callback, so that
+   closing a client from its own callback does not wait on itself */
+static pthread_key_t loc_glue_dispatch_key;
+static pthread_once_t loc_glue_dispatch_once = PTHREAD_ONCE_INIT;
+
+static void loc_glue_dispatch_key_create(void)
+{
+    pthread_key_create(&loc_glue_dispatch_key, NULL);
+}
+
+/* Unpins an entry pinned by loc_glue_entry_acquire() */
+static void loc_glue_entry_release(loc_glue_cb_entry_s_type* entry)
+{
+    __atomic_sub_fetch(&entry->active, 1, __ATOMIC_SEQ_CST);
+
+    /* loc_clear() sets closing before it reads active, so either it sees
+       the count dropped or we see it waiting and wake it */
+    if (__atomic_load_n(&entry->closing, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&loc_glue_cb_mutex);
+        pthread_cond_broadcast(&loc_glue_drain_cond);
+        pthread_mutex_unlock(&loc_glue_cb_mutex);
+    }
+}
+
+/* Pins the entry for dispatch if cb_id still names its current owner.
+   Returns the entry, or NULL if the client is gone. */
+static loc_glue_cb_entry_s_type* loc_glue_entry_acquire(uint32 cb_id)
+{
+    int index = LOC_GLUE_CB_INDEX(cb_id);
+    loc_glue_cb_entry_s_type* entry;
+
+    if (0 == cb_id || index >= LOC_API_CB_MAX_CLIENTS) {
+        return NULL;
+    }
+
+    entry = &loc_glue_callback_table[index];
+    __atomic_add_fetch(&entry->active, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&entry->cb_id, __ATOMIC_SEQ_CST) != cb_id) {
+        /* may be what loc_clear() waits on */
+        loc_glue_entry_release(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/* Hands a table entry to the client identified by userData, reusing the
+   one it already has. Returns the entry, or NULL if the table is full. */
+static loc_glue_cb_entry_s_type* loc_glue_entry_claim(
+    loc_event_cb_f_type           *event_callback,
+    loc_reset_notif_cb_f_type     *rpc_cb,
+    void*                         userData)
+{
+    int i, j = LOC_API_CB_MAX_CLIENTS;
+    loc_glue_cb_entry_s_type* entry = NULL;
+
+    pthread_mutex_lock(&loc_glue_cb_mutex);
+    for (i = 0; i < LOC_API_CB_MAX_CLIENTS; i++)
+    {
+        /* still draining, its fields are about to be cleared */
+        if (loc_glue_callback_table[i].closing)
+        {
+            continue;
+        }
+        if (loc_glue_callback_table[i].user == userData)
+        {
+            LOC_LOGW("Client already opened service (callback=%p)...\n",
+                  event_callback);
+            break;
+        } else if (j == LOC_API_CB_MAX_CLIENTS &&
+                   loc_glue_callback_table[i].user == NULL) {
+            j = i;
+        }
+    }
+
+    if (i == LOC_API_CB_MAX_CLIENTS)
+    {
+        i = j;
+    }
+
+    if (i < LOC_API_CB_MAX_CLIENTS)
+    {
+        entry = &loc_glue_callback_table[i];
+        entry->cb_func = event_callback;
+        entry->rpc_cb = rpc_cb;
+        entry->user = userData;
+        if (0 == entry->cb_id)
+        {
+            /* new owner: publish a fresh cb_id only after the fields are set */
+            entry->generation = (entry->generation % 0xFF) + 1;
+            __atomic_store_n(&entry->cb_id,
+                             LOC_GLUE_CB_ID(getpid(), entry->generation, i),
+                             __ATOMIC_SEQ_CST);
+        }
+    }
+    pthread_mutex_unlock(&loc_glue_cb_mutex);
+
+    return entry;
+}
+
 #define RPC_FUNC_VERSION_BASE(a,b) a ## b
 #define RPC_FUNC_VERSION(a,b) RPC_FUNC_VERSION_BASE(a,b)
 
@@ -115,13 +233,12 @@ bool_t rpc_loc_event_cb_f_type_svc(
       rpc_loc_event_cb_f_type_rets *ret,
       struct svc_req *req)
 {
-    // The lower word of cd_id is the index
-    int index = argp->cb_id & 0xFFFF;
+    loc_glue_cb_entry_s_type* entry = loc_glue_entry_acquire(argp->cb_id);
 
-    /* Callback not registered, or unexpected ID (shouldn't happen) */
-    if (index >= LOC_API_CB_MAX_CLIENTS || loc_glue_callback_table[index].cb_func == NULL)
+    /* Callback not registered, stale or unexpected ID */
+    if (NULL == entry)
     {
-        LOC_LOGE("Warning: No callback handler %d.\n", index);
+        LOC_LOGE("Warning: No callback handler for cb_id 0x%x.\n", argp->cb_id);
         ret->loc_event_cb_f_type_result = 0;
         return 1; /* simply return */
     }
@@ -146,10 +263,17 @@ bool_t rpc_loc_event_cb_f_type_svc(
     /* Gives control to synchronous call handler */
     loc_api_callback_process_sync_call(loc_handle, loc_event, loc_event_payload);
 
-    int32 rc = (loc_glue_callback_table[index].cb_func)(loc_glue_callback_table[index].user,
-                                                        loc_handle, loc_event, loc_event_payload);
+    void* prev_dispatch = pthread_getspecific(loc_glue_dispatch_key);
+    pthread_setspecific(loc_glue_dispatch_key,
+                        (void*)(long)(LOC_GLUE_CB_INDEX(argp->cb_id) + 1));
+
+    int32 rc = (entry->cb_func)(entry->user, loc_handle, loc_event, loc_event_payload);
 
-    LOC_LOGV("cb_func=%p", loc_glue_callback_table[index].cb_func);
+    pthread_setspecific(loc_glue_dispatch_key, prev_dispatch);
+
+    LOC_LOGV("cb_func=%p", entry->cb_func);
+
+    loc_glue_entry_release(entry);
 
     ret->loc_event_cb_f_type_result = rc;
 
@@ -246,8 +370,13 @@ static void loc_api_glue_rpc_cb(CLIENT* client, enum rpc_reset_event event)
 {
     int i;
     for (i = 0; i < LOC_API_CB_MAX_CLIENTS; i++) {
-        if (NULL != loc_glue_callback_table[i].rpc_cb) {
-            loc_glue_callback_table[i].rpc_cb(loc_glue_callback_table[i].user, client, event);
+        uint32 cb_id = __atomic_load_n(&loc_glue_callback_table[i].cb_id, __ATOMIC_SEQ_CST);
+        loc_glue_cb_entry_s_type* entry = loc_glue_entry_acquire(cb_id);
+        if (NULL != entry) {
+            if (NULL != entry->rpc_cb) {
+                entry->rpc_cb(entry->user, client, event);
+            }
+            loc_glue_entry_release(entry);
         }
     }
 }
@@ -270,15 +399,20 @@ int loc_api_glue_init(void)
    {
       /* Initialize data */
       int i;
-      int pid = getpid();
+      pthread_once(&loc_glue_dispatch_once, loc_glue_dispatch_key_create);
+      pthread_mutex_lock(&loc_glue_cb_mutex);
       for (i = 0; i < LOC_API_CB_MAX_CLIENTS; i++)
       {
-          loc_glue_callback_table[i].cb_id = i | (pid << 16);
+          loc_glue_callback_table[i].cb_id = 0;
           loc_glue_callback_table[i].cb_func = NULL;
           loc_glue_callback_table[i].handle = -1;
           loc_glue_callback_table[i].rpc_cb = NULL;
           loc_glue_callback_table[i].user = NULL;
+          loc_glue_callback_table[i].generation = 0;
+          loc_glue_callback_table[i].active = 0;
+          loc_glue_callback_table[i].closing = 0;
       }
+      pthread_mutex_unlock(&loc_glue_cb_mutex);
 
       /* Print msg */
       LOC_LOGV("Trying to create RPC client...\n");
@@ -325,37 +459,16 @@ rpc_loc_client_handle_type loc_open (
     rpc_loc_open_args args;
     args.event_reg_mask = event_reg_mask;
 
-    int i, j = LOC_API_CB_MAX_CLIENTS;
-    for (i = 0; i < LOC_API_CB_MAX_CLIENTS; i++)
-    {
-        if (loc_glue_callback_table[i].user == userData)
-        {
-            LOC_LOGW("Client already opened service (callback=%p)...\n",
-                  event_callback);
-            break;
-        } else if (j == LOC_API_CB_MAX_CLIENTS &&
-                   loc_glue_callback_table[i].user == NULL) {
-            j = i;
-        }
-    }
-
-    if (i == LOC_API_CB_MAX_CLIENTS)
-    {
-        i = j;
-    }
-
-    if (i == LOC_API_CB_MAX_CLIENTS)
+    loc_glue_cb_entry_s_type* entry =
+        loc_glue_entry_claim(event_callback, rpc_cb, userData);
+    if (NULL == entry)
     {
         LOC_LOGE("Too many clients opened at once...\n");
         return RPC_LOC_CLIENT_HANDLE_INVALID;
     }
 
-    loc_glue_callback_table[i].cb_func = event_callback;
-    loc_glue_callback_table[i].rpc_cb = rpc_cb;
-    loc_glue_callback_table[i].user = userData;
-
-    args.event_callback = loc_glue_callback_table[i].cb_id;
-    LOC_LOGV("cb_id=%d, func=0x%x", i, (unsigned int) event_callback);
+    args.event_callback = entry->cb_id;
+    LOC_LOGV("cb_id=0x%x, func=0x%x", entry->cb_id, (unsigned int) event_callback);
 
     rpc_loc_open_rets rets;
     enum clnt_stat stat = RPC_SUCCESS;
@@ -375,7 +488,9 @@ rpc_loc_client_handle_type loc_open (
     LOC_GLUE_CHECK_RESULT(stat, int32);
 
     /* save the handle in the table */
-    loc_glue_callback_table[i].handle = (rpc_loc_client_handle_type) rets.loc_open_result;
+    pthread_mutex_lock(&loc_glue_cb_mutex);
+    entry->handle = (rpc_loc_client_handle_type) rets.loc_open_result;
+    pthread_mutex_unlock(&loc_glue_cb_mutex);
 
     return ret_val;
 
@@ -411,18 +526,41 @@ int32 loc_close
 void loc_clear(rpc_loc_client_handle_type handle) {
     /* Clean the client's callback function in callback table */
     int i;
+    pthread_mutex_lock(&loc_glue_cb_mutex);
     for (i = 0; i < LOC_API_CB_MAX_CLIENTS; i++)
     {
-        if (loc_glue_callback_table[i].handle == handle)
+        loc_glue_cb_entry_s_type* entry = &loc_glue_callback_table[i];
+        if (entry->handle == handle && 0 != entry->cb_id)
         {
-            /* Found the client */
-            loc_glue_callback_table[i].cb_func = NULL;
-            loc_glue_callback_table[i].rpc_cb = NULL;
-            loc_glue_callback_table[i].handle = -1;
-            loc_glue_callback_table[i].user = NULL;
+            /* Found the client; stop new dispatches, then let the ones
+               already running finish before the fields go away. The wait
+               releases loc_glue_cb_mutex, so those callbacks may still
+               open or close other clients. */
+            __atomic_store_n(&entry->cb_id, 0, __ATOMIC_SEQ_CST);
+            __atomic_store_n(&entry->closing, 1, __ATOMIC_SEQ_CST);
+
+            /* closing from inside our own callback must not wait on itself */
+            int32 self = (pthread_getspecific(loc_glue_dispatch_key) ==
+                          (void*)(long)(i + 1)) ? 1 : 0;
+            if (__atomic_load_n(&entry->active, __ATOMIC_SEQ_CST) > self)
+            {
+                LOC_LOGW("waiting for callback(s) of handle %d to finish\n",
+                         (int) handle);
+                do
+                {
+                    pthread_cond_wait(&loc_glue_drain_cond, &loc_glue_cb_mutex);
+                } while (__atomic_load_n(&entry->active, __ATOMIC_SEQ_CST) > self);
+            }
+
+            entry->cb_func = NULL;
+            entry->rpc_cb = NULL;
+            entry->handle = -1;
+            entry->user = NULL;
+            __atomic_store_n(&entry->closing, 0, __ATOMIC_SEQ_CST);
             break;
         }
     }
+    pthread_mutex_unlock(&loc_glue_cb_mutex);
 
     if (i == LOC_API_CB_MAX_CLIENTS)
     {
@@ -93,6 +93,14 @@ void loc_api_sync_call_init()
       slot->loc_handle = -1;
       slot->loc_cb_wait_event_mask = 0;       /* event to wait   */
       slot->loc_cb_received_event_mask = 0;   /* received event   */
+      slot->bucket = LOC_SYNC_CALL_SLOT_NONE;
+      slot->next_in_bucket = LOC_SYNC_CALL_SLOT_NONE;
+   }
+
+   pthread_mutex_init(&loc_sync_data.table_lock, NULL);
+   for (i = 0; i < LOC_SYNC_CALL_BUCKETS; i++)
+   {
+      loc_sync_data.bucket_head[i] = LOC_SYNC_CALL_SLOT_NONE;
    }
 
    pthread_mutex_unlock(&loc_sync_call_mutex);
@@ -140,6 +148,8 @@ void loc_api_sync_call_destroy()
       pthread_mutex_destroy(&slot->lock);
    }
 
+   pthread_mutex_destroy(&loc_sync_data.table_lock);
+
    pthread_mutex_unlock(&loc_sync_call_mutex);
 }
 
@@ -174,10 +184,84 @@ static boolean loc_match_callback(
 
 /*===========================================================================
 
+FUNCTION    loc_sync_call_bucket
+
+DESCRIPTION
+   Hashes a (client handle, ioctl type) wait key into the wait table
+
+RETURN VALUE
+   bucket index
+
+===========================================================================*/
+static int loc_sync_call_bucket(
+      rpc_loc_client_handle_type          loc_handle,
+      rpc_loc_ioctl_e_type                ioctl_type
+)
+{
+   uint32 key = ((uint32) loc_handle * 31u) ^ (uint32) ioctl_type;
+   return (int) (key % LOC_SYNC_CALL_BUCKETS);
+}
+
+/*===========================================================================
+
+FUNCTION    loc_sync_call_link / loc_sync_call_unlink
+
+DESCRIPTION
+   Adds or removes a slot in the keyed wait table. Callers hold the slot
+   lock; the table lock is only taken here and never held while taking a
+   slot lock, so the two cannot deadlock.
+
+RETURN VALUE
+   none
+
+===========================================================================*/
+static void loc_sync_call_link(int select_id)
+{
+   loc_sync_call_slot_s_type *slot = &loc_sync_data.slots[select_id];
+   int bucket = loc_sync_call_bucket(slot->loc_handle, slot->ioctl_type);
+
+   pthread_mutex_lock(&loc_sync_data.table_lock);
+   slot->bucket = bucket;
+   slot->next_in_bucket = loc_sync_data.bucket_head[bucket];
+   loc_sync_data.bucket_head[bucket] = select_id;
+   pthread_mutex_unlock(&loc_sync_data.table_lock);
+}
+
+static void loc_sync_call_unlink(int select_id)
+{
+   loc_sync_call_slot_s_type *slot = &loc_sync_data.slots[select_id];
+   int *link;
+
+   pthread_mutex_lock(&loc_sync_data.table_lock);
+   if (slot->bucket != LOC_SYNC_CALL_SLOT_NONE)
+   {
+      for (link = &loc_sync_data.bucket_head[slot->bucket];
+           *link != LOC_SYNC_CALL_SLOT_NONE;
+           link = &loc_sync_data.slots[*link].next_in_bucket)
+      {
+         if (*link == select_id)
+         {
+            *link = slot->next_in_bucket;
+            break;
+         }
+      }
+      slot->bucket = LOC_SYNC_CALL_SLOT_NONE;
+      slot->next_in_bucket = LOC_SYNC_CALL_SLOT_NONE;
+   }
+   pthread_mutex_unlock(&loc_sync_data.table_lock);
+}
+
+/*===========================================================================
+
 FUNCTION    loc_api_callback_process_sync_call
 
 DESCRIPTION
-   Wakes up blocked API calls to check if the needed callback has arrived
+   Wakes up the blocked API call, if any, that waits for this callback.
+
+   Only IOCTL reports are ever waited on, so every other event returns
+   without taking a lock. For an IOCTL report the wait table yields the
+   candidate slots for (handle, ioctl type); each candidate is re-checked
+   under its own lock since it may have been released in between.
 
 DEPENDENCIES
    N/A
@@ -195,11 +279,32 @@ void loc_api_callback_process_sync_call(
       const rpc_loc_event_payload_u_type*   loc_event_payload       /* payload              */
 )
 {
+   int candidates[LOC_SYNC_CALL_SLOTS_MAX];
+   int num_candidates = 0;
    int i;
 
    ALOGV("loc_handle = 0x%lx, loc_event = 0x%lx", loc_handle, loc_event);
-   for (i = 0; i < loc_sync_data.num_of_slots; i++)
+   if (loc_event != RPC_LOC_EVENT_IOCTL_REPORT || loc_event_payload == NULL)
+   {
+      return;
+   }
+
+   rpc_loc_ioctl_e_type ioctl_type =
+      loc_event_payload->rpc_loc_event_payload_u_type_u.ioctl_report.type;
+
+   pthread_mutex_lock(&loc_sync_data.table_lock);
+   for (i = loc_sync_data.bucket_head[loc_sync_call_bucket(loc_handle, ioctl_type)];
+        i != LOC_SYNC_CALL_SLOT_NONE && num_candidates < LOC_SYNC_CALL_SLOTS_MAX;
+        i = loc_sync_data.slots[i].next_in_bucket)
+   {
+      candidates[num_candidates++] = i;
+   }
+   pthread_mutex_unlock(&loc_sync_data.table_lock);
+
+   /* oldest waiter was linked first and sits at the tail */
+   while (num_candidates-- > 0)
    {
+      i = candidates[num_candidates];
       loc_sync_call_slot_s_type *slot = &loc_sync_data.slots[i];
 
       pthread_mutex_lock(&slot->lock);
@@ -219,8 +324,6 @@ void loc_api_callback_process_sync_call(
 
          pthread_mutex_unlock(&slot->lock);
          break;
-      } else {
-         /* do nothing */
       }
 
       pthread_mutex_unlock(&slot->lock);
@@ -516,6 +619,7 @@ int loc_api_sync_ioctl
 
    // Select the callback we are waiting for
    loc_api_save_callback(select_id, handle, 0, ioctl_type);
+   loc_sync_call_link(select_id);
 
    loc_unlock_slot(select_id); // slot is unlocked, but in_use is still true
 
@@ -556,6 +660,7 @@ int loc_api_sync_ioctl
       } /* wait callback */
    } /* loc_ioctl */
 
+   loc_sync_call_unlink(select_id);
    loc_set_slot_in_use(select_id, 0); // set slot in use to false
    loc_unlock_slot(select_id);
 
@@ -0,0 +1,47 @@
+# callback table stress test
+OLD_LOCAL_PATH := $(LOCAL_PATH)
+LOC_GLUE_TEST_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_GLUE_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS := -fno-short-enums
+LOCAL_CFLAGS += -DDEBUG -DUSE_QCOM_AUTO_RPC
+LOCAL_CFLAGS += $(GPS_FEATURES)
+
+# the glue itself is included by the test source
+LOCAL_SRC_FILES := \
+    loc_api_rpc_glue_stress.c \
+    ../src/loc_api_sync_call.c \
+    ../src/loc_apicb_appinit.c \
+    ../src/loc_api_log.c
+
+LOCAL_C_INCLUDES := \
+    $(LOC_GLUE_TEST_PATH)/.. \
+    $(LOC_GLUE_TEST_PATH)/../rpc_inc \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/loc_api/rpcgen/inc \
+    $(TARGET_OUT_HEADERS)/libcommondefs/rpcgen/inc \
+    $(TARGET_OUT_HEADERS)/librpc \
+    $(TARGET_OUT_HEADERS)/libloc-rpc/rpc_inc \
+    $(TOP)/hardware/msm7k/librpc
+
+LOCAL_SHARED_LIBRARIES := \
+    librpc \
+    libutils \
+    libcutils \
+    libcommondefs \
+    libgps.utils
+
+LOCAL_STATIC_LIBRARIES := \
+    libloc_api_rpcgen
+
+LOCAL_MODULE := loc_api_rpc_glue_stress
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+LOCAL_PATH := $(OLD_LOCAL_PATH)
@@ -0,0 +1,190 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stress test of the callback table of the RPC glue. Callbacks are fed
+   straight into rpc_loc_event_cb_f_type_svc() while clients are opened and
+   closed, so no modem is needed:
+   - no callback runs on a client once loc_clear() returned for it
+   - a callback of a closing client may open and close another client
+   - a callback may close its own client
+   The glue is built into the test to reach its table. */
+
+#include "../src/loc_api_rpc_glue.c"
+
+#include <signal.h>
+
+#define STRESS_DISPATCHERS   4
+#define STRESS_ROUNDS        2000
+#define STRESS_TIMEOUT_SEC   120
+
+typedef struct
+{
+    volatile int closed;       /* set once loc_clear() returned */
+    volatile int in_callback;
+    int nested;                /* callback opens and closes another client */
+    int close_self;            /* callback closes its own client */
+    rpc_loc_client_handle_type handle;
+} stress_client_s_type;
+
+static volatile uint32 stress_cb_id;
+static volatile int stress_done;
+static volatile int stress_failures;
+static volatile long stress_callbacks;
+
+static stress_client_s_type stress_other;
+
+static int32 stress_nested_cb(void* user, rpc_loc_client_handle_type handle,
+                              rpc_loc_event_mask_type event,
+                              const rpc_loc_event_payload_u_type* payload)
+{
+    return 0;
+}
+
+static void stress_fail(const char* what)
+{
+    __atomic_add_fetch(&stress_failures, 1, __ATOMIC_SEQ_CST);
+    fprintf(stderr, "FAIL: %s\n", what);
+}
+
+static int32 stress_cb(void* user, rpc_loc_client_handle_type handle,
+                       rpc_loc_event_mask_type event,
+                       const rpc_loc_event_payload_u_type* payload)
+{
+    stress_client_s_type* client = (stress_client_s_type*)user;
+
+    if (NULL == client || client->closed) {
+        stress_fail("callback after loc_clear() returned");
+        return 0;
+    }
+    __atomic_add_fetch(&client->in_callback, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&stress_callbacks, 1, __ATOMIC_SEQ_CST);
+
+    if (client->nested) {
+        /* takes loc_glue_cb_mutex while our own client is being closed */
+        loc_glue_cb_entry_s_type* other =
+            loc_glue_entry_claim(stress_nested_cb, NULL, &stress_other);
+        if (NULL != other) {
+            pthread_mutex_lock(&loc_glue_cb_mutex);
+            other->handle = stress_other.handle;
+            pthread_mutex_unlock(&loc_glue_cb_mutex);
+            loc_clear(stress_other.handle);
+        }
+    } else if (client->close_self) {
+        loc_clear(client->handle);
+    } else {
+        usleep(100);
+    }
+
+    __atomic_sub_fetch(&client->in_callback, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+static void* stress_dispatcher(void* arg)
+{
+    rpc_loc_event_cb_f_type_args args;
+    rpc_loc_event_cb_f_type_rets rets;
+    struct svc_req req;
+
+    memset(&req, 0, sizeof(req));
+    while (!stress_done) {
+        memset(&args, 0, sizeof(args));
+        args.cb_id = __atomic_load_n(&stress_cb_id, __ATOMIC_SEQ_CST);
+        args.loc_handle = 1;
+        args.loc_event = RPC_LOC_EVENT_PARSED_POSITION_REPORT;
+        args.loc_event_payload = NULL;
+        rpc_loc_event_cb_f_type_svc(&args, &rets, &req);
+    }
+    return NULL;
+}
+
+static void stress_timeout(int sig)
+{
+    fprintf(stderr, "FAIL: no progress in %d sec, deadlock\n",
+            STRESS_TIMEOUT_SEC);
+    _exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    pthread_t dispatchers[STRESS_DISPATCHERS];
+    stress_client_s_type* clients;
+    int i, round;
+
+    signal(SIGALRM, stress_timeout);
+    alarm(STRESS_TIMEOUT_SEC);
+
+    pthread_once(&loc_glue_dispatch_once, loc_glue_dispatch_key_create);
+    stress_other.handle = STRESS_ROUNDS + 1;
+
+    clients = (stress_client_s_type*)calloc(STRESS_ROUNDS, sizeof(*clients));
+    if (NULL == clients) {
+        return 1;
+    }
+
+    for (i = 0; i < STRESS_DISPATCHERS; i++) {
+        pthread_create(&dispatchers[i], NULL, stress_dispatcher, NULL);
+    }
+
+    for (round = 0; round < STRESS_ROUNDS; round++) {
+        stress_client_s_type* client = &clients[round];
+        client->handle = round + 1;
+        client->nested = (round % 3) == 1;
+        client->close_self = (round % 3) == 2;
+
+        loc_glue_cb_entry_s_type* entry =
+            loc_glue_entry_claim(stress_cb, NULL, client);
+        if (NULL == entry) {
+            stress_fail("table full");
+            break;
+        }
+        pthread_mutex_lock(&loc_glue_cb_mutex);
+        entry->handle = client->handle;
+        pthread_mutex_unlock(&loc_glue_cb_mutex);
+        __atomic_store_n(&stress_cb_id, entry->cb_id, __ATOMIC_SEQ_CST);
+
+        usleep(200);
+
+        loc_clear(client->handle);
+        if (client->in_callback) {
+            stress_fail("loc_clear() returned with a callback running");
+        }
+        client->closed = 1;
+    }
+
+    stress_done = 1;
+    for (i = 0; i < STRESS_DISPATCHERS; i++) {
+        pthread_join(dispatchers[i], NULL);
+    }
+    free(clients);
+
+    printf("%d rounds, %ld callbacks, %d failures: %s\n", STRESS_ROUNDS,
+           stress_callbacks, stress_failures,
+           stress_failures ? "FAIL" : "PASS");
+    return stress_failures ? 1 : 0;
+}
@@ -15,10 +15,25 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     src/loc_api_rpcgen_cb_xdr.c \
-    src/loc_api_rpcgen_common_xdr.c \
     src/loc_api_rpcgen_cb_svc.c \
     src/loc_api_rpcgen_clnt.c \
-    src/loc_api_rpcgen_xdr.c
+    src/loc_api_rpcgen_xdr.c \
+    src/loc_api_xdr_table.c
+
+# src/loc_api_rpcgen_common_xdr.c is built with the routines of its
+# fixed-layout structs going through tables generated from the .xdr
+LOCAL_MODULE_CLASS := STATIC_LIBRARIES
+intermediates := $(call local-intermediates-dir)
+LOC_XDR_TABLE_GEN := $(intermediates)/loc_api_rpcgen_common_xdr_table.c
+$(LOC_XDR_TABLE_GEN): PRIVATE_PATH := $(LOCAL_PATH)
+$(LOC_XDR_TABLE_GEN): PRIVATE_CUSTOM_TOOL = python $(PRIVATE_PATH)/xdr/gen_xdr_tables.py \
+    $(PRIVATE_PATH)/xdr/loc_api_common.xdr \
+    $(PRIVATE_PATH)/src/loc_api_rpcgen_common_xdr.c $@
+$(LOC_XDR_TABLE_GEN): $(LOCAL_PATH)/xdr/gen_xdr_tables.py \
+                      $(LOCAL_PATH)/xdr/loc_api_common.xdr \
+                      $(LOCAL_PATH)/src/loc_api_rpcgen_common_xdr.c
+	$(transform-generated-source)
+LOCAL_GENERATED_SOURCES += $(LOC_XDR_TABLE_GEN)
 
 LOCAL_C_INCLUDES += hardware/msm7k/librpc
 LOCAL_C_INCLUDES += $(LOC_RPCGEN_APIS_PATH)/../../SHARED_LIBRARIES/libcommondefs_intermediates/inc
@@ -34,3 +49,5 @@ LOCAL_COPY_HEADERS += inc/loc_apicb_appinit.h
 LOCAL_LDLIBS += -lpthread
 LOCAL_PRELINK_MODULE := false
 include $(BUILD_STATIC_LIBRARY)
+
+include $(LOCAL_PATH)/test/Android.mk
@@ -0,0 +1,104 @@
+/* Copyright (c) 2011, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_API_XDR_TABLE_H
+#define LOC_API_XDR_TABLE_H
+
+#include <stddef.h>
+#include "loc_api_rpcgen_common_rpc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* XDR primitive used for a struct field. Each kind maps to the
+   xdr_* routine rpcgen would have called for that field. */
+typedef enum {
+    LOC_XDR_RPC_UINT8,      /* xdr_rpc_uint8,   1 unit */
+    LOC_XDR_U_CHAR,         /* xdr_u_char,      1 unit */
+    LOC_XDR_RPC_UINT16,     /* xdr_rpc_uint16,  1 unit */
+    LOC_XDR_RPC_UINT32,     /* xdr_rpc_uint32,  1 unit */
+    LOC_XDR_RPC_INT32,      /* xdr_rpc_int32,   1 unit */
+    LOC_XDR_RPC_BOOLEAN,    /* xdr_rpc_boolean, 1 unit */
+    LOC_XDR_ENUM,           /* xdr_enum,        1 unit */
+    LOC_XDR_FLOAT,          /* xdr_float,       1 unit */
+    LOC_XDR_RPC_UINT64,     /* xdr_rpc_uint64,  2 units */
+    LOC_XDR_DOUBLE          /* xdr_double,      2 units */
+} loc_xdr_kind_e_type;
+
+typedef struct {
+    unsigned short      offset;
+    loc_xdr_kind_e_type kind;
+} loc_xdr_field_s_type;
+
+/* Describes a fixed-layout struct: no arrays, pointers or unions */
+typedef struct {
+    const loc_xdr_field_s_type *fields;
+    unsigned int                num_fields;
+    unsigned int                num_units;  /* XDR units on the wire */
+} loc_xdr_table_s_type;
+
+#define LOC_XDR_FIELD(type, member, kind) { offsetof(type, member), kind }
+
+#define LOC_XDR_TABLE(fields, units) \
+    { fields, sizeof(fields) / sizeof(fields[0]), units }
+
+/* Compile time checks of a table against the struct it describes */
+#define LOC_XDR_CHECK(name, cond) \
+    typedef char name[(cond) ? 1 : -1]
+
+/* member n has the size of the C type of its XDR kind */
+#define LOC_XDR_CHECK_SIZE(type, member, ctype, n) \
+    LOC_XDR_CHECK(loc_xdr_size_check_##type##_##n, \
+                  sizeof(((type *)0)->member) == sizeof(ctype))
+
+/* member n follows member n - 1 without overlapping it */
+#define LOC_XDR_CHECK_ORDER(type, prev, member, n) \
+    LOC_XDR_CHECK(loc_xdr_order_check_##type##_##n, \
+                  offsetof(type, prev) + sizeof(((type *)0)->prev) <= \
+                  offsetof(type, member))
+
+/* no member follows the last one in the table */
+#define LOC_XDR_CHECK_END(type, last) \
+    LOC_XDR_CHECK(loc_xdr_end_check_##type, \
+                  sizeof(type) - offsetof(type, last) - \
+                  sizeof(((type *)0)->last) < sizeof(double))
+
+/* Encodes, decodes or frees a fixed-layout struct described by table.
+   When the stream gives direct access to its buffer, all fields are
+   converted in one pass over it; otherwise each field goes through its
+   xdr_* routine, as rpcgen generated code does. */
+extern bool_t loc_xdr_table_codec(XDR *xdrs, void *objp,
+                                  const loc_xdr_table_s_type *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOC_API_XDR_TABLE_H */
@@ -0,0 +1,196 @@
+/* Copyright (c) 2011, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <string.h>
+#include "loc_api_xdr_table.h"
+
+/* The tables themselves are generated at build time from
+   loc_api_common.xdr by xdr/gen_xdr_tables.py */
+
+/* Per field fallback, calling the same routines as rpcgen output */
+static bool_t loc_xdr_field_codec(XDR *xdrs, char *base,
+                                  const loc_xdr_field_s_type *field)
+{
+    void *p = base + field->offset;
+
+    switch (field->kind) {
+    case LOC_XDR_RPC_UINT8:
+        return xdr_rpc_uint8(xdrs, (rpc_uint8 *)p);
+    case LOC_XDR_U_CHAR:
+        return xdr_u_char(xdrs, (u_char *)p);
+    case LOC_XDR_RPC_UINT16:
+        return xdr_rpc_uint16(xdrs, (rpc_uint16 *)p);
+    case LOC_XDR_RPC_UINT32:
+        return xdr_rpc_uint32(xdrs, (rpc_uint32 *)p);
+    case LOC_XDR_RPC_INT32:
+        return xdr_rpc_int32(xdrs, (rpc_int32 *)p);
+    case LOC_XDR_RPC_BOOLEAN:
+        return xdr_rpc_boolean(xdrs, (rpc_boolean *)p);
+    case LOC_XDR_ENUM:
+        return xdr_enum(xdrs, (enum_t *)p);
+    case LOC_XDR_FLOAT:
+        return xdr_float(xdrs, (float *)p);
+    case LOC_XDR_RPC_UINT64:
+        return xdr_rpc_uint64(xdrs, (rpc_uint64 *)p);
+    case LOC_XDR_DOUBLE:
+        return xdr_double(xdrs, (double *)p);
+    }
+    return FALSE;
+}
+
+#ifdef XDR_INLINE
+/* Converts all fields straight out of the stream buffer */
+static void loc_xdr_table_decode_inline(const int32_t *buf, char *base,
+                                        const loc_xdr_table_s_type *table)
+{
+    unsigned int i;
+    uint32_t hi, lo;
+    uint64_t u64;
+
+    for (i = 0; i < table->num_fields; i++) {
+        void *p = base + table->fields[i].offset;
+        lo = (uint32_t)IXDR_GET_U_LONG(buf);
+
+        switch (table->fields[i].kind) {
+        case LOC_XDR_RPC_UINT8:
+            *(rpc_uint8 *)p = (rpc_uint8)lo;
+            break;
+        case LOC_XDR_U_CHAR:
+            *(u_char *)p = (u_char)lo;
+            break;
+        case LOC_XDR_RPC_UINT16:
+            *(rpc_uint16 *)p = (rpc_uint16)lo;
+            break;
+        case LOC_XDR_RPC_UINT32:
+            *(rpc_uint32 *)p = (rpc_uint32)lo;
+            break;
+        case LOC_XDR_RPC_INT32:
+            *(rpc_int32 *)p = (rpc_int32)lo;
+            break;
+        case LOC_XDR_RPC_BOOLEAN:
+            // as xdr_bool, anything but 0 is TRUE
+            *(rpc_boolean *)p = lo ? TRUE : FALSE;
+            break;
+        case LOC_XDR_ENUM:
+            *(enum_t *)p = (enum_t)lo;
+            break;
+        case LOC_XDR_FLOAT:
+            memcpy(p, &lo, sizeof(float));
+            break;
+        case LOC_XDR_RPC_UINT64:
+        case LOC_XDR_DOUBLE:
+            // high word goes first on the wire
+            hi = lo;
+            lo = (uint32_t)IXDR_GET_U_LONG(buf);
+            u64 = ((uint64_t)hi << 32) | lo;
+            memcpy(p, &u64, sizeof(u64));
+            break;
+        }
+    }
+}
+
+static void loc_xdr_table_encode_inline(int32_t *buf, const char *base,
+                                        const loc_xdr_table_s_type *table)
+{
+    unsigned int i;
+    uint32_t u32 = 0;
+    uint64_t u64;
+
+    for (i = 0; i < table->num_fields; i++) {
+        const void *p = base + table->fields[i].offset;
+
+        switch (table->fields[i].kind) {
+        case LOC_XDR_RPC_UINT8:
+            u32 = *(const rpc_uint8 *)p;
+            break;
+        case LOC_XDR_U_CHAR:
+            u32 = *(const u_char *)p;
+            break;
+        case LOC_XDR_RPC_UINT16:
+            u32 = *(const rpc_uint16 *)p;
+            break;
+        case LOC_XDR_RPC_UINT32:
+            u32 = *(const rpc_uint32 *)p;
+            break;
+        case LOC_XDR_RPC_INT32:
+            u32 = (uint32_t)*(const rpc_int32 *)p;
+            break;
+        case LOC_XDR_RPC_BOOLEAN:
+            u32 = *(const rpc_boolean *)p ? TRUE : FALSE;
+            break;
+        case LOC_XDR_ENUM:
+            u32 = (uint32_t)*(const enum_t *)p;
+            break;
+        case LOC_XDR_FLOAT:
+            memcpy(&u32, p, sizeof(float));
+            break;
+        case LOC_XDR_RPC_UINT64:
+        case LOC_XDR_DOUBLE:
+            memcpy(&u64, p, sizeof(u64));
+            IXDR_PUT_U_LONG(buf, (uint32_t)(u64 >> 32));
+            u32 = (uint32_t)u64;
+            break;
+        }
+        IXDR_PUT_U_LONG(buf, u32);
+    }
+}
+#endif /* XDR_INLINE */
+
+bool_t loc_xdr_table_codec(XDR *xdrs, void *objp,
+                           const loc_xdr_table_s_type *table)
+{
+    unsigned int i;
+
+    // fixed-layout structs own no memory
+    if (XDR_FREE == xdrs->x_op) {
+        return TRUE;
+    }
+
+#ifdef XDR_INLINE
+    {
+        int32_t *buf = (int32_t *)XDR_INLINE(xdrs,
+                                  table->num_units * BYTES_PER_XDR_UNIT);
+        if (NULL != buf) {
+            if (XDR_DECODE == xdrs->x_op) {
+                loc_xdr_table_decode_inline(buf, (char *)objp, table);
+            } else {
+                loc_xdr_table_encode_inline(buf, (const char *)objp, table);
+            }
+            return TRUE;
+        }
+    }
+#endif /* XDR_INLINE */
+
+    for (i = 0; i < table->num_fields; i++) {
+        if (!loc_xdr_field_codec(xdrs, (char *)objp, &table->fields[i])) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
@@ -0,0 +1,41 @@
+# table driven XDR codec against the rpcgen routines, fuzz and benchmark
+OLD_LOCAL_PATH := $(LOCAL_PATH)
+LOC_XDR_TEST_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_XDR_TEST_PATH)
+LOCAL_MODULE := loc_api_xdr_table_test
+LOCAL_MODULE_OWNER := qcom
+LOCAL_MODULE_TAGS := optional
+
+# the rpcgen routines as generated, next to the tables listed for the test
+LOCAL_SRC_FILES := \
+    loc_api_xdr_table_test.c \
+    ../src/loc_api_xdr_table.c \
+    ../src/loc_api_rpcgen_common_xdr.c
+
+LOCAL_MODULE_CLASS := EXECUTABLES
+intermediates := $(call local-intermediates-dir)
+LOC_XDR_TEST_GEN := $(intermediates)/loc_api_xdr_table_test_structs.c
+$(LOC_XDR_TEST_GEN): PRIVATE_PATH := $(LOCAL_PATH)
+$(LOC_XDR_TEST_GEN): PRIVATE_CUSTOM_TOOL = python $(PRIVATE_PATH)/../xdr/gen_xdr_tables.py \
+    --test $(PRIVATE_PATH)/../xdr/loc_api_common.xdr $@
+$(LOC_XDR_TEST_GEN): $(LOCAL_PATH)/../xdr/gen_xdr_tables.py \
+                     $(LOCAL_PATH)/../xdr/loc_api_common.xdr
+	$(transform-generated-source)
+LOCAL_GENERATED_SOURCES += $(LOC_XDR_TEST_GEN)
+
+LOCAL_C_INCLUDES := \
+    $(LOC_XDR_TEST_PATH) \
+    $(LOC_XDR_TEST_PATH)/../inc \
+    hardware/msm7k/librpc \
+    $(TARGET_OUT_HEADERS)/libcommondefs/rpcgen/inc
+
+LOCAL_SHARED_LIBRARIES := \
+    librpc \
+    libcommondefs
+
+LOCAL_PRELINK_MODULE := false
+include $(BUILD_EXECUTABLE)
+
+LOCAL_PATH := $(OLD_LOCAL_PATH)
@@ -0,0 +1,232 @@
+/* Copyright (c) 2011, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Round trip fuzz of the table driven XDR codec against the rpcgen
+   routines it replaces, linked side by side. For every table driven
+   struct and random contents:
+   - both codecs encode the same bytes, with and without direct access
+     to the stream buffer
+   - what the table codec decodes encodes back to the same bytes
+   - both decode random bytes to the same struct
+   Then the decode time per struct with either codec.
+   Usage: loc_api_xdr_table_test [iterations] [seed] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "loc_api_xdr_table_test.h"
+
+#define TEST_BUF_SIZE        (1024)
+#define TEST_BENCH_DECODES   (100000)
+
+static int test_failures;
+
+#define CHECK(cond, name) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: %s: check failed: %s\n", \
+                    __FILE__, __LINE__, name, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+static uint32_t test_rand_state;
+
+static uint32_t test_rand(void)
+{
+    // xorshift32, reproducible from the seed on every libc
+    test_rand_state ^= test_rand_state << 13;
+    test_rand_state ^= test_rand_state >> 17;
+    test_rand_state ^= test_rand_state << 5;
+    return test_rand_state;
+}
+
+static void test_fill(void *p, unsigned int size)
+{
+    unsigned char *c = (unsigned char *)p;
+    unsigned int i;
+    for (i = 0; i < size; i++) {
+        c[i] = (unsigned char)test_rand();
+    }
+}
+
+static long long test_now_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#ifdef XDR_INLINE
+/* A memory stream without direct buffer access, to take the table
+   codec through its per field fallback */
+static int32_t *test_no_inline(XDR *xdrs, u_int len)
+{
+    (void)xdrs;
+    (void)len;
+    return NULL;
+}
+#endif
+
+/* Encodes objp with proc into buf; returns the bytes written, or -1 */
+static int test_encode(xdrproc_t proc, void *objp, char *buf, int inline_ok)
+{
+    XDR xdrs;
+#ifdef XDR_INLINE
+    struct xdr_ops ops;
+#endif
+
+    xdrmem_create(&xdrs, buf, TEST_BUF_SIZE, XDR_ENCODE);
+#ifdef XDR_INLINE
+    if (!inline_ok) {
+        ops = *xdrs.x_ops;
+        ops.x_inline = (__typeof__(ops.x_inline))test_no_inline;
+        xdrs.x_ops = &ops;
+    }
+#else
+    (void)inline_ok;
+#endif
+    if (!proc(&xdrs, objp)) {
+        return -1;
+    }
+    return (int)xdr_getpos(&xdrs);
+}
+
+static int test_decode(xdrproc_t proc, void *objp, char *buf, int len)
+{
+    XDR xdrs;
+    xdrmem_create(&xdrs, buf, len, XDR_DECODE);
+    return proc(&xdrs, objp) && (int)xdr_getpos(&xdrs) == len;
+}
+
+/* The routine gen_xdr_tables.py writes for a table driven struct */
+static const loc_xdr_table_s_type *test_table;
+
+static bool_t test_table_proc(XDR *xdrs, void *objp)
+{
+    return loc_xdr_table_codec(xdrs, objp, test_table);
+}
+
+static void test_struct(const loc_xdr_test_struct_s_type *s, int iterations)
+{
+    char obj[TEST_BUF_SIZE], ref_obj[TEST_BUF_SIZE], tab_obj[TEST_BUF_SIZE];
+    char ref_buf[TEST_BUF_SIZE], tab_buf[TEST_BUF_SIZE];
+    int len = (int)(s->table->num_units * BYTES_PER_XDR_UNIT);
+    xdrproc_t table = (xdrproc_t)test_table_proc;
+    int i, n;
+
+    test_table = s->table;
+    CHECK(s->size <= sizeof(obj) && len <= TEST_BUF_SIZE, s->name);
+    if (s->size > sizeof(obj) || len > TEST_BUF_SIZE) {
+        return;
+    }
+
+    for (i = 0; i < iterations; i++) {
+        // same bytes from both codecs, either way through the table codec
+        test_fill(obj, s->size);
+        n = test_encode(s->rpcgen, obj, ref_buf, 1);
+        CHECK(len == n, s->name);
+        CHECK(len == test_encode(table, obj, tab_buf, 1) &&
+              0 == memcmp(ref_buf, tab_buf, len), s->name);
+        CHECK(len == test_encode(table, obj, tab_buf, 0) &&
+              0 == memcmp(ref_buf, tab_buf, len), s->name);
+
+        // round trip: what the table codec decodes encodes to the same bytes
+        memset(tab_obj, 0, s->size);
+        CHECK(test_decode(table, tab_obj, ref_buf, len), s->name);
+        CHECK(len == test_encode(table, tab_obj, tab_buf, 1) &&
+              0 == memcmp(ref_buf, tab_buf, len), s->name);
+
+        // same struct decoded from random bytes; members rpcgen does not
+        // write (padding) keep the same fill on both sides
+        test_fill(ref_buf, len);
+        memcpy(tab_buf, ref_buf, len);
+        memset(ref_obj, 0xa5, s->size);
+        memset(tab_obj, 0xa5, s->size);
+        CHECK(test_decode(s->rpcgen, ref_obj, ref_buf, len), s->name);
+        CHECK(test_decode(table, tab_obj, tab_buf, len), s->name);
+        CHECK(0 == memcmp(ref_obj, tab_obj, s->size), s->name);
+    }
+}
+
+static long long test_bench_decode(xdrproc_t proc, char *buf, int len,
+                                   void *objp)
+{
+    long long start = test_now_nsec();
+    int i;
+    for (i = 0; i < TEST_BENCH_DECODES; i++) {
+        test_decode(proc, objp, buf, len);
+    }
+    return (test_now_nsec() - start) / TEST_BENCH_DECODES;
+}
+
+static void test_bench(const loc_xdr_test_struct_s_type *s)
+{
+    char obj[TEST_BUF_SIZE], buf[TEST_BUF_SIZE];
+    int len;
+
+    test_table = s->table;
+    test_fill(obj, s->size);
+    len = test_encode(s->rpcgen, obj, buf, 1);
+    if (len <= 0) {
+        return;
+    }
+    long long rpcgen_nsec = test_bench_decode(s->rpcgen, buf, len, obj);
+    long long table_nsec = test_bench_decode((xdrproc_t)test_table_proc,
+                                             buf, len, obj);
+    printf("bench: %s (%d bytes): rpcgen %lld ns, table %lld ns per decode\n",
+           s->name, len, rpcgen_nsec, table_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+    unsigned int i;
+
+    test_rand_state = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) :
+                                 (uint32_t)time(NULL);
+    if (0 == test_rand_state) {
+        test_rand_state = 1;
+    }
+    printf("%u structs, %d iterations, seed %u\n", loc_xdr_test_num_structs,
+           iterations, test_rand_state);
+
+    for (i = 0; i < loc_xdr_test_num_structs; i++) {
+        test_struct(&loc_xdr_test_structs[i], iterations);
+    }
+    for (i = 0; i < loc_xdr_test_num_structs; i++) {
+        test_bench(&loc_xdr_test_structs[i]);
+    }
+
+    printf("%s: %d failures\n", 0 == test_failures ? "PASS" : "FAIL",
+           test_failures);
+    return 0 == test_failures ? 0 : 1;
+}
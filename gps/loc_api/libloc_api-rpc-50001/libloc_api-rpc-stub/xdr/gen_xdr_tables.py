@@ -0,0 +1,224 @@
+#!/usr/bin/env python
+# Copyright (c) 2015, The Linux Foundation. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above
+#       copyright notice, this list of conditions and the following
+#       disclaimer in the documentation and/or other materials provided
+#       with the distribution.
+#     * Neither the name of The Linux Foundation, nor the names of its
+#       contributors may be used to endorse or promote products derived
+#       from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+# BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+# BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+# OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Builds the table driven XDR codecs at build time.
+
+Usage: gen_xdr_tables.py <api.xdr> <rpcgen_xdr.c> <out.c>
+       gen_xdr_tables.py --test <api.xdr> <out.c>
+
+Every struct of <api.xdr> made only of scalars, and of nested structs that
+are, gets a field table. <out.c> is <rpcgen_xdr.c>, which is left as rpcgen
+generated it, with the routines of those structs handing the struct to
+loc_xdr_table_codec() and the tables ahead of them. Each table entry comes
+with compile time checks against the rpcgen header: the C member has the
+size of the XDR kind, and members follow each other without overlap.
+
+With --test, <out.c> only has the tables, and loc_xdr_test_structs[]
+pairing each of them with the rpcgen routine of its struct, for
+test/loc_api_xdr_table_test.c to check one codec against the other.
+"""
+
+import re
+import sys
+
+# scalar type -> (table kind, C type of the member, XDR units)
+SCALARS = {
+    'rpc_uint8': ('LOC_XDR_RPC_UINT8', 'rpc_uint8', 1),
+    'unsigned char': ('LOC_XDR_U_CHAR', 'u_char', 1),
+    'rpc_uint16': ('LOC_XDR_RPC_UINT16', 'rpc_uint16', 1),
+    'rpc_uint32': ('LOC_XDR_RPC_UINT32', 'rpc_uint32', 1),
+    'rpc_int32': ('LOC_XDR_RPC_INT32', 'rpc_int32', 1),
+    'rpc_boolean': ('LOC_XDR_RPC_BOOLEAN', 'rpc_boolean', 1),
+    'float': ('LOC_XDR_FLOAT', 'float', 1),
+    'rpc_uint64': ('LOC_XDR_RPC_UINT64', 'rpc_uint64', 2),
+    'double': ('LOC_XDR_DOUBLE', 'double', 2),
+}
+ENUM_KIND = ('LOC_XDR_ENUM', 'enum_t', 1)
+
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+    return re.sub(r'//[^\n]*', '', text)
+
+
+def parse_xdr(text):
+    """Returns (typedefs, enums, structs); structs keep .xdr order."""
+    text = strip_comments(text)
+    typedefs = {}
+    enums = set()
+    structs = []
+    for m in re.finditer(r'^typedef\s+([\w ]+?)\s+(\w+)\s*;', text, re.M):
+        typedefs[m.group(2)] = m.group(1)
+    for m in re.finditer(r'^enum\s+(\w+)\s*{', text, re.M):
+        enums.add(m.group(1))
+    for m in re.finditer(r'^struct\s+(\w+)\s*{(.*?)^};', text, re.M | re.S):
+        members = []
+        for line in m.group(2).split(';'):
+            line = ' '.join(line.split())
+            if line:
+                members.append(line)
+        structs.append((m.group(1), members))
+    return typedefs, enums, structs
+
+
+class Flattener(object):
+    def __init__(self, typedefs, enums, structs):
+        self.typedefs = typedefs
+        self.enums = enums
+        self.structs = dict(structs)
+        self.cache = {}
+
+    def scalar(self, xtype):
+        while xtype in self.typedefs:
+            xtype = self.typedefs[xtype]
+        if xtype in SCALARS:
+            return SCALARS[xtype]
+        if xtype in self.enums:
+            return ENUM_KIND
+        return None
+
+    def fields(self, name):
+        """(member path, kind, C type, units) list, or None if the struct
+        holds anything but scalars: arrays, strings, opaque, unions."""
+        if name in self.cache:
+            return self.cache[name]
+        self.cache[name] = None
+        result = []
+        for member in self.structs[name]:
+            m = re.match(r'^([\w ]+?)\s+(\w+)$', member)
+            if not m:
+                return None
+            xtype, mname = m.group(1), m.group(2)
+            kind = self.scalar(xtype)
+            if kind:
+                result.append((mname,) + kind)
+            elif xtype in self.structs:
+                nested = self.fields(xtype)
+                if nested is None:
+                    return None
+                result.extend([(mname + '.' + f[0],) + f[1:] for f in nested])
+            else:
+                return None
+        self.cache[name] = result
+        return result
+
+
+def emit_table(out, name, fields):
+    units = sum(f[3] for f in fields)
+    out.append('/* Fields of %s, in .xdr order */' % name)
+    out.append('static const loc_xdr_field_s_type loc_xdr_%s_fields[] = {'
+               % name)
+    for path, kind, _, _ in fields:
+        out.append('    LOC_XDR_FIELD(%s, %s, %s),' % (name, path, kind))
+    out.append('};')
+    for i, (path, _, ctype, _) in enumerate(fields):
+        out.append('LOC_XDR_CHECK_SIZE(%s, %s, %s, %d);'
+                   % (name, path, ctype, i))
+        if i > 0:
+            out.append('LOC_XDR_CHECK_ORDER(%s, %s, %s, %d);'
+                       % (name, fields[i - 1][0], path, i))
+    out.append('LOC_XDR_CHECK_END(%s, %s);' % (name, fields[-1][0]))
+    out.append('static const loc_xdr_table_s_type loc_xdr_%s_table ='
+               % name)
+    out.append('    LOC_XDR_TABLE(loc_xdr_%s_fields, %d);' % (name, units))
+    out.append('')
+
+
+def rewrite_routines(source, names):
+    done = set()
+
+    def body(m):
+        name = m.group(1)
+        if name not in names:
+            return m.group(0)
+        done.add(name)
+        return ('bool_t\nxdr_%s (XDR *xdrs, %s *objp)\n{\n'
+                '    return loc_xdr_table_codec (xdrs, objp, '
+                '&loc_xdr_%s_table);\n}\n' % (name, name, name))
+
+    source = re.sub(r'^bool_t\nxdr_(\w+) \(XDR \*xdrs, \w+ \*objp\)\n{\n'
+                    r'.*?^}\n', body, source, flags=re.M | re.S)
+    missing = set(names) - done
+    if missing:
+        raise SystemExit('no rpcgen routine for: ' +
+                         ', '.join(sorted(missing)))
+    return source
+
+
+def emit_test_list(out, names):
+    out.append('const loc_xdr_test_struct_s_type loc_xdr_test_structs[] = {')
+    for name in names:
+        out.append('    { "%s", &loc_xdr_%s_table,' % (name, name))
+        out.append('      sizeof(%s), (xdrproc_t)xdr_%s },' % (name, name))
+    out.append('};')
+    out.append('const unsigned int loc_xdr_test_num_structs = %d;'
+               % len(names))
+
+
+def main(argv):
+    test = len(argv) == 4 and argv[1] == '--test'
+    if test:
+        argv = argv[1:]
+    elif len(argv) != 4:
+        raise SystemExit(__doc__)
+    with open(argv[1]) as f:
+        typedefs, enums, structs = parse_xdr(f.read())
+
+    flattener = Flattener(typedefs, enums, structs)
+    tables = [(name, flattener.fields(name)) for name, _ in structs]
+    tables = [(name, fields) for name, fields in tables if fields]
+
+    sources = [argv[1]] if test else argv[1:3]
+    out = ['/* Generated by gen_xdr_tables.py from %s.'
+           % ' and '.join(path.split('/')[-1] for path in sources),
+           '   Do not edit. */',
+           '',
+           '#include "loc_api_xdr_table.h"',
+           '']
+    if test:
+        out[-1:-1] = ['#include "loc_api_xdr_table_test.h"']
+    for name, fields in tables:
+        emit_table(out, name, fields)
+
+    if test:
+        emit_test_list(out, [name for name, _ in tables])
+        with open(argv[2], 'w') as f:
+            f.write('\n'.join(out) + '\n')
+        return
+
+    with open(argv[2]) as f:
+        source = f.read()
+    out.append('#line 1 "%s"' % argv[2])
+
+    with open(argv[3], 'w') as f:
+        f.write('\n'.join(out) + '\n')
+        f.write(rewrite_routines(source, [name for name, _ in tables]))
+
+
+if __name__ == '__main__':
+    main(sys.argv)
@@ -16,7 +16,8 @@ LOCAL_SHARED_LIBRARIES := \
     libdl \
     liblog \
     libloc_core \
-    libgps.utils
+    libgps.utils \
+    libcrypto
 
 LOCAL_SRC_FILES += \
     loc_eng.cpp \
@@ -25,12 +26,14 @@ LOCAL_SRC_FILES += \
     loc_eng_ni.cpp \
     loc_eng_log.cpp \
     loc_eng_nmea.cpp \
+    loc_eng_batch.cpp \
+    loc_eng_geofence.cpp \
     LocEngAdapter.cpp
 
 LOCAL_SRC_FILES += \
     loc_eng_dmn_conn.cpp \
     loc_eng_dmn_conn_handler.cpp \
-    loc_eng_dmn_conn_thread_helper.c \
+    loc_eng_dmn_conn_thread_helper.cpp \
     loc_eng_dmn_conn_glue_msg.c \
     loc_eng_dmn_conn_glue_pipe.c
 
@@ -56,6 +59,8 @@ LOCAL_COPY_HEADERS:= \
    loc_eng_xtra.h \
    loc_eng_ni.h \
    loc_eng_agps.h \
+   loc_eng_batch.h \
+   loc_eng_geofence.h \
    loc_eng_msg.h \
    loc_eng_log.h
 
@@ -111,4 +116,6 @@ LOCAL_MODULE_RELATIVE_PATH := hw
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(LOCAL_PATH)/test/Android.mk
+
 endif # not BUILD_TINY_ANDROID
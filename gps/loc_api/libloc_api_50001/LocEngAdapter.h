@@ -34,6 +34,7 @@
 #include <loc.h>
 #include <loc_eng_log.h>
 #include <log_util.h>
+#include <loc_eng_batch.h>
 #include <LocAdapterBase.h>
 #include <LocDualContext.h>
 #include <UlpProxyBase.h>
@@ -80,6 +81,8 @@ class LocEngAdapter : public LocAdapterBase {
     unsigned int mPowerVote;
     static const unsigned int POWER_VOTE_RIGHT = 0x20;
     static const unsigned int POWER_VOTE_VALUE = 0x10;
+    // final fixes of periodic sessions held back for bulk delivery
+    LocEngFixBatch mFixBatch;
 
 public:
     bool mSupportsAgpsRequests;
@@ -106,6 +109,7 @@ public:
         return mContext->hasCPIExtendedCapabilities();
     }
     inline const MsgTask* getMsgTask() { return mMsgTask; }
+    inline LocEngFixBatch& getFixBatch() { return mFixBatch; }
 
     inline enum loc_api_adapter_err
         startFix()
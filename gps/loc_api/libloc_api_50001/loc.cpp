@@ -44,6 +44,10 @@
 #include <errno.h>
 #include <LocDualContext.h>
 #include <cutils/properties.h>
+#include <platform_lib_includes.h>
+#ifndef USE_GLIB
+#include <utils/SystemClock.h>
+#endif /* USE_GLIB */
 
 using namespace loc_core;
 
@@ -134,6 +138,26 @@ static const GpsMeasurementInterface sLocEngGpsMeasurementInterface =
     loc_gps_measurement_close
 };
 
+static void loc_geofence_init(GpsGeofenceCallbacks* callbacks);
+static void loc_geofence_add_area(int32_t geofence_id, double latitude,
+                                  double longitude, double radius_meters,
+                                  int last_transition, int monitor_transitions,
+                                  int notification_responsiveness_ms,
+                                  int unknown_timer_ms);
+static void loc_geofence_pause(int32_t geofence_id);
+static void loc_geofence_resume(int32_t geofence_id, int monitor_transitions);
+static void loc_geofence_remove_area(int32_t geofence_id);
+
+static const GpsGeofencingInterface sLocEngGeofenceInterface =
+{
+    sizeof(GpsGeofencingInterface),
+    loc_geofence_init,
+    loc_geofence_add_area,
+    loc_geofence_pause,
+    loc_geofence_resume,
+    loc_geofence_remove_area
+};
+
 static void loc_agps_ril_init( AGpsRilCallbacks* callbacks );
 static void loc_agps_ril_set_ref_location(const AGpsRefLocation *agps_reflocation, size_t sz_struct);
 static void loc_agps_ril_set_set_id(AGpsSetIDType type, const char* setid);
@@ -173,6 +197,9 @@ static const GnssConfigurationInterface sLocEngConfigInterface =
 };
 
 static loc_eng_data_s_type loc_afw_data;
+// kept here so that geofence requests made before the engine is up
+// are still answered
+static GpsGeofenceCallbacks sLocGeofenceCallbacks;
 static int gss_fd = -1;
 static int sGnssType = GNSS_UNKNOWN;
 /*===========================================================================
@@ -277,6 +304,7 @@ static int loc_init(GpsCallbacks* callbacks)
     int retVal = -1;
     ENTRY_LOG();
     LOC_API_ADAPTER_EVENT_MASK_T event;
+    int64_t startMsec = ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION;
 
     if (NULL == callbacks) {
         LOC_LOGE("loc_init failed. cb = NULL\n");
@@ -328,6 +356,10 @@ static int loc_init(GpsCallbacks* callbacks)
     LOC_LOGD("loc_eng_init() success!");
 
 err:
+    // startup cost, target identification included
+    LOC_LOGD("%s: took %lld ms", __func__,
+             (long long)(ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION -
+                         startMsec));
     EXIT_LOG(%d, retVal);
     return retVal;
 }
@@ -621,7 +653,9 @@ const void* loc_get_extension(const char* name)
    }
    else if (strcmp(name, GPS_GEOFENCING_INTERFACE) == 0)
    {
-       if ((gps_conf.CAPABILITIES | GPS_CAPABILITY_GEOFENCING) == gps_conf.CAPABILITIES ){
+       if (gps_conf.HAL_GEOFENCE) {
+           ret_val = &sLocEngGeofenceInterface;
+       } else if ((gps_conf.CAPABILITIES | GPS_CAPABILITY_GEOFENCING) == gps_conf.CAPABILITIES ){
            ret_val = get_geofence_interface();
        }
    }
@@ -941,6 +975,108 @@ static void loc_gps_measurement_close()
     EXIT_LOG(%s, VOID_RET);
 }
 
+/*===========================================================================
+FUNCTION    loc_geofence_init
+
+DESCRIPTION
+   This function initializes the HAL side geofence engine
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_geofence_init(GpsGeofenceCallbacks* callbacks)
+{
+    ENTRY_LOG();
+    if (NULL != callbacks) {
+        sLocGeofenceCallbacks = *callbacks;
+    }
+    loc_eng_geofence_init(loc_afw_data, callbacks);
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_geofence_add_area
+
+DESCRIPTION
+   This function adds a circular geofence. The HAL engine checks fences
+   against every fix it reports, so the responsiveness and unknown timer
+   hints are not used.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_geofence_add_area(int32_t geofence_id, double latitude,
+                                  double longitude, double radius_meters,
+                                  int last_transition, int monitor_transitions,
+                                  int notification_responsiveness_ms,
+                                  int unknown_timer_ms)
+{
+    ENTRY_LOG();
+    LOC_LOGD("%s: responsiveness %d ms, unknown timer %d ms not used",
+             __func__, notification_responsiveness_ms, unknown_timer_ms);
+    if (0 != loc_eng_geofence_add(loc_afw_data, geofence_id, latitude,
+                                  longitude, radius_meters, last_transition,
+                                  monitor_transitions) &&
+        NULL != sLocGeofenceCallbacks.geofence_add_callback) {
+        sLocGeofenceCallbacks.geofence_add_callback(geofence_id,
+                                                    GPS_GEOFENCE_ERROR_GENERIC);
+    }
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_geofence_pause(int32_t geofence_id)
+{
+    ENTRY_LOG();
+    if (0 != loc_eng_geofence_pause(loc_afw_data, geofence_id) &&
+        NULL != sLocGeofenceCallbacks.geofence_pause_callback) {
+        sLocGeofenceCallbacks.geofence_pause_callback(geofence_id,
+                                                      GPS_GEOFENCE_ERROR_GENERIC);
+    }
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_geofence_resume(int32_t geofence_id, int monitor_transitions)
+{
+    ENTRY_LOG();
+    if (0 != loc_eng_geofence_resume(loc_afw_data, geofence_id,
+                                     monitor_transitions) &&
+        NULL != sLocGeofenceCallbacks.geofence_resume_callback) {
+        sLocGeofenceCallbacks.geofence_resume_callback(geofence_id,
+                                                       GPS_GEOFENCE_ERROR_GENERIC);
+    }
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+static void loc_geofence_remove_area(int32_t geofence_id)
+{
+    ENTRY_LOG();
+    if (0 != loc_eng_geofence_remove(loc_afw_data, geofence_id) &&
+        NULL != sLocGeofenceCallbacks.geofence_remove_callback) {
+        sLocGeofenceCallbacks.geofence_remove_callback(geofence_id,
+                                                       GPS_GEOFENCE_ERROR_GENERIC);
+    }
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
 /*===========================================================================
 FUNCTION    loc_ni_init
 
@@ -67,6 +67,7 @@
 #include <loc_eng_msg.h>
 #include <loc_eng_nmea.h>
 #include <msg_q.h>
+#include <LocWorkerPool.h>
 #include <loc.h>
 #include "log_util.h"
 #include "platform_lib_includes.h"
@@ -107,6 +108,17 @@ static const loc_param_s_type gps_conf_table[] =
   {"NMEA_PROVIDER",                  &gps_conf.NMEA_PROVIDER,                  NULL, 'n'},
   {"CAPABILITIES",                   &gps_conf.CAPABILITIES,                   NULL, 'n'},
   {"XTRA_VERSION_CHECK",             &gps_conf.XTRA_VERSION_CHECK,             NULL, 'n'},
+  {"XTRA_CACHE_MAX_AGE",             &gps_conf.XTRA_CACHE_MAX_AGE,             NULL, 'n'},
+  {"FIX_BATCH_SIZE",                 &gps_conf.FIX_BATCH_SIZE,                 NULL, 'n'},
+  {"FIX_BATCH_INTERVAL",             &gps_conf.FIX_BATCH_INTERVAL,             NULL, 'n'},
+  {"REPORT_THREAD_PRIORITY",         &gps_conf.REPORT_THREAD_PRIORITY,         NULL, 'n'},
+  {"REPORT_THREAD_CPU_MASK",         &gps_conf.REPORT_THREAD_CPU_MASK,         NULL, 'n'},
+  {"HAL_GEOFENCE",                   &gps_conf.HAL_GEOFENCE,                   NULL, 'n'},
+  {"HAL_GEOFENCE_DWELL",             &gps_conf.HAL_GEOFENCE_DWELL,             NULL, 'n'},
+  {"SV_DELTA_MODE",                  &gps_conf.SV_DELTA_MODE,                  NULL, 'n'},
+  {"SV_DELTA_SNR",                   &gps_conf.SV_DELTA_SNR,                   NULL, 'n'},
+  {"SV_DELTA_ANGLE",                 &gps_conf.SV_DELTA_ANGLE,                 NULL, 'n'},
+  {"SV_DELTA_MAX_SKIP",              &gps_conf.SV_DELTA_MAX_SKIP,              NULL, 'n'},
   {"XTRA_SERVER_1",                  &gps_conf.XTRA_SERVER_1,                  NULL, 's'},
   {"XTRA_SERVER_2",                  &gps_conf.XTRA_SERVER_2,                  NULL, 's'},
   {"XTRA_SERVER_3",                  &gps_conf.XTRA_SERVER_3,                  NULL, 's'},
@@ -150,6 +162,22 @@ static void loc_default_parameters(void)
    gps_conf.A_GLONASS_POS_PROTOCOL_SELECT = 0;
    /*XTRA version check is disabled by default*/
    gps_conf.XTRA_VERSION_CHECK=0;
+   /*XTRA file caching across engine restarts is disabled by default*/
+   gps_conf.XTRA_CACHE_MAX_AGE = 0;
+   /*Fixes are reported as they arrive unless batching is configured*/
+   gps_conf.FIX_BATCH_SIZE = 0;
+   gps_conf.FIX_BATCH_INTERVAL = 60;
+   /*Report thread keeps the default scheduling policy and affinity*/
+   gps_conf.REPORT_THREAD_PRIORITY = 0;
+   gps_conf.REPORT_THREAD_CPU_MASK = 0;
+   /*Geofences are handled by libgeofence.so unless the HAL engine is enabled*/
+   gps_conf.HAL_GEOFENCE = 0;
+   gps_conf.HAL_GEOFENCE_DWELL = 0;
+   /*Every SV report is delivered unless delta mode is enabled*/
+   gps_conf.SV_DELTA_MODE = 0;
+   gps_conf.SV_DELTA_SNR = 2;
+   gps_conf.SV_DELTA_ANGLE = 1;
+   gps_conf.SV_DELTA_MAX_SKIP = 4;
    /*Use emergency PDN by default*/
    gps_conf.USE_EMERGENCY_PDN_FOR_EMERGENCY_SUPL = 1;
 
@@ -214,6 +242,8 @@ static void update_aiding_data_for_deletion(loc_eng_data_s_type& loc_eng_data) {
         loc_eng_data.aiding_data_for_deletion != 0)
     {
         loc_eng_data.adapter->deleteAidingData(loc_eng_data.aiding_data_for_deletion);
+        loc_eng_xtra_aiding_data_deleted(loc_eng_data,
+                                         loc_eng_data.aiding_data_for_deletion);
         loc_eng_data.aiding_data_for_deletion = 0;
     }
 }
@@ -742,10 +772,19 @@ void LocEngReportPosition::proc() const {
     LocEngAdapter* adapter = (LocEngAdapter*)mAdapter;
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)adapter->getOwner();
 
+    // geofences see every final fix, muted or batched or not
+    if (NULL != locEng->geofence && LOC_SESS_SUCCESS == mStatus) {
+        locEng->geofence->evaluate(mLocation.gpsLocation);
+    }
+
     if (locEng->mute_session_state != LOC_MUTE_SESS_IN_SESSION) {
         bool reported = false;
+        bool batched = false;
+        LocEngFixBatch& batch = adapter->getFixBatch();
         if (locEng->location_cb != NULL) {
             if (LOC_SESS_FAILURE == mStatus) {
+                // fixes held back came first
+                batch.flush();
                 // in case we want to handle the failure case
                 locEng->location_cb(NULL, NULL);
                 reported = true;
@@ -771,8 +810,22 @@ void LocEngReportPosition::proc() const {
                         (gps_conf.ACCURACY_THRES != 0) &&
                         (mLocation.gpsLocation.accuracy >
                          gps_conf.ACCURACY_THRES)))) {
-                locEng->location_cb((UlpLocation*)&(mLocation),
-                                    (void*)mLocationExt);
+                if (batch.isEnabled() &&
+                    GPS_POSITION_RECURRENCE_PERIODIC ==
+                    adapter->getPositionMode().recurrence) {
+                    // held back, delivered with the rest of the batch,
+                    // which now owns rawData
+                    batched = true;
+                    if (batch.add(mLocation, (void*)mLocationExt)) {
+                        batch.flush();
+                    }
+                    ((UlpLocation*)&(mLocation))->rawData = NULL;
+                    ((UlpLocation*)&(mLocation))->rawDataSize = 0;
+                } else {
+                    batch.flush();
+                    locEng->location_cb((UlpLocation*)&(mLocation),
+                                        (void*)mLocationExt);
+                }
                 reported = true;
             }
         }
@@ -796,7 +849,9 @@ void LocEngReportPosition::proc() const {
                         locEng->generateNmea, mLocation.position_source,
                         locEng->engine_status, locEng->adapter->isInSession());
 
-        if (locEng->generateNmea &&
+        // no NMEA for batched fixes, it would wake up the framework
+        // for every fix the batch is meant to hold back
+        if (locEng->generateNmea && !batched &&
             locEng->adapter->isInSession())
         {
             unsigned char generate_nmea = reported &&
@@ -839,20 +894,77 @@ LocEngReportSv::LocEngReportSv(LocAdapterBase* adapter,
 {
     locallog();
 }
+// In SV delta mode, a report is held back if it lists the same SVs
+// with the same masks as the last delivered one, and no SV has moved
+// by SV_DELTA_ANGLE degrees or more, or changed C/N0 by SV_DELTA_SNR
+// dB-Hz or more. Comparing against the last delivered report, not the
+// previous one, keeps slow drift from going unreported; still, at most
+// SV_DELTA_MAX_SKIP reports in a row are held back.
+static bool loc_eng_sv_delta_suppress(loc_eng_data_s_type &loc_eng_data,
+                                      const GnssSvStatus &svStatus)
+{
+    if (0 == gps_conf.SV_DELTA_MODE) {
+        return false;
+    }
+
+    const GnssSvStatus &last = loc_eng_data.sv_delta_last;
+    bool same = (loc_eng_data.sv_delta_skipped < gps_conf.SV_DELTA_MAX_SKIP &&
+                 last.num_svs == svStatus.num_svs &&
+                 last.ephemeris_mask == svStatus.ephemeris_mask &&
+                 last.almanac_mask == svStatus.almanac_mask &&
+                 last.gps_used_in_fix_mask == svStatus.gps_used_in_fix_mask &&
+                 last.glo_used_in_fix_mask == svStatus.glo_used_in_fix_mask &&
+                 last.bds_used_in_fix_mask == svStatus.bds_used_in_fix_mask);
+
+    for (int i = 0; same && i < svStatus.num_svs && i < GPS_MAX_SVS; i++) {
+        const GpsSvInfo &prev = last.sv_list[i];
+        const GpsSvInfo &sv = svStatus.sv_list[i];
+        // azimuth wraps, 359 and 1 degrees are 2 degrees apart
+        float azimuthDelta = fabs(prev.azimuth - sv.azimuth);
+        if (azimuthDelta > 180) {
+            azimuthDelta = 360 - azimuthDelta;
+        }
+        same = (prev.prn == sv.prn &&
+                fabs(prev.snr - sv.snr) < gps_conf.SV_DELTA_SNR &&
+                fabs(prev.elevation - sv.elevation) < gps_conf.SV_DELTA_ANGLE &&
+                azimuthDelta < gps_conf.SV_DELTA_ANGLE);
+    }
+
+    if (same) {
+        loc_eng_data.sv_delta_skipped++;
+        loc_eng_data.sv_delta_suppressed_count++;
+    } else {
+        loc_eng_data.sv_delta_last = svStatus;
+        loc_eng_data.sv_delta_skipped = 0;
+        loc_eng_data.sv_delta_delivered_count++;
+    }
+
+    if (0 == (loc_eng_data.sv_delta_delivered_count +
+              loc_eng_data.sv_delta_suppressed_count) % 100) {
+        LOC_LOGD("%s: %u SV reports delivered, %u suppressed", __func__,
+                 loc_eng_data.sv_delta_delivered_count,
+                 loc_eng_data.sv_delta_suppressed_count);
+    }
+    return same;
+}
+
 void LocEngReportSv::proc() const {
     LocEngAdapter* adapter = (LocEngAdapter*)mAdapter;
     loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)adapter->getOwner();
 
     if (locEng->mute_session_state != LOC_MUTE_SESS_IN_SESSION)
     {
-        if (locEng->sv_status_cb != NULL) {
+        bool suppress = loc_eng_sv_delta_suppress(*locEng, mSvStatus);
+
+        if (locEng->sv_status_cb != NULL && !suppress) {
             locEng->sv_status_cb((GpsSvStatus*)&(mSvStatus),
                                  (void*)mSvExt);
         }
 
         if (locEng->generateNmea)
         {
-            loc_eng_nmea_generate_sv(locEng, mSvStatus, mLocationExtended);
+            loc_eng_nmea_generate_sv(locEng, mSvStatus, mLocationExtended,
+                                     !suppress);
         }
     }
 }
@@ -1626,8 +1738,18 @@ struct LocEngGnssConstellationConfig : public LocMsg {
 //        case LOC_ENG_MSG_REPORT_GNSS_MEASUREMENT:
 LocEngReportGpsMeasurement::LocEngReportGpsMeasurement(void* locEng,
                                                        GpsData &gpsData) :
-    LocMsg(), mLocEng(locEng), mGpsData(gpsData)
+    LocMsg(), mLocEng(locEng)
 {
+    // copy only the measurements in use; the rest of the array is never read
+    size_t count = gpsData.measurement_count;
+    if (count > GPS_MAX_MEASUREMENT) {
+        count = GPS_MAX_MEASUREMENT;
+    }
+    mGpsData.size = gpsData.size;
+    mGpsData.measurement_count = count;
+    memcpy(mGpsData.measurements, gpsData.measurements,
+           sizeof(GpsMeasurement) * count);
+    mGpsData.clock = gpsData.clock;
     locallog();
 }
 void LocEngReportGpsMeasurement::proc() const {
@@ -1736,7 +1858,11 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
     STATE_CHECK((NULL == loc_eng_data.adapter),
                 "instance already initialized", return 0);
 
+    // without an adapter there is no msg task to touch the engine
+    delete loc_eng_data.geofence;
     memset(&loc_eng_data, 0, sizeof (loc_eng_data));
+    // nothing delivered yet, so the first SV report always goes out
+    loc_eng_data.sv_delta_last.num_svs = -1;
 
     // Save callbacks
     loc_eng_data.location_cb  = callbacks->location_cb;
@@ -1770,9 +1896,19 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
     loc_eng_data.adapter =
         new LocEngAdapter(event, &loc_eng_data, context,
                           (LocThread::tCreate)callbacks->create_thread_cb);
+    loc_eng_data.adapter->getFixBatch().configure(
+        gps_conf.FIX_BATCH_SIZE, gps_conf.FIX_BATCH_INTERVAL,
+        loc_eng_data.adapter->getMsgTask(), loc_eng_data.location_cb);
+    if (gps_conf.REPORT_THREAD_PRIORITY || gps_conf.REPORT_THREAD_CPU_MASK) {
+        // reports are delivered on the msg task thread
+        loc_eng_data.adapter->getMsgTask()->setSched(
+            LocThreadSched(gps_conf.REPORT_THREAD_PRIORITY,
+                           gps_conf.REPORT_THREAD_CPU_MASK));
+    }
 
     LOC_LOGD("loc_eng_init created client, id = %p\n",
              loc_eng_data.adapter);
+    LocWorkerPool::dumpShared();
     loc_eng_data.adapter->sendMsg(new LocEngInit(&loc_eng_data));
 
     EXIT_LOG(%d, ret_val);
@@ -1826,6 +1962,7 @@ static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
     adapter->sendMsg(new LocEngEnableData(adapter, NULL, 0, (agpsStatus ? 1:0)));
 
     loc_eng_xtra_version_check(loc_eng_data, gps_conf.XTRA_VERSION_CHECK);
+    loc_eng_xtra_inject_cached(loc_eng_data);
 
     LOC_LOGD("loc_eng_reinit reinit() successful");
     EXIT_LOG(%d, ret_val);
@@ -1856,6 +1993,8 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
     // XTRA has no state, so we are fine with it.
 
     // we need to check and clear NI
+    loc_eng_ni_cleanup(loc_eng_data);
+    loc_eng_geofence_cleanup(loc_eng_data);
 #if 0
     // we need to check and clear ATL
     if (NULL != loc_eng_data.agnss_nif) {
@@ -1873,6 +2012,8 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
         loc_eng_stop(loc_eng_data);
     }
 
+    LocWorkerPool::dumpShared();
+
 #if 0 // can't afford to actually clean up, for many reason.
 
     LOC_LOGD("loc_eng_init: client opened. close it now.");
@@ -1980,6 +2121,13 @@ static int loc_eng_stop_handler(loc_eng_data_s_type &loc_eng_data)
        loc_eng_data.adapter->setInSession(FALSE);
    }
 
+   // do not strand batched fixes when the session ends
+   loc_eng_data.adapter->getFixBatch().flush();
+
+   // the next session starts with a full SV report
+   loc_eng_data.sv_delta_last.num_svs = -1;
+   loc_eng_data.sv_delta_skipped = 0;
+
     EXIT_LOG(%d, ret_val);
     return ret_val;
 }
@@ -2211,7 +2359,8 @@ static int dataCallCb(void *cb_data)
         dsCbData *cbData = (dsCbData *)cb_data;
         LocEngAdapter *locAdapter = (LocEngAdapter *)cbData->mAdapter;
         if(cbData->action == GPS_REQUEST_AGPS_DATA_CONN) {
-            LOC_LOGD("dataCallCb GPS_REQUEST_AGPS_DATA_CONN\n");
+            LOC_LOGD("dataCallCb GPS_REQUEST_AGPS_DATA_CONN for handle %d\n",
+                     cbData->connHandle);
             ret =  locAdapter->openAndStartDataCall();
         }
         else if(cbData->action == GPS_RELEASE_AGPS_DATA_CONN) {
@@ -2330,6 +2479,7 @@ static void deleteAidingData(loc_eng_data_s_type &logEng) {
     if (logEng.engine_status != GPS_STATUS_ENGINE_ON &&
         logEng.aiding_data_for_deletion != 0) {
         logEng.adapter->deleteAidingData(logEng.aiding_data_for_deletion);
+        loc_eng_xtra_aiding_data_deleted(logEng, logEng.aiding_data_for_deletion);
         logEng.aiding_data_for_deletion = 0;
     }
 }
@@ -2997,3 +3147,252 @@ void loc_eng_gps_measurement_close(loc_eng_data_s_type &loc_eng_data)
     loc_eng_data.gps_measurement_cb = NULL;
     EXIT_LOG(%d, 0);
 }
+
+struct LocEngGeofenceInit : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const GpsGeofenceCallbacks mCallbacks;
+    inline LocEngGeofenceInit(loc_eng_data_s_type* locEng,
+                              const GpsGeofenceCallbacks& callbacks) :
+        LocMsg(), mLocEng(locEng), mCallbacks(callbacks)
+    {
+        locallog();
+    }
+    inline virtual void proc() const
+    {
+        if (NULL == mLocEng->geofence) {
+            mLocEng->geofence =
+                new LocEngGeofence(mCallbacks, gps_conf.HAL_GEOFENCE_DWELL);
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngGeofenceInit - dwell: %u s", gps_conf.HAL_GEOFENCE_DWELL);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+struct LocEngGeofenceAdd : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int32_t mId;
+    const double mLatitude;
+    const double mLongitude;
+    const double mRadius;
+    const int mLastTransition;
+    const int mMonitorTransitions;
+    inline LocEngGeofenceAdd(loc_eng_data_s_type* locEng, int32_t id,
+                             double latitude, double longitude,
+                             double radius, int lastTransition,
+                             int monitorTransitions) :
+        LocMsg(), mLocEng(locEng), mId(id), mLatitude(latitude),
+        mLongitude(longitude), mRadius(radius),
+        mLastTransition(lastTransition),
+        mMonitorTransitions(monitorTransitions)
+    {
+        locallog();
+    }
+    inline virtual void proc() const
+    {
+        if (NULL != mLocEng->geofence) {
+            mLocEng->geofence->add(mId, mLatitude, mLongitude, mRadius,
+                                   mLastTransition, mMonitorTransitions);
+        } else {
+            LOC_LOGE("LocEngGeofenceAdd - geofence engine not initialized");
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngGeofenceAdd - id: %d\n  lat: %f\n  lon: %f\n"
+                 "  radius: %f\n  last transition: %d\n  monitor: %d",
+                 mId, mLatitude, mLongitude, mRadius,
+                 mLastTransition, mMonitorTransitions);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+enum loc_eng_geofence_op_e_type {
+    LOC_ENG_GEOFENCE_REMOVE,
+    LOC_ENG_GEOFENCE_PAUSE,
+    LOC_ENG_GEOFENCE_RESUME
+};
+
+struct LocEngGeofenceOp : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const loc_eng_geofence_op_e_type mOp;
+    const int32_t mId;
+    const int mMonitorTransitions;
+    inline LocEngGeofenceOp(loc_eng_data_s_type* locEng,
+                            loc_eng_geofence_op_e_type op, int32_t id,
+                            int monitorTransitions = 0) :
+        LocMsg(), mLocEng(locEng), mOp(op), mId(id),
+        mMonitorTransitions(monitorTransitions)
+    {
+        locallog();
+    }
+    inline virtual void proc() const
+    {
+        if (NULL == mLocEng->geofence) {
+            LOC_LOGE("LocEngGeofenceOp - geofence engine not initialized");
+            return;
+        }
+        switch (mOp) {
+        case LOC_ENG_GEOFENCE_REMOVE:
+            mLocEng->geofence->remove(mId);
+            break;
+        case LOC_ENG_GEOFENCE_PAUSE:
+            mLocEng->geofence->pause(mId);
+            break;
+        case LOC_ENG_GEOFENCE_RESUME:
+            mLocEng->geofence->resume(mId, mMonitorTransitions);
+            break;
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngGeofenceOp - op: %d\n  id: %d\n  monitor: %d",
+                 mOp, mId, mMonitorTransitions);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+struct LocEngGeofenceCleanup : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    inline LocEngGeofenceCleanup(loc_eng_data_s_type* locEng) :
+        LocMsg(), mLocEng(locEng)
+    {
+        locallog();
+    }
+    inline virtual void proc() const
+    {
+        delete mLocEng->geofence;
+        mLocEng->geofence = NULL;
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngGeofenceCleanup");
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+/*===========================================================================
+FUNCTION    loc_eng_geofence_init
+
+DESCRIPTION
+   Starts the HAL side geofence engine, which evaluates the fixes reported
+   through the HAL against the geofences added to it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_geofence_init(loc_eng_data_s_type &loc_eng_data,
+                           GpsGeofenceCallbacks* callbacks)
+{
+    ENTRY_LOG_CALLFLOW();
+
+    INIT_CHECK(loc_eng_data.adapter, return);
+    STATE_CHECK((callbacks != NULL),
+                "callbacks can not be NULL",
+                return);
+
+    loc_eng_data.adapter->sendMsg(new LocEngGeofenceInit(&loc_eng_data,
+                                                         *callbacks));
+    EXIT_LOG(%s, VOID_RET);
+}
+
+int loc_eng_geofence_add(loc_eng_data_s_type &loc_eng_data, int32_t id,
+                         double latitude, double longitude, double radius,
+                         int last_transition, int monitor_transitions)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    loc_eng_data.adapter->sendMsg(new LocEngGeofenceAdd(&loc_eng_data, id,
+                                                        latitude, longitude,
+                                                        radius,
+                                                        last_transition,
+                                                        monitor_transitions));
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+int loc_eng_geofence_remove(loc_eng_data_s_type &loc_eng_data, int32_t id)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    loc_eng_data.adapter->sendMsg(new LocEngGeofenceOp(&loc_eng_data,
+                                                       LOC_ENG_GEOFENCE_REMOVE,
+                                                       id));
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+int loc_eng_geofence_pause(loc_eng_data_s_type &loc_eng_data, int32_t id)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    loc_eng_data.adapter->sendMsg(new LocEngGeofenceOp(&loc_eng_data,
+                                                       LOC_ENG_GEOFENCE_PAUSE,
+                                                       id));
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+int loc_eng_geofence_resume(loc_eng_data_s_type &loc_eng_data, int32_t id,
+                            int monitor_transitions)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    loc_eng_data.adapter->sendMsg(new LocEngGeofenceOp(&loc_eng_data,
+                                                       LOC_ENG_GEOFENCE_RESUME,
+                                                       id,
+                                                       monitor_transitions));
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_geofence_cleanup
+
+DESCRIPTION
+   Deletes the HAL side geofence engine with all its geofences. A later
+   loc_eng_geofence_init() starts a new one.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_geofence_cleanup(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return);
+
+    loc_eng_data.adapter->sendMsg(new LocEngGeofenceCleanup(&loc_eng_data));
+    EXIT_LOG(%s, VOID_RET);
+}
@@ -52,6 +52,7 @@ typedef unsigned char boolean;
 #include <loc_eng_xtra.h>
 #include <loc_eng_ni.h>
 #include <loc_eng_agps.h>
+#include <loc_eng_geofence.h>
 #include <loc_cfg.h>
 #include <loc_log.h>
 #include <log_util.h>
@@ -100,6 +101,9 @@ typedef struct loc_eng_data_s
     loc_eng_xtra_data_s_type       xtra_module_data;
     loc_eng_ni_data_s_type         loc_eng_ni_data;
 
+    // HAL side geofence engine, only touched on the msg task
+    LocEngGeofence*                geofence;
+
     // AGPS state machines
     AgpsStateMachine*              agnss_nif;
     AgpsStateMachine*              internet_nif;
@@ -117,6 +121,12 @@ typedef struct loc_eng_data_s
     // For muting session broadcast
     loc_mute_session_e_type        mute_session_state;
 
+    // For SV report delta mode, the last SV report delivered
+    GnssSvStatus                   sv_delta_last;
+    uint32_t                       sv_delta_skipped;
+    uint32_t                       sv_delta_delivered_count;
+    uint32_t                       sv_delta_suppressed_count;
+
     // For nmea generation
     boolean generateNmea;
     uint32_t sv_used_mask;
@@ -152,6 +162,17 @@ typedef struct loc_gps_cfg_s
     uint32_t       CAPABILITIES;
     uint32_t       LPP_PROFILE;
     uint32_t       XTRA_VERSION_CHECK;
+    uint32_t       XTRA_CACHE_MAX_AGE;
+    uint32_t       FIX_BATCH_SIZE;
+    uint32_t       FIX_BATCH_INTERVAL;
+    uint32_t       REPORT_THREAD_PRIORITY;
+    uint32_t       REPORT_THREAD_CPU_MASK;
+    uint32_t       HAL_GEOFENCE;
+    uint32_t       HAL_GEOFENCE_DWELL;
+    uint32_t       SV_DELTA_MODE;
+    uint32_t       SV_DELTA_SNR;
+    uint32_t       SV_DELTA_ANGLE;
+    uint32_t       SV_DELTA_MAX_SKIP;
     char        XTRA_SERVER_1[MAX_XTRA_SERVER_URL_LENGTH];
     char        XTRA_SERVER_2[MAX_XTRA_SERVER_URL_LENGTH];
     char        XTRA_SERVER_3[MAX_XTRA_SERVER_URL_LENGTH];
@@ -246,6 +267,9 @@ int  loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
                              char* data, int length);
 int  loc_eng_xtra_request_server(loc_eng_data_s_type &loc_eng_data);
 void loc_eng_xtra_version_check(loc_eng_data_s_type &loc_eng_data, int check);
+void loc_eng_xtra_inject_cached(loc_eng_data_s_type &loc_eng_data);
+void loc_eng_xtra_aiding_data_deleted(loc_eng_data_s_type &loc_eng_data,
+                                      GpsAidingData f);
 
 //loc_eng_ni functions
 extern void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data,
@@ -256,6 +280,7 @@ extern void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
                                    const GpsNiNotification *notif,
                                    const void* passThrough);
 extern void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data);
+extern void loc_eng_ni_cleanup(loc_eng_data_s_type &loc_eng_data);
 
 void loc_eng_configuration_update (loc_eng_data_s_type &loc_eng_data,
                                    const char* config_data, int32_t length);
@@ -263,6 +288,17 @@ int loc_eng_gps_measurement_init(loc_eng_data_s_type &loc_eng_data,
                                  GpsMeasurementCallbacks* callbacks);
 void loc_eng_gps_measurement_close(loc_eng_data_s_type &loc_eng_data);
 
+void loc_eng_geofence_init(loc_eng_data_s_type &loc_eng_data,
+                           GpsGeofenceCallbacks* callbacks);
+int loc_eng_geofence_add(loc_eng_data_s_type &loc_eng_data, int32_t id,
+                         double latitude, double longitude, double radius,
+                         int last_transition, int monitor_transitions);
+int loc_eng_geofence_remove(loc_eng_data_s_type &loc_eng_data, int32_t id);
+int loc_eng_geofence_pause(loc_eng_data_s_type &loc_eng_data, int32_t id);
+int loc_eng_geofence_resume(loc_eng_data_s_type &loc_eng_data, int32_t id,
+                            int monitor_transitions);
+void loc_eng_geofence_cleanup(loc_eng_data_s_type &loc_eng_data);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -37,6 +37,9 @@
 #include <loc_eng_dmn_conn_handler.h>
 #include <loc_eng_dmn_conn.h>
 #include <sys/time.h>
+#ifndef USE_GLIB
+#include <utils/SystemClock.h>
+#endif /* USE_GLIB */
 
 //======================================================================
 // C callbacks
@@ -71,6 +74,10 @@ static bool notifySubscriber(void* fromCaller, void* fromList)
     Notification* notification = (Notification*)fromCaller;
     Subscriber* s1 = (Subscriber*)fromList;
 
+    if (s1->forMe(*notification)) {
+        s1->mStateMachine->reportSetupLatency(s1, notification->rsrcStatus);
+    }
+
     // we notify every subscriber indiscriminatively
     // each subscriber decides if this notification is interesting.
     return s1->notifyRsrcStatus(*notification) &&
@@ -273,9 +280,9 @@ AgpsState* AgpsReleasedState::onRsrcEvent(AgpsRsrcStatus event, void* data)
         // but we need to add subscriber to the list
         mStateMachine->addSubscriber((Subscriber*)data);
         // request from connecivity service for NIF
-        //The if condition is added so that if the data call setup fails
-        //for DS State Machine, we want to retry in released state.
-        //for AGps State Machine, sendRsrcRequest() will always return success
+        //sendRsrcRequest() only queues the request for both the AGps and
+        //the DS State Machine; a failed data call setup comes back later
+        //as RSRC_DENIED in PENDING state.
         if(!mStateMachine->sendRsrcRequest(GPS_REQUEST_AGPS_DATA_CONN)) {
             // move the state to PENDING
             nextState = mPendingState;
@@ -629,6 +636,9 @@ AgpsStateMachine::AgpsStateMachine(servicerType servType,
     mAPNLen(0),
     mBearer(AGPS_APN_BEARER_INVALID),
     mEnforceSingleSubscriber(enforceSingleSubscriber),
+    mSetupCount(0),
+    mSetupTotalMsec(0),
+    mSetupMaxMsec(0),
     mServicer(Servicer :: getServicer(servType, (void *)cb_func))
 {
     linked_list_init(&mSubscribers);
@@ -697,6 +707,35 @@ void AgpsStateMachine::setAPN(const char* apn, unsigned int len)
     }
 }
 
+void AgpsStateMachine::reportSetupLatency(Subscriber* subscriber,
+                                          AgpsRsrcStatus status) const
+{
+    if (0 == subscriber->mRequestTime ||
+        (RSRC_GRANTED != status && RSRC_DENIED != status)) {
+        return;
+    }
+
+    int64_t latency =
+        ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION -
+        subscriber->mRequestTime;
+    subscriber->mRequestTime = 0;
+
+    if (RSRC_GRANTED == status) {
+        mSetupCount++;
+        mSetupTotalMsec += latency;
+        if (latency > mSetupMaxMsec) {
+            mSetupMaxMsec = latency;
+        }
+    }
+
+    LOC_LOGI("%s: bearer setup for type %s handle %u %s in %lld msec "
+             "(setups: %u, avg: %lld msec, max: %lld msec)",
+             __func__, loc_get_agps_type_name(mType), subscriber->ID,
+             RSRC_GRANTED == status ? "granted" : "denied",
+             (long long)latency, mSetupCount,
+             (long long)getSetupAvgMsec(), (long long)mSetupMaxMsec);
+}
+
 void AgpsStateMachine::onRsrcEvent(AgpsRsrcStatus event)
 {
     switch (event)
@@ -743,7 +782,9 @@ void AgpsStateMachine::addSubscriber(Subscriber* subscriber) const
                        hasSubscriber, (void*)&notification, false);
 
     if (NULL == s) {
-        linked_list_add(mSubscribers, subscriber->clone(), deleteObj);
+        s = subscriber->clone();
+        s->mRequestTime = ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION;
+        linked_list_add(mSubscribers, s, deleteObj);
     }
 }
 
@@ -812,11 +853,69 @@ bool AgpsStateMachine::hasActiveSubscribers() const
 //======================================================================
 // DSStateMachine
 //======================================================================
+
+// runs a ds_client request on the DS call task; the outcome of a start
+// request goes back to the state machine on the loc_eng task
+struct LocEngDataCallReq : public LocMsg {
+    DSStateMachine* mStateMachine;
+    LocEngAdapter* mAdapter;
+    Servicer* mServicer;
+    dsCbData mCbData;
+    const int mConnHandle;
+    inline LocEngDataCallReq(DSStateMachine* stateMachine,
+                             LocEngAdapter* adapter, Servicer* servicer,
+                             AGpsStatusValue action, int connHandle) :
+        LocMsg(), mStateMachine(stateMachine), mAdapter(adapter),
+        mServicer(servicer), mConnHandle(connHandle)
+    {
+        mCbData.action = action;
+        mCbData.mAdapter = adapter;
+        mCbData.connHandle = connHandle;
+    }
+    virtual void proc() const;
+};
+
+struct LocEngDataCallResult : public LocMsg {
+    DSStateMachine* mStateMachine;
+    const int mResult;
+    const int mConnHandle;
+    inline LocEngDataCallResult(DSStateMachine* stateMachine,
+                                int result, int connHandle) :
+        LocMsg(), mStateMachine(stateMachine), mResult(result),
+        mConnHandle(connHandle) {}
+    inline virtual void proc() const {
+        mStateMachine->onDataCallResult(mResult, mConnHandle);
+    }
+};
+
+struct LocEngDataCallRetry : public LocMsg {
+    DSStateMachine* mStateMachine;
+    const int mConnHandle;
+    inline LocEngDataCallRetry(DSStateMachine* stateMachine,
+                               int connHandle) :
+        LocMsg(), mStateMachine(stateMachine), mConnHandle(connHandle) {}
+    inline virtual void proc() const {
+        mStateMachine->retryDataCall(mConnHandle);
+    }
+};
+
+void LocEngDataCallReq::proc() const
+{
+    int ret = mServicer->requestRsrc((void *)&mCbData);
+    //Only the request to start data call returns a success/failure
+    //The request to stop data call will always succeed
+    if (GPS_REQUEST_AGPS_DATA_CONN == mCbData.action) {
+        mAdapter->sendMsg(new LocEngDataCallResult(mStateMachine, ret,
+                                                   mConnHandle));
+    }
+}
+
 void delay_callback(void *callbackData, int result)
 {
     if(callbackData) {
-        DSStateMachine *DSSMInstance = (DSStateMachine *)callbackData;
-        DSSMInstance->retryCallback();
+        dsRetryData *retry = (dsRetryData *)callbackData;
+        retry->mStateMachine->retryCallback(retry->connHandle);
+        delete retry;
     }
     else {
         LOC_LOGE(" NULL argument received. Failing.\n");
@@ -829,31 +928,46 @@ err:
 DSStateMachine :: DSStateMachine(servicerType type, void *cb_func,
                                  LocEngAdapter* adapterHandle):
     AgpsStateMachine(type, cb_func, AGPS_TYPE_INVALID,false),
-    mLocAdapter(adapterHandle)
+    mLocAdapter(adapterHandle),
+    mDataCalls(LocWorkerPool::getShared())
 {
     LOC_LOGD("%s:%d]: New DSStateMachine\n", __func__, __LINE__);
     mRetries = 0;
 }
 
-void DSStateMachine :: retryCallback(void)
+void DSStateMachine :: retryCallback(int connHandle)
 {
+    //Runs on the timer thread; the subscriber list belongs to the
+    //loc_eng task, so the retry is handed over to it
+    mLocAdapter->sendMsg(new LocEngDataCallRetry(this, connHandle));
+}
+
+void DSStateMachine :: retryDataCall(int connHandle)
+{
+    //Retry the connection handle whose data call failed. If it has been
+    //released meanwhile, the call is retried for the next active handle,
+    //if any, so that it is not left pending
     DSSubscriber *subscriber = NULL;
-    Notification notification(Notification::BROADCAST_ACTIVE);
+    DSSubscriber target(this, connHandle);
+    Notification notification((const Subscriber*)&target);
     linked_list_search(mSubscribers, (void**)&subscriber, hasSubscriber,
                        (void*)&notification, false);
-    if(subscriber)
-        mLocAdapter->requestSuplES(subscriber->ID);
+    if(subscriber && !subscriber->isInactive())
+        postDataCall(GPS_REQUEST_AGPS_DATA_CONN, connHandle);
+    else if(hasActiveSubscribers()) {
+        LOC_LOGD("DSStateMachine :: retryDataCall: handle %d released," \
+                 " retrying for the next active handle\n", connHandle);
+        sendRsrcRequest(GPS_REQUEST_AGPS_DATA_CONN);
+    }
     else
-        LOC_LOGE("DSStateMachine :: retryCallback: No subscriber found." \
-                 "Cannot retry data call\n");
+        LOC_LOGE("DSStateMachine :: retryDataCall: No active subscriber for" \
+                 " handle %d. Cannot retry data call\n", connHandle);
     return;
 }
 
 int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
 {
     DSSubscriber* s = NULL;
-    dsCbData cbData;
-    int ret=-1;
     int connHandle=-1;
     LOC_LOGD("Enter DSStateMachine :: sendRsrcRequest\n");
     Notification notification(Notification::BROADCAST_ACTIVE);
@@ -866,32 +980,47 @@ int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
     else
         LOC_LOGD("DSStateMachine :: sendRsrcRequest - No subscriber found\n");
 
-    cbData.action = action;
-    cbData.mAdapter = mLocAdapter;
-    ret = mServicer->requestRsrc((void *)&cbData);
-    //Only the request to start data call returns a success/failure
-    //The request to stop data call will always succeed
-    //Hence, the below block will only be executed when the
-    //request to start the data call fails
-    switch(ret) {
+    postDataCall(action, connHandle);
+    LOC_LOGD("EXIT DSStateMachine :: sendRsrcRequest\n");
+    return 0;
+}
+
+void DSStateMachine :: postDataCall(AGpsStatusValue action, int connHandle) const
+{
+    //The request only gets queued here; the outcome of a start request
+    //comes back through onDataCallResult(). Start and stop requests run
+    //in the order they are sent, so a stop never overtakes its start.
+    mDataCalls.post(new LocEngDataCallReq((DSStateMachine *)this,
+                                          mLocAdapter, mServicer,
+                                          action, connHandle));
+}
+
+void DSStateMachine :: onDataCallResult(int result, int connHandle)
+{
+    LOC_LOGD("Enter DSStateMachine :: onDataCallResult; result = %d\n", result);
+    switch(result) {
     case LOC_API_ADAPTER_ERR_ENGINE_BUSY:
-        LOC_LOGD("DSStateMachine :: sendRsrcRequest - Failure returned: %d\n",ret);
-        ((DSStateMachine *)this)->incRetries();
+        LOC_LOGD("DSStateMachine :: onDataCallResult - Failure returned: %d\n",result);
+        incRetries();
         if(mRetries > MAX_START_DATA_CALL_RETRIES) {
             LOC_LOGE(" Failed to start Data call. Fallback to normal ATL SUPL\n");
-            informStatus(RSRC_DENIED, connHandle);
+            onRsrcEvent(RSRC_DENIED);
         }
         else {
-            if(loc_timer_start(DATA_CALL_RETRY_DELAY_MSEC, delay_callback, (void *)this)) {
+            dsRetryData *retry = new dsRetryData;
+            retry->mStateMachine = this;
+            retry->connHandle = connHandle;
+            if(NULL == loc_timer_start(DATA_CALL_RETRY_DELAY_MSEC,
+                                       delay_callback, (void *)retry)) {
                 LOC_LOGE("Error: Could not start delay thread\n");
-                ret = -1;
-                goto err;
+                delete retry;
+                onRsrcEvent(RSRC_DENIED);
             }
         }
         break;
     case LOC_API_ADAPTER_ERR_UNSUPPORTED:
         LOC_LOGE("No profile found for emergency call. Fallback to normal SUPL ATL\n");
-        informStatus(RSRC_DENIED, connHandle);
+        onRsrcEvent(RSRC_DENIED);
         break;
     case LOC_API_ADAPTER_ERR_SUCCESS:
         LOC_LOGD("%s:%d]: Request to start data call sent\n", __func__, __LINE__);
@@ -900,14 +1029,11 @@ int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
         //One of the ways this case can be encountered is if the callback function
         //receives a null argument, it just exits with -1 error
         LOC_LOGE("Error: Something went wrong somewhere. Falling back to normal SUPL ATL\n");
-        informStatus(RSRC_DENIED, connHandle);
+        onRsrcEvent(RSRC_DENIED);
         break;
     default:
         LOC_LOGE("%s:%d]: Unrecognized return value\n", __func__, __LINE__);
     }
-err:
-    LOC_LOGD("EXIT DSStateMachine :: sendRsrcRequest; ret = %d\n", ret);
-    return ret;
 }
 
 void DSStateMachine :: onRsrcEvent(AgpsRsrcStatus event)
@@ -39,6 +39,7 @@
 #include <loc_core_log.h>
 #include <linked_list.h>
 #include <loc_timer.h>
+#include <LocWorkerPool.h>
 #include <LocEngAdapter.h>
 
 // forward declaration
@@ -65,8 +66,16 @@ typedef enum {
 typedef struct {
     LocEngAdapter *mAdapter;
     AGpsStatusValue action;
+    int connHandle;
 }dsCbData;
 
+//DS retry timer payload, one per pending connection handle
+class DSStateMachine;
+typedef struct {
+    DSStateMachine *mStateMachine;
+    int connHandle;
+}dsRetryData;
+
 // information bundle for subscribers
 struct Notification {
     // goes to every subscriber
@@ -203,6 +212,10 @@ private:
     AGpsBearerType mBearer;
     // ipv4 address for routing
     bool mEnforceSingleSubscriber;
+    // bearer setup latency stats, in msec, over all subscribers
+    mutable unsigned int mSetupCount;
+    mutable int64_t mSetupTotalMsec;
+    mutable int64_t mSetupMaxMsec;
 
 public:
     AgpsStateMachine(servicerType servType, void *cb_func,
@@ -225,6 +238,11 @@ public:
     // add a subscriber in the linked list, if not already there.
     void addSubscriber(Subscriber* subscriber) const;
 
+    // close out the bearer setup the subscriber is waiting on, if any,
+    // and log its latency. Called as the subscriber gets notified.
+    void reportSetupLatency(Subscriber* subscriber,
+                            AgpsRsrcStatus status) const;
+
     virtual void onRsrcEvent(AgpsRsrcStatus event);
 
     // put the data together and send the FW
@@ -239,6 +257,11 @@ public:
 
     bool hasActiveSubscribers() const;
 
+    inline unsigned int getSetupCount() const { return mSetupCount; }
+    inline int64_t getSetupMaxMsec() const { return mSetupMaxMsec; }
+    inline int64_t getSetupAvgMsec() const
+    { return mSetupCount ? mSetupTotalMsec / mSetupCount : 0; }
+
     inline void dropAllSubscribers() const
     { linked_list_flush(mSubscribers); }
 
@@ -252,13 +275,22 @@ class DSStateMachine : public AgpsStateMachine {
     static const unsigned int DATA_CALL_RETRY_DELAY_MSEC;
     LocEngAdapter* mLocAdapter;
     unsigned char mRetries;
+    // ds_client calls block on QMI transactions with the modem. They run
+    // in order on the shared worker pool, so that ATL requests for the
+    // other bearers are not queued behind an emergency call setup on the
+    // loc_eng task. A call in progress is waited for on destruction.
+    mutable LocWorkerSerial mDataCalls;
+    void postDataCall(AGpsStatusValue action, int connHandle) const;
 public:
     DSStateMachine(servicerType type,
                    void *cb_func,
                    LocEngAdapter* adapterHandle);
     int sendRsrcRequest(AGpsStatusValue action) const;
     void onRsrcEvent(AgpsRsrcStatus event);
-    void retryCallback();
+    void retryCallback(int connHandle);
+    // the following run on the loc_eng task
+    void onDataCallResult(int result, int connHandle);
+    void retryDataCall(int connHandle);
     void informStatus(AgpsRsrcStatus status, int ID) const;
     inline void incRetries() {mRetries++;}
     inline virtual char *whoami() {return (char*)"DSStateMachine";}
@@ -270,9 +302,12 @@ public:
 struct Subscriber {
     const uint32_t ID;
     const AgpsStateMachine* mStateMachine;
+    // time this subscriber started waiting on the NIF, 0 once granted
+    // or denied
+    int64_t mRequestTime;
     inline Subscriber(const int id,
                       const AgpsStateMachine* stateMachine) :
-        ID(id), mStateMachine(stateMachine) {}
+        ID(id), mStateMachine(stateMachine), mRequestTime(0) {}
     inline virtual ~Subscriber() {}
 
     virtual void setIPAddresses(uint32_t &v4, char* v6) = 0;
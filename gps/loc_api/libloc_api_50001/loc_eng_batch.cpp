@@ -0,0 +1,204 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <stdlib.h>
+#include <string.h>
+#include <loc_eng_batch.h>
+#include <LocTimer.h>
+#include <log_util.h>
+#include <platform_lib_includes.h>
+#ifndef USE_GLIB
+#include <utils/SystemClock.h>
+#endif /* USE_GLIB */
+
+/* the batch never holds more fixes than this, whatever gps.conf says */
+#define LOC_FIX_BATCH_CAPACITY_MAX 3600
+
+struct LocEngFixBatchFlush : public LocMsg {
+    LocEngFixBatch* mBatch;
+    const uint32_t mGen;
+    inline LocEngFixBatchFlush(LocEngFixBatch* batch, uint32_t gen) :
+        LocMsg(), mBatch(batch), mGen(gen) {}
+    inline virtual void proc() const {
+        mBatch->flushOnTimeout(mGen);
+    }
+};
+
+// Armed when the first fix goes into an empty batch. Every flush bumps
+// mGen, so a timeout that was already posted when the batch got flushed
+// otherwise does not flush the fixes that came after. mGen is bumped on
+// the msg task and read on the timer thread, hence the atomics.
+class LocEngFixBatchTimer : public LocTimer {
+    LocEngFixBatch& mBatch;
+    const MsgTask* mMsgTask;
+    uint32_t mGen;
+public:
+    inline LocEngFixBatchTimer(LocEngFixBatch& batch, const MsgTask* msgTask) :
+        LocTimer(), mBatch(batch), mMsgTask(msgTask), mGen(0) {}
+    inline uint32_t getGen() const {
+        return __atomic_load_n(&mGen, __ATOMIC_ACQUIRE);
+    }
+    inline void nextGen() {
+        __atomic_add_fetch(&mGen, 1, __ATOMIC_RELEASE);
+    }
+    inline virtual void timeOutCallback() {
+        mMsgTask->sendMsg(new LocEngFixBatchFlush(&mBatch, getGen()));
+    }
+};
+
+LocEngFixBatch::LocEngFixBatch() :
+    mBuffer(NULL), mCapacity(0), mHead(0), mCount(0),
+    mFlushIntervalMsec(0), mOldestMsec(0), mLocationCb(NULL), mTimer(NULL),
+    mFlushCount(0), mFixCount(0), mDropCount(0)
+{
+}
+
+LocEngFixBatch::~LocEngFixBatch()
+{
+    configure(0, 0, NULL, NULL);
+}
+
+void LocEngFixBatch::configure(uint32_t capacity, uint32_t flushIntervalSec,
+                               const MsgTask* msgTask,
+                               loc_location_cb_ext locationCb)
+{
+    if (NULL != mTimer) {
+        mTimer->stop();
+        delete mTimer;
+        mTimer = NULL;
+    }
+    while (mCount > 0) {
+        delete (char*)at(0).location.rawData;
+        mHead = (mHead + 1) % mCapacity;
+        mCount--;
+    }
+    free(mBuffer);
+    mBuffer = NULL;
+    mHead = 0;
+
+    if (capacity > LOC_FIX_BATCH_CAPACITY_MAX) {
+        capacity = LOC_FIX_BATCH_CAPACITY_MAX;
+    }
+    if (capacity > 0) {
+        mBuffer = (LocBatchedFix*)malloc(sizeof(LocBatchedFix) * capacity);
+        if (NULL == mBuffer) {
+            LOC_LOGE("%s: cannot allocate %u batched fixes", __func__, capacity);
+            capacity = 0;
+        } else if (flushIntervalSec > 0 && NULL != msgTask) {
+            mTimer = new LocEngFixBatchTimer(*this, msgTask);
+        }
+    }
+    mCapacity = capacity;
+    mFlushIntervalMsec = flushIntervalSec * 1000;
+    mLocationCb = locationCb;
+    LOC_LOGD("%s: capacity %u, flush interval %u s",
+             __func__, mCapacity, flushIntervalSec);
+}
+
+bool LocEngFixBatch::add(const UlpLocation& location, void* locationExt)
+{
+    if (NULL == mBuffer) {
+        return false;
+    }
+
+    if (mCount == mCapacity) {
+        // only reached if a full batch was not flushed
+        LocBatchedFix& oldest = at(0);
+        delete (char*)oldest.location.rawData;
+        mHead = (mHead + 1) % mCapacity;
+        mCount--;
+        mDropCount++;
+    }
+    if (0 == mCount) {
+        mOldestMsec = ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION;
+        if (NULL != mTimer) {
+            mTimer->start(mFlushIntervalMsec, true);
+        }
+    }
+
+    // fixes mostly come in order, so this rarely moves any
+    uint32_t i = mCount;
+    while (i > 0 &&
+           at(i - 1).location.gpsLocation.timestamp >
+           location.gpsLocation.timestamp) {
+        at(i) = at(i - 1);
+        i--;
+    }
+    LocBatchedFix& fix = at(i);
+    fix.location = location;
+    fix.locationExt = locationExt;
+    mCount++;
+
+    return mCount == mCapacity;
+}
+
+void LocEngFixBatch::flush()
+{
+    if (NULL != mTimer) {
+        mTimer->stop();
+        mTimer->nextGen();
+    }
+    if (0 == mCount) {
+        return;
+    }
+
+    int64_t ageMsec =
+        ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION - mOldestMsec;
+    uint32_t count = mCount;
+
+    while (mCount > 0) {
+        LocBatchedFix& fix = at(0);
+        if (NULL != mLocationCb) {
+            mLocationCb(&fix.location, fix.locationExt);
+        }
+        delete (char*)fix.location.rawData;
+
+        mHead = (mHead + 1) % mCapacity;
+        mCount--;
+    }
+    mHead = 0;
+
+    mFlushCount++;
+    mFixCount += count;
+    LOC_LOGD("%s: flush %u: %u fixes spanning %lld ms, "
+             "%u fixes in %u flushes so far, %u dropped",
+             __func__, mFlushCount, count, (long long)ageMsec,
+             mFixCount, mFlushCount, mDropCount);
+}
+
+void LocEngFixBatch::flushOnTimeout(uint32_t gen)
+{
+    if (NULL != mTimer && gen == mTimer->getGen()) {
+        LOC_LOGV("%s: flush interval of %u ms elapsed",
+                 __func__, mFlushIntervalMsec);
+        flush();
+    }
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_BATCH_H
+#define LOC_ENG_BATCH_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+#include <loc.h>
+#include <MsgTask.h>
+
+class LocEngFixBatchTimer;
+
+/* A batched fix, kept as it was reported */
+typedef struct
+{
+    UlpLocation location;       /* owns rawData, if any */
+    void*       locationExt;
+} LocBatchedFix;
+
+/* Holds the fixes of a periodic session and hands them to the framework
+   in bulk, oldest first, either when the buffer fills up or when the
+   oldest batched fix has waited for the flush interval. Only used from
+   the loc_eng MsgTask thread, so it takes no locks; the flush timer
+   posts its flush to that thread.
+   GpsData measurement sets are not batched: the measurement callback
+   has no batched form in the framework, which expects each epoch as it
+   is measured, and a set is several KB against about 100 bytes a fix. */
+class LocEngFixBatch {
+    LocBatchedFix* mBuffer;
+    uint32_t mCapacity;
+    uint32_t mHead;             /* index of the oldest fix */
+    uint32_t mCount;
+    uint32_t mFlushIntervalMsec;
+    int64_t mOldestMsec;        /* boot time the oldest fix was added */
+    loc_location_cb_ext mLocationCb;
+    LocEngFixBatchTimer* mTimer;
+
+    /* statistics */
+    uint32_t mFlushCount;
+    uint32_t mFixCount;
+    uint32_t mDropCount;
+
+    inline LocBatchedFix& at(uint32_t i) const {
+        return mBuffer[(mHead + i) % mCapacity];
+    }
+
+public:
+    LocEngFixBatch();
+    ~LocEngFixBatch();
+
+    /* capacity of 0 turns batching off */
+    void configure(uint32_t capacity, uint32_t flushIntervalSec,
+                   const MsgTask* msgTask, loc_location_cb_ext locationCb);
+    inline bool isEnabled() const { return NULL != mBuffer; }
+    inline uint32_t getCount() const { return mCount; }
+
+    /* batches a fix in timestamp order and takes over its rawData;
+       returns true if the batch is full and due for a flush */
+    bool add(const UlpLocation& location, void* locationExt);
+
+    /* reports all batched fixes, oldest first, and empties the batch */
+    void flush();
+
+    /* flush of the timer armed as generation gen */
+    void flushOnTimeout(uint32_t gen);
+};
+
+#endif /* LOC_ENG_BATCH_H */
@@ -31,6 +31,7 @@
 #include "log_util.h"
 #include "platform_lib_includes.h"
 #include "loc_eng_dmn_conn_thread_helper.h"
+#include <LocThread.h>
 
 /*===========================================================================
 FUNCTION    thelper_signal_init
@@ -201,27 +202,34 @@ int thelper_signal_block(struct loc_eng_dmn_conn_thelper * thelper)
 }
 
 /*===========================================================================
-FUNCTION    thelper_main
+CLASS    LocThelperRunnable
 
 DESCRIPTION
-   This function is the main thread. It will be launched as a child thread
-
-    data - pointer to the instance
+   Runs the thelper task loop on a LocThread: prerun() does the
+   initialization, run() one round of the task loop, until thread_exit
+   is set, and then the post function
 
 DEPENDENCIES
    None
 
-RETURN VALUE
-   NULL
-
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-static void * thelper_main(void *data)
+class LocThelperRunnable : public LocRunnable {
+    struct loc_eng_dmn_conn_thelper * mThelper;
+    bool mStarted;
+public:
+    inline LocThelperRunnable(struct loc_eng_dmn_conn_thelper * thelper) :
+        LocRunnable(), mThelper(thelper), mStarted(false) {}
+    virtual void prerun();
+    virtual bool run();
+};
+
+void LocThelperRunnable::prerun()
 {
     int result = 0;
-    struct loc_eng_dmn_conn_thelper * thelper = (struct loc_eng_dmn_conn_thelper *) data;
+    struct loc_eng_dmn_conn_thelper * thelper = mThelper;
 
     if (thelper->thread_proc_init) {
         result = thelper->thread_proc_init(thelper->thread_context);
@@ -229,7 +237,7 @@ static void * thelper_main(void *data)
             thelper->thread_exit = 1;
             thelper_signal_ready(thelper);
             LOC_LOGE("%s:%d] error: 0x%lx\n", __func__, __LINE__, (long) thelper);
-            return NULL;
+            return;
         }
     }
 
@@ -240,20 +248,33 @@ static void * thelper_main(void *data)
         if (result < 0) {
             thelper->thread_exit = 1;
             LOC_LOGE("%s:%d] error: 0x%lx\n", __func__, __LINE__, (long) thelper);
-            return NULL;
+            return;
         }
     }
+    mStarted = true;
+}
 
-    do {
-        if (thelper->thread_proc) {
-            result = thelper->thread_proc(thelper->thread_context);
-            if (result < 0) {
-                thelper->thread_exit = 1;
-                LOC_LOGE("%s:%d] error: 0x%lx\n", __func__, __LINE__, (long) thelper);
-            }
+bool LocThelperRunnable::run()
+{
+    int result = 0;
+    struct loc_eng_dmn_conn_thelper * thelper = mThelper;
+
+    if (!mStarted) {
+        return false;
+    }
+
+    if (thelper->thread_proc) {
+        result = thelper->thread_proc(thelper->thread_context);
+        if (result < 0) {
+            thelper->thread_exit = 1;
+            LOC_LOGE("%s:%d] error: 0x%lx\n", __func__, __LINE__, (long) thelper);
         }
-    } while (thelper->thread_exit == 0);
+    }
+    if (thelper->thread_exit == 0) {
+        return true;
+    }
 
+    // run here rather than in postrun(), which a stop() would skip
     if (thelper->thread_proc_post) {
         result = thelper->thread_proc_post(thelper->thread_context);
     }
@@ -261,16 +282,9 @@ static void * thelper_main(void *data)
     if (result != 0) {
         LOC_LOGE("%s:%d] error: 0x%lx\n", __func__, __LINE__, (long) thelper);
     }
-    return NULL;
+    return false;
 }
 
-static void thelper_main_2(void *data)
-{
-    thelper_main(data);
-    return;
-}
-
-
 /*===========================================================================
 FUNCTION    loc_eng_dmn_conn_launch_thelper
 
@@ -302,8 +316,6 @@ int loc_eng_dmn_conn_launch_thelper(struct loc_eng_dmn_conn_thelper * thelper,
     thelper_create_thread   create_thread_cb,
     void * context)
 {
-    int result;
-
     thelper_signal_init(thelper);
 
     if (context) {
@@ -315,22 +327,20 @@ int loc_eng_dmn_conn_launch_thelper(struct loc_eng_dmn_conn_thelper * thelper,
     thelper->thread_proc       = thread_proc;
     thelper->thread_proc_post  = thread_proc_post;
 
-    LOC_LOGD("%s:%d] 0x%lx call pthread_create\n", __func__, __LINE__, (long) thelper);
-    if (create_thread_cb) {
-        result = 0;
-        thelper->thread_id = create_thread_cb("loc_eng_dmn_conn",
-            thelper_main_2, (void *)thelper);
-    } else {
-        result = pthread_create(&thelper->thread_id, NULL,
-            thelper_main, (void *)thelper);
-    }
-
-    if (result != 0) {
+    LOC_LOGD("%s:%d] 0x%lx start thread\n", __func__, __LINE__, (long) thelper);
+    // a LocThread, so that it is named and counted with the others
+    LocThread* thread = new LocThread();
+    LocThelperRunnable* runnable = new LocThelperRunnable(thelper);
+    if (!thread->start((LocThread::tCreate)create_thread_cb,
+                       "loc_eng_dmn_conn", runnable)) {
         LOC_LOGE("%s:%d] 0x%lx\n", __func__, __LINE__, (long) thelper);
+        delete runnable;
+        delete thread;
         return -1;
     }
+    thelper->thread = thread;
 
-    LOC_LOGD("%s:%d] 0x%lx pthread_create done\n", __func__, __LINE__, (long) thelper);
+    LOC_LOGD("%s:%d] 0x%lx thread started\n", __func__, __LINE__, (long) thelper);
 
     thelper_signal_wait(thelper);
 
@@ -383,12 +393,17 @@ SIDE EFFECTS
 ===========================================================================*/
 int loc_eng_dmn_conn_join_thelper(struct loc_eng_dmn_conn_thelper * thelper)
 {
-    int result;
+    int result = 0;
+    LocThread* thread = (LocThread*)thelper->thread;
 
     LOC_LOGD("%s:%d] 0x%lx\n", __func__, __LINE__, (long) thelper);
-    result = pthread_join(thelper->thread_id, NULL);
-    if (result != 0) {
+    if (thread) {
+        // joins the thread
+        delete thread;
+        thelper->thread = NULL;
+    } else {
         LOC_LOGE("%s:%d] 0x%lx\n", __func__, __LINE__, (long) thelper);
+        result = -1;
     }
     LOC_LOGD("%s:%d] 0x%lx\n", __func__, __LINE__, (long) thelper);
 
@@ -40,7 +40,7 @@ struct loc_eng_dmn_conn_thelper {
     unsigned char   thread_ready;
     pthread_cond_t  thread_cond;
     pthread_mutex_t thread_mutex;
-    pthread_t       thread_id;
+    void *          thread;     /* LocThread running the task loop */
     void *          thread_context;
     int             (*thread_proc_init) (void * context);
     int             (*thread_proc_pre)  (void * context);
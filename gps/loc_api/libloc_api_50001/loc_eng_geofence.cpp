@@ -0,0 +1,535 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <loc_eng_geofence.h>
+#include <log_util.h>
+
+/* the engine never holds more fences than this */
+#define LOC_GEOFENCE_MAX              20000
+
+/* hash table sizes, powers of 2 */
+#define LOC_GEOFENCE_CELL_BUCKETS     4096
+#define LOC_GEOFENCE_ID_BUCKETS       1024
+
+/* grid level n has cells of LOC_GEOFENCE_CELL_DEG * 2^n degrees */
+#define LOC_GEOFENCE_CELL_DEG         0.005
+#define LOC_GEOFENCE_LEVELS           16
+
+#define LOC_GEOFENCE_EARTH_RADIUS     6371000.0
+#define LOC_GEOFENCE_METERS_PER_DEG   111320.0
+
+/* stats are logged every so many evaluated fixes */
+#define LOC_GEOFENCE_STATS_FIXES      100
+
+#define LOC_GEOFENCE_NONE             0
+
+struct LocGeofence {
+    int32_t id;
+    double latitude;
+    double longitude;
+    double radius;
+    int monitorTransitions;
+    int lastTransition;         /* last reported, or as given by add */
+    int pendingTransition;      /* waiting for the dwell time to pass */
+    GpsUtcTime pendingSince;
+    bool paused;
+    bool active;
+    bool wide;
+    uint32_t level;
+    uint32_t cellCount;
+    uint64_t cells[4];
+    uint32_t epoch;             /* last fix this fence was checked against */
+    LocGeofence* nextId;
+    LocGeofence* prevActive;
+    LocGeofence* nextActive;
+};
+
+struct LocGeofenceCell {
+    uint64_t key;
+    LocGeofence* fence;
+    LocGeofenceCell* next;
+};
+
+static inline uint32_t cellBucket(uint64_t key)
+{
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 32;
+    return (uint32_t)key & (LOC_GEOFENCE_CELL_BUCKETS - 1);
+}
+
+static inline uint32_t idBucket(int32_t id)
+{
+    return ((uint32_t)id * 2654435761U) >> 22 & (LOC_GEOFENCE_ID_BUCKETS - 1);
+}
+
+static inline double cellDeg(uint32_t level)
+{
+    return LOC_GEOFENCE_CELL_DEG * (1 << level);
+}
+
+/* cell key of a grid index pair at a level; long index wraps at 180 */
+static uint64_t cellKey(uint32_t level, int64_t latIdx, int64_t lonIdx)
+{
+    int64_t lonCells = (int64_t)ceil(360.0 / cellDeg(level));
+    lonIdx %= lonCells;
+    if (lonIdx < 0) {
+        lonIdx += lonCells;
+    }
+    return ((uint64_t)level << 56) |
+           ((uint64_t)(latIdx & 0xFFFFFFF) << 28) |
+           (uint64_t)(lonIdx & 0xFFFFFFF);
+}
+
+static inline int64_t latIndex(double latitude, uint32_t level)
+{
+    return (int64_t)floor((latitude + 90.0) / cellDeg(level));
+}
+
+static inline int64_t lonIndex(double longitude, uint32_t level)
+{
+    return (int64_t)floor((longitude + 180.0) / cellDeg(level));
+}
+
+static double distance(double lat1, double lon1, double lat2, double lon2)
+{
+    double dLat = (lat2 - lat1) * M_PI / 180.0;
+    double dLon = (lon2 - lon1) * M_PI / 180.0;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * M_PI / 180.0) * cos(lat2 * M_PI / 180.0) *
+               sin(dLon / 2) * sin(dLon / 2);
+    return 2 * LOC_GEOFENCE_EARTH_RADIUS * atan2(sqrt(a), sqrt(1 - a));
+}
+
+static int64_t monotonicUsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+LocEngGeofence::LocEngGeofence(const GpsGeofenceCallbacks& callbacks,
+                               uint32_t dwellSec) :
+    mCallbacks(callbacks),
+    mCells((LocGeofenceCell**)calloc(LOC_GEOFENCE_CELL_BUCKETS,
+                                     sizeof(LocGeofenceCell*))),
+    mIds((LocGeofence**)calloc(LOC_GEOFENCE_ID_BUCKETS,
+                               sizeof(LocGeofence*))),
+    mActive(NULL), mWide(NULL), mLevelMask(0), mFenceCount(0),
+    mDwellMsec(dwellSec * 1000), mEpoch(0),
+    mFixCount(0), mCheckCount(0), mTransitionCount(0),
+    mMaxEvalUsec(0), mMaxLatencyMsec(0)
+{
+    memset(mLevelFences, 0, sizeof(mLevelFences));
+    if (NULL != mCallbacks.geofence_status_callback) {
+        // no fix evaluated yet, so the last location carries no data
+        GpsLocation lastLocation;
+        memset(&lastLocation, 0, sizeof(lastLocation));
+        lastLocation.size = sizeof(lastLocation);
+        mCallbacks.geofence_status_callback(GPS_GEOFENCE_AVAILABLE,
+                                            &lastLocation);
+    }
+}
+
+LocEngGeofence::~LocEngGeofence()
+{
+    if (NULL != mIds) {
+        for (int i = 0; i < LOC_GEOFENCE_ID_BUCKETS; i++) {
+            while (NULL != mIds[i]) {
+                LocGeofence* fence = mIds[i];
+                mIds[i] = fence->nextId;
+                unindex(fence);
+                free(fence);
+            }
+        }
+    }
+    free(mIds);
+    free(mCells);
+}
+
+LocGeofence* LocEngGeofence::find(int32_t id) const
+{
+    LocGeofence* fence = mIds[idBucket(id)];
+    while (NULL != fence && fence->id != id) {
+        fence = fence->nextId;
+    }
+    return fence;
+}
+
+// picks the smallest grid level whose cells are no smaller than the
+// fence, so that the fence spans at most 2 cells either way.
+void LocEngGeofence::index(LocGeofence* fence)
+{
+    double latSpan = 2 * fence->radius / LOC_GEOFENCE_METERS_PER_DEG;
+    double cosLat = cos(fence->latitude * M_PI / 180.0);
+    double lonSpan = cosLat > 0.01 ? latSpan / cosLat : 360.0;
+    double span = latSpan > lonSpan ? latSpan : lonSpan;
+
+    uint32_t level = 0;
+    while (level < LOC_GEOFENCE_LEVELS && cellDeg(level) < span) {
+        level++;
+    }
+
+    fence->cellCount = 0;
+    if (level >= LOC_GEOFENCE_LEVELS || lonSpan >= 180.0) {
+        // polar or continent sized, checked against every fix
+        fence->wide = true;
+        fence->nextActive = mWide;
+        mWide = fence;
+        return;
+    }
+
+    fence->wide = false;
+    fence->level = level;
+    double halfLat = latSpan / 2;
+    double halfLon = lonSpan / 2;
+    int64_t latLo = latIndex(fence->latitude - halfLat, level);
+    int64_t latHi = latIndex(fence->latitude + halfLat, level);
+    int64_t lonLo = lonIndex(fence->longitude - halfLon, level);
+    int64_t lonHi = lonIndex(fence->longitude + halfLon, level);
+
+    for (int64_t lat = latLo; lat <= latHi; lat++) {
+        for (int64_t lon = lonLo; lon <= lonHi && fence->cellCount < 4; lon++) {
+            uint64_t key = cellKey(level, lat, lon);
+            LocGeofenceCell* cell =
+                (LocGeofenceCell*)malloc(sizeof(LocGeofenceCell));
+            if (NULL == cell) {
+                LOC_LOGE("%s: cannot index fence %d", __func__, fence->id);
+                continue;
+            }
+            uint32_t bucket = cellBucket(key);
+            cell->key = key;
+            cell->fence = fence;
+            cell->next = mCells[bucket];
+            mCells[bucket] = cell;
+            fence->cells[fence->cellCount++] = key;
+        }
+    }
+    mLevelFences[level]++;
+    mLevelMask |= 1 << level;
+}
+
+void LocEngGeofence::unindex(LocGeofence* fence)
+{
+    setActive(fence, false);
+
+    if (fence->wide) {
+        LocGeofence** link = &mWide;
+        while (NULL != *link && *link != fence) {
+            link = &(*link)->nextActive;
+        }
+        if (NULL != *link) {
+            *link = fence->nextActive;
+        }
+        fence->nextActive = NULL;
+        return;
+    }
+
+    for (uint32_t i = 0; i < fence->cellCount; i++) {
+        LocGeofenceCell** link = &mCells[cellBucket(fence->cells[i])];
+        while (NULL != *link) {
+            LocGeofenceCell* cell = *link;
+            if (cell->fence == fence && cell->key == fence->cells[i]) {
+                *link = cell->next;
+                free(cell);
+                break;
+            }
+            link = &cell->next;
+        }
+    }
+    fence->cellCount = 0;
+    if (0 == --mLevelFences[fence->level]) {
+        mLevelMask &= ~(1 << fence->level);
+    }
+}
+
+// wide fences stay on mWide and are always checked, so they are
+// never put on the active list
+void LocEngGeofence::setActive(LocGeofence* fence, bool active)
+{
+    if (fence->wide || fence->active == active) {
+        return;
+    }
+    if (active) {
+        fence->prevActive = NULL;
+        fence->nextActive = mActive;
+        if (NULL != mActive) {
+            mActive->prevActive = fence;
+        }
+        mActive = fence;
+    } else {
+        if (NULL != fence->prevActive) {
+            fence->prevActive->nextActive = fence->nextActive;
+        } else {
+            mActive = fence->nextActive;
+        }
+        if (NULL != fence->nextActive) {
+            fence->nextActive->prevActive = fence->prevActive;
+        }
+        fence->prevActive = fence->nextActive = NULL;
+    }
+    fence->active = active;
+}
+
+void LocEngGeofence::add(int32_t id, double latitude, double longitude,
+                         double radius, int lastTransition,
+                         int monitorTransitions)
+{
+    int32_t status = GPS_GEOFENCE_OPERATION_SUCCESS;
+    LocGeofence* fence = NULL;
+
+    if (NULL == mCells || NULL == mIds) {
+        status = GPS_GEOFENCE_ERROR_GENERIC;
+    } else if (NULL != find(id)) {
+        status = GPS_GEOFENCE_ERROR_ID_EXISTS;
+    } else if (mFenceCount >= LOC_GEOFENCE_MAX) {
+        status = GPS_GEOFENCE_ERROR_TOO_MANY_GEOFENCES;
+    } else if (lastTransition != GPS_GEOFENCE_ENTERED &&
+               lastTransition != GPS_GEOFENCE_EXITED &&
+               lastTransition != GPS_GEOFENCE_UNCERTAIN) {
+        status = GPS_GEOFENCE_ERROR_INVALID_TRANSITION;
+    } else if (radius <= 0 || latitude < -90 || latitude > 90 ||
+               longitude < -180 || longitude > 180 ||
+               NULL == (fence = (LocGeofence*)calloc(1, sizeof(LocGeofence)))) {
+        status = GPS_GEOFENCE_ERROR_GENERIC;
+    } else {
+        fence->id = id;
+        fence->latitude = latitude;
+        fence->longitude = longitude;
+        fence->radius = radius;
+        fence->monitorTransitions = monitorTransitions;
+        fence->lastTransition = lastTransition;
+        fence->pendingTransition = LOC_GEOFENCE_NONE;
+
+        uint32_t bucket = idBucket(id);
+        fence->nextId = mIds[bucket];
+        mIds[bucket] = fence;
+        index(fence);
+        setActive(fence, GPS_GEOFENCE_EXITED != lastTransition);
+        mFenceCount++;
+    }
+
+    LOC_LOGD("%s: id %d at %f, %f radius %f, %u fences, status %d",
+             __func__, id, latitude, longitude, radius, mFenceCount, status);
+    if (NULL != mCallbacks.geofence_add_callback) {
+        mCallbacks.geofence_add_callback(id, status);
+    }
+}
+
+void LocEngGeofence::remove(int32_t id)
+{
+    int32_t status = GPS_GEOFENCE_ERROR_ID_UNKNOWN;
+    LocGeofence** link = NULL != mIds ? &mIds[idBucket(id)] : NULL;
+
+    while (NULL != link && NULL != *link) {
+        LocGeofence* fence = *link;
+        if (fence->id == id) {
+            *link = fence->nextId;
+            unindex(fence);
+            free(fence);
+            mFenceCount--;
+            status = GPS_GEOFENCE_OPERATION_SUCCESS;
+            break;
+        }
+        link = &fence->nextId;
+    }
+
+    LOC_LOGD("%s: id %d, %u fences, status %d",
+             __func__, id, mFenceCount, status);
+    if (NULL != mCallbacks.geofence_remove_callback) {
+        mCallbacks.geofence_remove_callback(id, status);
+    }
+}
+
+void LocEngGeofence::pause(int32_t id)
+{
+    int32_t status = GPS_GEOFENCE_ERROR_ID_UNKNOWN;
+    LocGeofence* fence = NULL != mIds ? find(id) : NULL;
+
+    if (NULL != fence) {
+        fence->paused = true;
+        fence->pendingTransition = LOC_GEOFENCE_NONE;
+        status = GPS_GEOFENCE_OPERATION_SUCCESS;
+    }
+    if (NULL != mCallbacks.geofence_pause_callback) {
+        mCallbacks.geofence_pause_callback(id, status);
+    }
+}
+
+void LocEngGeofence::resume(int32_t id, int monitorTransitions)
+{
+    int32_t status = GPS_GEOFENCE_ERROR_ID_UNKNOWN;
+    LocGeofence* fence = NULL != mIds ? find(id) : NULL;
+
+    if (NULL != fence) {
+        fence->paused = false;
+        fence->monitorTransitions = monitorTransitions;
+        status = GPS_GEOFENCE_OPERATION_SUCCESS;
+    }
+    if (NULL != mCallbacks.geofence_resume_callback) {
+        mCallbacks.geofence_resume_callback(id, status);
+    }
+}
+
+// A fix is only taken as inside (outside) when it is that far within
+// (beyond) the border by a margin of half its accuracy, capped at half
+// the radius, so inaccurate fixes near the border do not flip the
+// state. A new state is reported once it has held for the dwell time.
+void LocEngGeofence::check(LocGeofence* fence, const GpsLocation& location)
+{
+    fence->epoch = mEpoch;
+    if (fence->paused) {
+        return;
+    }
+    mCheckCount++;
+
+    double margin = 0;
+    if (location.flags & GPS_LOCATION_HAS_ACCURACY) {
+        margin = location.accuracy / 2;
+        if (margin > fence->radius / 2) {
+            margin = fence->radius / 2;
+        }
+    }
+    double dist = distance(fence->latitude, fence->longitude,
+                           location.latitude, location.longitude);
+
+    int state = LOC_GEOFENCE_NONE;
+    if (dist <= fence->radius - margin) {
+        state = GPS_GEOFENCE_ENTERED;
+    } else if (dist >= fence->radius + margin) {
+        state = GPS_GEOFENCE_EXITED;
+    }
+
+    if (LOC_GEOFENCE_NONE == state) {
+        // too close to the border to tell, keep any pending state
+        return;
+    }
+
+    if (state == fence->lastTransition) {
+        fence->pendingTransition = LOC_GEOFENCE_NONE;
+    } else {
+        if (state != fence->pendingTransition) {
+            fence->pendingTransition = state;
+            fence->pendingSince = location.timestamp;
+        }
+        if (location.timestamp - fence->pendingSince >= (GpsUtcTime)mDwellMsec) {
+            fence->lastTransition = state;
+            fence->pendingTransition = LOC_GEOFENCE_NONE;
+            report(fence, location);
+        }
+    }
+
+    // a pending entry needs the fence checked until it is decided
+    setActive(fence, GPS_GEOFENCE_EXITED != fence->lastTransition ||
+                     LOC_GEOFENCE_NONE != fence->pendingTransition);
+}
+
+void LocEngGeofence::report(LocGeofence* fence, const GpsLocation& location)
+{
+    int transition = fence->lastTransition;
+    if (!(fence->monitorTransitions & transition) ||
+        NULL == mCallbacks.geofence_transition_callback) {
+        return;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t latencyMsec = (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000 -
+                          location.timestamp;
+    if (latencyMsec > mMaxLatencyMsec) {
+        mMaxLatencyMsec = latencyMsec;
+    }
+    mTransitionCount++;
+    LOC_LOGD("%s: id %d %s, %lld ms after the fix", __func__, fence->id,
+             GPS_GEOFENCE_ENTERED == transition ? "entered" : "exited",
+             (long long)latencyMsec);
+    mCallbacks.geofence_transition_callback(fence->id, (GpsLocation*)&location,
+                                            transition, location.timestamp);
+}
+
+void LocEngGeofence::evaluate(const GpsLocation& location)
+{
+    if (0 == mFenceCount ||
+        !(location.flags & GPS_LOCATION_HAS_LAT_LONG)) {
+        return;
+    }
+
+    int64_t startUsec = monotonicUsec();
+    mEpoch++;
+
+    // fences near the fix, one cell per grid level in use
+    for (uint32_t level = 0; level < LOC_GEOFENCE_LEVELS; level++) {
+        if (!(mLevelMask & (1 << level))) {
+            continue;
+        }
+        uint64_t key = cellKey(level, latIndex(location.latitude, level),
+                               lonIndex(location.longitude, level));
+        for (LocGeofenceCell* cell = mCells[cellBucket(key)];
+             NULL != cell; cell = cell->next) {
+            if (cell->key == key && cell->fence->epoch != mEpoch) {
+                check(cell->fence, location);
+            }
+        }
+    }
+
+    // fences not known to be outside, however far they are; check()
+    // may take the fence off the list, so step ahead first
+    LocGeofence* fence = mActive;
+    while (NULL != fence) {
+        LocGeofence* next = fence->nextActive;
+        if (fence->epoch != mEpoch) {
+            check(fence, location);
+        }
+        fence = next;
+    }
+
+    for (fence = mWide; NULL != fence; fence = fence->nextActive) {
+        check(fence, location);
+    }
+
+    int64_t evalUsec = monotonicUsec() - startUsec;
+    if (evalUsec > mMaxEvalUsec) {
+        mMaxEvalUsec = evalUsec;
+    }
+    if (0 == ++mFixCount % LOC_GEOFENCE_STATS_FIXES) {
+        LOC_LOGD("%s: %u fences, %u fixes, %llu checks (%.1f per fix), "
+                 "%u transitions, max %lld us per fix, max %lld ms "
+                 "fix to transition", __func__, mFenceCount, mFixCount,
+                 (unsigned long long)mCheckCount,
+                 (double)mCheckCount / mFixCount, mTransitionCount,
+                 (long long)mMaxEvalUsec, (long long)mMaxLatencyMsec);
+    }
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_GEOFENCE_H
+#define LOC_ENG_GEOFENCE_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+struct LocGeofence;
+struct LocGeofenceCell;
+
+/* Evaluates geofences against the fixes the HAL reports, so that
+   breaches are found without asking the modem. Fences are indexed in
+   a hierarchy of lat/long grids: each fence lives in the (at most 4)
+   cells of the one grid level whose cells are at least as large as
+   the fence, so a fix only needs one cell lookup per level in use.
+   Fences not known to be outside are also kept on an active list, so
+   exits are seen however far the fix is. Only used from the loc_eng
+   MsgTask thread, so it takes no locks. */
+class LocEngGeofence {
+    GpsGeofenceCallbacks mCallbacks;
+    LocGeofenceCell** mCells;       /* hash buckets of grid cells */
+    LocGeofence** mIds;             /* hash buckets of fence ids */
+    LocGeofence* mActive;           /* fences not known to be outside */
+    LocGeofence* mWide;             /* fences too large for the grid */
+    uint32_t mLevelMask;            /* grid levels holding fences */
+    uint32_t mLevelFences[32];      /* fence count per grid level */
+    uint32_t mFenceCount;
+    uint32_t mDwellMsec;
+    uint32_t mEpoch;
+
+    /* statistics */
+    uint32_t mFixCount;
+    uint64_t mCheckCount;
+    uint32_t mTransitionCount;
+    int64_t mMaxEvalUsec;
+    int64_t mMaxLatencyMsec;
+
+    LocGeofence* find(int32_t id) const;
+    void index(LocGeofence* fence);
+    void unindex(LocGeofence* fence);
+    void setActive(LocGeofence* fence, bool active);
+    void check(LocGeofence* fence, const GpsLocation& location);
+    void report(LocGeofence* fence, const GpsLocation& location);
+
+public:
+    LocEngGeofence(const GpsGeofenceCallbacks& callbacks, uint32_t dwellSec);
+    ~LocEngGeofence();
+
+    /* GpsGeofencingInterface operations, each answered through the
+       matching GpsGeofenceCallbacks callback */
+    void add(int32_t id, double latitude, double longitude,
+             double radius, int lastTransition, int monitorTransitions);
+    void remove(int32_t id);
+    void pause(int32_t id);
+    void resume(int32_t id, int monitorTransitions);
+
+    /* checks a fix against the fences near it and the active ones */
+    void evaluate(const GpsLocation& location);
+};
+
+#endif /* LOC_ENG_GEOFENCE_H */
@@ -291,7 +291,7 @@ struct LocEngGetZpp : public LocMsg {
 
 struct LocEngReportGpsMeasurement : public LocMsg {
     void* mLocEng;
-    const GpsData mGpsData;
+    GpsData mGpsData;
     LocEngReportGpsMeasurement(void* locEng,
                                GpsData &gpsData);
     virtual void proc() const;
@@ -40,6 +40,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <MsgTask.h>
+#include <LocTimer.h>
 
 #include <loc_eng.h>
 
@@ -59,37 +60,84 @@ using namespace loc_core;
  *                             FUNCTION DECLARATIONS
  *
  *============================================================================*/
-static void* ni_thread_proc(void *args);
+static void ni_session_complete(loc_eng_ni_session_s_type* pSession,
+                                GpsUserResponseType resp);
+static void ni_respond_handler(loc_eng_data_s_type &loc_eng_data,
+                               int notif_id, GpsUserResponseType user_response);
+
+// One timer per NI session slot, armed for each request. The timer
+// thread only posts LocEngNiTimeout; the session itself is only ever
+// touched on the loc_eng msg task, so there is no locking here.
+class LocEngNiTimer : public LocTimer {
+    loc_eng_data_s_type& mLocEng;
+    loc_eng_ni_session_s_type& mSession;
+    // request the timer is armed for; start() orders the write before
+    // the read in timeOutCallback()
+    int mReqID;
+public:
+    inline LocEngNiTimer(loc_eng_data_s_type& locEng,
+                         loc_eng_ni_session_s_type& session) :
+        LocTimer(), mLocEng(locEng), mSession(session), mReqID(0) {}
+    inline bool arm(int reqID, uint32_t timeOutInMs) {
+        // a timer that fired but whose timeout is still queued is no
+        // longer running, so stop() first to be able to rearm it.
+        stop();
+        mReqID = reqID;
+        return start(timeOutInMs, false);
+    }
+    virtual void timeOutCallback();
+};
 
-struct LocEngInformNiResponse : public LocMsg {
-    LocEngAdapter* mAdapter;
-    const GpsUserResponseType mResponse;
-    const void *mPayload;
-    inline LocEngInformNiResponse(LocEngAdapter* adapter,
-                                  GpsUserResponseType resp,
-                                  const void* data) :
-        LocMsg(), mAdapter(adapter),
-        mResponse(resp), mPayload(data)
+struct LocEngNiTimeout : public LocMsg {
+    loc_eng_ni_session_s_type* mSession;
+    const int mReqID;
+    inline LocEngNiTimeout(loc_eng_ni_session_s_type* session, int reqID) :
+        LocMsg(), mSession(session), mReqID(reqID)
     {
         locallog();
     }
-    inline ~LocEngInformNiResponse()
+    inline virtual void proc() const
+    {
+        if (NULL == mSession->rawRequest) {
+            LOC_LOGD("LocEngNiTimeout - session already completed");
+        } else if (mReqID != mSession->reqID) {
+            // fired for an earlier request on this slot before it completed
+            LOC_LOGD("LocEngNiTimeout - stale timeout for reqID %d, slot has %d",
+                     mReqID, mSession->reqID);
+        } else {
+            LOC_LOGD("LocEngNiTimeout - no user response for reqID %d",
+                     mSession->reqID);
+            ni_session_complete(mSession, GPS_NI_RESPONSE_NORESP);
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNiTimeout - session: %p reqID: %d", mSession, mReqID);
+    }
+    inline virtual void log() const
     {
-        // this is a bit weird since mPayload is not
-        // allocated by this class.  But there is no better way.
-        // mPayload actually won't be NULL here.
-        free((void*)mPayload);
+        locallog();
+    }
+};
+
+struct LocEngNiRespond : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int mNotifId;
+    const GpsUserResponseType mResponse;
+    inline LocEngNiRespond(loc_eng_data_s_type* locEng, int notifId,
+                           GpsUserResponseType resp) :
+        LocMsg(), mLocEng(locEng), mNotifId(notifId), mResponse(resp)
+    {
+        locallog();
     }
     inline virtual void proc() const
     {
-        mAdapter->informNiResponse(mResponse, mPayload);
+        ni_respond_handler(*mLocEng, mNotifId, mResponse);
     }
     inline void locallog() const
     {
-        LOC_LOGV("LocEngInformNiResponse - "
-                 "response: %s\n  mPayload: %p",
-                 loc_get_ni_response_name(mResponse),
-                 mPayload);
+        LOC_LOGV("LocEngNiRespond - notif_id: %d response: %s",
+                 mNotifId, loc_get_ni_response_name(mResponse));
     }
     inline virtual void log() const
     {
@@ -97,6 +145,11 @@ struct LocEngInformNiResponse : public LocMsg {
     }
 };
 
+void LocEngNiTimer::timeOutCallback()
+{
+    mLocEng.adapter->sendMsg(new LocEngNiTimeout(&mSession, mReqID));
+}
+
 /*===========================================================================
 
 FUNCTION loc_eng_ni_request_handler
@@ -170,22 +223,15 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
             LOC_LOGI("              extras: %s", notif->extras);
         }
 
-        /* For robustness, spawn a thread at this point to timeout to clear up the notification status, even though
+        /* For robustness, arm a timer at this point to timeout to clear up the notification status, even though
          * the OEM layer in java does not do so.
          **/
-        pSession->respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
-        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", pSession->respTimeLeft);
+        int respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
+        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", respTimeLeft);
 
-        int rc = 0;
-        rc = pthread_create(&pSession->thread, NULL, ni_thread_proc, pSession);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not created.\n");
-        }
-        rc = pthread_detach(pSession->thread);
-        if (rc)
+        if (!pSession->timer->arm(pSession->reqID, respTimeLeft * 1000))
         {
-            LOC_LOGE("Loc NI thread is not detached.\n");
+            LOC_LOGE("Loc NI timer is not started.\n");
         }
 
         CALLBACK_LOG_CALLFLOW("ni_notify_cb - id", %d, notif->notification_id);
@@ -196,76 +242,38 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
 
 /*===========================================================================
 
-FUNCTION ni_thread_proc
+FUNCTION ni_session_complete
+
+DESCRIPTION
+   Sends the user response, or the timeout, of an NI session to the modem
+   and frees the session slot. Runs on the loc_eng msg task.
 
 ===========================================================================*/
-static void* ni_thread_proc(void *args)
+static void ni_session_complete(loc_eng_ni_session_s_type* pSession,
+                                GpsUserResponseType resp)
 {
     ENTRY_LOG();
 
-    loc_eng_ni_session_s_type* pSession = (loc_eng_ni_session_s_type*)args;
-    int rc = 0;          /* return code from pthread calls */
-
-    struct timeval present_time;
-    struct timespec expire_time;
-
-    LOC_LOGD("Starting Loc NI thread...\n");
-    pthread_mutex_lock(&pSession->tLock);
-    /* Calculate absolute expire time */
-    gettimeofday(&present_time, NULL);
-    expire_time.tv_sec  = present_time.tv_sec + pSession->respTimeLeft;
-    expire_time.tv_nsec = present_time.tv_usec * 1000;
-    LOC_LOGD("ni_thread_proc-Time out set for abs time %ld with delay %d sec\n",
-             (long) expire_time.tv_sec, pSession->respTimeLeft );
-
-    while (!pSession->respRecvd)
-    {
-        rc = pthread_cond_timedwait(&pSession->tCond,
-                                    &pSession->tLock,
-                                    &expire_time);
-        if (rc == ETIMEDOUT)
-        {
-            pSession->resp = GPS_NI_RESPONSE_NORESP;
-            LOC_LOGD("ni_thread_proc-Thread time out after valting for specified time. Ret Val %d\n",rc );
-            break;
-        }
-    }
-    LOC_LOGD("ni_thread_proc-Java layer has sent us a user response and return value from "
-             "pthread_cond_timedwait = %d\n",rc );
-    pSession->respRecvd = FALSE; /* Reset the user response flag for the next session*/
-
-    LOC_LOGD("pSession->resp is %d\n",pSession->resp);
+    pSession->timer->stop();
 
-    // adding this check to support modem restart, in which case, we need the thread
-    // to exit without calling sending data. We made sure that rawRequest is NULL in
-    // loc_eng_ni_reset_on_engine_restart()
-    LocEngAdapter* adapter = pSession->adapter;
-    LocEngInformNiResponse *msg = NULL;
+    LOC_LOGD("pSession->resp is %d\n", resp);
 
     if (NULL != pSession->rawRequest) {
-        if (pSession->resp != GPS_NI_RESPONSE_IGNORE) {
+        if (resp != GPS_NI_RESPONSE_IGNORE) {
             LOC_LOGD("pSession->resp != GPS_NI_RESPONSE_IGNORE \n");
-            msg = new LocEngInformNiResponse(adapter,
-                                             pSession->resp,
-                                             pSession->rawRequest);
+            LOC_LOGV("informNiResponse - response: %s\n  payload: %p",
+                     loc_get_ni_response_name(resp), pSession->rawRequest);
+            pSession->adapter->informNiResponse(resp, pSession->rawRequest);
         } else {
             LOC_LOGD("this is the ignore reply for SUPL ES\n");
-            free(pSession->rawRequest);
         }
+        free(pSession->rawRequest);
         pSession->rawRequest = NULL;
     }
-    pthread_mutex_unlock(&pSession->tLock);
 
-    pSession->respTimeLeft = 0;
     pSession->reqID = 0;
 
-    if (NULL != msg) {
-        LOC_LOGD("ni_thread_proc: adapter->sendMsg(msg)\n");
-        adapter->sendMsg(msg);
-    }
-
     EXIT_LOG(%s, VOID_RET);
-    return NULL;
 }
 
 void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
@@ -278,30 +286,91 @@ void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
         return;
     }
 
-    // only if modem has requested but then died.
+    // only if modem has requested but then died. The modem has no
+    // session to respond to any more, so just drop the requests;
+    // a timeout still queued sees rawRequest NULL and does nothing.
     if (NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
+        loc_eng_ni_data_p->sessionEs.timer->stop();
         free(loc_eng_ni_data_p->sessionEs.rawRequest);
         loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
-
-        pthread_mutex_lock(&loc_eng_ni_data_p->sessionEs.tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->sessionEs.respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->sessionEs.tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->sessionEs.tLock);
+        loc_eng_ni_data_p->sessionEs.reqID = 0;
     }
 
     if (NULL != loc_eng_ni_data_p->session.rawRequest) {
+        loc_eng_ni_data_p->session.timer->stop();
         free(loc_eng_ni_data_p->session.rawRequest);
         loc_eng_ni_data_p->session.rawRequest = NULL;
+        loc_eng_ni_data_p->session.reqID = 0;
+    }
+
+    EXIT_LOG(%s, VOID_RET);
+}
 
-        pthread_mutex_lock(&loc_eng_ni_data_p->session.tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->session.respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->session.tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->session.tLock);
+struct LocEngNiCleanup : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    inline LocEngNiCleanup(loc_eng_data_s_type* locEng) :
+        LocMsg(), mLocEng(locEng)
+    {
+        locallog();
     }
+    inline void cleanupSession(loc_eng_ni_session_s_type& session) const
+    {
+        // deleting a LocTimer stops it; a timeout already queued behind
+        // this msg sees rawRequest NULL and does nothing.
+        delete session.timer;
+        session.timer = NULL;
+        if (NULL != session.rawRequest) {
+            free(session.rawRequest);
+            session.rawRequest = NULL;
+        }
+        session.reqID = 0;
+    }
+    inline virtual void proc() const
+    {
+        if (NULL == mLocEng->ni_notify_cb) {
+            LOC_LOGD("LocEngNiCleanup - loc_eng_ni_init hasn't happened yet.");
+            return;
+        }
+        cleanupSession(mLocEng->loc_eng_ni_data.sessionEs);
+        cleanupSession(mLocEng->loc_eng_ni_data.session);
+        mLocEng->ni_notify_cb = NULL;
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNiCleanup");
+    }
+    virtual void log() const
+    {
+        locallog();
+    }
+};
+
+/*===========================================================================
+FUNCTION    loc_eng_ni_cleanup
+
+DESCRIPTION
+   Deletes the NI session timers and drops any pending request. A later
+   loc_eng_ni_init() sets NI up again.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_ni_cleanup(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG_CALLFLOW();
+    if (NULL == loc_eng_data.adapter) {
+        EXIT_LOG(%s, "loc_eng_init hasn't happened yet.");
+        return;
+    }
+
+    loc_eng_data.adapter->sendMsg(new LocEngNiCleanup(&loc_eng_data));
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -322,6 +391,44 @@ SIDE EFFECTS
    N/A
 
 ===========================================================================*/
+struct LocEngNiInit : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const gps_ni_notify_callback mNotifyCb;
+    inline LocEngNiInit(loc_eng_data_s_type* locEng,
+                        gps_ni_notify_callback notifyCb) :
+        LocMsg(), mLocEng(locEng), mNotifyCb(notifyCb)
+    {
+        locallog();
+    }
+    inline virtual void proc() const
+    {
+        if (NULL != mLocEng->ni_notify_cb) {
+            LOC_LOGD("LocEngNiInit - already inited.");
+            return;
+        }
+        loc_eng_ni_data_s_type* loc_eng_ni_data_p = &mLocEng->loc_eng_ni_data;
+        loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
+        loc_eng_ni_data_p->sessionEs.reqID = 0;
+        loc_eng_ni_data_p->sessionEs.timer =
+            new LocEngNiTimer(*mLocEng, loc_eng_ni_data_p->sessionEs);
+
+        loc_eng_ni_data_p->session.rawRequest = NULL;
+        loc_eng_ni_data_p->session.reqID = 0;
+        loc_eng_ni_data_p->session.timer =
+            new LocEngNiTimer(*mLocEng, loc_eng_ni_data_p->session);
+
+        mLocEng->ni_notify_cb = mNotifyCb;
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNiInit - notify cb: %p", mNotifyCb);
+    }
+    virtual void log() const
+    {
+        locallog();
+    }
+};
+
 void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiExtCallbacks *callbacks)
 {
     ENTRY_LOG_CALLFLOW();
@@ -330,25 +437,13 @@ void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiExtCallbacks *callb
         EXIT_LOG(%s, "loc_eng_ni_init: failed, cb is NULL");
     else if (NULL == callbacks->notify_cb) {
         EXIT_LOG(%s, "loc_eng_ni_init: failed, no cb.");
-    } else if (NULL != loc_eng_data.ni_notify_cb) {
-        EXIT_LOG(%s, "loc_eng_ni_init: already inited.");
+    } else if (NULL == loc_eng_data.adapter) {
+        EXIT_LOG(%s, "loc_eng_ni_init: failed, loc_eng_init hasn't happened yet.");
     } else {
-        loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-        loc_eng_ni_data_p->sessionEs.respTimeLeft = 0;
-        loc_eng_ni_data_p->sessionEs.respRecvd = FALSE;
-        loc_eng_ni_data_p->sessionEs.rawRequest = NULL;
-        loc_eng_ni_data_p->sessionEs.reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->sessionEs.tCond, NULL);
-        pthread_mutex_init(&loc_eng_ni_data_p->sessionEs.tLock, NULL);
-
-        loc_eng_ni_data_p->session.respTimeLeft = 0;
-        loc_eng_ni_data_p->session.respRecvd = FALSE;
-        loc_eng_ni_data_p->session.rawRequest = NULL;
-        loc_eng_ni_data_p->session.reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->session.tCond, NULL);
-        pthread_mutex_init(&loc_eng_ni_data_p->session.tLock, NULL);
-
-        loc_eng_data.ni_notify_cb = callbacks->notify_cb;
+        // the NI sessions and their timers are only touched on the
+        // msg task, which also orders this after an earlier cleanup.
+        loc_eng_data.adapter->sendMsg(
+            new LocEngNiInit(&loc_eng_data, callbacks->notify_cb));
         EXIT_LOG(%s, VOID_RET);
     }
 }
@@ -373,25 +468,42 @@ void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
                         int notif_id, GpsUserResponseType user_response)
 {
     ENTRY_LOG_CALLFLOW();
-    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-    loc_eng_ni_session_s_type* pSession = NULL;
 
-    if (NULL == loc_eng_data.ni_notify_cb) {
+    if (NULL == loc_eng_data.ni_notify_cb || NULL == loc_eng_data.adapter) {
         EXIT_LOG(%s, "loc_eng_ni_init hasn't happened yet.");
         return;
     }
 
+    // sessions are only looked at on the msg task
+    loc_eng_data.adapter->sendMsg(new LocEngNiRespond(&loc_eng_data,
+                                                      notif_id, user_response));
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    ni_respond_handler
+
+DESCRIPTION
+   Matches the user response against the NI session it is for, on the
+   loc_eng msg task.
+
+===========================================================================*/
+static void ni_respond_handler(loc_eng_data_s_type &loc_eng_data,
+                               int notif_id, GpsUserResponseType user_response)
+{
+    ENTRY_LOG();
+    loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
+    loc_eng_ni_session_s_type* pSession = NULL;
+
     if (notif_id == loc_eng_ni_data_p->sessionEs.reqID &&
         NULL != loc_eng_ni_data_p->sessionEs.rawRequest) {
         pSession = &loc_eng_ni_data_p->sessionEs;
         // ignore any SUPL NI non-Es session if a SUPL NI ES is accepted
         if (user_response == GPS_NI_RESPONSE_ACCEPT &&
             NULL != loc_eng_ni_data_p->session.rawRequest) {
-                pthread_mutex_lock(&loc_eng_ni_data_p->session.tLock);
-                loc_eng_ni_data_p->session.resp = GPS_NI_RESPONSE_IGNORE;
-                loc_eng_ni_data_p->session.respRecvd = TRUE;
-                pthread_cond_signal(&loc_eng_ni_data_p->session.tCond);
-                pthread_mutex_unlock(&loc_eng_ni_data_p->session.tLock);
+                ni_session_complete(&loc_eng_ni_data_p->session,
+                                    (GpsUserResponseType)GPS_NI_RESPONSE_IGNORE);
         }
     } else if (notif_id == loc_eng_ni_data_p->session.reqID &&
         NULL != loc_eng_ni_data_p->session.rawRequest) {
@@ -400,11 +512,7 @@ void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
 
     if (pSession) {
         LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", user_response, notif_id);
-        pthread_mutex_lock(&pSession->tLock);
-        pSession->resp = user_response;
-        pSession->respRecvd = TRUE;
-        pthread_cond_signal(&pSession->tCond);
-        pthread_mutex_unlock(&pSession->tLock);
+        ni_session_complete(pSession, user_response);
     }
     else {
         LOC_LOGE("loc_eng_ni_respond: notif_id %d not an active session", notif_id);
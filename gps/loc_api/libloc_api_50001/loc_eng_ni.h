@@ -37,15 +37,12 @@
 #define LOC_NI_NOTIF_KEY_ADDRESS           "Address"
 #define GPS_NI_RESPONSE_IGNORE             4
 
+class LocEngNiTimer;
+
 typedef struct {
-    pthread_t               thread;            /* NI thread */
-    int                     respTimeLeft;       /* examine time for NI response */
-    bool                    respRecvd;   /* NI User reponse received or not from Java layer*/
+    LocEngNiTimer*          timer;             /* NI response timeout */
     void*                   rawRequest;
     int                     reqID;         /* ID to check against response */
-    GpsUserResponseType     resp;
-    pthread_cond_t          tCond;
-    pthread_mutex_t         tLock;
     LocEngAdapter*          adapter;
 } loc_eng_ni_session_s_type;
 
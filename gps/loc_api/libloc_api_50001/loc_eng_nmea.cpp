@@ -587,6 +587,47 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
 
 
 
+/*===========================================================================
+FUNCTION    loc_eng_nmea_cache_sv
+
+DESCRIPTION
+   Keep what the position report sentences need from the sv report
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_nmea_cache_sv(loc_eng_data_s_type *loc_eng_data_p,
+                                  const GnssSvStatus &svStatus,
+                                  const GpsLocationExtended &locationExtended)
+{
+    // cache the used in fix mask, as it will be needed to send $GPGSA
+    // during the position report
+    loc_eng_data_p->sv_used_mask = svStatus.gps_used_in_fix_mask;
+
+    // For RPC, the DOP are sent during sv report, so cache them
+    // now to be sent during position report.
+    // For QMI, the DOP will be in position report.
+    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
+    {
+        loc_eng_data_p->pdop = locationExtended.pdop;
+        loc_eng_data_p->hdop = locationExtended.hdop;
+        loc_eng_data_p->vdop = locationExtended.vdop;
+    }
+    else
+    {
+        loc_eng_data_p->pdop = 0;
+        loc_eng_data_p->hdop = 0;
+        loc_eng_data_p->vdop = 0;
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_nmea_generate_sv
 
@@ -604,10 +645,19 @@ SIDE EFFECTS
 
 ===========================================================================*/
 void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
-                              const GnssSvStatus &svStatus, const GpsLocationExtended &locationExtended)
+                              const GnssSvStatus &svStatus, const GpsLocationExtended &locationExtended,
+                              bool generateGsv)
 {
     ENTRY_LOG();
 
+    // no GSV sentences for an sv report held back in delta mode
+    if (!generateGsv)
+    {
+        loc_eng_nmea_cache_sv(loc_eng_data_p, svStatus, locationExtended);
+        EXIT_LOG(%d, 0);
+        return;
+    }
+
     char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
     char* pMarker = sentence;
     int lengthRemaining = sizeof(sentence);
@@ -790,25 +840,7 @@ void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
 
     }//if
 
-    // cache the used in fix mask, as it will be needed to send $GPGSA
-    // during the position report
-    loc_eng_data_p->sv_used_mask = svStatus.gps_used_in_fix_mask;
-
-    // For RPC, the DOP are sent during sv report, so cache them
-    // now to be sent during position report.
-    // For QMI, the DOP will be in position report.
-    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-    {
-        loc_eng_data_p->pdop = locationExtended.pdop;
-        loc_eng_data_p->hdop = locationExtended.hdop;
-        loc_eng_data_p->vdop = locationExtended.vdop;
-    }
-    else
-    {
-        loc_eng_data_p->pdop = 0;
-        loc_eng_data_p->hdop = 0;
-        loc_eng_data_p->vdop = 0;
-    }
+    loc_eng_nmea_cache_sv(loc_eng_data_p, svStatus, locationExtended);
 
     EXIT_LOG(%d, 0);
 }
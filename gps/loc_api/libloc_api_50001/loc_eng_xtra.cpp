@@ -32,11 +32,166 @@
 
 #include <loc_eng.h>
 #include <MsgTask.h>
+#include <LocWorkerPool.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "log_util.h"
 #include "platform_lib_includes.h"
 
 using namespace loc_core;
 
+#define XTRA_CACHE_FOLDER     "/data/misc/location/xtra"
+#define XTRA_CACHE_FILE       "/data/misc/location/xtra/xtra_cache.bin"
+#define XTRA_CACHE_TMP_FILE   "/data/misc/location/xtra/xtra_cache.tmp"
+#define XTRA_CACHE_MAGIC      0x32525458 /* "XTR2" */
+
+// header preceding the XTRA blob in the cache file
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version_check;  // XTRA_VERSION_CHECK in effect when saved
+    uint32_t length;         // length of the blob following the header
+    uint8_t  digest[SHA256_DIGEST_LENGTH];  // SHA-256 of the blob
+    int64_t  saved_time;     // wall clock seconds when saved
+} loc_eng_xtra_cache_hdr_s_type;
+
+// saves are run on the shared worker pool, which does not keep order;
+// the lock keeps writers off the tmp file of each other and the sequence
+// keeps an older blob from replacing a newer one
+static pthread_mutex_t sXtraCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t sXtraCacheSaveSeq = 0;
+static uint32_t sXtraCacheSavedSeq = 0;
+
+static void xtra_cache_save(const char* data, int length, const uint8_t* digest)
+{
+    loc_eng_xtra_cache_hdr_s_type hdr;
+    struct stat s;
+
+    if (stat(XTRA_CACHE_FOLDER, &s) < 0) {
+        if (ENOENT != errno || mkdir(XTRA_CACHE_FOLDER, 0700) < 0) {
+            LOC_LOGE("%s:%d]: XTRA_CACHE_FOLDER invalid", __func__, __LINE__);
+            return;
+        }
+    }
+
+    int fd = open(XTRA_CACHE_TMP_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOC_LOGE("%s:%d]: open XTRA_CACHE_TMP_FILE failed, errno %d",
+                 __func__, __LINE__, errno);
+        return;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = XTRA_CACHE_MAGIC;
+    hdr.version_check = gps_conf.XTRA_VERSION_CHECK;
+    hdr.length = length;
+    memcpy(hdr.digest, digest, sizeof(hdr.digest));
+    hdr.saved_time = time(NULL);
+
+    bool written = write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+                   write(fd, data, length) == (ssize_t)length;
+    close(fd);
+
+    // rename so that a reader never sees a partially written cache
+    if (!written || rename(XTRA_CACHE_TMP_FILE, XTRA_CACHE_FILE) < 0) {
+        LOC_LOGE("%s:%d]: write XTRA cache failed", __func__, __LINE__);
+        unlink(XTRA_CACHE_TMP_FILE);
+    }
+}
+
+// writes the cache file off the MsgTask thread
+struct LocEngSaveXtraCache : public LocMsg {
+    char* mData;
+    const int mLen;
+    uint8_t mDigest[SHA256_DIGEST_LENGTH];
+    uint32_t mSeq;
+    inline LocEngSaveXtraCache(const char* data, int len,
+                               const uint8_t* digest) :
+        LocMsg(), mData(new char[len]), mLen(len)
+    {
+        memcpy(mData, data, len);
+        memcpy(mDigest, digest, sizeof(mDigest));
+        pthread_mutex_lock(&sXtraCacheLock);
+        mSeq = ++sXtraCacheSaveSeq;
+        pthread_mutex_unlock(&sXtraCacheLock);
+        locallog();
+    }
+    inline ~LocEngSaveXtraCache()
+    {
+        delete[] mData;
+    }
+    virtual void proc() const {
+        pthread_mutex_lock(&sXtraCacheLock);
+        // a newer blob may have been saved already
+        if ((int32_t)(mSeq - sXtraCacheSavedSeq) > 0) {
+            xtra_cache_save(mData, mLen, mDigest);
+            sXtraCacheSavedSeq = mSeq;
+        } else {
+            LOC_LOGD("%s:%d]: XTRA cache save %u superseded by %u",
+                     __func__, __LINE__, mSeq, sXtraCacheSavedSeq);
+        }
+        pthread_mutex_unlock(&sXtraCacheLock);
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngSaveXtraCache: seq %u, length %d", mSeq, mLen);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+/* Hands an XTRA blob to the engine unless the engine already has the
+   identical blob since it last came up. Freshly downloaded blobs are
+   also saved to the local cache. */
+static void loc_eng_xtra_inject_blob(LocEngAdapter* adapter,
+                                     loc_eng_xtra_data_s_type* xtra,
+                                     const char* data, int length,
+                                     bool fromCache,
+                                     const uint8_t* knownDigest = NULL)
+{
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+
+    if (NULL != knownDigest) {
+        memcpy(digest, knownDigest, sizeof(digest));
+    } else {
+        SHA256((const uint8_t*)data, length, digest);
+    }
+
+    if (xtra->injected_len == length &&
+        0 == memcmp(xtra->injected_digest, digest, sizeof(digest))) {
+        xtra->skip_count++;
+        LOC_LOGD("%s:%d]: identical XTRA data already injected, skipped %u",
+                 __func__, __LINE__, xtra->skip_count);
+        return;
+    }
+
+    if (LOC_API_ADAPTER_ERR_SUCCESS !=
+        adapter->setXtraData((char*)data, length)) {
+        LOC_LOGE("%s:%d]: XTRA injection failed, length %d",
+                 __func__, __LINE__, length);
+        return;
+    }
+
+    memcpy(xtra->injected_digest, digest, sizeof(digest));
+    xtra->injected_len = length;
+    xtra->inject_count++;
+    if (fromCache) {
+        xtra->cache_inject_count++;
+    } else if (gps_conf.XTRA_CACHE_MAX_AGE > 0) {
+        LocWorkerPool::getShared()->post(
+            new LocEngSaveXtraCache(data, length, digest));
+    }
+
+    LOC_LOGD("%s:%d]: injected %d bytes%s; injected: %u, from cache: %u, "
+             "skipped: %u", __func__, __LINE__, length,
+             fromCache ? " from cache" : "", xtra->inject_count,
+             xtra->cache_inject_count, xtra->skip_count);
+}
+
 struct LocEngRequestXtraServer : public LocMsg {
     LocEngAdapter* mAdapter;
     inline LocEngRequestXtraServer(LocEngAdapter* adapter) :
@@ -57,11 +212,13 @@ struct LocEngRequestXtraServer : public LocMsg {
 
 struct LocEngInjectXtraData : public LocMsg {
     LocEngAdapter* mAdapter;
+    loc_eng_xtra_data_s_type* mXtra;
     char* mData;
     const int mLen;
     inline LocEngInjectXtraData(LocEngAdapter* adapter,
+                                loc_eng_xtra_data_s_type* xtra,
                                 char* data, int len):
-        LocMsg(), mAdapter(adapter),
+        LocMsg(), mAdapter(adapter), mXtra(xtra),
         mData(new char[len]), mLen(len)
     {
         memcpy((void*)mData, (void*)data, len);
@@ -72,7 +229,7 @@ struct LocEngInjectXtraData : public LocMsg {
         delete[] mData;
     }
     inline virtual void proc() const {
-        mAdapter->setXtraData(mData, mLen);
+        loc_eng_xtra_inject_blob(mAdapter, mXtra, mData, mLen, false);
     }
     inline  void locallog() const {
         LOC_LOGV("length: %d\n  data: %p", mLen, mData);
@@ -82,6 +239,78 @@ struct LocEngInjectXtraData : public LocMsg {
     }
 };
 
+struct LocEngInjectXtraCache : public LocMsg {
+    LocEngAdapter* mAdapter;
+    loc_eng_xtra_data_s_type* mXtra;
+    inline LocEngInjectXtraCache(LocEngAdapter* adapter,
+                                 loc_eng_xtra_data_s_type* xtra):
+        LocMsg(), mAdapter(adapter), mXtra(xtra)
+    {
+        locallog();
+    }
+    virtual void proc() const {
+        // the engine has (re)started and holds no XTRA data
+        memset(mXtra->injected_digest, 0, sizeof(mXtra->injected_digest));
+        mXtra->injected_len = 0;
+
+        if (0 == gps_conf.XTRA_CACHE_MAX_AGE) {
+            return;
+        }
+
+        int fd = open(XTRA_CACHE_FILE, O_RDONLY);
+        if (fd < 0) {
+            LOC_LOGD("%s:%d]: no XTRA cache", __func__, __LINE__);
+            return;
+        }
+
+        struct stat st;
+        void* map = MAP_FAILED;
+        if (0 == fstat(fd, &st) &&
+            st.st_size > (off_t)sizeof(loc_eng_xtra_cache_hdr_s_type)) {
+            map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+
+        if (MAP_FAILED == map) {
+            LOC_LOGE("%s:%d]: failed to map XTRA cache", __func__, __LINE__);
+            return;
+        }
+
+        const loc_eng_xtra_cache_hdr_s_type* hdr =
+            (const loc_eng_xtra_cache_hdr_s_type*)map;
+        const char* data = (const char*)(hdr + 1);
+        int64_t age = (int64_t)time(NULL) - hdr->saved_time;
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        bool sized = XTRA_CACHE_MAGIC == hdr->magic &&
+            (off_t)hdr->length == st.st_size - (off_t)sizeof(*hdr);
+
+        if (sized) {
+            SHA256((const uint8_t*)data, hdr->length, digest);
+        }
+
+        if (!sized || 0 != memcmp(hdr->digest, digest, sizeof(digest))) {
+            LOC_LOGE("%s:%d]: corrupt XTRA cache, discarding",
+                     __func__, __LINE__);
+            unlink(XTRA_CACHE_FILE);
+        } else if (hdr->version_check != gps_conf.XTRA_VERSION_CHECK ||
+                   age < 0 || age > gps_conf.XTRA_CACHE_MAX_AGE * 3600LL) {
+            LOC_LOGD("%s:%d]: stale XTRA cache, age %lld sec, version check %u",
+                     __func__, __LINE__, (long long)age, hdr->version_check);
+        } else {
+            loc_eng_xtra_inject_blob(mAdapter, mXtra, data, hdr->length, true,
+                                     digest);
+        }
+
+        munmap(map, st.st_size);
+    }
+    inline void locallog() const {
+        LOC_LOGV("LocEngInjectXtraCache");
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
 struct LocEngSetXtraVersionCheck : public LocMsg {
     LocEngAdapter *mAdapter;
     int mCheck;
@@ -158,7 +387,9 @@ int loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
 {
     ENTRY_LOG();
     LocEngAdapter* adapter = loc_eng_data.adapter;
-    adapter->sendMsg(new LocEngInjectXtraData(adapter, data, length));
+    adapter->sendMsg(new LocEngInjectXtraData(adapter,
+                                              &loc_eng_data.xtra_module_data,
+                                              data, length));
     EXIT_LOG(%d, 0);
     return 0;
 }
@@ -211,3 +442,61 @@ void loc_eng_xtra_version_check(loc_eng_data_s_type &loc_eng_data,
     adapter->sendMsg(new LocEngSetXtraVersionCheck(adapter, check));
     EXIT_LOG(%d, 0);
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_cached
+
+DESCRIPTION
+   Re-injects the locally cached XTRA file, if it is still valid, after the
+   engine starts or restarts, so no new download is needed.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   none
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_inject_cached(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    LocEngAdapter *adapter = loc_eng_data.adapter;
+    adapter->sendMsg(new LocEngInjectXtraCache(adapter,
+                                               &loc_eng_data.xtra_module_data));
+    EXIT_LOG(%d, 0);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_aiding_data_deleted
+
+DESCRIPTION
+   Forgets the last injected XTRA blob once the engine has been told to
+   delete all of its aiding data, so that the same blob, when downloaded
+   again, is injected rather than skipped as a duplicate.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   none
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_aiding_data_deleted(loc_eng_data_s_type &loc_eng_data,
+                                      GpsAidingData f)
+{
+    // GpsAidingData has no separate bit for XTRA data, which the engine
+    // drops only along with everything else
+    if (GPS_DELETE_ALL == f) {
+        loc_eng_xtra_data_s_type* xtra = &loc_eng_data.xtra_module_data;
+        LOC_LOGD("%s:%d]: XTRA data deleted, forgetting %d byte blob",
+                 __func__, __LINE__, xtra->injected_len);
+        memset(xtra->injected_digest, 0, sizeof(xtra->injected_digest));
+        xtra->injected_len = 0;
+    }
+}
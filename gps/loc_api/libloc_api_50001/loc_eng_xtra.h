@@ -31,6 +31,7 @@
 #define LOC_ENG_XTRA_H
 
 #include <hardware/gps.h>
+#include <openssl/sha.h>
 
 // Module data
 typedef struct
@@ -42,6 +43,15 @@ typedef struct
    // XTRA data buffer
    char                          *xtra_data_for_injection;  // NULL if no pending data
    int                            xtra_data_len;
+
+   // last blob accepted by the engine, used to skip identical injections
+   uint8_t                        injected_digest[SHA256_DIGEST_LENGTH];
+   int                            injected_len;
+
+   // injection statistics
+   uint32_t                       inject_count;
+   uint32_t                       skip_count;
+   uint32_t                       cache_inject_count;
 } loc_eng_xtra_data_s_type;
 
 #endif // LOC_ENG_XTRA_H
@@ -0,0 +1,99 @@
+# LocEngGeofence check against a brute force model, and benchmark
+OLD_LOCAL_PATH := $(LOCAL_PATH)
+LOC_ENG_TEST_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_ENG_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_SRC_FILES := \
+    ../loc_eng_geofence.cpp \
+    loc_eng_geofence_test.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_ENG_TEST_PATH)/.. \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog \
+    libgps.utils
+
+LOCAL_MODULE := loc_eng_geofence_test
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+# DSStateMachine over a stub LocEngAdapter and ds_client servicer
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_ENG_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_SRC_FILES := \
+    ../loc_eng_agps.cpp \
+    loc_eng_agps_test.cpp
+
+# the stub LocEngAdapter.h goes ahead of the real one
+LOCAL_C_INCLUDES := \
+    $(LOC_ENG_TEST_PATH)/stub \
+    $(LOC_ENG_TEST_PATH)/.. \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog \
+    libloc_core \
+    libgps.utils
+
+LOCAL_MODULE := loc_eng_agps_test
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+# NI sessions over a stub LocEngAdapter: responses, timeouts, restarts
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_ENG_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_SRC_FILES := \
+    ../loc_eng_ni.cpp \
+    loc_eng_ni_test.cpp
+
+# the stub LocEngAdapter.h goes ahead of the real one
+LOCAL_C_INCLUDES := \
+    $(LOC_ENG_TEST_PATH)/stub \
+    $(LOC_ENG_TEST_PATH)/.. \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/gps.utils
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    liblog \
+    libloc_core \
+    libgps.utils
+
+LOCAL_MODULE := loc_eng_ni_test
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+LOCAL_PATH := $(OLD_LOCAL_PATH)
@@ -0,0 +1,417 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Drives DSStateMachine, the emergency DS call NIF, through a stub
+   LocEngAdapter and a stub ds_client servicer: a granted call, a busy
+   modem retried per connection handle, a handle released while its retry
+   is pending, and denials falling back to SUPL ATL. The test thread plays
+   the loc_eng task, running the msgs the state machine sends it.
+   Usage: loc_eng_agps_test */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <deque>
+#include <vector>
+#include <loc_eng_agps.h>
+
+#define TEST_MSG_TIMEOUT_MSEC  (3000)
+#define TEST_NO_MSG_MSEC       (800)
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+enum TestCallType {
+    ATL_OPEN,
+    ATL_CLOSE,
+    REQUEST_ATL,
+    CLOSE_DATA_CALL,
+    START_DATA_CALL,
+    STOP_DATA_CALL
+};
+
+// a call the state machine made, on the adapter or the servicer
+struct TestCall {
+    int type;
+    int handle;
+    int arg;
+};
+
+static pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCond = PTHREAD_COND_INITIALIZER;
+static std::vector<TestCall> gCalls;
+// results of the next start requests, success once empty
+static std::deque<int> gStartResults;
+
+static void record(int type, int handle, int arg)
+{
+    TestCall call = { type, handle, arg };
+    pthread_mutex_lock(&gMutex);
+    gCalls.push_back(call);
+    pthread_mutex_unlock(&gMutex);
+}
+
+static std::vector<TestCall> calls(int type)
+{
+    std::vector<TestCall> found;
+    pthread_mutex_lock(&gMutex);
+    for (size_t i = 0; i < gCalls.size(); i++) {
+        if (type == gCalls[i].type) {
+            found.push_back(gCalls[i]);
+        }
+    }
+    pthread_mutex_unlock(&gMutex);
+    return found;
+}
+
+static void reset(void)
+{
+    pthread_mutex_lock(&gMutex);
+    gCalls.clear();
+    gStartResults.clear();
+    pthread_mutex_unlock(&gMutex);
+}
+
+static void scriptStarts(int result, int count)
+{
+    pthread_mutex_lock(&gMutex);
+    for (int i = 0; i < count; i++) {
+        gStartResults.push_back(result);
+    }
+    pthread_mutex_unlock(&gMutex);
+}
+
+// stand-in for dataCallCb and ds_client, runs on the worker pool
+static int testDataCall(void* cb_data)
+{
+    dsCbData* cbData = (dsCbData*)cb_data;
+    int ret = LOC_API_ADAPTER_ERR_SUCCESS;
+
+    if (GPS_REQUEST_AGPS_DATA_CONN == cbData->action) {
+        record(START_DATA_CALL, cbData->connHandle, 0);
+        pthread_mutex_lock(&gMutex);
+        if (!gStartResults.empty()) {
+            ret = gStartResults.front();
+            gStartResults.pop_front();
+        }
+        pthread_mutex_unlock(&gMutex);
+    } else {
+        record(STOP_DATA_CALL, cbData->connHandle, 0);
+    }
+    return ret;
+}
+
+class TestAdapter : public LocEngAdapter {
+    mutable std::deque<const LocMsg*> mMsgs;
+public:
+    inline TestAdapter() : LocEngAdapter() {}
+    virtual ~TestAdapter() {
+        while (!mMsgs.empty()) {
+            delete mMsgs.front();
+            mMsgs.pop_front();
+        }
+    }
+
+    virtual void sendMsg(const LocMsg* msg) const {
+        pthread_mutex_lock(&gMutex);
+        mMsgs.push_back(msg);
+        pthread_cond_broadcast(&gCond);
+        pthread_mutex_unlock(&gMutex);
+    }
+
+    virtual enum loc_api_adapter_err
+        atlOpenStatus(int handle, int is_succ, char* apn,
+                      AGpsBearerType bearer, AGpsType agpsType) {
+        record(ATL_OPEN, handle, is_succ);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    virtual enum loc_api_adapter_err
+        atlCloseStatus(int handle, int is_succ) {
+        record(ATL_CLOSE, handle, is_succ);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    virtual bool requestATL(int connHandle, AGpsType agps_type) {
+        record(REQUEST_ATL, connHandle, agps_type);
+        return true;
+    }
+    virtual void closeDataCall() {
+        record(CLOSE_DATA_CALL, -1, 0);
+    }
+
+    // runs the next msg sent to the loc_eng task, waiting up to
+    // timeoutMsec for it. Returns false if none came.
+    bool runMsg(uint32_t timeoutMsec) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeoutMsec / 1000;
+        deadline.tv_nsec += (timeoutMsec % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_mutex_lock(&gMutex);
+        int rc = 0;
+        while (mMsgs.empty() && ETIMEDOUT != rc) {
+            rc = pthread_cond_timedwait(&gCond, &gMutex, &deadline);
+        }
+        const LocMsg* msg = NULL;
+        if (!mMsgs.empty()) {
+            msg = mMsgs.front();
+            mMsgs.pop_front();
+        }
+        pthread_mutex_unlock(&gMutex);
+
+        if (NULL == msg) {
+            return false;
+        }
+        msg->proc();
+        delete msg;
+        return true;
+    }
+
+    // runs msgs until count of them ran. Returns how many did.
+    int runMsgs(int count) {
+        int ran = 0;
+        while (ran < count && runMsg(TEST_MSG_TIMEOUT_MSEC)) {
+            ran++;
+        }
+        return ran;
+    }
+};
+
+static void subscribe(DSStateMachine& nif, int handle)
+{
+    DSSubscriber subscriber(&nif, handle);
+    nif.subscribeRsrc((Subscriber*)&subscriber);
+}
+
+static bool unsubscribe(DSStateMachine& nif, int handle)
+{
+    DSSubscriber subscriber(&nif, handle);
+    return nif.unsubscribeRsrc((Subscriber*)&subscriber);
+}
+
+static void sleepMsec(int msec)
+{
+    struct timespec ts = { msec / 1000, (msec % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// a call that starts at once is granted to its handle
+static void testGranted(void)
+{
+    reset();
+    TestAdapter adapter;
+    DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+    subscribe(nif, 7);
+    CHECK(1 == adapter.runMsgs(1));
+    std::vector<TestCall> starts = calls(START_DATA_CALL);
+    CHECK(1 == starts.size() && 7 == starts[0].handle);
+
+    // ds_client reports the call up
+    nif.onRsrcEvent(RSRC_GRANTED);
+    std::vector<TestCall> opens = calls(ATL_OPEN);
+    CHECK(1 == opens.size() && 7 == opens[0].handle && 1 == opens[0].arg);
+    CHECK(1 == nif.getSetupCount());
+    CHECK(calls(REQUEST_ATL).empty());
+
+    CHECK(unsubscribe(nif, 7));
+    CHECK(1 == calls(ATL_CLOSE).size());
+    printf("granted: %zu start, %zu open\n", starts.size(), opens.size());
+}
+
+// a busy modem is retried for the handle that failed, not for the one
+// first on the subscriber list
+static void testBusyRetry(void)
+{
+    reset();
+    TestAdapter adapter;
+    DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+    scriptStarts(LOC_API_ADAPTER_ERR_ENGINE_BUSY, 2);
+    subscribe(nif, 1);
+    // joins the pending call, and goes first on the list
+    subscribe(nif, 2);
+
+    // busy result, retry, busy result, retry, successful result
+    CHECK(5 == adapter.runMsgs(5));
+    std::vector<TestCall> starts = calls(START_DATA_CALL);
+    CHECK(3 == starts.size());
+    for (size_t i = 0; i < starts.size(); i++) {
+        CHECK(1 == starts[i].handle);
+    }
+    CHECK(calls(REQUEST_ATL).empty());
+
+    nif.onRsrcEvent(RSRC_GRANTED);
+    CHECK(2 == calls(ATL_OPEN).size());
+    CHECK(2 == nif.getSetupCount());
+    printf("busy retry: %zu starts for handle 1\n", starts.size());
+}
+
+// a handle released while its retry is pending is not retried; the call
+// goes on for the handle still waiting, or stops if there is none
+static void testRetryReleased(void)
+{
+    reset();
+    {
+        TestAdapter adapter;
+        DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+        scriptStarts(LOC_API_ADAPTER_ERR_ENGINE_BUSY, 1);
+        subscribe(nif, 1);
+        subscribe(nif, 2);
+        CHECK(1 == adapter.runMsgs(1));
+        CHECK(unsubscribe(nif, 1));
+        // retry, then the result of the call made for handle 2
+        CHECK(2 == adapter.runMsgs(2));
+        std::vector<TestCall> starts = calls(START_DATA_CALL);
+        CHECK(2 == starts.size());
+        CHECK(2 == starts.size() && 1 == starts[0].handle &&
+              2 == starts[1].handle);
+    }
+
+    reset();
+    {
+        TestAdapter adapter;
+        DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+        scriptStarts(LOC_API_ADAPTER_ERR_ENGINE_BUSY, 1);
+        subscribe(nif, 1);
+        CHECK(1 == adapter.runMsgs(1));
+        CHECK(unsubscribe(nif, 1));
+        // only the retry comes, and starts nothing
+        CHECK(1 == adapter.runMsgs(1));
+        CHECK(!adapter.runMsg(TEST_NO_MSG_MSEC));
+        CHECK(1 == calls(START_DATA_CALL).size());
+        CHECK(1 == calls(STOP_DATA_CALL).size());
+        CHECK(1 == calls(ATL_CLOSE).size());
+    }
+    printf("retry released: ok\n");
+}
+
+// a modem busy beyond the retries, or a call with no emergency profile,
+// falls each handle back to normal SUPL ATL
+static void testDenied(void)
+{
+    reset();
+    {
+        TestAdapter adapter;
+        DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+        scriptStarts(LOC_API_ADAPTER_ERR_ENGINE_BUSY, 5);
+        subscribe(nif, 3);
+        // 4 busy results each followed by a retry, then the last one
+        CHECK(9 == adapter.runMsgs(9));
+        CHECK(5 == calls(START_DATA_CALL).size());
+        std::vector<TestCall> atls = calls(REQUEST_ATL);
+        CHECK(1 == atls.size() && 3 == atls[0].handle &&
+              AGPS_TYPE_SUPL == atls[0].arg);
+        CHECK(!nif.hasSubscribers());
+        CHECK(!adapter.runMsg(TEST_NO_MSG_MSEC));
+
+        // the retries start over for the next call
+        reset();
+        scriptStarts(LOC_API_ADAPTER_ERR_ENGINE_BUSY, 1);
+        subscribe(nif, 4);
+        CHECK(3 == adapter.runMsgs(3));
+        CHECK(2 == calls(START_DATA_CALL).size());
+        CHECK(calls(REQUEST_ATL).empty());
+    }
+
+    reset();
+    {
+        TestAdapter adapter;
+        DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+        scriptStarts(LOC_API_ADAPTER_ERR_UNSUPPORTED, 1);
+        subscribe(nif, 5);
+        subscribe(nif, 6);
+        CHECK(1 == adapter.runMsgs(1));
+        std::vector<TestCall> atls = calls(REQUEST_ATL);
+        CHECK(2 == atls.size());
+        for (size_t i = 0; i < atls.size(); i++) {
+            CHECK(AGPS_TYPE_SUPL == atls[i].arg);
+        }
+        CHECK(!nif.hasSubscribers());
+        CHECK(0 == nif.getSetupCount());
+        CHECK(!adapter.runMsg(TEST_NO_MSG_MSEC));
+    }
+    printf("denied: ok\n");
+}
+
+// setup latency is kept per handle: one that joins later waits less
+static void testLatency(void)
+{
+    reset();
+    TestAdapter adapter;
+    DSStateMachine nif(servicerTypeExt, (void*)testDataCall, &adapter);
+
+    subscribe(nif, 1);
+    CHECK(1 == adapter.runMsgs(1));
+    sleepMsec(200);
+    subscribe(nif, 2);
+    sleepMsec(100);
+    nif.onRsrcEvent(RSRC_GRANTED);
+
+    CHECK(2 == nif.getSetupCount());
+    CHECK(nif.getSetupMaxMsec() >= 300);
+    CHECK(nif.getSetupAvgMsec() < nif.getSetupMaxMsec());
+    printf("latency: %u setups, avg %lld ms, max %lld ms\n",
+           nif.getSetupCount(), (long long)nif.getSetupAvgMsec(),
+           (long long)nif.getSetupMaxMsec());
+}
+
+int loc_eng_dmn_conn_loc_api_server_data_conn(int sender_id, int status)
+{
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    testGranted();
+    testBusyRetry();
+    testRetryReleased();
+    testDenied();
+    testLatency();
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
@@ -0,0 +1,396 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+
+/* Checks LocEngGeofence against a brute force model that tests every
+   fence against every fix, then times evaluate() with many fences.
+   Usage: loc_eng_geofence_test [fences] [fixes] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include <loc_eng_geofence.h>
+
+#define TEST_EARTH_RADIUS  6371000.0
+#define TEST_NONE          0
+
+struct TestFence {
+    int32_t id;
+    double latitude;
+    double longitude;
+    double radius;
+    int monitorTransitions;
+    int lastTransition;
+    int pendingTransition;
+    GpsUtcTime pendingSince;
+    bool paused;
+    bool removed;
+};
+
+struct TestEvent {
+    int32_t id;
+    int32_t transition;
+    bool operator<(const TestEvent& other) const {
+        return id != other.id ? id < other.id : transition < other.transition;
+    }
+    bool operator==(const TestEvent& other) const {
+        return id == other.id && transition == other.transition;
+    }
+};
+
+static std::vector<TestEvent> gEvents;
+static int32_t gLastStatus;
+static int gStatusCount;
+static bool gStatusLocationValid;
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+static void transitionCb(int32_t id, GpsLocation* location,
+                         int32_t transition, GpsUtcTime timestamp)
+{
+    TestEvent event = { id, transition };
+    gEvents.push_back(event);
+}
+
+static void statusCb(int32_t status, GpsLocation* lastLocation)
+{
+    gStatusCount++;
+    gStatusLocationValid = NULL != lastLocation &&
+                           sizeof(GpsLocation) == lastLocation->size;
+}
+
+static void opCb(int32_t id, int32_t status)
+{
+    gLastStatus = status;
+}
+
+static GpsGeofenceCallbacks sCallbacks = {
+    transitionCb, statusCb, opCb, opCb, opCb, opCb, NULL
+};
+
+static double distance(double lat1, double lon1, double lat2, double lon2)
+{
+    double dLat = (lat2 - lat1) * M_PI / 180.0;
+    double dLon = (lon2 - lon1) * M_PI / 180.0;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * M_PI / 180.0) * cos(lat2 * M_PI / 180.0) *
+               sin(dLon / 2) * sin(dLon / 2);
+    return 2 * TEST_EARTH_RADIUS * atan2(sqrt(a), sqrt(1 - a));
+}
+
+static double randRange(double lo, double hi)
+{
+    return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+static double wrapLongitude(double longitude)
+{
+    while (longitude > 180) longitude -= 360;
+    while (longitude < -180) longitude += 360;
+    return longitude;
+}
+
+// the rules LocEngGeofence documents, applied to every fence
+static void modelCheck(TestFence& fence, const GpsLocation& location,
+                       uint32_t dwellMsec, std::vector<TestEvent>& events)
+{
+    if (fence.removed || fence.paused) {
+        return;
+    }
+    double margin = 0;
+    if (location.flags & GPS_LOCATION_HAS_ACCURACY) {
+        margin = std::min((double)location.accuracy / 2, fence.radius / 2);
+    }
+    double dist = distance(fence.latitude, fence.longitude,
+                           location.latitude, location.longitude);
+    int state = TEST_NONE;
+    if (dist <= fence.radius - margin) {
+        state = GPS_GEOFENCE_ENTERED;
+    } else if (dist >= fence.radius + margin) {
+        state = GPS_GEOFENCE_EXITED;
+    }
+    if (TEST_NONE == state) {
+        return;
+    }
+    if (state == fence.lastTransition) {
+        fence.pendingTransition = TEST_NONE;
+        return;
+    }
+    if (state != fence.pendingTransition) {
+        fence.pendingTransition = state;
+        fence.pendingSince = location.timestamp;
+    }
+    if (location.timestamp - fence.pendingSince >= (GpsUtcTime)dwellMsec) {
+        fence.lastTransition = state;
+        fence.pendingTransition = TEST_NONE;
+        if (fence.monitorTransitions & state) {
+            TestEvent event = { fence.id, state };
+            events.push_back(event);
+        }
+    }
+}
+
+static void testOperations()
+{
+    gStatusCount = 0;
+    LocEngGeofence engine(sCallbacks, 0);
+    CHECK(1 == gStatusCount && gStatusLocationValid);
+
+    engine.add(1, 10, 20, 100, GPS_GEOFENCE_UNCERTAIN, GPS_GEOFENCE_ENTERED);
+    CHECK(GPS_GEOFENCE_OPERATION_SUCCESS == gLastStatus);
+    engine.add(1, 10, 20, 100, GPS_GEOFENCE_UNCERTAIN, GPS_GEOFENCE_ENTERED);
+    CHECK(GPS_GEOFENCE_ERROR_ID_EXISTS == gLastStatus);
+    engine.add(2, 10, 20, 100, 3, GPS_GEOFENCE_ENTERED);
+    CHECK(GPS_GEOFENCE_ERROR_INVALID_TRANSITION == gLastStatus);
+    engine.add(2, 10, 20, 0, GPS_GEOFENCE_UNCERTAIN, GPS_GEOFENCE_ENTERED);
+    CHECK(GPS_GEOFENCE_ERROR_GENERIC == gLastStatus);
+    engine.add(2, 91, 20, 100, GPS_GEOFENCE_UNCERTAIN, GPS_GEOFENCE_ENTERED);
+    CHECK(GPS_GEOFENCE_ERROR_GENERIC == gLastStatus);
+    engine.pause(2);
+    CHECK(GPS_GEOFENCE_ERROR_ID_UNKNOWN == gLastStatus);
+    engine.resume(2, GPS_GEOFENCE_ENTERED);
+    CHECK(GPS_GEOFENCE_ERROR_ID_UNKNOWN == gLastStatus);
+    engine.remove(2);
+    CHECK(GPS_GEOFENCE_ERROR_ID_UNKNOWN == gLastStatus);
+
+    // a fence across the date line is found from either side of it
+    engine.add(3, 0, 180, 1000, GPS_GEOFENCE_EXITED,
+               GPS_GEOFENCE_ENTERED | GPS_GEOFENCE_EXITED);
+    GpsLocation location;
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+    location.flags = GPS_LOCATION_HAS_LAT_LONG;
+    location.latitude = 0;
+    location.longitude = -179.999;
+    location.timestamp = 1000;
+    gEvents.clear();
+    engine.evaluate(location);
+    CHECK(1 == gEvents.size() && 3 == gEvents[0].id &&
+          GPS_GEOFENCE_ENTERED == gEvents[0].transition);
+    location.longitude = 170;
+    location.timestamp = 2000;
+    gEvents.clear();
+    engine.evaluate(location);
+    CHECK(1 == gEvents.size() && 3 == gEvents[0].id &&
+          GPS_GEOFENCE_EXITED == gEvents[0].transition);
+
+    // a paused fence reports nothing
+    engine.pause(3);
+    CHECK(GPS_GEOFENCE_OPERATION_SUCCESS == gLastStatus);
+    location.longitude = 179.999;
+    location.timestamp = 3000;
+    gEvents.clear();
+    engine.evaluate(location);
+    CHECK(gEvents.empty());
+    engine.remove(3);
+    CHECK(GPS_GEOFENCE_OPERATION_SUCCESS == gLastStatus);
+}
+
+// fences of all sizes around a random walk, with some across the date
+// line, and random pause, resume and remove along the way
+static void testAgainstModel(uint32_t dwellSec, int fenceCount, int fixCount)
+{
+    LocEngGeofence engine(sCallbacks, dwellSec);
+    std::vector<TestFence> fences(fenceCount);
+    double centerLat = 37.5;
+    double centerLon = dwellSec ? 179.9 : -122.0;
+
+    for (int i = 0; i < fenceCount; i++) {
+        TestFence& fence = fences[i];
+        memset(&fence, 0, sizeof(fence));
+        fence.id = i + 1;
+        fence.latitude = centerLat + randRange(-0.2, 0.2);
+        fence.longitude = wrapLongitude(centerLon + randRange(-0.2, 0.2));
+        // mostly small, some up to hundreds of km
+        fence.radius = 0 == i % 50 ? randRange(1000, 500000) :
+                       randRange(20, 2000);
+        fence.monitorTransitions = 1 + rand() % 3;
+        fence.lastTransition = 0 == rand() % 2 ? GPS_GEOFENCE_UNCERTAIN :
+                               GPS_GEOFENCE_EXITED;
+        engine.add(fence.id, fence.latitude, fence.longitude, fence.radius,
+                   fence.lastTransition, fence.monitorTransitions);
+        CHECK(GPS_GEOFENCE_OPERATION_SUCCESS == gLastStatus);
+    }
+
+    GpsLocation location;
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+    location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ACCURACY;
+    location.latitude = centerLat;
+    location.longitude = centerLon;
+    int mismatches = 0;
+    size_t transitions = 0;
+
+    for (int n = 0; n < fixCount; n++) {
+        if (0 == n % 200) {
+            // jump somewhere else, far enough to leave everything
+            location.latitude = centerLat + randRange(-0.3, 0.3);
+            location.longitude = wrapLongitude(centerLon + randRange(-0.3, 0.3));
+        } else {
+            location.latitude += randRange(-0.0005, 0.0005);
+            location.longitude = wrapLongitude(location.longitude +
+                                               randRange(-0.0005, 0.0005));
+        }
+        location.accuracy = randRange(3, 80);
+        location.timestamp = 1000000 + (GpsUtcTime)n * 1000;
+
+        if (0 == n % 97) {
+            TestFence& fence = fences[rand() % fenceCount];
+            if (!fence.removed) {
+                switch (rand() % 3) {
+                case 0:
+                    engine.pause(fence.id);
+                    fence.paused = true;
+                    fence.pendingTransition = TEST_NONE;
+                    break;
+                case 1:
+                    fence.monitorTransitions = 1 + rand() % 3;
+                    engine.resume(fence.id, fence.monitorTransitions);
+                    fence.paused = false;
+                    break;
+                default:
+                    engine.remove(fence.id);
+                    fence.removed = true;
+                    break;
+                }
+                CHECK(GPS_GEOFENCE_OPERATION_SUCCESS == gLastStatus);
+            }
+        }
+
+        std::vector<TestEvent> expected;
+        for (int i = 0; i < fenceCount; i++) {
+            modelCheck(fences[i], location, dwellSec * 1000, expected);
+        }
+        gEvents.clear();
+        engine.evaluate(location);
+        std::sort(expected.begin(), expected.end());
+        std::sort(gEvents.begin(), gEvents.end());
+        transitions += expected.size();
+        if (expected != gEvents && mismatches++ < 5) {
+            fprintf(stderr, "fix %d: %zu transitions expected, %zu reported\n",
+                    n, expected.size(), gEvents.size());
+        }
+    }
+    CHECK(0 == mismatches);
+    printf("model, dwell %u s: %d fences, %d fixes, %zu transitions, "
+           "%d mismatched fixes\n",
+           dwellSec, fenceCount, fixCount, transitions, mismatches);
+}
+
+static long long nowNsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// evaluate() cost with the fences spread over a city, against testing
+// every fence against every fix
+static void bench(int fenceCount, int fixCount)
+{
+    LocEngGeofence engine(sCallbacks, 0);
+    std::vector<TestFence> fences(fenceCount);
+    for (int i = 0; i < fenceCount; i++) {
+        TestFence& fence = fences[i];
+        memset(&fence, 0, sizeof(fence));
+        fence.id = i + 1;
+        fence.latitude = 37.5 + randRange(-0.5, 0.5);
+        fence.longitude = -122.0 + randRange(-0.5, 0.5);
+        fence.radius = randRange(50, 1000);
+        fence.monitorTransitions = GPS_GEOFENCE_ENTERED | GPS_GEOFENCE_EXITED;
+        fence.lastTransition = GPS_GEOFENCE_EXITED;
+        engine.add(fence.id, fence.latitude, fence.longitude, fence.radius,
+                   fence.lastTransition, fence.monitorTransitions);
+    }
+
+    std::vector<GpsLocation> fixes(fixCount);
+    double latitude = 37.5, longitude = -122.0;
+    for (int n = 0; n < fixCount; n++) {
+        latitude += randRange(-0.0005, 0.0005);
+        longitude += randRange(-0.0005, 0.0005);
+        GpsLocation& location = fixes[n];
+        memset(&location, 0, sizeof(location));
+        location.size = sizeof(location);
+        location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ACCURACY;
+        location.latitude = latitude;
+        location.longitude = longitude;
+        location.accuracy = 10;
+        location.timestamp = 1000000 + (GpsUtcTime)n * 1000;
+    }
+
+    long long start = nowNsec();
+    for (int n = 0; n < fixCount; n++) {
+        engine.evaluate(fixes[n]);
+    }
+    long long engineNsec = (nowNsec() - start) / fixCount;
+
+    std::vector<TestEvent> events;
+    int bruteFixes = std::min(fixCount, 1000);
+    start = nowNsec();
+    for (int n = 0; n < bruteFixes; n++) {
+        for (int i = 0; i < fenceCount; i++) {
+            modelCheck(fences[i], fixes[n], 0, events);
+        }
+    }
+    long long bruteNsec = (nowNsec() - start) / bruteFixes;
+
+    printf("bench: %d fences, %lld ns per fix (%lld fixes/s), "
+           "brute force %lld ns per fix\n",
+           fenceCount, engineNsec,
+           engineNsec ? 1000000000LL / engineNsec : 0, bruteNsec);
+}
+
+int main(int argc, char** argv)
+{
+    int fenceCount = argc > 1 ? atoi(argv[1]) : 10000;
+    int fixCount = argc > 2 ? atoi(argv[2]) : 100000;
+    if (fenceCount < 1 || fixCount < 1) {
+        fprintf(stderr, "usage: %s [fences] [fixes]\n", argv[0]);
+        return 1;
+    }
+
+    srand(1);
+    testOperations();
+    testAgainstModel(0, 2000, 5000);
+    testAgainstModel(3, 2000, 5000);
+    bench(fenceCount, fixCount);
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
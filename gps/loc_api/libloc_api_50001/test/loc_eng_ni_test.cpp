@@ -0,0 +1,315 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Drives the NI sessions of loc_eng_ni through a stub LocEngAdapter: a
+   user response before the timeout, the timeout answering for the user,
+   and an engine restart while the timeout of the dropped request is still
+   queued. The test thread plays the loc_eng task, running the msgs the
+   sessions and their timers send it.
+   Usage: loc_eng_ni_test */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <deque>
+#include <vector>
+#include <loc_eng.h>
+
+/* the timer is armed for 5 s more than the request's own timeout */
+#define TEST_NI_TIMEOUT_SEC    (1)
+#define TEST_NI_TIMER_MSEC     ((5 + TEST_NI_TIMEOUT_SEC) * 1000)
+#define TEST_SLACK_MSEC        (500)
+#define TEST_NO_MSG_MSEC       (800)
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+// a response the NI sessions sent to the modem
+struct TestResponse {
+    GpsUserResponseType response;
+    const void* request;
+};
+
+static pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCond = PTHREAD_COND_INITIALIZER;
+static std::vector<TestResponse> gResponses;
+static std::vector<int> gNotifIds;
+
+static std::vector<TestResponse> takeResponses(void)
+{
+    std::vector<TestResponse> responses;
+    pthread_mutex_lock(&gMutex);
+    responses.swap(gResponses);
+    pthread_mutex_unlock(&gMutex);
+    return responses;
+}
+
+static int64_t monotonicMsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+class TestAdapter : public LocEngAdapter {
+    mutable std::deque<const LocMsg*> mMsgs;
+public:
+    inline TestAdapter() : LocEngAdapter() {}
+    virtual ~TestAdapter() {
+        while (!mMsgs.empty()) {
+            delete mMsgs.front();
+            mMsgs.pop_front();
+        }
+    }
+
+    virtual void sendMsg(const LocMsg* msg) const {
+        pthread_mutex_lock(&gMutex);
+        mMsgs.push_back(msg);
+        pthread_cond_broadcast(&gCond);
+        pthread_mutex_unlock(&gMutex);
+    }
+
+    virtual enum loc_api_adapter_err
+        atlOpenStatus(int handle, int is_succ, char* apn,
+                      AGpsBearerType bearer, AGpsType agpsType) {
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    virtual enum loc_api_adapter_err
+        atlCloseStatus(int handle, int is_succ) {
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    virtual bool requestATL(int connHandle, AGpsType agps_type) {
+        return true;
+    }
+    virtual void closeDataCall() {}
+
+    virtual void informNiResponse(GpsUserResponseType userResponse,
+                                  const void* passThroughData) {
+        TestResponse response = { userResponse, passThroughData };
+        pthread_mutex_lock(&gMutex);
+        gResponses.push_back(response);
+        pthread_mutex_unlock(&gMutex);
+    }
+
+    // waits up to timeoutMsec for a msg to be sent to the loc_eng task,
+    // and leaves it queued. Returns false if none came.
+    bool waitMsg(uint32_t timeoutMsec) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeoutMsec / 1000;
+        deadline.tv_nsec += (timeoutMsec % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_mutex_lock(&gMutex);
+        int rc = 0;
+        while (mMsgs.empty() && ETIMEDOUT != rc) {
+            rc = pthread_cond_timedwait(&gCond, &gMutex, &deadline);
+        }
+        bool queued = !mMsgs.empty();
+        pthread_mutex_unlock(&gMutex);
+        return queued;
+    }
+
+    // runs the msgs queued so far. Returns how many ran.
+    int runMsgs(void) {
+        int ran = 0;
+        for (;;) {
+            pthread_mutex_lock(&gMutex);
+            const LocMsg* msg = NULL;
+            if (!mMsgs.empty()) {
+                msg = mMsgs.front();
+                mMsgs.pop_front();
+            }
+            pthread_mutex_unlock(&gMutex);
+
+            if (NULL == msg) {
+                return ran;
+            }
+            msg->proc();
+            delete msg;
+            ran++;
+        }
+    }
+};
+
+static TestAdapter* gAdapter;
+static loc_eng_data_s_type gLocEngData;
+
+// loc_eng.cpp is not linked in
+void loc_eng_mute_one_session(loc_eng_data_s_type &loc_eng_data)
+{
+}
+
+static void testNotifyCb(GpsNiNotification* notification)
+{
+    pthread_mutex_lock(&gMutex);
+    gNotifIds.push_back(notification->notification_id);
+    pthread_mutex_unlock(&gMutex);
+}
+
+/* as LocEngRequestNi does on the msg task; returns the notification id,
+   0 if the request was not notified */
+static int request(void* rawRequest)
+{
+    GpsNiNotification notif;
+    memset(&notif, 0, sizeof(notif));
+    notif.ni_type = GPS_NI_TYPE_UMTS_SUPL;
+    notif.notify_flags = GPS_NI_NEED_NOTIFY | GPS_NI_NEED_VERIFY;
+    notif.timeout = TEST_NI_TIMEOUT_SEC;
+    notif.default_response = GPS_NI_RESPONSE_NORESP;
+    strlcpy(notif.requestor_id, "test", sizeof(notif.requestor_id));
+
+    pthread_mutex_lock(&gMutex);
+    gNotifIds.clear();
+    pthread_mutex_unlock(&gMutex);
+
+    loc_eng_ni_request_handler(gLocEngData, &notif, rawRequest);
+
+    pthread_mutex_lock(&gMutex);
+    int id = 1 == gNotifIds.size() ? gNotifIds[0] : 0;
+    pthread_mutex_unlock(&gMutex);
+    return id;
+}
+
+static void respond(int notifId, GpsUserResponseType response)
+{
+    loc_eng_ni_respond(gLocEngData, notifId, response);
+    CHECK(1 == gAdapter->runMsgs());
+}
+
+// the user answers in time: that answer goes out, and nothing more
+static void testResponse(void)
+{
+    void* raw = malloc(16);
+    int id = request(raw);
+    CHECK(0 != id);
+    CHECK(takeResponses().empty());
+
+    respond(id, GPS_NI_RESPONSE_ACCEPT);
+    std::vector<TestResponse> responses = takeResponses();
+    CHECK(1 == responses.size() &&
+          GPS_NI_RESPONSE_ACCEPT == responses[0].response &&
+          raw == responses[0].request);
+
+    // the timer was stopped: no timeout is posted, and a second answer
+    // finds no session
+    CHECK(!gAdapter->waitMsg(TEST_NI_TIMER_MSEC + TEST_SLACK_MSEC));
+    respond(id, GPS_NI_RESPONSE_DENY);
+    CHECK(takeResponses().empty());
+    printf("response: %zu sent\n", responses.size());
+}
+
+// no answer: the timeout sends no response for the user
+static void testTimeout(void)
+{
+    void* raw = malloc(16);
+    int64_t startMsec = monotonicMsec();
+    int id = request(raw);
+    CHECK(0 != id);
+
+    CHECK(!gAdapter->waitMsg(TEST_NI_TIMER_MSEC - TEST_SLACK_MSEC));
+    CHECK(gAdapter->waitMsg(2 * TEST_SLACK_MSEC));
+    int64_t waitMsec = monotonicMsec() - startMsec;
+    CHECK(1 == gAdapter->runMsgs());
+    std::vector<TestResponse> responses = takeResponses();
+    CHECK(1 == responses.size() &&
+          GPS_NI_RESPONSE_NORESP == responses[0].response &&
+          raw == responses[0].request);
+
+    // an answer after the timeout finds no session
+    respond(id, GPS_NI_RESPONSE_ACCEPT);
+    CHECK(takeResponses().empty());
+    printf("timeout: NORESP sent after %lld ms, timer %d ms\n",
+           (long long)waitMsec, TEST_NI_TIMER_MSEC);
+}
+
+// the engine restarts while the timeout of its request is queued; that
+// timeout must leave the request made after the restart alone
+static void testRestart(void)
+{
+    void* rawDropped = malloc(16);
+    int droppedId = request(rawDropped);
+    CHECK(0 != droppedId);
+    CHECK(gAdapter->waitMsg(TEST_NI_TIMER_MSEC + TEST_SLACK_MSEC));
+
+    // on the msg task ahead of the queued timeout
+    loc_eng_ni_reset_on_engine_restart(gLocEngData);
+    void* raw = malloc(16);
+    int id = request(raw);
+    CHECK(0 != id && droppedId != id);
+
+    CHECK(1 == gAdapter->runMsgs());
+    CHECK(takeResponses().empty());
+
+    respond(droppedId, GPS_NI_RESPONSE_ACCEPT);
+    CHECK(takeResponses().empty());
+    respond(id, GPS_NI_RESPONSE_ACCEPT);
+    std::vector<TestResponse> responses = takeResponses();
+    CHECK(1 == responses.size() &&
+          GPS_NI_RESPONSE_ACCEPT == responses[0].response &&
+          raw == responses[0].request);
+    CHECK(!gAdapter->waitMsg(TEST_NO_MSG_MSEC));
+    printf("restart: %zu sent for the request after it\n", responses.size());
+}
+
+int main(int argc, char** argv)
+{
+    gAdapter = new TestAdapter();
+    gLocEngData.adapter = gAdapter;
+
+    GpsNiExtCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.notify_cb = testNotifyCb;
+    loc_eng_ni_init(gLocEngData, &callbacks);
+    CHECK(1 == gAdapter->runMsgs());
+
+    testResponse();
+    testTimeout();
+    testRestart();
+
+    loc_eng_ni_cleanup(gLocEngData);
+    CHECK(1 == gAdapter->runMsgs());
+    delete gAdapter;
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_API_ENG_ADAPTER_H
+#define LOC_API_ENG_ADAPTER_H
+
+/* Stand-in for LocEngAdapter.h, found first on the include path of
+   loc_eng_agps_test and loc_eng_ni_test. It declares only the adapter
+   calls the AGPS state machines and the NI sessions make, for the tests
+   to implement without a LocApi behind it. */
+
+#include <hardware/gps.h>
+#include <gps_extended.h>
+#include <MsgTask.h>
+#include <ContextBase.h>
+
+using namespace loc_core;
+
+class LocEngAdapter {
+public:
+    inline LocEngAdapter() {}
+    inline virtual ~LocEngAdapter() {}
+
+    // msgs for the loc_eng task
+    virtual void sendMsg(const LocMsg* msg) const = 0;
+
+    virtual enum loc_api_adapter_err
+        atlOpenStatus(int handle, int is_succ, char* apn,
+                      AGpsBearerType bearer, AGpsType agpsType) = 0;
+    virtual enum loc_api_adapter_err
+        atlCloseStatus(int handle, int is_succ) = 0;
+    virtual bool requestATL(int connHandle, AGpsType agps_type) = 0;
+    virtual void closeDataCall() = 0;
+
+    // NI, only loc_eng_ni_test looks at it
+    inline virtual void
+        informNiResponse(GpsUserResponseType userResponse,
+                         const void* passThroughData) {}
+};
+
+#endif //LOC_API_ENG_ADAPTER_H
@@ -29,6 +29,7 @@ LOCAL_SRC_FILES = \
     LocApiV02.cpp \
     loc_api_v02_log.c \
     loc_api_v02_client.c \
+    loc_api_v02_ind_table.c \
     loc_api_sync_req.c \
     location_service_v02.c
 
@@ -60,5 +61,7 @@ LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
 
+include $(LOCAL_PATH)/test/Android.mk
+
 endif # not BUILD_TINY_ANDROID
 endif # QCPATH
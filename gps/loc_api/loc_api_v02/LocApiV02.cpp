@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <hardware/gps.h>
 
@@ -44,6 +46,7 @@
 #include <loc_api_sync_req.h>
 #include <loc_util_log.h>
 #include <gps_extended.h>
+#include <loc_cfg.h>
 #include "platform_lib_includes.h"
 
 using namespace loc_core;
@@ -77,6 +80,74 @@ using namespace loc_core;
 /* number of QMI_LOC messages that need to be checked*/
 #define NUMBER_OF_MSG_TO_BE_CHECKED        (3)
 
+/* XTRA parts in flight at most; must leave loc_sync_req slots for others */
+#define LOC_XTRA_INJECT_WINDOW_MAX         (4)
+
+/* times an unacknowledged XTRA part is resent */
+#define LOC_XTRA_INJECT_RETRIES_MAX        (2)
+
+#define GPS_CONF_FILE                      "/etc/gps.conf"
+
+/* gps.conf parameters read by LocApiV02 */
+static uint32_t gXtraInjectWindow = 1;
+static uint32_t gQmiIndRecord = 0;
+static uint32_t gQmiIndStatsInterval = 0;
+static uint32_t gZppCacheMaxAge = 0;
+static uint32_t gZppCacheMaxAccuracy = 0;
+static const loc_param_s_type loc_api_v02_conf_table[] =
+{
+  {"XTRA_INJECT_WINDOW",     &gXtraInjectWindow,    NULL, 'n'},
+  {"QMI_IND_RECORD",         &gQmiIndRecord,        NULL, 'n'},
+  {"QMI_IND_STATS_INTERVAL", &gQmiIndStatsInterval, NULL, 'n'},
+  {"ZPP_CACHE_MAX_AGE",      &gZppCacheMaxAge,      NULL, 'n'},
+  {"ZPP_CACHE_MAX_ACCURACY", &gZppCacheMaxAccuracy, NULL, 'n'},
+};
+
+static inline int64_t monotonicUsec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* appends one recorded indication, on the record thread */
+struct LocIndRecordWrite : public LocMsg {
+    FILE* mFile;
+    void* mRecord;
+    size_t mSize;
+    inline LocIndRecordWrite(FILE* file, void* record, size_t size) :
+        LocMsg(), mFile(file), mRecord(record), mSize(size) {}
+    inline virtual ~LocIndRecordWrite() { free(mRecord); }
+    virtual void proc() const {
+        if (ferror(mFile)) {
+            return;
+        }
+        // flushed per record, so a session cut short by a crash is kept
+        if (1 != fwrite(mRecord, mSize, 1, mFile) || 0 != fflush(mFile)) {
+            LOC_LOGE("%s:%d]: write failed, recording stopped",
+                     __func__, __LINE__);
+        }
+    }
+};
+
+/* closes the record file once every queued record is written */
+struct LocIndRecordClose : public LocMsg {
+    FILE* mFile;
+    pthread_mutex_t* mMutex;
+    pthread_cond_t* mCond;
+    bool* mDone;
+    inline LocIndRecordClose(FILE* file, pthread_mutex_t* mutex,
+                             pthread_cond_t* cond, bool* done) :
+        LocMsg(), mFile(file), mMutex(mutex), mCond(cond), mDone(done) {}
+    virtual void proc() const {
+        fclose(mFile);
+        pthread_mutex_lock(mMutex);
+        *mDone = true;
+        pthread_cond_signal(mCond);
+        pthread_mutex_unlock(mMutex);
+    }
+};
+
 /* static event callbacks that call the LocApiV02 callbacks*/
 
 /* global event callback, call the eventCb function in loc api adapter v02
@@ -167,16 +238,59 @@ LocApiV02 :: LocApiV02(const MsgTask* msgTask,
     LocApiBase(msgTask, exMask, context),
     clientHandle(LOC_CLIENT_INVALID_HANDLE_VALUE),
     dsClientHandle(NULL), mGnssMeasurementSupported(sup_unknown),
-    mQmiMask(0), mInSession(false), mEngineOn(false)
+    mQmiMask(0), mInSession(false), mEngineOn(false),
+    mXtraInjectWindow(1), mIndRecordTask(NULL), mIndRecordFile(NULL),
+    mIndStatsInterval(0),
+    mIndCount(0), mIndStatsStartUsec(0), mIndTotalUsec(0), mIndMaxUsec(0),
+    mIndMaxId(0), mGpsMeasurementData(NULL),
+    mZppCacheHits(0), mZppCacheMisses(0)
 {
   // initialize loc_sync_req interface
   loc_sync_req_init();
+
+  UTIL_READ_CONF(GPS_CONF_FILE, loc_api_v02_conf_table);
+  setXtraInjectWindow(gXtraInjectWindow);
+
+  mIndStatsInterval = gQmiIndStatsInterval;
+
+  if (gQmiIndRecord) {
+    mIndRecordFile = fopen(LOC_IND_RECORD_FILE, "wb");
+    if (NULL == mIndRecordFile) {
+      LOC_LOGE("%s:%d]: cannot open %s", __func__, __LINE__,
+               LOC_IND_RECORD_FILE);
+    } else {
+      uint32_t fileHeader[2] = {LOC_IND_RECORD_MAGIC, LOC_IND_RECORD_VERSION};
+      fwrite(fileHeader, sizeof(fileHeader), 1, mIndRecordFile);
+      // file I/O stays off the QMI callback thread
+      mIndRecordTask = new MsgTask("LocIndRecord", false);
+      LOC_LOGD("%s:%d]: recording QMI indications to %s", __func__, __LINE__,
+               LOC_IND_RECORD_FILE);
+    }
+  }
 }
 
 /* Destructor for LocApiV02 */
 LocApiV02 :: ~LocApiV02()
 {
     close();
+    if (NULL != mIndRecordTask) {
+        pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+        bool done = false;
+
+        // destroy() drops queued msgs, so wait for the records to be written
+        mIndRecordTask->sendMsg(
+            new LocIndRecordClose(mIndRecordFile, &mutex, &cond, &done));
+        pthread_mutex_lock(&mutex);
+        while (!done) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        pthread_mutex_unlock(&mutex);
+        mIndRecordTask->destroy();
+        mIndRecordTask = NULL;
+        mIndRecordFile = NULL;
+    }
+    free(mGpsMeasurementData);
 }
 
 LocApiBase* getLocApi(const MsgTask *msgTask,
@@ -1024,23 +1138,42 @@ enum loc_api_adapter_err LocApiV02 ::
 }
 
 /* Inject XTRA data, this module breaks down the XTRA
-   file into "chunks" and injects them one at a time */
+   file into "chunks" and injects them with up to mXtraInjectWindow
+   chunks in flight. The engine takes the chunks in order only, so
+   once one of them is not acknowledged no new ones are sent, and
+   injection resumes one at a time from the first chunk missing. */
 enum loc_api_adapter_err LocApiV02 :: setXtraData(
   char* data, int length)
 {
   locClientStatusEnumType status = eLOC_CLIENT_SUCCESS;
   int     total_parts;
-  uint8_t   part;
-  uint16_t  len_injected;
+  int     len_injected;
+  uint16_t  part;
+  // parts 1..acked_upto have all been acknowledged
+  uint16_t  acked_upto = 0;
+  // acknowledged parts above acked_upto, by partNum % window. No part
+  // past acked_upto + mXtraInjectWindow is sent, so a lost ack whose
+  // slot is filled by a later part's ack cannot alias an entry here.
+  bool    acked_ahead[LOC_XTRA_INJECT_WINDOW_MAX];
+  bool    failed = false;
 
   locClientReqUnionType req_union;
   qmiLocInjectPredictedOrbitsDataReqMsgT_v02 inject_xtra;
-  qmiLocInjectPredictedOrbitsDataIndMsgT_v02 inject_xtra_ind;
+  qmiLocInjectPredictedOrbitsDataIndMsgT_v02
+      inject_xtra_ind[LOC_XTRA_INJECT_WINDOW_MAX];
+  int wait_id[LOC_XTRA_INJECT_WINDOW_MAX];
 
   req_union.pInjectPredictedOrbitsDataReq = &inject_xtra;
 
-  LOC_LOGD("%s:%d]: xtra size = %d\n", __func__, __LINE__, length);
+  LOC_LOGD("%s:%d]: xtra size = %d, window = %u\n", __func__, __LINE__,
+           length, mXtraInjectWindow);
+
+  if (NULL == data || length <= 0)
+  {
+    return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+  }
 
+  memset(&inject_xtra, 0, sizeof(inject_xtra));
   inject_xtra.formatType_valid = 1;
   inject_xtra.formatType = eQMI_LOC_PREDICTED_ORBITS_XTRA_V02;
   inject_xtra.totalSize = length;
@@ -1049,53 +1182,160 @@ enum loc_api_adapter_err LocApiV02 :: setXtraData(
 
   inject_xtra.totalParts = total_parts;
 
-  len_injected = 0; // O bytes injected
+  memset(acked_ahead, 0, sizeof(acked_ahead));
 
   // XTRA injection starts with part 1
-  for (part = 1; part <= total_parts; part++)
+  int head = 0, in_flight = 0;
+  part = 1;
+  while ((!failed && part <= total_parts) || in_flight > 0)
   {
-    inject_xtra.partNum = part;
+    // fill the window
+    while (!failed && part <= total_parts &&
+           in_flight < (int)mXtraInjectWindow &&
+           part <= acked_upto + mXtraInjectWindow)
+    {
+      int slot = (head + in_flight) % LOC_XTRA_INJECT_WINDOW_MAX;
+      int offset = (part - 1) * QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02;
+
+      inject_xtra.partNum = part;
+      inject_xtra.partData_len =
+          (length - offset < QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02) ?
+          length - offset : QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02;
+      memcpy(inject_xtra.partData, data + offset, inject_xtra.partData_len);
+
+      LOC_LOGV("[%s:%d] part %d/%d, len = %d, in flight = %d\n",
+               __func__, __LINE__, inject_xtra.partNum, total_parts,
+               inject_xtra.partData_len, in_flight);
+
+      memset(&inject_xtra_ind[slot], 0, sizeof(inject_xtra_ind[slot]));
+      wait_id[slot] = loc_sync_send_req_nowait(
+          clientHandle, QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02,
+          req_union, QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02,
+          &inject_xtra_ind[slot], &status);
+
+      if (wait_id[slot] < 0)
+      {
+        LOC_LOGE("%s:%d]: send failed for part %d, status = %s\n",
+                 __func__, __LINE__, inject_xtra.partNum,
+                 loc_get_v02_client_status_name(status));
+        failed = true;
+        break;
+      }
+      part++;
+      in_flight++;
+    }
 
-    if (QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02 > (length - len_injected))
+    if (0 == in_flight)
     {
-      inject_xtra.partData_len = length - len_injected;
+      // nothing more can go out in this pass
+      break;
+    }
+
+    // retire the oldest outstanding slot. Indications go to the lowest
+    // numbered waiting slot, not necessarily the one of their part, so
+    // the acknowledged part is read from the payload.
+    status = loc_sync_wait_req(wait_id[head], LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02);
+    qmiLocInjectPredictedOrbitsDataIndMsgT_v02* ind = &inject_xtra_ind[head];
+
+    if (eLOC_CLIENT_SUCCESS == status &&
+        eQMI_LOC_SUCCESS_V02 == ind->status &&
+        ind->partNum_valid &&
+        ind->partNum > acked_upto && ind->partNum < part)
+    {
+      acked_ahead[ind->partNum % LOC_XTRA_INJECT_WINDOW_MAX] = true;
+      while (acked_ahead[(acked_upto + 1) % LOC_XTRA_INJECT_WINDOW_MAX])
+      {
+        acked_upto++;
+        acked_ahead[acked_upto % LOC_XTRA_INJECT_WINDOW_MAX] = false;
+      }
     }
     else
     {
-      inject_xtra.partData_len = QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02;
+      LOC_LOGE ("%s:%d]: failed status = %s, inject_xtra_ind.status = %s,"
+                " ind.partNum = %d\n", __func__, __LINE__,
+                loc_get_v02_client_status_name(status),
+                loc_get_v02_qmi_status_name(ind->status), ind->partNum);
+      failed = true;
     }
 
-    // copy data into the message
-    memcpy(inject_xtra.partData, data+len_injected, inject_xtra.partData_len);
+    head = (head + 1) % LOC_XTRA_INJECT_WINDOW_MAX;
+    in_flight--;
+  }
 
-    LOC_LOGD("[%s:%d] part %d/%d, len = %d, total injected = %d\n",
-                  __func__, __LINE__,
-                  inject_xtra.partNum, total_parts, inject_xtra.partData_len,
-                  len_injected);
+  LOC_LOGD("%s:%d]: %d/%d parts acknowledged in order in first pass\n",
+           __func__, __LINE__, acked_upto, total_parts);
 
-    status = loc_sync_send_req( clientHandle,
-                                QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02,
-                                req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
-                                QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02,
-                                &inject_xtra_ind);
+  // resend in order from the first part missing, one at a time. Parts
+  // after it that were acknowledged are sent again, as the engine does
+  // not take a part before the ones preceding it.
+  for (part = acked_upto + 1; part <= total_parts; part++)
+  {
+    int offset = (part - 1) * QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02;
+    inject_xtra.partNum = part;
+    inject_xtra.partData_len =
+        (length - offset < QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02) ?
+        length - offset : QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02;
+    memcpy(inject_xtra.partData, data + offset, inject_xtra.partData_len);
 
-    if (status != eLOC_CLIENT_SUCCESS ||
-        eQMI_LOC_SUCCESS_V02 != inject_xtra_ind.status ||
-        inject_xtra.partNum != inject_xtra_ind.partNum)
+    for (int retry = 0; retry < LOC_XTRA_INJECT_RETRIES_MAX; retry++)
     {
-      LOC_LOGE ("%s:%d]: failed status = %s, inject_pos_ind.status = %s,"
-                     " part num = %d, ind.partNum = %d\n", __func__, __LINE__,
+      memset(&inject_xtra_ind[0], 0, sizeof(inject_xtra_ind[0]));
+      status = loc_sync_send_req( clientHandle,
+                                  QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02,
+                                  req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                                  QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02,
+                                  &inject_xtra_ind[0]);
+
+      if (status == eLOC_CLIENT_SUCCESS &&
+          eQMI_LOC_SUCCESS_V02 == inject_xtra_ind[0].status &&
+          inject_xtra.partNum == inject_xtra_ind[0].partNum)
+      {
+        acked_upto = part;
+        break;
+      }
+
+      LOC_LOGE ("%s:%d]: resend failed status = %s, inject_xtra_ind.status = %s,"
+                " part num = %d, ind.partNum = %d\n", __func__, __LINE__,
                 loc_get_v02_client_status_name(status),
-                loc_get_v02_qmi_status_name(inject_xtra_ind.status),
-                inject_xtra.partNum, inject_xtra_ind.partNum);
-    } else {
-      len_injected += inject_xtra.partData_len;
-      LOC_LOGD("%s:%d]: XTRA injected length: %d\n", __func__, __LINE__,
-               len_injected);
+                loc_get_v02_qmi_status_name(inject_xtra_ind[0].status),
+                inject_xtra.partNum, inject_xtra_ind[0].partNum);
+    }
+
+    if (acked_upto != part)
+    {
+      // the parts after it would not be taken either
+      break;
     }
   }
 
-  return convertErr(status);
+  len_injected = acked_upto * QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02;
+  if (len_injected > length)
+  {
+    len_injected = length;
+  }
+
+  LOC_LOGD("%s:%d]: XTRA injected length: %d/%d, parts: %d/%d\n",
+           __func__, __LINE__, len_injected, length, acked_upto, total_parts);
+
+  if (acked_upto != total_parts)
+  {
+    return (eLOC_CLIENT_SUCCESS != status) ? convertErr(status) :
+                                             LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+  }
+
+  return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+void LocApiV02 :: setXtraInjectWindow(uint32_t window)
+{
+  if (window < 1) {
+    mXtraInjectWindow = 1;
+  } else if (window > LOC_XTRA_INJECT_WINDOW_MAX) {
+    mXtraInjectWindow = LOC_XTRA_INJECT_WINDOW_MAX;
+  } else {
+    mXtraInjectWindow = window;
+  }
 }
 
 /* Request the Xtra Server Url from the modem */
@@ -1940,6 +2180,11 @@ void LocApiV02 :: reportPosition (
                     break;
                }
             }
+            if (location_report_ptr->sessionStatus ==
+                eQMI_LOC_SESS_STATUS_SUCCESS_V02) {
+                updateZppCache(location.gpsLocation, tech_Mask);
+            }
+
             LocApiBase::reportPosition( location,
                             locationExtended,
                             (void*)location_report_ptr,
@@ -2486,19 +2731,15 @@ void LocApiV02 :: reportGnssMeasurementData(
 {
     LOC_LOGV ("%s:%d]: entering\n", __func__, __LINE__);
 
-    GpsData gpsMeasurementData;
-    memset (&gpsMeasurementData, 0, sizeof(GpsData));
-
     int svMeasurment_len = 0;
 
-    // size
-    gpsMeasurementData.size = sizeof(GpsData);
-
     // number of measurements
     if (gnss_measurement_report_ptr.svMeasurement_valid) {
         svMeasurment_len =
             gnss_measurement_report_ptr.svMeasurement_len;
-        gpsMeasurementData.measurement_count = svMeasurment_len;
+        if (svMeasurment_len > GPS_MAX_MEASUREMENT) {
+            svMeasurment_len = GPS_MAX_MEASUREMENT;
+        }
         LOC_LOGV ("%s:%d]: there are %d SV measurements\n",
                   __func__, __LINE__, svMeasurment_len);
     } else {
@@ -2509,14 +2750,26 @@ void LocApiV02 :: reportGnssMeasurementData(
     if (svMeasurment_len != 0 &&
         gnss_measurement_report_ptr.system == eQMI_LOC_SV_SYSTEM_GPS_V02) {
 
-        // the array of measurements
-        int index = 0;
-        while(svMeasurment_len > 0) {
-            convertGpsMeasurements(gpsMeasurementData.measurements[index],
-                                   gnss_measurement_report_ptr.svMeasurement[index]);
-            index++;
-            svMeasurment_len--;
+        if (NULL == mGpsMeasurementData) {
+            mGpsMeasurementData = (GpsData*)malloc(sizeof(GpsData));
+            if (NULL == mGpsMeasurementData) {
+                LOC_LOGE ("%s:%d]: out of memory\n", __func__, __LINE__);
+                return;
+            }
         }
+        GpsData& gpsMeasurementData = *mGpsMeasurementData;
+
+        // only the entries reported this epoch are written and copied on
+        gpsMeasurementData.size = sizeof(GpsData);
+        gpsMeasurementData.measurement_count = svMeasurment_len;
+        memset (gpsMeasurementData.measurements, 0,
+                sizeof(GpsMeasurement) * svMeasurment_len);
+        memset (&gpsMeasurementData.clock, 0, sizeof(GpsClock));
+
+        // the array of measurements
+        convertGpsMeasurements(gpsMeasurementData.measurements,
+                               gnss_measurement_report_ptr.svMeasurement,
+                               svMeasurment_len);
 
         // the GPS clock time reading
         convertGpsClock(gpsMeasurementData.clock,
@@ -2532,120 +2785,122 @@ void LocApiV02 :: reportGnssMeasurementData(
     }
 }
 
-/*convert GpsMeasurement type from QMI LOC to loc eng format*/
-void LocApiV02 :: convertGpsMeasurements (GpsMeasurement& gpsMeasurement,
-    const qmiLocSVMeasurementStructT_v02& gnss_measurement_info)
+/*convert a batch of GpsMeasurement from QMI LOC to loc eng format
+  The plain field conversions run as one straight loop over all SVs, and
+  the measurement state, which needs per-SV branching, in a second one.
+  Both sides are arrays of structs, so gathering the fields into one
+  array each for a branch free pass costs more than the branches do. */
+void LocApiV02 :: convertGpsMeasurements (GpsMeasurement* gpsMeasurements,
+    const qmiLocSVMeasurementStructT_v02* gnss_measurement_info,
+    int count)
 {
     LOC_LOGV ("%s:%d]: entering\n", __func__, __LINE__);
 
-    // size
-    gpsMeasurement.size = sizeof(GpsMeasurement);
-
-    // flag initiation
-    int flags = 0;
-
-    // prn
-    gpsMeasurement.prn = gnss_measurement_info.gnssSvId;
-
-    // time_offset_ns
-    gpsMeasurement.time_offset_ns = 0;
+    const uint64_t bitSynMask = QMI_LOC_MASK_MEAS_STATUS_BE_CONFIRM_V02 |
+                                QMI_LOC_MASK_MEAS_STATUS_SB_VALID_V02;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        const qmiLocSVMeasurementStructT_v02& in = gnss_measurement_info[i];
+        GpsMeasurement& out = gpsMeasurements[i];
+
+        out.size = sizeof(GpsMeasurement);
+        out.flags = 0;
+        out.prn = in.gnssSvId;
+        out.time_offset_ns = 0;
+        out.c_n0_dbhz = in.CNo/10.0;
+        out.pseudorange_rate_mps = in.svTimeSpeed.dopplerShift;
+        out.pseudorange_rate_uncertainty_mps = in.svTimeSpeed.dopplerShiftUnc;
+        out.accumulated_delta_range_state = GPS_ADR_STATE_UNKNOWN;
+    }
 
     // state & received_gps_tow_ns & received_gps_tow_uncertainty_ns
-    uint64_t validMask = gnss_measurement_info.measurementStatus &
-                         gnss_measurement_info.validMeasStatusMask;
-    uint64_t bitSynMask = QMI_LOC_MASK_MEAS_STATUS_BE_CONFIRM_V02 |
-                          QMI_LOC_MASK_MEAS_STATUS_SB_VALID_V02;
-    double gpsTowUncNs = (double)gnss_measurement_info.svTimeSpeed.svTimeUncMs * 1e6;
-
-    if (validMask & QMI_LOC_MASK_MEAS_STATUS_MS_VALID_V02) {
-        /* sub-frame decode & TOW decode */
-        gpsMeasurement.state = GPS_MEASUREMENT_STATE_SUBFRAME_SYNC |
-                                GPS_MEASUREMENT_STATE_TOW_DECODED |
-                                GPS_MEASUREMENT_STATE_BIT_SYNC |
-                                GPS_MEASUREMENT_STATE_CODE_LOCK;
-        gpsMeasurement.received_gps_tow_ns =
-            ((double)gnss_measurement_info.svTimeSpeed.svTimeMs +
-             (double)gnss_measurement_info.svTimeSpeed.svTimeSubMs) * 1e6;
-        gpsMeasurement.received_gps_tow_uncertainty_ns = gpsTowUncNs;
-
-    } else if ((validMask & bitSynMask) == bitSynMask) {
-        /* bit sync */
-        gpsMeasurement.state = GPS_MEASUREMENT_STATE_BIT_SYNC |
-                                GPS_MEASUREMENT_STATE_CODE_LOCK;
-        gpsMeasurement.received_gps_tow_ns =
-            fmod(((double)gnss_measurement_info.svTimeSpeed.svTimeMs +
-                  (double)gnss_measurement_info.svTimeSpeed.svTimeSubMs), 20) * 1e6;
-        gpsMeasurement.received_gps_tow_uncertainty_ns = gpsTowUncNs;
-
-    } else if (validMask & QMI_LOC_MASK_MEAS_STATUS_SM_VALID_V02) {
-        /* code lock */
-        gpsMeasurement.state = GPS_MEASUREMENT_STATE_CODE_LOCK;
-        gpsMeasurement.received_gps_tow_ns =
-             (double)gnss_measurement_info.svTimeSpeed.svTimeSubMs * 1e6;
-        gpsMeasurement.received_gps_tow_uncertainty_ns = gpsTowUncNs;
+    for (i = 0; i < count; i++) {
+        const qmiLocSVMeasurementStructT_v02& in = gnss_measurement_info[i];
+        GpsMeasurement& out = gpsMeasurements[i];
+
+        uint64_t validMask = in.measurementStatus & in.validMeasStatusMask;
+        double svTimeMs = (double)in.svTimeSpeed.svTimeMs +
+                          (double)in.svTimeSpeed.svTimeSubMs;
+        double gpsTowUncNs = (double)in.svTimeSpeed.svTimeUncMs * 1e6;
+
+        if (validMask & QMI_LOC_MASK_MEAS_STATUS_MS_VALID_V02) {
+            /* sub-frame decode & TOW decode */
+            out.state = GPS_MEASUREMENT_STATE_SUBFRAME_SYNC |
+                        GPS_MEASUREMENT_STATE_TOW_DECODED |
+                        GPS_MEASUREMENT_STATE_BIT_SYNC |
+                        GPS_MEASUREMENT_STATE_CODE_LOCK;
+            out.received_gps_tow_ns = svTimeMs * 1e6;
+            out.received_gps_tow_uncertainty_ns = gpsTowUncNs;
+
+        } else if ((validMask & bitSynMask) == bitSynMask) {
+            /* bit sync */
+            out.state = GPS_MEASUREMENT_STATE_BIT_SYNC |
+                        GPS_MEASUREMENT_STATE_CODE_LOCK;
+            out.received_gps_tow_ns = fmod(svTimeMs, 20) * 1e6;
+            out.received_gps_tow_uncertainty_ns = gpsTowUncNs;
+
+        } else if (validMask & QMI_LOC_MASK_MEAS_STATUS_SM_VALID_V02) {
+            /* code lock */
+            out.state = GPS_MEASUREMENT_STATE_CODE_LOCK;
+            out.received_gps_tow_ns =
+                (double)in.svTimeSpeed.svTimeSubMs * 1e6;
+            out.received_gps_tow_uncertainty_ns = gpsTowUncNs;
 
-    } else {
-        /* by default */
-        gpsMeasurement.state = GPS_MEASUREMENT_STATE_UNKNOWN;
-        gpsMeasurement.received_gps_tow_ns = 0;
-        gpsMeasurement.received_gps_tow_uncertainty_ns = 0;
+        } else {
+            /* by default */
+            out.state = GPS_MEASUREMENT_STATE_UNKNOWN;
+            out.received_gps_tow_ns = 0;
+            out.received_gps_tow_uncertainty_ns = 0;
+        }
     }
 
-    // c_n0_dbhz
-    gpsMeasurement.c_n0_dbhz = gnss_measurement_info.CNo/10.0;
-
-    // pseudorange_rate_mps
-    gpsMeasurement.pseudorange_rate_mps =
-        gnss_measurement_info.svTimeSpeed.dopplerShift;
-
-    // pseudorange_rate_uncertainty_mps
-    gpsMeasurement.pseudorange_rate_uncertainty_mps =
-        gnss_measurement_info.svTimeSpeed.dopplerShiftUnc;
-
-    // accumulated_delta_range_state
-    gpsMeasurement.accumulated_delta_range_state = GPS_ADR_STATE_UNKNOWN;
-
-    gpsMeasurement.flags = flags;
-
-    LOC_LOGV(" %s:%d]: GNSS measurement raw data received form modem: \n"
-             " Input => gnssSvId | CNo "
-             "| measurementStatus | dopplerShift |"
-             " dopplerShiftUnc| svTimeMs | svTimeSubMs | svTimeUncMs"
-             " | validMeasStatusMask | \n"
-             " Input => %d | %d | 0x%04x%04x | %f | %f | %u | %f | %f | 0x%04x%04x |\n",
-             __func__, __LINE__,
-             gnss_measurement_info.gnssSvId,                                    // %d
-             gnss_measurement_info.CNo,                                         // %d
-             (uint32_t)(gnss_measurement_info.measurementStatus >> 32),         // %04x Upper 32
-             (uint32_t)(gnss_measurement_info.measurementStatus & 0xFFFFFFFF),  // %04x Lower 32
-             gnss_measurement_info.svTimeSpeed.dopplerShift,                    // %f
-             gnss_measurement_info.svTimeSpeed.dopplerShiftUnc,                 // %f
-             gnss_measurement_info.svTimeSpeed.svTimeMs,                        // %u
-             gnss_measurement_info.svTimeSpeed.svTimeSubMs,                     // %f
-             gnss_measurement_info.svTimeSpeed.svTimeUncMs,                     // %f
-             (uint32_t)(gnss_measurement_info.validMeasStatusMask >> 32),       // %04x Upper 32
-             (uint32_t)(gnss_measurement_info.validMeasStatusMask & 0xFFFFFFFF) // %04x Lower 32
-            );
-
-    LOC_LOGV(" %s:%d]: GNSS measurement data after conversion: \n"
-             " Output => size | prn | time_offset_ns | state |"
-             " received_gps_tow_ns| received_gps_tow_uncertainty_ns |c_n0_dbhz |"
-             " pseudorange_rate_mps | pseudorange_rate_uncertainty_mps |"
-             " accumulated_delta_range_state | flags \n"
-             " Output => %d | %d | %f | %d | %lld | %lld | %f | %f | %f | %d | %d \n",
-             __func__, __LINE__,
-             gpsMeasurement.size,                              // %d
-             gpsMeasurement.prn,                               // %d
-             gpsMeasurement.time_offset_ns,                    // %f
-             gpsMeasurement.state,                             // %d
-             gpsMeasurement.received_gps_tow_ns,               // %lld
-             gpsMeasurement.received_gps_tow_uncertainty_ns,   // %lld
-             gpsMeasurement.c_n0_dbhz,                         // %f
-             gpsMeasurement.pseudorange_rate_mps,              // %f
-             gpsMeasurement.pseudorange_rate_uncertainty_mps,  // %f
-             gpsMeasurement.accumulated_delta_range_state,     // %d
-             gpsMeasurement.flags                              // %d
-            );
+    IF_LOC_LOGV {
+        for (i = 0; i < count; i++) {
+            const qmiLocSVMeasurementStructT_v02& in = gnss_measurement_info[i];
+            const GpsMeasurement& out = gpsMeasurements[i];
+
+            LOC_LOGV(" %s:%d]: GNSS measurement raw data received form modem: \n"
+                     " Input => gnssSvId | CNo "
+                     "| measurementStatus | dopplerShift |"
+                     " dopplerShiftUnc| svTimeMs | svTimeSubMs | svTimeUncMs"
+                     " | validMeasStatusMask | \n"
+                     " Input => %d | %d | 0x%04x%04x | %f | %f | %u | %f | %f | 0x%04x%04x |\n",
+                     __func__, __LINE__,
+                     in.gnssSvId,                                    // %d
+                     in.CNo,                                         // %d
+                     (uint32_t)(in.measurementStatus >> 32),         // %04x Upper 32
+                     (uint32_t)(in.measurementStatus & 0xFFFFFFFF),  // %04x Lower 32
+                     in.svTimeSpeed.dopplerShift,                    // %f
+                     in.svTimeSpeed.dopplerShiftUnc,                 // %f
+                     in.svTimeSpeed.svTimeMs,                        // %u
+                     in.svTimeSpeed.svTimeSubMs,                     // %f
+                     in.svTimeSpeed.svTimeUncMs,                     // %f
+                     (uint32_t)(in.validMeasStatusMask >> 32),       // %04x Upper 32
+                     (uint32_t)(in.validMeasStatusMask & 0xFFFFFFFF) // %04x Lower 32
+                    );
+
+            LOC_LOGV(" %s:%d]: GNSS measurement data after conversion: \n"
+                     " Output => size | prn | time_offset_ns | state |"
+                     " received_gps_tow_ns| received_gps_tow_uncertainty_ns |c_n0_dbhz |"
+                     " pseudorange_rate_mps | pseudorange_rate_uncertainty_mps |"
+                     " accumulated_delta_range_state | flags \n"
+                     " Output => %d | %d | %f | %d | %lld | %lld | %f | %f | %f | %d | %d \n",
+                     __func__, __LINE__,
+                     out.size,                              // %d
+                     out.prn,                               // %d
+                     out.time_offset_ns,                    // %f
+                     out.state,                             // %d
+                     out.received_gps_tow_ns,               // %lld
+                     out.received_gps_tow_uncertainty_ns,   // %lld
+                     out.c_n0_dbhz,                         // %f
+                     out.pseudorange_rate_mps,              // %f
+                     out.pseudorange_rate_uncertainty_mps,  // %f
+                     out.accumulated_delta_range_state,     // %d
+                     out.flags                              // %d
+                    );
+        }
+    }
 }
 
 /*convert GpsClock type from QMI LOC to loc eng format*/
@@ -2710,13 +2965,76 @@ void LocApiV02 :: convertGpsClock (GpsClock& gpsClock,
     gpsClock.flags = flags;
 }
 
+/* queue an indication for the record thread */
+void LocApiV02 :: recordIndication(uint32_t eventId,
+  const locClientEventIndUnionType &eventPayload)
+{
+  size_t size = 0;
+  // every member of the union is a pointer to the indication struct
+  const void* payload = (const void*)eventPayload.pPositionReportEvent;
+
+  if (NULL == payload || !locClientGetSizeByEventIndId(eventId, &size)) {
+    return;
+  }
+
+  uint8_t* record = (uint8_t*)malloc(sizeof(locIndRecordHeader) + size);
+  if (NULL == record) {
+    return;
+  }
+
+  locIndRecordHeader* header = (locIndRecordHeader*)record;
+  header->timestampMsec = ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION;
+  header->eventId = eventId;
+  header->payloadSize = (uint32_t)size;
+  memcpy(record + sizeof(locIndRecordHeader), payload, size);
+
+  mIndRecordTask->sendMsg(new LocIndRecordWrite(mIndRecordFile, record,
+                                                sizeof(locIndRecordHeader) + size));
+}
+
+/* account an indication's dispatch time and log the periodic summary */
+void LocApiV02 :: updateIndicationStats(uint32_t eventId, int64_t startUsec)
+{
+  int64_t nowUsec = monotonicUsec();
+  int64_t spentUsec = nowUsec - startUsec;
+
+  if (0 == mIndCount) {
+    mIndStatsStartUsec = startUsec;
+  }
+  mIndCount++;
+  mIndTotalUsec += spentUsec;
+  if (spentUsec > mIndMaxUsec) {
+    mIndMaxUsec = spentUsec;
+    mIndMaxId = eventId;
+  }
+
+  int64_t periodUsec = nowUsec - mIndStatsStartUsec;
+  if (periodUsec >= (int64_t)mIndStatsInterval * 1000000) {
+    LOC_LOGI("%s:%d]: %u indications in %lld ms (%.1f/s), "
+             "dispatch avg %lld us, max %lld us (%s)",
+             __func__, __LINE__, mIndCount, periodUsec / 1000,
+             (double)mIndCount * 1000000 / (periodUsec > 0 ? periodUsec : 1),
+             mIndTotalUsec / mIndCount, mIndMaxUsec,
+             loc_get_v02_event_name(mIndMaxId));
+    mIndCount = 0;
+    mIndTotalUsec = 0;
+    mIndMaxUsec = 0;
+  }
+}
+
 /* event callback registered with the loc_api v02 interface */
 void LocApiV02 :: eventCb(locClientHandleType clientHandle,
   uint32_t eventId, locClientEventIndUnionType eventPayload)
 {
+  int64_t startUsec = mIndStatsInterval ? monotonicUsec() : 0;
+
   LOC_LOGD("%s:%d]: event id = %d\n", __func__, __LINE__,
                 eventId);
 
+  if (NULL != mIndRecordTask) {
+    recordIndication(eventId, eventPayload);
+  }
+
   switch(eventId)
   {
     //Position Report
@@ -2780,6 +3098,10 @@ void LocApiV02 :: eventCb(locClientHandleType clientHandle,
       reportGnssMeasurementData(*eventPayload.pGnssSvRawInfoEvent);
       break;
   }
+
+  if (mIndStatsInterval) {
+    updateIndicationStats(eventId, startUsec);
+  }
 }
 
 /* Call the service LocAdapterBase down event*/
@@ -2898,6 +3220,62 @@ void LocApiV02 :: closeDataCall()
     return;
 }
 
+/* remember a fix as the latest one for ZPP queries */
+void LocApiV02 :: updateZppCache(const GpsLocation &location,
+                                 LocPosTechMask techMask)
+{
+    if (0 == gZppCacheMaxAge ||
+        !(location.flags & GPS_LOCATION_HAS_LAT_LONG) ||
+        !(location.flags & GPS_LOCATION_HAS_ACCURACY)) {
+        return;
+    }
+
+    ZppCacheEntry entry;
+    entry.location = location;
+    entry.techMask = techMask;
+    entry.cachedMsec = ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION;
+    mZppCache.write(entry);
+}
+
+/* answer a ZPP query from the latest fix if it is recent and accurate
+   enough; wwanOnly only accepts fixes that involve cell ID */
+bool LocApiV02 :: getCachedZppFix(GpsLocation &zppLoc,
+                                  LocPosTechMask &techMask, bool wwanOnly)
+{
+    if (0 == gZppCacheMaxAge) {
+        return false;
+    }
+
+    ZppCacheEntry entry;
+    mZppCache.read(entry);
+
+    int64_t ageMsec =
+        ELAPSED_MILLIS_SINCE_BOOT_PLATFORM_LIB_ABSTRACTION - entry.cachedMsec;
+    bool hit = (0 != entry.cachedMsec) &&
+        ageMsec <= (int64_t)gZppCacheMaxAge * 1000 &&
+        (0 == gZppCacheMaxAccuracy ||
+         entry.location.accuracy <= (float)gZppCacheMaxAccuracy) &&
+        (!wwanOnly ||
+         (entry.techMask != LOC_POS_TECH_MASK_DEFAULT &&
+          (entry.techMask & LOC_POS_TECH_MASK_CELLID)));
+
+    uint32_t hits, misses;
+    if (hit) {
+        hits = __atomic_add_fetch(&mZppCacheHits, 1, __ATOMIC_RELAXED);
+        misses = __atomic_load_n(&mZppCacheMisses, __ATOMIC_RELAXED);
+        zppLoc = entry.location;
+        techMask = entry.techMask;
+    } else {
+        hits = __atomic_load_n(&mZppCacheHits, __ATOMIC_RELAXED);
+        misses = __atomic_add_fetch(&mZppCacheMisses, 1, __ATOMIC_RELAXED);
+    }
+
+    LOC_LOGD("%s:%d]: %s, fix age %lld ms, %u hits / %u misses",
+             __func__, __LINE__, hit ? "hit" : "miss",
+             entry.cachedMsec ? ageMsec : -1LL, hits, misses);
+    return hit;
+}
+
 enum loc_api_adapter_err LocApiV02 ::
 getWwanZppFix(GpsLocation &zppLoc)
 {
@@ -2908,6 +3286,11 @@ getWwanZppFix(GpsLocation &zppLoc)
     memset(&zpp_req, 0, sizeof(zpp_req));
     memset(&zppLoc, 0, sizeof(zppLoc));
 
+    LocPosTechMask cached_tech_mask;
+    if (getCachedZppFix(zppLoc, cached_tech_mask, true)) {
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+
     req_union.pGetAvailWwanPositionReq = &zpp_req;
 
     LOC_LOGD("%s:%d]: Get ZPP Fix from available wwan position\n", __func__, __LINE__);
@@ -2987,6 +3370,8 @@ getWwanZppFix(GpsLocation &zppLoc)
         zppLoc.altitude = zpp_ind.altitudeWrtEllipsoid;
     }
 
+    updateZppCache(zppLoc, LOC_POS_TECH_MASK_CELLID);
+
     return LOC_API_ADAPTER_ERR_SUCCESS;
 }
 
@@ -3009,6 +3394,10 @@ getBestAvailableZppFix(GpsLocation &zppLoc, LocPosTechMask &tech_mask)
     memset(&zppLoc, 0, sizeof(zppLoc));
     tech_mask = LOC_POS_TECH_MASK_DEFAULT;
 
+    if (getCachedZppFix(zppLoc, tech_mask, false)) {
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+
     req_union.pGetBestAvailablePositionReq = &zpp_req;
 
     LOC_LOGD("%s:%d]: Get ZPP Fix from best available source\n", __func__, __LINE__);
@@ -3079,6 +3468,8 @@ getBestAvailableZppFix(GpsLocation &zppLoc, LocPosTechMask &tech_mask)
             if (zpp_ind.technologyMask_valid) {
                 tech_mask = zpp_ind.technologyMask;
             }
+
+            updateZppCache(zppLoc, tech_mask);
         }
     }
 
@@ -34,9 +34,28 @@
 #include "ds_client.h"
 #include <LocApiBase.h>
 #include <loc_api_v02_client.h>
+#include <LocSeqLock.h>
 
 using namespace loc_core;
 
+/* QMI indication record file, written when QMI_IND_RECORD is set and read
+   by the replay test in test/.
+   Layout: LOC_IND_RECORD_MAGIC, LOC_IND_RECORD_VERSION (uint32 each), then
+   per indication a locIndRecordHeader followed by the raw indication
+   struct exactly as received from the QMI client layer. The structs are
+   fixed size C types, so a recording replays on builds of the same
+   target. */
+#define LOC_IND_RECORD_FILE                "/data/misc/location/qmi_ind.rec"
+#define LOC_IND_RECORD_MAGIC               (0x444e4951) /* "QIND" */
+#define LOC_IND_RECORD_VERSION             (1)
+
+typedef struct
+{
+  int64_t  timestampMsec;   /* ms since boot on arrival */
+  uint32_t eventId;         /* QMI_LOC_EVENT_..._IND_V02 */
+  uint32_t payloadSize;     /* bytes following this header */
+} locIndRecordHeader;
+
 /* This class derives from the LocApiBase class.
    The members of this class are responsible for converting
    the Loc API V02 data structures into Loc Adapter data structures.
@@ -59,6 +78,30 @@ private:
   locClientEventMaskType mQmiMask;
   bool mInSession;
   bool mEngineOn;
+  /* XTRA parts sent before waiting for the oldest to be acknowledged */
+  uint32_t mXtraInjectWindow;
+  /* QMI indication recording, written on mIndRecordTask */
+  MsgTask* mIndRecordTask;
+  FILE* mIndRecordFile;
+  /* per-indication dispatch statistics, reported every mIndStatsInterval s */
+  uint32_t mIndStatsInterval;
+  uint32_t mIndCount;
+  int64_t mIndStatsStartUsec;
+  int64_t mIndTotalUsec;
+  int64_t mIndMaxUsec;
+  uint32_t mIndMaxId;
+  /* reused for every GNSS measurement report, allocated on first use */
+  GpsData* mGpsMeasurementData;
+
+  /* latest fix known to the HAL, answers ZPP queries without the modem */
+  typedef struct {
+    GpsLocation location;
+    LocPosTechMask techMask;
+    int64_t cachedMsec;         /* boot time it was cached, 0 if empty */
+  } ZppCacheEntry;
+  LocSeqLock<ZppCacheEntry> mZppCache;
+  uint32_t mZppCacheHits;
+  uint32_t mZppCacheMisses;
 
   /* Convert event mask from loc eng to loc_api_v02 format */
   static locClientEventMaskType convertMask(LOC_API_ADAPTER_EVENT_MASK_T mask);
@@ -77,9 +120,10 @@ private:
   static bool convertNiNotifyVerifyType (GpsNiNotification *notif,
       qmiLocNiNotifyVerifyEnumT_v02 notif_priv);
 
-  /*convert GpsMeasurement type from QMI LOC to loc eng format*/
-  static void convertGpsMeasurements (GpsMeasurement& gpsMeasurement,
-      const qmiLocSVMeasurementStructT_v02& gnss_measurement_info);
+  /*convert a batch of GpsMeasurement from QMI LOC to loc eng format*/
+  static void convertGpsMeasurements (GpsMeasurement* gpsMeasurements,
+      const qmiLocSVMeasurementStructT_v02* gnss_measurement_info,
+      int count);
 
   /*convert GpsClock type from QMI LOC to loc eng format*/
   static void convertGpsClock (GpsClock& gpsClock,
@@ -125,6 +169,21 @@ private:
   void reportGnssMeasurementData(
     const qmiLocEventGnssSvMeasInfoIndMsgT_v02& gnss_measurement_report_ptr);
 
+  /* queue an indication for the record thread */
+  void recordIndication(uint32_t eventId,
+                        const locClientEventIndUnionType &eventPayload);
+
+  /* account an indication's dispatch time and log the periodic summary */
+  void updateIndicationStats(uint32_t eventId, int64_t startUsec);
+
+  /* remember a fix as the latest one for ZPP queries */
+  void updateZppCache(const GpsLocation &location, LocPosTechMask techMask);
+
+  /* answer a ZPP query from the latest fix if it is recent and accurate
+     enough; wwanOnly only accepts fixes that involve cell ID */
+  bool getCachedZppFix(GpsLocation &zppLoc, LocPosTechMask &techMask,
+                       bool wwanOnly);
+
   bool registerEventMask(locClientEventMaskType qmiMask);
   locClientEventMaskType adjustMaskForNoSession(locClientEventMaskType qmiMask);
   void cacheGnssMeasurementSupport();
@@ -179,6 +238,9 @@ public:
     setServer(unsigned int ip, int port, LocServerType type);
   virtual enum loc_api_adapter_err
     setXtraData(char* data, int length);
+  /* XTRA parts setXtraData() keeps in flight, XTRA_INJECT_WINDOW in
+     gps.conf; clamped to 1..LOC_XTRA_INJECT_WINDOW_MAX */
+  void setXtraInjectWindow(uint32_t window);
   virtual enum loc_api_adapter_err
     requestXtraServer();
   virtual enum loc_api_adapter_err
@@ -65,6 +65,7 @@ typedef struct {
    bool                    ind_is_selected;              /* is cb selected? */
    bool                    ind_is_waiting;               /* is waiting?     */
    bool                    ind_has_arrived;              /* callback has arrived */
+   bool                    ind_is_multipart;  /* one of several outstanding reqs */
    uint32_t                req_id;                    /*  sync request */
    void                    *recv_ind_payload_ptr; /* received  payload */
    uint32_t                recv_ind_id;      /* received  ind   */
@@ -203,8 +204,16 @@ void loc_sync_process_ind(
             memcpy(slot->recv_ind_payload_ptr, ind_payload_ptr, payload_size);
 
             consumed = true;
-
          }
+         /* Each outstanding part of a multipart request takes exactly one
+            ind, even one without a payload, so the next ind with the same
+            id goes to the next slot waiting for it */
+         if (slot->ind_is_multipart)
+         {
+            consumed = true;
+         }
+         slot->ind_has_arrived = true;
+
          /* Received a callback while waiting, wake up thread to check it */
          if (slot->ind_is_waiting)
          {
@@ -217,8 +226,6 @@ void loc_sync_process_ind(
             /* If callback arrives before wait, remember it */
             LOC_LOGV("%s:%d]: ind %u arrived before wait was called \n",
                           __func__, __LINE__, ind_id);
-
-            slot->ind_has_arrived = true;
          }
       }
       pthread_mutex_unlock(&slot->sync_req_lock);
@@ -347,7 +354,8 @@ static int loc_sync_select_ind(
       locClientHandleType       client_handle,   /* Client handle */
       uint32_t                  ind_id,  /* ind Id wait for */
       uint32_t                  req_id,   /* req id */
-      void *                    ind_payload_ptr /* ptr where payload should be copied to*/
+      void *                    ind_payload_ptr, /* ptr where payload should be copied to*/
+      bool                      multipart /* one of several outstanding reqs */
 )
 {
    int select_id = loc_alloc_slot();
@@ -370,6 +378,7 @@ static int loc_sync_select_ind(
    slot->ind_is_selected = true;
    slot->ind_is_waiting = false;
    slot->ind_has_arrived = false;
+   slot->ind_is_multipart = multipart;
 
    slot->recv_ind_id = ind_id;
    slot->req_id      = req_id;
@@ -449,13 +458,17 @@ static int loc_sync_wait_for_ind(
       /* Take new wait request */
       slot->ind_is_waiting = true;
 
-      /* Waiting */
-      rc = pthread_cond_timedwait(&slot->ind_arrived_cond,
-            &slot->sync_req_lock, &expire_time);
+      /* Waiting, ignoring spurious wakeups */
+      rc = 0;
+      while (!slot->ind_has_arrived && rc != ETIMEDOUT)
+      {
+         rc = pthread_cond_timedwait(&slot->ind_arrived_cond,
+               &slot->sync_req_lock, &expire_time);
+      }
 
       slot->ind_is_waiting = false;
 
-      if(rc == ETIMEDOUT)
+      if (!slot->ind_has_arrived)
       {
          LOC_LOGE("%s:%d]: slot %d, timed out for ind_id %s\n",
                     __func__, __LINE__, select_id, loc_get_v02_event_name(ind_id));
@@ -472,38 +485,39 @@ static int loc_sync_wait_for_ind(
 
 /*===========================================================================
 
-FUNCTION    loc_sync_send_req
+FUNCTION    loc_sync_send_req_select
 
 DESCRIPTION
-   Synchronous req call (thread safe)
+   Selects the indication to wait for and sends the request
 
 DEPENDENCIES
    N/A
 
 RETURN VALUE
-   Loc API 2.0 status
+   Wait id (>=0) on success, -1 on failure with the Loc API 2.0 status in
+   *status_ptr
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-locClientStatusEnumType loc_sync_send_req
+static int loc_sync_send_req_select
 (
       locClientHandleType       client_handle,
       uint32_t                  req_id,        /* req id */
       locClientReqUnionType     req_payload,
-      uint32_t                  timeout_msec,
-      uint32_t                  ind_id,  //ind ID to block for, usually the same as req_id */
-      void                      *ind_payload_ptr /* can be NULL*/
+      uint32_t                  ind_id,  //ind ID to wait for, usually the same as req_id */
+      void                      *ind_payload_ptr, /* can be NULL*/
+      bool                      multipart,
+      locClientStatusEnumType   *status_ptr
 )
 {
-   locClientStatusEnumType status = eLOC_CLIENT_SUCCESS ;
+   locClientStatusEnumType status = eLOC_CLIENT_FAILURE_INTERNAL;
    int select_id;
-   int rc = 0;
 
    // Select the callback we are waiting for
    select_id = loc_sync_select_ind(client_handle, ind_id, req_id,
-                                   ind_payload_ptr);
+                                   ind_payload_ptr, multipart);
 
    if (select_id >= 0)
    {
@@ -514,34 +528,149 @@ locClientStatusEnumType loc_sync_send_req
       if (status != eLOC_CLIENT_SUCCESS )
       {
          loc_free_slot(select_id);
+         select_id = -1;
       }
+   }
+   else
+   {
+      select_id = -1;
+   }
+
+   if (NULL != status_ptr)
+   {
+      *status_ptr = status;
+   }
+
+   return select_id;
+}
+
+/*===========================================================================
+
+FUNCTION    loc_sync_send_req_nowait
+
+DESCRIPTION
+   Sends one part of a multipart request and selects the indication to wait
+   for, without blocking for it. Several parts may be outstanding at once;
+   each must be completed with loc_sync_wait_req(). An indication goes to
+   the lowest numbered slot still waiting for its id, and slots are reused
+   lowest free first, so that is not necessarily the part it answers. The
+   caller must tell the parts apart by the indication payload.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Wait id (>=0) to pass to loc_sync_wait_req() on success, -1 on failure
+   with the Loc API 2.0 status in *status_ptr
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_sync_send_req_nowait
+(
+      locClientHandleType       client_handle,
+      uint32_t                  req_id,        /* req id */
+      locClientReqUnionType     req_payload,
+      uint32_t                  ind_id,  //ind ID to wait for, usually the same as req_id */
+      void                      *ind_payload_ptr, /* can be NULL*/
+      locClientStatusEnumType   *status_ptr
+)
+{
+   return loc_sync_send_req_select(client_handle, req_id, req_payload,
+                                   ind_id, ind_payload_ptr, true,
+                                   status_ptr);
+}
+
+/*===========================================================================
+
+FUNCTION    loc_sync_wait_req
+
+DESCRIPTION
+   Waits for the indication of a request sent by loc_sync_send_req_nowait()
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Loc API 2.0 status
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+locClientStatusEnumType loc_sync_wait_req
+(
+      int                       wait_id,  /* from loc_sync_send_req_nowait() */
+      uint32_t                  timeout_msec,
+      uint32_t                  ind_id
+)
+{
+   locClientStatusEnumType status = eLOC_CLIENT_SUCCESS;
+   int rc;
+
+   // Wait for the indication callback
+   if (( rc = loc_sync_wait_for_ind( wait_id,
+                                     timeout_msec / 1000,
+                                     ind_id) ) < 0)
+   {
+      if ( rc == -ETIMEDOUT)
+         status = eLOC_CLIENT_FAILURE_TIMEOUT;
       else
-      {
-         // Wait for the indication callback
-         if (( rc = loc_sync_wait_for_ind( select_id,
-                                           timeout_msec / 1000,
-                                           ind_id) ) < 0)
-         {
-            if ( rc == -ETIMEDOUT)
-               status = eLOC_CLIENT_FAILURE_TIMEOUT;
-            else
-               status = eLOC_CLIENT_FAILURE_INTERNAL;
-
-            // Callback waiting failed
-            LOC_LOGE("%s:%d]: loc_api_wait_for_ind failed, err %d, "
-                     "select id %d, status %s", __func__, __LINE__, rc ,
-                     select_id, loc_get_v02_client_status_name(status));
-         }
-         else
-         {
-            status =  eLOC_CLIENT_SUCCESS;
-            LOC_LOGV("%s:%d]: success (select id %d)\n",
-                          __func__, __LINE__, select_id);
-         }
-      }
-   } /* select id */
+         status = eLOC_CLIENT_FAILURE_INTERNAL;
+
+      // Callback waiting failed
+      LOC_LOGE("%s:%d]: loc_api_wait_for_ind failed, err %d, "
+               "select id %d, status %s", __func__, __LINE__, rc ,
+               wait_id, loc_get_v02_client_status_name(status));
+   }
+   else
+   {
+      LOC_LOGV("%s:%d]: success (select id %d)\n",
+                    __func__, __LINE__, wait_id);
+   }
 
    return status;
 }
 
+/*===========================================================================
+
+FUNCTION    loc_sync_send_req
+
+DESCRIPTION
+   Synchronous req call (thread safe)
 
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Loc API 2.0 status
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+locClientStatusEnumType loc_sync_send_req
+(
+      locClientHandleType       client_handle,
+      uint32_t                  req_id,        /* req id */
+      locClientReqUnionType     req_payload,
+      uint32_t                  timeout_msec,
+      uint32_t                  ind_id,  //ind ID to block for, usually the same as req_id */
+      void                      *ind_payload_ptr /* can be NULL*/
+)
+{
+   locClientStatusEnumType status = eLOC_CLIENT_SUCCESS ;
+   int wait_id;
+
+   wait_id = loc_sync_send_req_select(client_handle, req_id, req_payload,
+                                      ind_id, ind_payload_ptr, false,
+                                      &status);
+
+   if (wait_id >= 0)
+   {
+      status = loc_sync_wait_req(wait_id, timeout_msec, ind_id);
+   }
+
+   return status;
+}
@@ -83,6 +83,28 @@ extern locClientStatusEnumType loc_sync_send_req
       void                      *ind_payload_ptr /* can be NULL*/
 );
 
+/* Sends one part of a multipart request without blocking for its
+   indication; returns a wait id for loc_sync_wait_req(), or -1 on failure
+   with the status in status_ptr. Indications are not matched to parts in
+   send order; tell them apart by their payload. */
+extern int loc_sync_send_req_nowait
+(
+      locClientHandleType       client_handle,
+      uint32_t                  req_id,        /* req id */
+      locClientReqUnionType     req_payload,
+      uint32_t                  ind_id,  //ind ID to wait for, usually the same as req_id */
+      void                      *ind_payload_ptr, /* can be NULL*/
+      locClientStatusEnumType   *status_ptr
+);
+
+/* Blocks for the indication of a request sent by loc_sync_send_req_nowait */
+extern locClientStatusEnumType loc_sync_wait_req
+(
+      int                       wait_id,
+      uint32_t                  timeout_msec,
+      uint32_t                  ind_id
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,146 @@
+# QMI indication replay: LocApiV02 over a stand-in QMI_LOC client, loaded
+# by the replay executable as its LBS proxy
+OLD_LOCAL_PATH := $(LOCAL_PATH)
+LOC_REPLAY_TEST_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_REPLAY_TEST_PATH)
+LOCAL_MODULE := libloc_api_v02_replay
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_SRC_FILES := \
+    ../LocApiV02.cpp \
+    ../loc_api_v02_log.c \
+    ../loc_api_v02_ind_table.c \
+    ../loc_api_sync_req.c \
+    loc_api_v02_replay_client.c \
+    loc_api_v02_replay_proxy.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_REPLAY_TEST_PATH) \
+    $(LOC_REPLAY_TEST_PATH)/.. \
+    $(call project-path-for,qcom-gps)/core \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/qmi-framework/inc \
+    $(TARGET_OUT_HEADERS)/qmi/inc \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_ds_api
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libloc_core \
+    libgps.utils \
+    libloc_ds_api
+
+LOCAL_PRELINK_MODULE := false
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_REPLAY_TEST_PATH)
+LOCAL_MODULE := loc_api_v02_replay
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_SRC_FILES := loc_api_v02_replay.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_REPLAY_TEST_PATH) \
+    $(LOC_REPLAY_TEST_PATH)/.. \
+    $(call project-path-for,qcom-gps)/core \
+    $(call project-path-for,qcom-gps)/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/libloc_eng \
+    $(TARGET_OUT_HEADERS)/qmi-framework/inc \
+    $(TARGET_OUT_HEADERS)/qmi/inc \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_ds_api
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libloc_core \
+    libgps.utils \
+    libloc_eng \
+    libloc_api_v02_replay
+
+LOCAL_PRELINK_MODULE := false
+include $(BUILD_EXECUTABLE)
+
+# XTRA injection window over the stand-in client: lost and reordered
+# acks, and the injection time per window size
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_REPLAY_TEST_PATH)
+LOCAL_MODULE := loc_api_v02_xtra_test
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_SRC_FILES := loc_api_v02_xtra_test.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_REPLAY_TEST_PATH) \
+    $(LOC_REPLAY_TEST_PATH)/.. \
+    $(call project-path-for,qcom-gps)/core \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/qmi-framework/inc \
+    $(TARGET_OUT_HEADERS)/qmi/inc \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_ds_api
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libloc_core \
+    libgps.utils \
+    libloc_api_v02_replay
+
+LOCAL_PRELINK_MODULE := false
+include $(BUILD_EXECUTABLE)
+
+# Fix batching through loc_eng over the stand-in client: order, interval
+# and stop flushes
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_REPLAY_TEST_PATH)
+LOCAL_MODULE := loc_api_v02_batch_test
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+    -fno-short-enums \
+    -D_ANDROID_
+
+LOCAL_SRC_FILES := loc_api_v02_batch_test.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_REPLAY_TEST_PATH) \
+    $(LOC_REPLAY_TEST_PATH)/.. \
+    $(call project-path-for,qcom-gps)/core \
+    $(call project-path-for,qcom-gps)/loc_api/libloc_api_50001 \
+    $(TARGET_OUT_HEADERS)/libloc_core \
+    $(TARGET_OUT_HEADERS)/libloc_eng \
+    $(TARGET_OUT_HEADERS)/qmi-framework/inc \
+    $(TARGET_OUT_HEADERS)/qmi/inc \
+    $(TARGET_OUT_HEADERS)/gps.utils \
+    $(TARGET_OUT_HEADERS)/libloc_ds_api
+
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libloc_core \
+    libgps.utils \
+    libloc_eng \
+    libloc_api_v02_replay
+
+LOCAL_PRELINK_MODULE := false
+include $(BUILD_EXECUTABLE)
+
+LOCAL_PATH := $(OLD_LOCAL_PATH)
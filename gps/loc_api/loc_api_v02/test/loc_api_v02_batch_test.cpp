@@ -0,0 +1,329 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Fix batching (FIX_BATCH_SIZE, FIX_BATCH_INTERVAL) end to end, from
+   position indications handed to LocApiV02 to the location callback,
+   over the stand-in QMI_LOC client:
+   - a full batch is reported at once, in timestamp order
+   - a partial batch is reported FIX_BATCH_INTERVAL after its first fix
+   - a timeout queued behind the flush of a full batch does not flush the
+     next one
+   - stopping the session reports what is batched
+   Usage: loc_api_v02_batch_test */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_batch_test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+
+#include <ContextBase.h>
+#include <MsgTask.h>
+#include <loc_eng.h>
+#include <LocApiV02.h>
+#include "loc_api_v02_replay.h"
+
+using namespace loc_core;
+
+#define TEST_OPEN_TIMEOUT_MSEC   (5000)
+#define TEST_BATCH_SIZE          (5)
+#define TEST_BATCH_INTERVAL_SEC  (1)
+#define TEST_INTERVAL_MSEC       (TEST_BATCH_INTERVAL_SEC * 1000)
+/* timer and msg task latency allowed on top of the interval */
+#define TEST_SLACK_MSEC          (400)
+#define TEST_UTC_BASE            (1445000000000ULL)
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+// a fix as it reached the location callback
+struct TestFix {
+    GpsUtcTime utc;
+    int64_t msec;
+};
+
+static loc_eng_data_s_type gLocEngData;
+static ContextBase* gContext;
+static pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gCond = PTHREAD_COND_INITIALIZER;
+static std::vector<TestFix> gFixes;
+
+static int64_t monotonicMsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void testLocationCb(UlpLocation* location, void* locExt)
+{
+    if (NULL == location) {
+        return;
+    }
+    pthread_mutex_lock(&gMutex);
+    TestFix fix = {location->gpsLocation.timestamp, monotonicMsec()};
+    gFixes.push_back(fix);
+    pthread_cond_broadcast(&gCond);
+    pthread_mutex_unlock(&gMutex);
+}
+
+static void testStatusCb(GpsStatus* status) {}
+static void testSvStatusCb(GpsSvStatus* svStatus, void* svExt) {}
+static void testNmeaCb(GpsUtcTime timestamp, const char* nmea, int length) {}
+static void testSetCapabilitiesCb(uint32_t capabilities) {}
+static void testWakelockCb() {}
+static void testRequestUtcTimeCb() {}
+
+/* signals once every msg queued ahead of it on the task is processed */
+struct TestDrain : public LocMsg {
+    pthread_mutex_t* mMutex;
+    pthread_cond_t* mCond;
+    bool* mDone;
+    inline TestDrain(pthread_mutex_t* mutex, pthread_cond_t* cond,
+                     bool* done) :
+        LocMsg(), mMutex(mutex), mCond(cond), mDone(done) {}
+    virtual void proc() const {
+        pthread_mutex_lock(mMutex);
+        *mDone = true;
+        pthread_cond_signal(mCond);
+        pthread_mutex_unlock(mMutex);
+    }
+};
+
+static void drain()
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+    bool done = false;
+
+    gContext->sendMsg(new TestDrain(&mutex, &cond, &done));
+    pthread_mutex_lock(&mutex);
+    while (!done) {
+        pthread_cond_wait(&cond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* hands a final satellite fix at TEST_UTC_BASE + utcSec s to LocApiV02 */
+static void injectFix(int utcSec)
+{
+    static qmiLocEventPositionReportIndMsgT_v02 ind;
+
+    memset(&ind, 0, sizeof(ind));
+    ind.sessionStatus = eQMI_LOC_SESS_STATUS_SUCCESS_V02;
+    ind.latitude_valid = 1;
+    ind.latitude = 37.0 + utcSec * 1e-5;
+    ind.longitude_valid = 1;
+    ind.longitude = -122.0;
+    ind.horUncCircular_valid = 1;
+    ind.horUncCircular = 5;
+    ind.timestampUtc_valid = 1;
+    ind.timestampUtc = TEST_UTC_BASE + utcSec * 1000ULL;
+    ind.technologyMask_valid = 1;
+    ind.technologyMask = QMI_LOC_POS_TECH_MASK_SATELLITE_V02;
+    locClientReplayEventInd(QMI_LOC_EVENT_POSITION_REPORT_IND_V02, &ind);
+}
+
+/* the fixes reported since the last call, after waiting up to timeoutMsec
+   for count of them */
+static std::vector<TestFix> takeFixes(size_t count, int64_t timeoutMsec)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMsec / 1000;
+    deadline.tv_nsec += (timeoutMsec % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&gMutex);
+    while (gFixes.size() < count &&
+           0 == pthread_cond_timedwait(&gCond, &gMutex, &deadline)) {
+    }
+    std::vector<TestFix> fixes;
+    fixes.swap(gFixes);
+    pthread_mutex_unlock(&gMutex);
+    return fixes;
+}
+
+static bool inOrder(const std::vector<TestFix>& fixes, int firstSec)
+{
+    for (size_t i = 0; i < fixes.size(); i++) {
+        if (TEST_UTC_BASE + (firstSec + i) * 1000ULL != fixes[i].utc) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// out of order fixes; the last one fills the batch
+static void testFullBatch()
+{
+    const int utcSec[TEST_BATCH_SIZE] = {2, 0, 1, 4, 3};
+    for (int i = 0; i < TEST_BATCH_SIZE - 1; i++) {
+        injectFix(utcSec[i]);
+    }
+    drain();
+    CHECK(takeFixes(0, 0).empty());
+
+    int64_t startMsec = monotonicMsec();
+    injectFix(utcSec[TEST_BATCH_SIZE - 1]);
+    drain();
+    std::vector<TestFix> fixes = takeFixes(TEST_BATCH_SIZE, 0);
+    CHECK(TEST_BATCH_SIZE == fixes.size() && inOrder(fixes, 0));
+    CHECK(fixes.empty() || fixes.back().msec - startMsec < TEST_SLACK_MSEC);
+}
+
+static void testIntervalFlush()
+{
+    int64_t startMsec = monotonicMsec();
+    injectFix(10);
+    injectFix(11);
+    drain();
+    CHECK(takeFixes(2, TEST_INTERVAL_MSEC / 2).empty());
+
+    std::vector<TestFix> fixes =
+        takeFixes(2, TEST_INTERVAL_MSEC + TEST_SLACK_MSEC);
+    CHECK(2 == fixes.size() && inOrder(fixes, 10));
+    if (2 == fixes.size()) {
+        int64_t waitMsec = fixes[0].msec - startMsec;
+        CHECK(waitMsec >= TEST_INTERVAL_MSEC - 50);
+        CHECK(waitMsec < TEST_INTERVAL_MSEC + TEST_SLACK_MSEC);
+        printf("bench: partial batch reported after %lld ms, interval %d ms\n",
+               (long long)waitMsec, TEST_INTERVAL_MSEC);
+    }
+}
+
+/* keeps the msg task busy, so that what is sent meanwhile queues up */
+struct TestBlock : public LocMsg {
+    const useconds_t mUsec;
+    inline TestBlock(useconds_t usec) : LocMsg(), mUsec(usec) {}
+    virtual void proc() const {
+        usleep(mUsec);
+    }
+};
+
+// the batch fills while the timeout of its first fix is queued behind it;
+// that timeout must not flush the fix batched after the full flush, which
+// waits a whole interval of its own
+static void testStaleTimeout()
+{
+    for (int i = 0; i < TEST_BATCH_SIZE - 1; i++) {
+        injectFix(20 + i);
+    }
+    drain();
+    gContext->sendMsg(new TestBlock(TEST_INTERVAL_MSEC * 1000 * 3 / 2));
+    usleep(TEST_INTERVAL_MSEC * 1000 / 2);
+    injectFix(20 + TEST_BATCH_SIZE - 1);
+    injectFix(30);
+    // the timeout is posted behind both fixes while the task is blocked
+    drain();
+    int64_t startMsec = monotonicMsec();
+    CHECK(TEST_BATCH_SIZE == takeFixes(TEST_BATCH_SIZE, 0).size());
+
+    CHECK(takeFixes(1, TEST_INTERVAL_MSEC * 3 / 4).empty());
+    std::vector<TestFix> fixes = takeFixes(1, TEST_INTERVAL_MSEC);
+    CHECK(1 == fixes.size() && inOrder(fixes, 30));
+    CHECK(fixes.empty() ||
+          fixes[0].msec - startMsec >= TEST_INTERVAL_MSEC - 50);
+}
+
+static void testStopFlush()
+{
+    int64_t startMsec = monotonicMsec();
+    injectFix(41);
+    injectFix(40);
+    injectFix(42);
+    drain();
+    CHECK(takeFixes(0, 0).empty());
+
+    loc_eng_stop(gLocEngData);
+    drain();
+    std::vector<TestFix> fixes = takeFixes(3, 0);
+    CHECK(3 == fixes.size() && inOrder(fixes, 40));
+    CHECK(fixes.empty() || fixes.back().msec - startMsec < TEST_SLACK_MSEC);
+
+    // and no timer flush is left behind
+    CHECK(takeFixes(1, TEST_INTERVAL_MSEC + TEST_SLACK_MSEC).empty());
+}
+
+int main(int argc, char** argv)
+{
+    loc_eng_read_config();
+    gps_conf.FIX_BATCH_SIZE = TEST_BATCH_SIZE;
+    gps_conf.FIX_BATCH_INTERVAL = TEST_BATCH_INTERVAL_SEC;
+
+    LOC_API_ADAPTER_EVENT_MASK_T event =
+        LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+        LOC_API_ADAPTER_BIT_STATUS_REPORT;
+    LocCallbacks callbacks = {testLocationCb, /* location_cb */
+                              testStatusCb, /* status_cb */
+                              testSvStatusCb, /* sv_status_cb */
+                              testNmeaCb, /* nmea_cb */
+                              testSetCapabilitiesCb, /* set_capabilities_cb */
+                              testWakelockCb, /* acquire_wakelock_cb */
+                              testWakelockCb, /* release_wakelock_cb */
+                              NULL, /* create_thread_cb */
+                              NULL, /* location_ext_parser */
+                              NULL, /* sv_ext_parser */
+                              testRequestUtcTimeCb, /* request_utc_time_cb */
+                              };
+    gContext = new ContextBase(new MsgTask("Loc_batch_test", false), 0,
+                               LOC_REPLAY_LIB_NAME);
+    if (0 != loc_eng_init(gLocEngData, &callbacks, event, gContext) ||
+        !locClientReplayWaitOpen(TEST_OPEN_TIMEOUT_MSEC)) {
+        fprintf(stderr, "LocApiV02 did not open the stand-in client\n");
+        return 1;
+    }
+    LocPosMode params;
+    loc_eng_set_position_mode(gLocEngData, params);
+    loc_eng_start(gLocEngData);
+    drain();
+
+    testFullBatch();
+    testIntervalFlush();
+    testStaleTimeout();
+    testStopFlush();
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
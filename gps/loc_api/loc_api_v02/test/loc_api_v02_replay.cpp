@@ -0,0 +1,534 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Replays QMI_LOC event indications recorded with QMI_IND_RECORD=1 through
+   LocApiV02, LocEngAdapter and loc_eng up to the HAL callbacks, with no
+   modem: the QMI_LOC client is the stand-in in loc_api_v02_replay_client.c.
+
+   usage: loc_api_v02_replay [-m] [-n loops] [record file]
+     -m  replay at max speed instead of at the recorded pace
+     -n  replay the recording this many times, 1 by default
+   The record file defaults to LOC_IND_RECORD_FILE.
+
+   An epoch is one position report indication, or one GPS measurement
+   report in a recording without any. Reported are
+   - latency of each fix, from handing its indication to LocApiV02 to the
+     location callback; fixes are matched by their UTC timestamp
+   - latency of each GPS measurement report, from its indication to the
+     measurement callback; reports come back in order
+   - indications per second over the whole replay
+   - operator new calls per epoch, made by any library in the process
+   - process CPU time per epoch */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_replay"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <ContextBase.h>
+#include <MsgTask.h>
+#include <loc_eng.h>
+#include <LocApiV02.h>
+#include "loc_api_v02_replay.h"
+
+using namespace loc_core;
+
+#define LOC_REPLAY_OPEN_TIMEOUT_MSEC   (5000)
+
+typedef struct
+{
+    const locIndRecordHeader* header;
+    const void* payload;
+} LocReplayRecord;
+
+typedef struct
+{
+    GpsUtcTime utc;
+    int64_t injectUsec;
+    bool reported;
+} LocReplayFix;
+
+static loc_eng_data_s_type gLocEngData;
+
+static pthread_mutex_t gReplayMutex = PTHREAD_MUTEX_INITIALIZER;
+/* fixes handed to LocApiV02 in order, those before gFixHead are reported */
+static LocReplayFix* gFixes;
+static uint32_t gFixCount;
+static uint32_t gFixHead;
+static uint32_t gFixMax;
+static int64_t* gLatencyUsec;
+static uint32_t gLatencyCount;
+static uint32_t gLocationCbCount;
+static uint32_t gSvStatusCbCount;
+static uint32_t gNmeaCbCount;
+/* measurement reports handed to LocApiV02, in order, and their latency */
+static int64_t* gMeasInjectUsec;
+static uint32_t gMeasCount;
+static uint32_t gMeasMax;
+static int64_t* gMeasLatencyUsec;
+static uint32_t gMeasCbCount;
+
+static volatile uint32_t gNewCount;
+
+/* Counts allocations of every library in the process: the executable's
+   definitions take precedence over the C++ runtime's in the dynamic
+   linker's lookup. */
+void* operator new(size_t size)
+{
+    __sync_fetch_and_add(&gNewCount, 1);
+    void* p = malloc(size ? size : 1);
+    if (NULL == p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p)
+{
+    free(p);
+}
+
+void operator delete[](void* p)
+{
+    free(p);
+}
+
+static int64_t monotonicUsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t cpuUsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void replayLocationCb(UlpLocation* location, void* locExt)
+{
+    int64_t nowUsec = monotonicUsec();
+
+    pthread_mutex_lock(&gReplayMutex);
+    gLocationCbCount++;
+    // fixes are reported in order, the oldest one with this UTC time is it
+    for (uint32_t i = gFixHead; NULL != location && i < gFixCount; i++) {
+        LocReplayFix& fix = gFixes[i];
+        if (!fix.reported && fix.utc == location->gpsLocation.timestamp) {
+            fix.reported = true;
+            gLatencyUsec[gLatencyCount++] = nowUsec - fix.injectUsec;
+            break;
+        }
+    }
+    while (gFixHead < gFixCount && gFixes[gFixHead].reported) {
+        gFixHead++;
+    }
+    pthread_mutex_unlock(&gReplayMutex);
+}
+
+static void replaySvStatusCb(GpsSvStatus* svStatus, void* svExt)
+{
+    __sync_fetch_and_add(&gSvStatusCbCount, 1);
+}
+
+static void replayNmeaCb(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    __sync_fetch_and_add(&gNmeaCbCount, 1);
+}
+
+static void replayMeasurementCb(GpsData* data)
+{
+    int64_t nowUsec = monotonicUsec();
+
+    pthread_mutex_lock(&gReplayMutex);
+    if (gMeasCbCount < gMeasCount) {
+        gMeasLatencyUsec[gMeasCbCount] =
+            nowUsec - gMeasInjectUsec[gMeasCbCount];
+    }
+    gMeasCbCount++;
+    pthread_mutex_unlock(&gReplayMutex);
+}
+
+static void replayStatusCb(GpsStatus* status) {}
+static void replaySetCapabilitiesCb(uint32_t capabilities) {}
+static void replayWakelockCb() {}
+static void replayRequestUtcTimeCb() {}
+
+/* remember a fix handed to LocApiV02, by its UTC time */
+static void replayFixInjected(const qmiLocEventPositionReportIndMsgT_v02* ind)
+{
+    if (!ind->timestampUtc_valid) {
+        return;
+    }
+
+    pthread_mutex_lock(&gReplayMutex);
+    if (gFixCount < gFixMax) {
+        LocReplayFix& fix = gFixes[gFixCount++];
+        fix.utc = (GpsUtcTime)ind->timestampUtc;
+        fix.injectUsec = monotonicUsec();
+        fix.reported = false;
+    }
+    pthread_mutex_unlock(&gReplayMutex);
+}
+
+/* LocApiV02 only reports GPS measurements, and only non empty ones */
+static bool replayIsGpsMeasurement(const locIndRecordHeader* header,
+                                   const void* payload)
+{
+    if (QMI_LOC_EVENT_GNSS_MEASUREMENT_REPORT_IND_V02 != header->eventId) {
+        return false;
+    }
+    const qmiLocEventGnssSvMeasInfoIndMsgT_v02* ind =
+        (const qmiLocEventGnssSvMeasInfoIndMsgT_v02*)payload;
+    return eQMI_LOC_SV_SYSTEM_GPS_V02 == ind->system &&
+           ind->svMeasurement_valid && ind->svMeasurement_len > 0;
+}
+
+/* remember when a measurement report was handed to LocApiV02 */
+static void replayMeasurementInjected()
+{
+    pthread_mutex_lock(&gReplayMutex);
+    if (gMeasCount < gMeasMax) {
+        gMeasInjectUsec[gMeasCount++] = monotonicUsec();
+    }
+    pthread_mutex_unlock(&gReplayMutex);
+}
+
+/* signals once every msg queued ahead of it on the task is processed */
+struct LocReplayDrain : public LocMsg {
+    pthread_mutex_t* mMutex;
+    pthread_cond_t* mCond;
+    bool* mDone;
+    inline LocReplayDrain(pthread_mutex_t* mutex, pthread_cond_t* cond,
+                          bool* done) :
+        LocMsg(), mMutex(mutex), mCond(cond), mDone(done) {}
+    virtual void proc() const {
+        pthread_mutex_lock(mMutex);
+        *mDone = true;
+        pthread_cond_signal(mCond);
+        pthread_mutex_unlock(mMutex);
+    }
+};
+
+static void replayDrain(ContextBase* context)
+{
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+    bool done = false;
+
+    context->sendMsg(new LocReplayDrain(&mutex, &cond, &done));
+    pthread_mutex_lock(&mutex);
+    while (!done) {
+        pthread_cond_wait(&cond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+/* reads a whole record file and indexes its indications */
+static uint8_t* replayLoad(const char* fileName, LocReplayRecord** records,
+                           uint32_t* count, uint32_t* skipped)
+{
+    FILE* file = fopen(fileName, "rb");
+    if (NULL == file) {
+        fprintf(stderr, "cannot open %s\n", fileName);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = (uint8_t*)malloc(size > 0 ? size : 1);
+    if (NULL == data || size < (long)(2 * sizeof(uint32_t)) ||
+        1 != fread(data, size, 1, file)) {
+        fprintf(stderr, "cannot read %s\n", fileName);
+        fclose(file);
+        free(data);
+        return NULL;
+    }
+    fclose(file);
+
+    const uint32_t* fileHeader = (const uint32_t*)data;
+    if (LOC_IND_RECORD_MAGIC != fileHeader[0] ||
+        LOC_IND_RECORD_VERSION != fileHeader[1]) {
+        fprintf(stderr, "%s is not a version %d record file\n",
+                fileName, LOC_IND_RECORD_VERSION);
+        free(data);
+        return NULL;
+    }
+
+    // at most one record per header's worth of bytes
+    uint32_t maxRecords = size / sizeof(locIndRecordHeader) + 1;
+    *records = (LocReplayRecord*)malloc(maxRecords * sizeof(LocReplayRecord));
+    if (NULL == *records) {
+        free(data);
+        return NULL;
+    }
+
+    *count = 0;
+    *skipped = 0;
+    long offset = 2 * sizeof(uint32_t);
+    while (offset + (long)sizeof(locIndRecordHeader) <= size) {
+        const locIndRecordHeader* header =
+            (const locIndRecordHeader*)(data + offset);
+        offset += sizeof(locIndRecordHeader);
+        if (offset + (long)header->payloadSize > size) {
+            break;
+        }
+
+        // a recording of another target's structs cannot be replayed
+        size_t eventSize = 0;
+        if (locClientGetSizeByEventIndId(header->eventId, &eventSize) &&
+            eventSize == header->payloadSize) {
+            (*records)[*count].header = header;
+            (*records)[*count].payload = data + offset;
+            (*count)++;
+        } else {
+            (*skipped)++;
+        }
+        offset += header->payloadSize;
+    }
+    return data;
+}
+
+static int compareUsec(const void* a, const void* b)
+{
+    int64_t d = *(const int64_t*)a - *(const int64_t*)b;
+    return d < 0 ? -1 : (d > 0 ? 1 : 0);
+}
+
+/* sorts latencyUsec and prints its distribution */
+static void printLatency(const char* what, int64_t* latencyUsec,
+                         uint32_t count)
+{
+    int64_t totalUsec = 0;
+    qsort(latencyUsec, count, sizeof(int64_t), compareUsec);
+    for (uint32_t i = 0; i < count; i++) {
+        totalUsec += latencyUsec[i];
+    }
+    printf("%s latency over %u: min %lld us, avg %lld us, "
+           "p50 %lld us, p95 %lld us, max %lld us\n", what, count,
+           (long long)latencyUsec[0],
+           (long long)(totalUsec / count),
+           (long long)latencyUsec[count / 2],
+           (long long)latencyUsec[count * 95 / 100],
+           (long long)latencyUsec[count - 1]);
+}
+
+int main(int argc, char** argv)
+{
+    const char* fileName = LOC_IND_RECORD_FILE;
+    bool maxSpeed = false;
+    int loops = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "mn:")) != -1) {
+        switch (opt) {
+        case 'm':
+            maxSpeed = true;
+            break;
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m] [-n loops] [record file]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (optind < argc) {
+        fileName = argv[optind];
+    }
+    if (loops < 1) {
+        loops = 1;
+    }
+
+    LocReplayRecord* records = NULL;
+    uint32_t recordCount = 0, skipped = 0, fixCount = 0, measCount = 0;
+    uint8_t* data = replayLoad(fileName, &records, &recordCount, &skipped);
+    if (NULL == data) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < recordCount; i++) {
+        if (QMI_LOC_EVENT_POSITION_REPORT_IND_V02 ==
+            records[i].header->eventId) {
+            fixCount++;
+        } else if (replayIsGpsMeasurement(records[i].header,
+                                          records[i].payload)) {
+            measCount++;
+        }
+    }
+    printf("%s: %u indications, %u fixes, %u GPS measurement reports,"
+           " %u skipped\n", fileName, recordCount, fixCount, measCount,
+           skipped);
+    if (0 == recordCount) {
+        free(records);
+        free(data);
+        return 1;
+    }
+
+    gFixMax = fixCount * loops;
+    gFixes = (LocReplayFix*)malloc((gFixMax + 1) * sizeof(LocReplayFix));
+    gLatencyUsec = (int64_t*)malloc((gFixMax + 1) * sizeof(int64_t));
+    gMeasMax = measCount * loops;
+    gMeasInjectUsec = (int64_t*)malloc((gMeasMax + 1) * sizeof(int64_t));
+    gMeasLatencyUsec = (int64_t*)malloc((gMeasMax + 1) * sizeof(int64_t));
+    if (NULL == gFixes || NULL == gLatencyUsec ||
+        NULL == gMeasInjectUsec || NULL == gMeasLatencyUsec) {
+        return 1;
+    }
+
+    // the same engine as loc_init() sets up, on a context of our own
+    loc_eng_read_config();
+    LOC_API_ADAPTER_EVENT_MASK_T event =
+        LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+        LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+        LOC_API_ADAPTER_BIT_LOCATION_SERVER_REQUEST |
+        LOC_API_ADAPTER_BIT_ASSISTANCE_DATA_REQUEST |
+        LOC_API_ADAPTER_BIT_IOCTL_REPORT |
+        LOC_API_ADAPTER_BIT_STATUS_REPORT |
+        LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+        LOC_API_ADAPTER_BIT_NI_NOTIFY_VERIFY_REQUEST;
+    LocCallbacks callbacks = {replayLocationCb, /* location_cb */
+                              replayStatusCb, /* status_cb */
+                              replaySvStatusCb, /* sv_status_cb */
+                              replayNmeaCb, /* nmea_cb */
+                              replaySetCapabilitiesCb, /* set_capabilities_cb */
+                              replayWakelockCb, /* acquire_wakelock_cb */
+                              replayWakelockCb, /* release_wakelock_cb */
+                              NULL, /* create_thread_cb */
+                              NULL, /* location_ext_parser */
+                              NULL, /* sv_ext_parser */
+                              replayRequestUtcTimeCb, /* request_utc_time_cb */
+                              };
+    ContextBase* context =
+        new ContextBase(new MsgTask("Loc_replay", false), 0,
+                        LOC_REPLAY_LIB_NAME);
+
+    if (0 != loc_eng_init(gLocEngData, &callbacks, event, context) ||
+        !locClientReplayWaitOpen(LOC_REPLAY_OPEN_TIMEOUT_MSEC)) {
+        fprintf(stderr, "LocApiV02 did not open the stand-in client\n");
+        return 1;
+    }
+    GpsMeasurementCallbacks measurementCallbacks = {
+        sizeof(GpsMeasurementCallbacks), replayMeasurementCb};
+    loc_eng_gps_measurement_init(gLocEngData, &measurementCallbacks);
+    LocPosMode params;
+    loc_eng_set_position_mode(gLocEngData, params);
+    loc_eng_start(gLocEngData);
+    replayDrain(context);
+
+    uint32_t startReqs = locClientReplayReqCount();
+    uint32_t startNew = gNewCount;
+    int64_t startCpu = cpuUsec();
+    int64_t startUsec = monotonicUsec();
+
+    for (int loop = 0; loop < loops; loop++) {
+        int64_t loopUsec = monotonicUsec();
+        int64_t firstMsec = records[0].header->timestampMsec;
+
+        for (uint32_t i = 0; i < recordCount; i++) {
+            const LocReplayRecord& record = records[i];
+
+            if (!maxSpeed) {
+                int64_t dueUsec = loopUsec +
+                    (record.header->timestampMsec - firstMsec) * 1000;
+                int64_t waitUsec = dueUsec - monotonicUsec();
+                if (waitUsec > 0) {
+                    usleep(waitUsec);
+                }
+            }
+            if (QMI_LOC_EVENT_POSITION_REPORT_IND_V02 ==
+                record.header->eventId) {
+                replayFixInjected(
+                    (const qmiLocEventPositionReportIndMsgT_v02*)record.payload);
+            } else if (replayIsGpsMeasurement(record.header, record.payload)) {
+                replayMeasurementInjected();
+            }
+            locClientReplayEventInd(record.header->eventId, record.payload);
+        }
+    }
+    replayDrain(context);
+
+    int64_t wallUsec = monotonicUsec() - startUsec;
+    int64_t cpuSpentUsec = cpuUsec() - startCpu;
+    uint32_t newCalls = gNewCount - startNew;
+    uint32_t reqs = locClientReplayReqCount() - startReqs;
+    uint32_t indications = recordCount * loops;
+    uint32_t epochs = (fixCount > 0 ? fixCount : measCount) * loops;
+
+    pthread_mutex_lock(&gReplayMutex);
+    printf("%u indications in %lld ms: %.1f/s\n", indications,
+           (long long)(wallUsec / 1000),
+           (double)indications * 1000000 / (wallUsec > 0 ? wallUsec : 1));
+    printf("callbacks: %u location, %u sv status, %u nmea, %u measurement;"
+           " %u requests\n", gLocationCbCount, gSvStatusCbCount,
+           gNmeaCbCount, gMeasCbCount, reqs);
+    if (gLatencyCount > 0) {
+        printLatency("fix", gLatencyUsec, gLatencyCount);
+    } else if (fixCount > 0) {
+        printf("fix latency: no fix reached the location callback\n");
+    }
+    uint32_t measLatencyCount = gMeasCbCount < gMeasCount ? gMeasCbCount :
+                                                            gMeasCount;
+    if (measLatencyCount > 0) {
+        printLatency("measurement report", gMeasLatencyUsec,
+                     measLatencyCount);
+    } else if (measCount > 0) {
+        printf("measurement latency: no report reached the measurement"
+               " callback\n");
+    }
+    if (epochs > 0) {
+        printf("per epoch: %.1f allocations, %lld us CPU\n",
+               (double)newCalls / epochs,
+               (long long)(cpuSpentUsec / epochs));
+    }
+    pthread_mutex_unlock(&gReplayMutex);
+
+    loc_eng_stop(gLocEngData);
+    loc_eng_gps_measurement_close(gLocEngData);
+    replayDrain(context);
+    free(gMeasLatencyUsec);
+    free(gMeasInjectUsec);
+    free(gLatencyUsec);
+    free(gFixes);
+    free(records);
+    free(data);
+    return 0;
+}
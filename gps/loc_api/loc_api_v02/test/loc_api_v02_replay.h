@@ -0,0 +1,76 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_API_V02_REPLAY_H
+#define LOC_API_V02_REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Name of the library holding LocApiV02 over the stand-in QMI_LOC client.
+   ContextBase loads it as its LBS proxy, which hands out that LocApiV02. */
+#define LOC_REPLAY_LIB_NAME "libloc_api_v02_replay.so"
+
+/* Waits up to timeoutMsec for LocApiV02 to open the stand-in client.
+   Returns true once it is open. */
+bool locClientReplayWaitOpen(uint32_t timeoutMsec);
+
+/* Delivers an event indication to the open client, on the calling thread,
+   as the QMI client layer does after decoding it. Returns false if no
+   client is open. */
+bool locClientReplayEventInd(uint32_t eventIndId, const void* pEventInd);
+
+/* Number of requests LocApiV02 sent to the stand-in client */
+uint32_t locClientReplayReqCount(void);
+
+/* XTRA parts (QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02) are acked with
+   their part number. With delayUsec 0 and reverse false the ack comes
+   before locClientSendReq() returns; otherwise a service thread sends it
+   delayUsec after the request, and with reverse set all acks pending when
+   the oldest one is due go out newest first. Also clears the drops and
+   the part log. */
+void locClientReplaySetXtraAck(uint32_t delayUsec, bool reverse);
+
+/* The next count requests for XTRA part partNum get no ack. Returns false
+   if too many drops are set already. */
+bool locClientReplayDropXtraAck(uint16_t partNum, uint32_t count);
+
+/* Part numbers of the XTRA requests since locClientReplaySetXtraAck(), in
+   the order they were sent; copies up to maxParts of them to pParts and
+   returns how many there were. */
+uint32_t locClientReplayXtraParts(uint16_t* pParts, uint32_t maxParts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOC_API_V02_REPLAY_H */
@@ -0,0 +1,478 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Stand-in for loc_api_v02_client.c: the same locClient API with no QMI
+   service behind it. Every request succeeds, and a request that has a
+   response indication gets one with status eQMI_LOC_SUCCESS_V02 and no
+   optional fields before locClientSendReq() returns. Event indications
+   come from the replay through locClientReplayEventInd().
+   XTRA parts (QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02) are acked with
+   their part number, and can be acked late, out of order or not at all,
+   see locClientReplaySetXtraAck(). */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_replay_client"
+
+#include "loc_api_v02_client.h"
+#include "loc_util_log.h"
+#include "loc_api_v02_replay.h"
+
+typedef struct
+{
+  locClientCallbacksType callbacks;
+  void* pClientCookie;
+  locClientEventMaskType eventRegMask;
+  bool open;
+} locClientReplayDataType;
+
+static locClientReplayDataType gReplayClient;
+static uint32_t gReplayReqCount;
+static pthread_mutex_t gReplayMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gReplayOpenCond = PTHREAD_COND_INITIALIZER;
+
+/* XTRA part acks. Late ones are held in gXtraAckPending, oldest first,
+   until the service thread sends them. */
+#define REPLAY_XTRA_ACK_PENDING_MAX  (16)
+#define REPLAY_XTRA_DROP_MAX         (8)
+#define REPLAY_XTRA_PART_LOG_MAX     (1024)
+
+typedef struct
+{
+  uint16_t partNum;
+  uint64_t dueUsec;
+} locClientReplayXtraAckType;
+
+typedef struct
+{
+  uint16_t partNum;
+  uint32_t count;
+} locClientReplayXtraDropType;
+
+static uint32_t gXtraAckDelayUsec;
+static bool gXtraAckReverse;
+static locClientReplayXtraDropType gXtraDrop[REPLAY_XTRA_DROP_MAX];
+static locClientReplayXtraAckType gXtraAckPending[REPLAY_XTRA_ACK_PENDING_MAX];
+static uint32_t gXtraAckPendingCount;
+static uint16_t gXtraPartLog[REPLAY_XTRA_PART_LOG_MAX];
+static uint32_t gXtraPartCount;
+static bool gXtraAckThreadStarted;
+static pthread_cond_t gXtraAckCond;
+
+static uint64_t replayNowUsec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void replaySendXtraAck(locClientRespIndCbType respCallback,
+                              void* pClientCookie, uint16_t partNum)
+{
+  qmiLocInjectPredictedOrbitsDataIndMsgT_v02 ind;
+  locClientRespIndUnionType respIndUnion;
+
+  memset(&ind, 0, sizeof(ind));
+  ind.status = eQMI_LOC_SUCCESS_V02;
+  ind.partNum_valid = 1;
+  ind.partNum = partNum;
+  respIndUnion.pInjectPredictedOrbitsDataInd = &ind;
+  respCallback((locClientHandleType)&gReplayClient,
+               QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_IND_V02,
+               respIndUnion, pClientCookie);
+}
+
+/* Sends the late XTRA acks as they fall due. With gXtraAckReverse, all
+   acks pending when the oldest one is due go out newest first. */
+static void* replayXtraAckThread(void* arg)
+{
+  locClientReplayXtraAckType due[REPLAY_XTRA_ACK_PENDING_MAX];
+  (void)arg;
+
+  pthread_mutex_lock(&gReplayMutex);
+  while (true)
+  {
+    if (0 == gXtraAckPendingCount)
+    {
+      pthread_cond_wait(&gXtraAckCond, &gReplayMutex);
+      continue;
+    }
+
+    uint64_t now = replayNowUsec();
+    if (gXtraAckPending[0].dueUsec > now)
+    {
+      uint64_t waitUsec = gXtraAckPending[0].dueUsec - now;
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += waitUsec / 1000000;
+      deadline.tv_nsec += (waitUsec % 1000000) * 1000;
+      if (deadline.tv_nsec >= 1000000000)
+      {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&gXtraAckCond, &gReplayMutex, &deadline);
+      continue;
+    }
+
+    uint32_t count = 0;
+    if (gXtraAckReverse)
+    {
+      while (gXtraAckPendingCount > 0)
+      {
+        due[count++] = gXtraAckPending[--gXtraAckPendingCount];
+      }
+    }
+    else
+    {
+      while (count < gXtraAckPendingCount &&
+             gXtraAckPending[count].dueUsec <= now)
+      {
+        due[count] = gXtraAckPending[count];
+        count++;
+      }
+      gXtraAckPendingCount -= count;
+      memmove(gXtraAckPending, gXtraAckPending + count,
+              gXtraAckPendingCount * sizeof(gXtraAckPending[0]));
+    }
+
+    locClientRespIndCbType respCallback =
+      gReplayClient.open ? gReplayClient.callbacks.respIndCb : NULL;
+    void* pClientCookie = gReplayClient.pClientCookie;
+    pthread_mutex_unlock(&gReplayMutex);
+
+    for (uint32_t i = 0; i < count && NULL != respCallback; i++)
+    {
+      replaySendXtraAck(respCallback, pClientCookie, due[i].partNum);
+    }
+
+    pthread_mutex_lock(&gReplayMutex);
+  }
+
+  return NULL;
+}
+
+/* Logs an XTRA part request and tells how to ack it, with gReplayMutex
+   held. Returns true if the ack goes out before locClientSendReq()
+   returns, false if it is dropped or left to the service thread. */
+static bool replayXtraPartLocked(uint16_t partNum)
+{
+  if (gXtraPartCount < REPLAY_XTRA_PART_LOG_MAX)
+  {
+    gXtraPartLog[gXtraPartCount] = partNum;
+  }
+  gXtraPartCount++;
+
+  for (int i = 0; i < REPLAY_XTRA_DROP_MAX; i++)
+  {
+    if (gXtraDrop[i].count > 0 && partNum == gXtraDrop[i].partNum)
+    {
+      gXtraDrop[i].count--;
+      LOC_LOGD("%s:%d]: dropping ack of XTRA part %u\n",
+               __func__, __LINE__, partNum);
+      return false;
+    }
+  }
+
+  if (0 == gXtraAckDelayUsec && !gXtraAckReverse)
+  {
+    return true;
+  }
+
+  if (gXtraAckPendingCount >= REPLAY_XTRA_ACK_PENDING_MAX)
+  {
+    LOC_LOGE("%s:%d]: too many XTRA acks pending, dropping part %u\n",
+             __func__, __LINE__, partNum);
+    return false;
+  }
+  if (!gXtraAckThreadStarted)
+  {
+    pthread_condattr_t attr;
+    pthread_t thread;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gXtraAckCond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (0 != pthread_create(&thread, NULL, replayXtraAckThread, NULL))
+    {
+      LOC_LOGE("%s:%d]: cannot start the XTRA ack thread\n",
+               __func__, __LINE__);
+      return false;
+    }
+    pthread_detach(thread);
+    gXtraAckThreadStarted = true;
+  }
+  gXtraAckPending[gXtraAckPendingCount].partNum = partNum;
+  gXtraAckPending[gXtraAckPendingCount].dueUsec =
+    replayNowUsec() + gXtraAckDelayUsec;
+  gXtraAckPendingCount++;
+  pthread_cond_signal(&gXtraAckCond);
+  return false;
+}
+
+locClientStatusEnumType locClientOpen (
+  locClientEventMaskType         eventRegMask,
+  const locClientCallbacksType*  pLocClientCallbacks,
+  locClientHandleType*           pLocClientHandle,
+  const void*                    pClientCookie)
+{
+  if (NULL == pLocClientCallbacks || NULL == pLocClientHandle ||
+      NULL == pLocClientCallbacks->eventIndCb)
+  {
+    return eLOC_CLIENT_FAILURE_INVALID_PARAMETER;
+  }
+
+  pthread_mutex_lock(&gReplayMutex);
+  if (gReplayClient.open)
+  {
+    pthread_mutex_unlock(&gReplayMutex);
+    LOC_LOGE("%s:%d]: only one client is supported\n", __func__, __LINE__);
+    return eLOC_CLIENT_FAILURE_INTERNAL;
+  }
+  gReplayClient.callbacks = *pLocClientCallbacks;
+  gReplayClient.pClientCookie = (void*)pClientCookie;
+  gReplayClient.eventRegMask = eventRegMask;
+  gReplayClient.open = true;
+  *pLocClientHandle = (locClientHandleType)&gReplayClient;
+  pthread_cond_broadcast(&gReplayOpenCond);
+  pthread_mutex_unlock(&gReplayMutex);
+
+  return eLOC_CLIENT_SUCCESS;
+}
+
+locClientStatusEnumType locClientClose(
+  locClientHandleType* pLocClientHandle)
+{
+  if (NULL == pLocClientHandle ||
+      (locClientHandleType)&gReplayClient != *pLocClientHandle)
+  {
+    return eLOC_CLIENT_FAILURE_INVALID_HANDLE;
+  }
+
+  pthread_mutex_lock(&gReplayMutex);
+  memset(&gReplayClient, 0, sizeof(gReplayClient));
+  pthread_mutex_unlock(&gReplayMutex);
+
+  *pLocClientHandle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+  return eLOC_CLIENT_SUCCESS;
+}
+
+locClientStatusEnumType locClientSendReq(
+  locClientHandleType      handle,
+  uint32_t                 reqId,
+  locClientReqUnionType    reqPayload )
+{
+  locClientRespIndCbType respCallback;
+  void* pClientCookie;
+  size_t respIndSize = 0;
+  bool xtraPart = false, xtraAckNow = false;
+  uint16_t xtraPartNum = 0;
+
+  pthread_mutex_lock(&gReplayMutex);
+  if ((locClientHandleType)&gReplayClient != handle || !gReplayClient.open)
+  {
+    pthread_mutex_unlock(&gReplayMutex);
+    return eLOC_CLIENT_FAILURE_INVALID_HANDLE;
+  }
+  gReplayReqCount++;
+  if (QMI_LOC_REG_EVENTS_REQ_V02 == reqId && NULL != reqPayload.pRegEventsReq)
+  {
+    gReplayClient.eventRegMask =
+      (locClientEventMaskType)reqPayload.pRegEventsReq->eventRegMask;
+  }
+  if (QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02 == reqId &&
+      NULL != reqPayload.pInjectPredictedOrbitsDataReq)
+  {
+    xtraPart = true;
+    xtraPartNum = reqPayload.pInjectPredictedOrbitsDataReq->partNum;
+    xtraAckNow = replayXtraPartLocked(xtraPartNum);
+  }
+  respCallback = gReplayClient.callbacks.respIndCb;
+  pClientCookie = gReplayClient.pClientCookie;
+  pthread_mutex_unlock(&gReplayMutex);
+
+  if (xtraPart)
+  {
+    if (xtraAckNow && NULL != respCallback)
+    {
+      replaySendXtraAck(respCallback, pClientCookie, xtraPartNum);
+    }
+  }
+  // QMI_LOC response indications share the id of their request
+  else if (NULL != respCallback &&
+      locClientGetSizeByRespIndId(reqId, &respIndSize))
+  {
+    // all zero is status eQMI_LOC_SUCCESS_V02 with no optional fields
+    void* respInd = calloc(1, respIndSize);
+    if (NULL != respInd)
+    {
+      locClientRespIndUnionType respIndUnion;
+      respIndUnion.pDeleteAssistDataInd =
+        (qmiLocDeleteAssistDataIndMsgT_v02*)respInd;
+      respCallback(handle, reqId, respIndUnion, pClientCookie);
+      free(respInd);
+    }
+  }
+
+  return eLOC_CLIENT_SUCCESS;
+}
+
+locClientStatusEnumType locClientSupportMsgCheck(
+     locClientHandleType      handle,
+     const uint32_t*          msgArray,
+     uint32_t                 msgArrayLength,
+     uint64_t*                supportedMsg)
+{
+  if ((locClientHandleType)&gReplayClient != handle || NULL == supportedMsg)
+  {
+    return eLOC_CLIENT_FAILURE_GENERAL;
+  }
+  // no optional messages, recordings of those replay as plain events
+  *supportedMsg = 0;
+  return eLOC_CLIENT_SUCCESS;
+}
+
+bool locClientRegisterEventMask(
+    locClientHandleType clientHandle,
+    locClientEventMaskType eventRegMask)
+{
+  locClientReqUnionType reqUnion;
+  qmiLocRegEventsReqMsgT_v02 regEventsReq;
+
+  memset(&regEventsReq, 0, sizeof(regEventsReq));
+  regEventsReq.eventRegMask = eventRegMask;
+  reqUnion.pRegEventsReq = &regEventsReq;
+
+  return eLOC_CLIENT_SUCCESS ==
+    locClientSendReq(clientHandle, QMI_LOC_REG_EVENTS_REQ_V02, reqUnion);
+}
+
+bool locClientReplayWaitOpen(uint32_t timeoutMsec)
+{
+  struct timespec deadline;
+  int rc = 0;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeoutMsec / 1000;
+  deadline.tv_nsec += (timeoutMsec % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock(&gReplayMutex);
+  while (!gReplayClient.open && ETIMEDOUT != rc)
+  {
+    rc = pthread_cond_timedwait(&gReplayOpenCond, &gReplayMutex, &deadline);
+  }
+  bool open = gReplayClient.open;
+  pthread_mutex_unlock(&gReplayMutex);
+
+  return open;
+}
+
+bool locClientReplayEventInd(uint32_t eventIndId, const void* pEventInd)
+{
+  locClientEventIndCbType eventCallback;
+  void* pClientCookie;
+  locClientEventIndUnionType eventIndUnion;
+
+  pthread_mutex_lock(&gReplayMutex);
+  eventCallback = gReplayClient.open ? gReplayClient.callbacks.eventIndCb : NULL;
+  pClientCookie = gReplayClient.pClientCookie;
+  pthread_mutex_unlock(&gReplayMutex);
+
+  if (NULL == eventCallback)
+  {
+    return false;
+  }
+
+  // every member of the union is a pointer to the indication struct
+  eventIndUnion.pPositionReportEvent =
+    (qmiLocEventPositionReportIndMsgT_v02*)pEventInd;
+  eventCallback((locClientHandleType)&gReplayClient, eventIndId,
+                eventIndUnion, pClientCookie);
+  return true;
+}
+
+uint32_t locClientReplayReqCount(void)
+{
+  pthread_mutex_lock(&gReplayMutex);
+  uint32_t count = gReplayReqCount;
+  pthread_mutex_unlock(&gReplayMutex);
+  return count;
+}
+
+void locClientReplaySetXtraAck(uint32_t delayUsec, bool reverse)
+{
+  pthread_mutex_lock(&gReplayMutex);
+  gXtraAckDelayUsec = delayUsec;
+  gXtraAckReverse = reverse;
+  memset(gXtraDrop, 0, sizeof(gXtraDrop));
+  gXtraPartCount = 0;
+  pthread_mutex_unlock(&gReplayMutex);
+}
+
+bool locClientReplayDropXtraAck(uint16_t partNum, uint32_t count)
+{
+  bool added = false;
+
+  pthread_mutex_lock(&gReplayMutex);
+  for (int i = 0; i < REPLAY_XTRA_DROP_MAX && !added; i++)
+  {
+    if (0 == gXtraDrop[i].count)
+    {
+      gXtraDrop[i].partNum = partNum;
+      gXtraDrop[i].count = count;
+      added = true;
+    }
+  }
+  pthread_mutex_unlock(&gReplayMutex);
+
+  return added;
+}
+
+uint32_t locClientReplayXtraParts(uint16_t* pParts, uint32_t maxParts)
+{
+  pthread_mutex_lock(&gReplayMutex);
+  uint32_t count = gXtraPartCount;
+  for (uint32_t i = 0;
+       NULL != pParts && i < count && i < maxParts && i < REPLAY_XTRA_PART_LOG_MAX;
+       i++)
+  {
+    pParts[i] = gXtraPartLog[i];
+  }
+  pthread_mutex_unlock(&gReplayMutex);
+  return count;
+}
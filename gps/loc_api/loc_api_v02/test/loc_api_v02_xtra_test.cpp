@@ -0,0 +1,230 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* LocApiV02::setXtraData() against the stand-in QMI_LOC client: parts
+   acked in order for every window size, acked newest first, an ack lost
+   and the part resent, and a part never acked. Then the injection time
+   of an XTRA file per window size, with each ack ackDelayUsec after its
+   part as the modem would take.
+   Usage: loc_api_v02_xtra_test [ackDelayUsec] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <MsgTask.h>
+#include <LocApiV02.h>
+#include "loc_api_v02_replay.h"
+
+#define TEST_XTRA_WINDOW_MAX    (4)
+#define TEST_XTRA_PART_LEN      QMI_LOC_MAX_PREDICTED_ORBITS_PART_LEN_V02
+#define TEST_XTRA_SIZE          (12 * TEST_XTRA_PART_LEN + 100)
+#define BENCH_XTRA_SIZE         (48 * TEST_XTRA_PART_LEN)
+#define BENCH_ACK_DELAY_USEC    (2000)
+
+static int gFailures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #cond); \
+            gFailures++; \
+        } \
+    } while (0)
+
+// open() is for the adapters only
+class XtraTestApi : public LocApiV02 {
+public:
+    inline XtraTestApi(const MsgTask* msgTask) :
+        LocApiV02(msgTask, 0, NULL) {}
+    using LocApiV02::open;
+};
+
+static long long nowUsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int partsOf(int length)
+{
+    return (length + TEST_XTRA_PART_LEN - 1) / TEST_XTRA_PART_LEN;
+}
+
+// the parts sent since the last locClientReplaySetXtraAck()
+static std::vector<uint16_t> sentParts()
+{
+    uint32_t count = locClientReplayXtraParts(NULL, 0);
+    std::vector<uint16_t> parts(count);
+    if (count > 0) {
+        locClientReplayXtraParts(&parts[0], count);
+    }
+    return parts;
+}
+
+static int timesSent(const std::vector<uint16_t>& parts, uint16_t part)
+{
+    int times = 0;
+    for (size_t i = 0; i < parts.size(); i++) {
+        times += part == parts[i];
+    }
+    return times;
+}
+
+// true if the parts sent end with from..to in order
+static bool endsWithRun(const std::vector<uint16_t>& parts, int from, int to)
+{
+    int run = to - from + 1;
+    if (run <= 0 || (int)parts.size() < run) {
+        return false;
+    }
+    for (int i = 0; i < run; i++) {
+        if (parts[parts.size() - run + i] != from + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testInOrder(XtraTestApi* api, char* xtra)
+{
+    int total = partsOf(TEST_XTRA_SIZE);
+    for (uint32_t window = 1; window <= TEST_XTRA_WINDOW_MAX; window++) {
+        api->setXtraInjectWindow(window);
+        locClientReplaySetXtraAck(window > 1 ? 500 : 0, false);
+        CHECK(LOC_API_ADAPTER_ERR_SUCCESS ==
+              api->setXtraData(xtra, TEST_XTRA_SIZE));
+        std::vector<uint16_t> parts = sentParts();
+        CHECK(total == (int)parts.size() && endsWithRun(parts, 1, total));
+    }
+}
+
+// every window of acks comes back newest first; nothing is resent
+static void testOutOfOrder(XtraTestApi* api, char* xtra)
+{
+    int total = partsOf(TEST_XTRA_SIZE);
+    api->setXtraInjectWindow(TEST_XTRA_WINDOW_MAX);
+    locClientReplaySetXtraAck(1000, true);
+    CHECK(LOC_API_ADAPTER_ERR_SUCCESS == api->setXtraData(xtra, TEST_XTRA_SIZE));
+    std::vector<uint16_t> parts = sentParts();
+    CHECK(total == (int)parts.size() && endsWithRun(parts, 1, total));
+}
+
+// the ack of part 5 is lost once: the parts in flight behind it are
+// acked, but injection resumes from part 5, one part at a time
+static void testMissingPart(XtraTestApi* api, char* xtra)
+{
+    int total = partsOf(TEST_XTRA_SIZE);
+    for (uint32_t window = 1; window <= TEST_XTRA_WINDOW_MAX;
+         window += TEST_XTRA_WINDOW_MAX - 1) {
+        api->setXtraInjectWindow(window);
+        locClientReplaySetXtraAck(500, false);
+        CHECK(locClientReplayDropXtraAck(5, 1));
+        CHECK(LOC_API_ADAPTER_ERR_SUCCESS ==
+              api->setXtraData(xtra, TEST_XTRA_SIZE));
+        std::vector<uint16_t> parts = sentParts();
+        CHECK(2 == timesSent(parts, 5));
+        CHECK(1 == timesSent(parts, 4));
+        // first pass up to the end of the window, then 5..total again
+        CHECK((int)(4 + window + total - 4) == (int)parts.size());
+        CHECK(endsWithRun(parts, 5, total));
+    }
+}
+
+// the ack of part 5 is lost on every try: nothing after it is taken
+static void testPartNeverAcked(XtraTestApi* api, char* xtra)
+{
+    api->setXtraInjectWindow(2);
+    locClientReplaySetXtraAck(500, false);
+    CHECK(locClientReplayDropXtraAck(5, 3));
+    CHECK(LOC_API_ADAPTER_ERR_SUCCESS != api->setXtraData(xtra, TEST_XTRA_SIZE));
+    std::vector<uint16_t> parts = sentParts();
+    CHECK(3 == timesSent(parts, 5));
+    CHECK(!parts.empty() && 5 == parts.back());
+    CHECK(1 == timesSent(parts, 6));
+}
+
+static void benchWindows(XtraTestApi* api, uint32_t ackDelayUsec)
+{
+    char* xtra = (char*)malloc(BENCH_XTRA_SIZE);
+    if (NULL == xtra) {
+        CHECK(NULL != xtra);
+        return;
+    }
+    for (int i = 0; i < BENCH_XTRA_SIZE; i++) {
+        xtra[i] = (char)(i * 31);
+    }
+
+    for (uint32_t window = 1; window <= TEST_XTRA_WINDOW_MAX; window++) {
+        api->setXtraInjectWindow(window);
+        locClientReplaySetXtraAck(ackDelayUsec, false);
+        long long start = nowUsec();
+        CHECK(LOC_API_ADAPTER_ERR_SUCCESS ==
+              api->setXtraData(xtra, BENCH_XTRA_SIZE));
+        long long elapsed = nowUsec() - start;
+        printf("bench: window %u, %d parts acked after %u us: %lld ms,"
+               " %lld us per part\n", window, partsOf(BENCH_XTRA_SIZE),
+               ackDelayUsec, elapsed / 1000,
+               elapsed / partsOf(BENCH_XTRA_SIZE));
+    }
+    free(xtra);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t ackDelayUsec = argc > 1 ? (uint32_t)atoi(argv[1]) :
+                                       BENCH_ACK_DELAY_USEC;
+
+    MsgTask* msgTask = new MsgTask("Loc_xtra_test", false);
+    XtraTestApi* api = new XtraTestApi(msgTask);
+    if (LOC_API_ADAPTER_ERR_SUCCESS != api->open(0) ||
+        !locClientReplayWaitOpen(1000)) {
+        fprintf(stderr, "cannot open LocApiV02\n");
+        return 1;
+    }
+
+    static char xtra[TEST_XTRA_SIZE];
+    for (int i = 0; i < TEST_XTRA_SIZE; i++) {
+        xtra[i] = (char)i;
+    }
+
+    testInOrder(api, xtra);
+    testOutOfOrder(api, xtra);
+    testMissingPart(api, xtra);
+    testPartNeverAcked(api, xtra);
+    benchWindows(api, ackDelayUsec);
+
+    delete api;
+    msgTask->destroy();
+
+    printf("%s: %d failures\n", 0 == gFailures ? "PASS" : "FAIL", gFailures);
+    return 0 == gFailures ? 0 : 1;
+}
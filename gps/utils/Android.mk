@@ -21,6 +21,7 @@ LOCAL_SRC_FILES += \
     LocHeap.cpp \
     LocTimer.cpp \
     LocThread.cpp \
+    LocWorkerPool.cpp \
     MsgTask.cpp \
     loc_misc_utils.cpp
 
@@ -49,10 +50,12 @@ LOCAL_COPY_HEADERS:= \
    MsgTask.h \
    LocHeap.h \
    LocThread.h \
+   LocWorkerPool.h \
    LocTimer.h \
    loc_target.h \
    loc_timer.h \
    LocSharedLock.h \
+   LocSeqLock.h \
    platform_lib_abstractions/platform_lib_includes.h \
    platform_lib_abstractions/platform_lib_time.h \
    platform_lib_abstractions/platform_lib_macros.h \
@@ -66,4 +69,6 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(LOCAL_PATH)/test/Android.mk
 endif # not BUILD_TINY_ANDROID
@@ -0,0 +1,76 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_SEQ_LOCK__
+#define __LOC_SEQ_LOCK__
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+// This is a utility for a single value that is written now and then but
+// read often, possibly from many threads. Readers never block: they copy
+// the value and simply retry if a writer changed it in the meantime.
+// Writers are serialized among themselves with a mutex. T must be a plain
+// C type that can be copied with memcpy.
+template <typename T>
+class LocSeqLock {
+    uint32_t mSeq;
+    pthread_mutex_t mWriteMutex;
+    T mValue;
+public:
+    inline LocSeqLock() : mSeq(0) {
+        pthread_mutex_init(&mWriteMutex, NULL);
+        memset(&mValue, 0, sizeof(mValue));
+    }
+    inline ~LocSeqLock() { pthread_mutex_destroy(&mWriteMutex); }
+
+    // replaces the value; an odd sequence number marks a write in progress
+    inline void write(const T& value) {
+        pthread_mutex_lock(&mWriteMutex);
+        uint32_t seq = __atomic_load_n(&mSeq, __ATOMIC_RELAXED);
+        __atomic_store_n(&mSeq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(&mValue, &value, sizeof(mValue));
+        __atomic_store_n(&mSeq, seq + 2, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&mWriteMutex);
+    }
+
+    // copies out a consistent snapshot of the value
+    inline void read(T& value) const {
+        uint32_t before, after;
+        do {
+            before = __atomic_load_n(&mSeq, __ATOMIC_ACQUIRE);
+            memcpy(&value, &mValue, sizeof(value));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&mSeq, __ATOMIC_RELAXED);
+        } while ((before & 1) || before != after);
+    }
+};
+
+#endif //__LOC_SEQ_LOCK__
@@ -26,23 +26,36 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_LocThread"
+
 #include <LocThread.h>
 #include <string.h>
+#include <errno.h>
+#include <sched.h>
 #include <pthread.h>
+#include <log_util.h>
+
+// process wide thread counts, see LocThread::getCreatedCount()
+static uint32_t sCreatedCount = 0;
+static uint32_t sLiveCount = 0;
 
 class LocThreadDelegate {
     LocRunnable* mRunnable;
     bool mJoinable;
+    LocThreadSched mSched;
     pthread_t mThandle;
     pthread_mutex_t mMutex;
     int mRefCount;
     ~LocThreadDelegate();
     LocThreadDelegate(LocThread::tCreate creator, const char* threadName,
-                      LocRunnable* runnable, bool joinable);
+                      LocRunnable* runnable, bool joinable,
+                      const LocThreadSched& sched);
     void destroy();
 public:
     static LocThreadDelegate* create(LocThread::tCreate creator,
-            const char* threadName, LocRunnable* runnable, bool joinable);
+            const char* threadName, LocRunnable* runnable, bool joinable,
+            const LocThreadSched& sched);
     void stop();
     // bye() is for the parent thread to go away. if joinable,
     // parent must stop the spawned thread, join, and then
@@ -63,8 +76,9 @@ public:
 // must be set to  indicate failure, e.g. mRunnable, and
 // threashold approprietly for destroy(), e.g. mRefCount.
 LocThreadDelegate::LocThreadDelegate(LocThread::tCreate creator,
-        const char* threadName, LocRunnable* runnable, bool joinable) :
-    mRunnable(runnable), mJoinable(joinable), mThandle(NULL),
+        const char* threadName, LocRunnable* runnable, bool joinable,
+        const LocThreadSched& sched) :
+    mRunnable(runnable), mJoinable(joinable), mSched(sched), mThandle(NULL),
     mMutex(PTHREAD_MUTEX_INITIALIZER), mRefCount(2) {
 
     // set up thread name, if nothing is passed in
@@ -82,6 +96,8 @@ LocThreadDelegate::LocThreadDelegate(LocThread::tCreate creator,
     }
 
     if (mThandle) {
+        __atomic_add_fetch(&sCreatedCount, 1, __ATOMIC_RELAXED);
+
         // set thread name
         char lname[16];
         int len = sizeof(lname) - 1;
@@ -109,10 +125,12 @@ LocThreadDelegate::~LocThreadDelegate() {
 
 // factory method so that we could return NULL upon failure
 LocThreadDelegate* LocThreadDelegate::create(LocThread::tCreate creator,
-        const char* threadName, LocRunnable* runnable, bool joinable) {
+        const char* threadName, LocRunnable* runnable, bool joinable,
+        const LocThreadSched& sched) {
     LocThreadDelegate* thread = NULL;
     if (runnable) {
-        thread = new LocThreadDelegate(creator, threadName, runnable, joinable);
+        thread = new LocThreadDelegate(creator, threadName, runnable,
+                                       joinable, sched);
         if (thread && !thread->isRunning()) {
             thread->destroy();
             thread = NULL;
@@ -177,8 +195,13 @@ void* LocThreadDelegate::threadMain(void* arg) {
 
     if (locThread) {
         LocRunnable* runnable = locThread->mRunnable;
+        __atomic_add_fetch(&sLiveCount, 1, __ATOMIC_RELAXED);
 
         if (runnable) {
+            if (!locThread->mSched.isDefault()) {
+                LocThread::applySched(locThread->mSched);
+            }
+
             if (locThread->isRunning()) {
                 runnable->prerun();
             }
@@ -196,6 +219,7 @@ void* LocThreadDelegate::threadMain(void* arg) {
             delete runnable;
         }
         locThread->destroy();
+        __atomic_sub_fetch(&sLiveCount, 1, __ATOMIC_RELAXED);
     }
 
     return NULL;
@@ -211,7 +235,8 @@ LocThread::~LocThread() {
 bool LocThread::start(tCreate creator, const char* threadName, LocRunnable* runnable, bool joinable) {
     bool success = false;
     if (!mThread) {
-        mThread = LocThreadDelegate::create(creator, threadName, runnable, joinable);
+        mThread = LocThreadDelegate::create(creator, threadName, runnable,
+                                            joinable, mSched);
         // true only if thread is created successfully
         success = (NULL != mThread);
     }
@@ -225,6 +250,51 @@ void LocThread::stop() {
     }
 }
 
+// sched_setscheduler() and sched_setaffinity() with pid 0 act on the
+// calling thread only, which is what we want; bionic does not provide
+// pthread_setaffinity_np() to do this from the parent.
+bool LocThread::applySched(const LocThreadSched& sched) {
+    bool success = true;
+
+    if (sched.fifoPriority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = sched.fifoPriority;
+        if (sched_setscheduler(0, SCHED_FIFO, &param)) {
+            LOC_LOGE("%s: SCHED_FIFO priority %d failed: %s", __func__,
+                     sched.fifoPriority, strerror(errno));
+            success = false;
+        }
+    }
+
+    if (sched.cpuMask) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 32; cpu++) {
+            if (sched.cpuMask & (1U << cpu)) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(cpus), &cpus)) {
+            LOC_LOGE("%s: cpu mask 0x%x failed: %s", __func__,
+                     sched.cpuMask, strerror(errno));
+            success = false;
+        }
+    }
+
+    LOC_LOGD("%s: priority %d cpu mask 0x%x %s", __func__, sched.fifoPriority,
+             sched.cpuMask, success ? "applied" : "partially applied");
+    return success;
+}
+
+uint32_t LocThread::getCreatedCount() {
+    return __atomic_load_n(&sCreatedCount, __ATOMIC_RELAXED);
+}
+
+uint32_t LocThread::getLiveCount() {
+    return __atomic_load_n(&sLiveCount, __ATOMIC_RELAXED);
+}
+
 #ifdef __LOC_DEBUG__
 
 #include <stdio.h>
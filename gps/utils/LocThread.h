@@ -30,6 +30,7 @@
 #define __LOC_THREAD__
 
 #include <stddef.h>
+#include <stdint.h>
 #include <pthread.h>
 
 // abstract class to be implemented by client to provide a runnable class
@@ -57,12 +58,29 @@ public:
 // opaque class to provide service implementation.
 class LocThreadDelegate;
 
+// scheduling hints applied by the spawned thread to itself before
+// LocRunnable::prerun() is called.
+// fifoPriority - 0 keeps the default (SCHED_OTHER) policy; 1..99 runs
+//                the thread as SCHED_FIFO with that priority. Meant for
+//                latency sensitive paths only, such as position reports.
+// cpuMask      - 0 leaves the affinity alone; otherwise bit n allows the
+//                thread on cpu n. This is a hint, failures are logged and
+//                the thread keeps running with the default affinity.
+struct LocThreadSched {
+    int fifoPriority;
+    uint32_t cpuMask;
+    inline LocThreadSched(int prio = 0, uint32_t mask = 0) :
+        fifoPriority(prio), cpuMask(mask) {}
+    inline bool isDefault() const { return 0 == fifoPriority && 0 == cpuMask; }
+};
+
 // A utility class to create a thread and run LocRunnable
 // caller passes in.
 class LocThread {
     LocThreadDelegate* mThread;
+    LocThreadSched mSched;
 public:
-    inline LocThread() : mThread(NULL) {}
+    inline LocThread() : mThread(NULL), mSched() {}
     virtual ~LocThread();
 
     typedef pthread_t (*tCreate)(const char* name, void* (*start)(void*), void* arg);
@@ -87,6 +105,20 @@ public:
 
     // thread status check
     inline bool isRunning() { return NULL != mThread; }
+
+    // scheduling hints for the thread to be created by the next start().
+    // Has no effect on a thread that is already running; use
+    // applySched() from within that thread instead.
+    inline void setSched(const LocThreadSched& sched) { mSched = sched; }
+
+    // applies the scheduling hints to the calling thread.
+    // Returns true if all of the requested hints took effect.
+    static bool applySched(const LocThreadSched& sched);
+
+    // number of threads ever created through LocThread, and the number
+    // of those still alive, for the process.
+    static uint32_t getCreatedCount();
+    static uint32_t getLiveCount();
 };
 
 #endif //__LOC_THREAD__
@@ -0,0 +1,219 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_WorkerPool"
+
+#include <stdio.h>
+#include <LocWorkerPool.h>
+#include <msg_q.h>
+#include <linked_list.h>
+#include <log_util.h>
+#include <loc_log.h>
+
+#define LOC_SHARED_POOL_WORKERS 2
+
+static void LocMsgDestroy(void* msg) {
+    delete (LocMsg*)msg;
+}
+
+class LocPoolWorker : public LocRunnable {
+    const LocWorkerPool* mPool;
+public:
+    inline LocPoolWorker(const LocWorkerPool* pool) :
+        LocRunnable(), mPool(pool) {}
+    virtual bool run();
+};
+
+bool LocPoolWorker::run() {
+    LocMsg* msg;
+    msq_q_err_type result = msg_q_rcv((void*)mPool->mQ, (void **)&msg);
+    if (eMSG_Q_SUCCESS != result) {
+        // unblocked by the pool going away
+        LOC_LOGD("%s:%d] worker exits: %s\n", __func__, __LINE__,
+                 loc_get_msg_q_status(result));
+        return false;
+    }
+
+    msg->log();
+    msg->proc();
+
+    delete msg;
+    __atomic_add_fetch(&mPool->mRunCount, 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+LocWorkerPool::LocWorkerPool(const char* name, int workerCount,
+                             const LocThreadSched& sched) :
+    mQ(msg_q_init2()), mThreads(NULL), mWorkerCount(0), mName(name),
+    mPostedCount(0), mRunCount(0) {
+    if (!name) {
+        name = mName = "LocWorker";
+    }
+    if (mQ && workerCount > 0) {
+        mThreads = new LocThread[workerCount];
+        for (int i = 0; i < workerCount; i++) {
+            char threadName[16];
+            snprintf(threadName, sizeof(threadName), "%s-%d", name, i);
+            LocPoolWorker* worker = new LocPoolWorker(this);
+            mThreads[mWorkerCount].setSched(sched);
+            if (mThreads[mWorkerCount].start(threadName, worker)) {
+                mWorkerCount++;
+            } else {
+                LOC_LOGE("%s: failed to start %s", __func__, threadName);
+                delete worker;
+            }
+        }
+    }
+    LOC_LOGD("%s: %s started %d of %d workers, %u threads created so far",
+             __func__, name, mWorkerCount, workerCount,
+             LocThread::getCreatedCount());
+}
+
+LocWorkerPool::~LocWorkerPool() {
+    if (mQ) {
+        msg_q_unblock((void*)mQ);
+    }
+    if (mThreads) {
+        // joins each of the workers
+        delete[] mThreads;
+    }
+    if (mQ) {
+        msg_q_flush((void*)mQ);
+        msg_q_destroy((void**)&mQ);
+    }
+}
+
+void LocWorkerPool::post(const LocMsg* msg) const {
+    if (mWorkerCount > 0) {
+        __atomic_add_fetch(&mPostedCount, 1, __ATOMIC_RELAXED);
+        msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
+    } else {
+        LOC_LOGE("%s: no worker to run msg %p, dropped", __func__, msg);
+        delete msg;
+    }
+}
+
+static pthread_once_t sSharedPoolOnce = PTHREAD_ONCE_INIT;
+static LocWorkerPool* sSharedPool = NULL;
+
+static void createSharedPool() {
+    sSharedPool = new LocWorkerPool("LocWorker", LOC_SHARED_POOL_WORKERS);
+}
+
+void LocWorkerPool::dump() const {
+    LOC_LOGD("%s: %s: %d workers, %u jobs posted, %u run", __func__, mName,
+             mWorkerCount, __atomic_load_n(&mPostedCount, __ATOMIC_RELAXED),
+             __atomic_load_n(&mRunCount, __ATOMIC_RELAXED));
+}
+
+const LocWorkerPool* LocWorkerPool::getShared() {
+    pthread_once(&sSharedPoolOnce, createSharedPool);
+    return sSharedPool;
+}
+
+void LocWorkerPool::dumpShared() {
+    LOC_LOGD("%s: %u threads created, %u alive", __func__,
+             LocThread::getCreatedCount(), LocThread::getLiveCount());
+    // pthread_once has completed for every caller that got to see it
+    const LocWorkerPool* pool = __atomic_load_n(&sSharedPool, __ATOMIC_ACQUIRE);
+    if (pool) {
+        pool->dump();
+    }
+}
+
+struct LocWorkerSerialDrain : public LocMsg {
+    LocWorkerSerial* mSerial;
+    inline LocWorkerSerialDrain(LocWorkerSerial* serial) :
+        LocMsg(), mSerial(serial) {}
+    inline virtual void proc() const {
+        mSerial->drain();
+    }
+};
+
+LocWorkerSerial::LocWorkerSerial(const LocWorkerPool* pool) :
+    mPool(pool), mJobs(NULL), mMutex(PTHREAD_MUTEX_INITIALIZER),
+    mCond(PTHREAD_COND_INITIALIZER), mDraining(false), mClosing(false) {
+    linked_list_init(&mJobs);
+}
+
+LocWorkerSerial::~LocWorkerSerial() {
+    pthread_mutex_lock(&mMutex);
+    mClosing = true;
+    while (mDraining) {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    if (mJobs) {
+        linked_list_flush(mJobs);
+        linked_list_destroy(&mJobs);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocWorkerSerial::post(const LocMsg* msg) {
+    if (NULL == mJobs || NULL == mPool || mPool->getWorkerCount() <= 0) {
+        LOC_LOGE("%s: no worker to run msg %p, dropped", __func__, msg);
+        delete msg;
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    linked_list_add(mJobs, (void*)msg, LocMsgDestroy);
+    bool start = !mDraining;
+    mDraining = true;
+    pthread_mutex_unlock(&mMutex);
+
+    // one drain job at a time runs the queued jobs in order
+    if (start) {
+        mPool->post(new LocWorkerSerialDrain(this));
+    }
+}
+
+void LocWorkerSerial::drain() {
+    LocMsg* msg = NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&mMutex);
+        if (mClosing ||
+            eLINKED_LIST_SUCCESS != linked_list_remove(mJobs, (void**)&msg)) {
+            mDraining = false;
+            pthread_cond_broadcast(&mCond);
+            pthread_mutex_unlock(&mMutex);
+            return;
+        }
+        pthread_mutex_unlock(&mMutex);
+
+        msg->log();
+        msg->proc();
+        delete msg;
+    }
+}
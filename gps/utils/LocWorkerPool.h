@@ -0,0 +1,91 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_WORKER_POOL__
+#define __LOC_WORKER_POOL__
+
+#include <MsgTask.h>
+
+// A small set of named worker threads draining one shared msg queue.
+// Meant for short lived jobs (timeouts, one shot retries) that would
+// otherwise each get a thread of their own. Jobs are LocMsg objs; they
+// run on whichever worker is free, so a job must not assume ordering
+// against other jobs, and must not block for long.
+class LocWorkerPool {
+    const void* mQ;
+    LocThread* mThreads;
+    int mWorkerCount;
+    const char* mName;
+    mutable uint32_t mPostedCount;
+    mutable uint32_t mRunCount;
+    friend class LocPoolWorker;
+public:
+    // workers are named "<name>-<n>" (truncated to 15 characters), and
+    // started with the given scheduling hints.
+    LocWorkerPool(const char* name, int workerCount,
+                  const LocThreadSched& sched = LocThreadSched());
+    // stops and joins all the workers; jobs not yet run are dropped.
+    // Must not be called from one of this pool's workers.
+    ~LocWorkerPool();
+
+    // the msg is owned by the pool from here on, and deleted after proc()
+    void post(const LocMsg* msg) const;
+    inline int getWorkerCount() const { return mWorkerCount; }
+
+    // logs the jobs posted to and run by this pool so far
+    void dump() const;
+
+    // process wide pool, created upon first use and never destroyed
+    static const LocWorkerPool* getShared();
+    // logs the LocThread counts, and the shared pool if it was created
+    static void dumpShared();
+};
+
+// Jobs posted through a LocWorkerSerial run on the pool one at a time, in
+// the order they are posted, for users whose jobs must not overtake each
+// other. A job waiting its turn does not hold a worker.
+class LocWorkerSerial {
+    const LocWorkerPool* mPool;
+    void* mJobs;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+    bool mDraining;
+    bool mClosing;
+    friend struct LocWorkerSerialDrain;
+    void drain();
+public:
+    LocWorkerSerial(const LocWorkerPool* pool);
+    // drops the jobs not yet run, and waits for the one running, if any.
+    // Must not be called from one of its own jobs.
+    ~LocWorkerSerial();
+
+    // the msg is owned by the serial queue from here on
+    void post(const LocMsg* msg);
+};
+
+#endif //__LOC_WORKER_POOL__
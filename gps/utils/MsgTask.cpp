@@ -77,6 +77,19 @@ void MsgTask::sendMsg(const LocMsg* msg) const {
     msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
 }
 
+struct LocSchedMsg : public LocMsg {
+    const LocThreadSched mSched;
+    inline LocSchedMsg(const LocThreadSched& sched) :
+        LocMsg(), mSched(sched) {}
+    inline virtual void proc() const {
+        LocThread::applySched(mSched);
+    }
+};
+
+void MsgTask::setSched(const LocThreadSched& sched) const {
+    sendMsg(new LocSchedMsg(sched));
+}
+
 void MsgTask::prerun() {
     // make sure we do not run in background scheduling group
     set_sched_policy(gettid(), SP_FOREGROUND);
@@ -50,6 +50,9 @@ public:
     // this obj will be deleted once thread is deleted
     void destroy();
     void sendMsg(const LocMsg* msg) const;
+    // queues a msg that applies the scheduling hints to this task's own
+    // thread, so that it takes effect after every msg already queued.
+    void setSched(const LocThreadSched& sched) const;
     // Overrides of LocRunnable methods
     // This method will be repeated called until it returns false; or
     // until thread is stopped.
@@ -43,11 +43,78 @@ typedef struct list_element {
    void (*dealloc_func)(void*);
 }list_element;
 
+/* List elements are carved out of slabs owned by the list and recycled
+   through a free list, so that steady state add / remove (e.g. every
+   msg_q send / receive) does not go to the heap. Slabs are only given
+   back in linked_list_destroy(). Building with LIST_SLAB_ELEMENTS 0
+   allocates every element on its own instead, as loc_msg_q_bench_malloc
+   does for comparison. */
+#ifndef LIST_SLAB_ELEMENTS
+#define LIST_SLAB_ELEMENTS 16
+#endif
+
+#if LIST_SLAB_ELEMENTS > 0
+
+typedef struct list_slab {
+   struct list_slab* next;
+   list_element elements[LIST_SLAB_ELEMENTS];
+} list_slab;
+#endif
+
 typedef struct list_state {
    list_element* p_head;
    list_element* p_tail;
+#if LIST_SLAB_ELEMENTS > 0
+   list_element* p_free;
+   list_slab* p_slabs;
+#endif
 } list_state;
 
+/* ----------------------- INTERNAL FUNCTIONS ---------------------------------------- */
+
+#if LIST_SLAB_ELEMENTS > 0
+static list_element* list_element_alloc(list_state* p_list)
+{
+   if( p_list->p_free == NULL )
+   {
+      list_slab* slab = (list_slab*)malloc(sizeof(list_slab));
+      if( slab == NULL )
+      {
+         return NULL;
+      }
+      slab->next = p_list->p_slabs;
+      p_list->p_slabs = slab;
+
+      int i;
+      for( i = 0; i < LIST_SLAB_ELEMENTS; i++ )
+      {
+         slab->elements[i].next = p_list->p_free;
+         p_list->p_free = &slab->elements[i];
+      }
+   }
+
+   list_element* elem = p_list->p_free;
+   p_list->p_free = elem->next;
+   return elem;
+}
+
+static void list_element_free(list_state* p_list, list_element* elem)
+{
+   elem->next = p_list->p_free;
+   p_list->p_free = elem;
+}
+#else
+static list_element* list_element_alloc(list_state* p_list)
+{
+   return (list_element*)malloc(sizeof(list_element));
+}
+
+static void list_element_free(list_state* p_list, list_element* elem)
+{
+   free(elem);
+}
+#endif /* LIST_SLAB_ELEMENTS > 0 */
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -73,6 +140,10 @@ linked_list_err_type linked_list_init(void** list_data)
 
    tmp_list->p_head = NULL;
    tmp_list->p_tail = NULL;
+#if LIST_SLAB_ELEMENTS > 0
+   tmp_list->p_free = NULL;
+   tmp_list->p_slabs = NULL;
+#endif
 
    *list_data = tmp_list;
 
@@ -96,6 +167,15 @@ linked_list_err_type linked_list_destroy(void** list_data)
 
    linked_list_flush(p_list);
 
+#if LIST_SLAB_ELEMENTS > 0
+   while( p_list->p_slabs != NULL )
+   {
+      list_slab* slab = p_list->p_slabs;
+      p_list->p_slabs = slab->next;
+      free(slab);
+   }
+#endif
+
    free(*list_data);
    *list_data = NULL;
 
@@ -123,7 +203,7 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
    }
 
    list_state* p_list = (list_state*)list_data;
-   list_element* elem = (list_element*)malloc(sizeof(list_element));
+   list_element* elem = list_element_alloc(p_list);
    if( elem == NULL )
    {
       LOC_LOGE("%s: Memory allocation failed\n", __FUNCTION__);
@@ -197,8 +277,8 @@ linked_list_err_type linked_list_remove(void* list_data, void **data_obj)
    /* Copy data to output param */
    *data_obj = tmp->data_ptr;
 
-   /* Free allocated list element */
-   free(tmp);
+   /* Recycle list element */
+   list_element_free(p_list, tmp);
 
    return eLINKED_LIST_SUCCESS;
 }
@@ -248,8 +328,8 @@ linked_list_err_type linked_list_flush(void* list_data)
          p_list->p_head->dealloc_func(p_list->p_head->data_ptr);
       }
 
-      /* Free list element */
-      free(p_list->p_head);
+      /* Recycle list element */
+      list_element_free(p_list, p_list->p_head);
 
       p_list->p_head = tmp;
    }
@@ -314,7 +394,7 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
          if (NULL == data_p && NULL != tmp->dealloc_func) {
              tmp->dealloc_func(tmp->data_ptr);
          }
-         free(tmp);
+         list_element_free(p_list, tmp);
        }
 
        tmp = NULL;
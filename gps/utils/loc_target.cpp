@@ -34,6 +34,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 #include <hardware/gps.h>
 #include <cutils/properties.h>
 #include "loc_target.h"
@@ -65,7 +66,22 @@
 #define QCA1530_DETECT_PRESENT "yes"
 #define QCA1530_DETECT_PROGRESS "detect"
 
-static unsigned int gTarget = (unsigned int)-1;
+#define TARGET_INVALID ((unsigned int)-1)
+
+/* The properties identifying the target are read-only, so they are read
+ * once, on first use, and served from here. The target itself is kept
+ * only once detected: while detection comes out invalid, e.g. before
+ * /dev/mdm shows up, every loc_get_target() probes again. */
+typedef struct {
+    int lean;
+    char baseband[PROPERTY_VALUE_MAX];
+    char platform_name[PROPERTY_VALUE_MAX];
+} loc_target_desc_s_type;
+
+static loc_target_desc_s_type gTargetDesc;
+static pthread_once_t gTargetDescOnce = PTHREAD_ONCE_INIT;
+static unsigned int gTarget = TARGET_INVALID;
+static pthread_mutex_t gTargetMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static int read_a_line(const char * file_path, char * line, int line_size)
 {
@@ -96,7 +112,8 @@ static int read_a_line(const char * file_path, char * line, int line_size)
  * based on property value. For 1530 scenario, the value shall be one of the
  * following: "yes", "no", "detect". All other values are treated equally to
  * "no". When the value is "detect" the system waits for SoC detection to
- * finish before returning result.
+ * finish before returning result. That wait is made once per process: once
+ * it has timed out, later calls only look at the property.
  *
  * \retval true - QCA1530 is available.
  * \retval false - QCA1530 is not available.
@@ -104,6 +121,8 @@ static int read_a_line(const char * file_path, char * line, int line_size)
 static bool is_qca1530(void)
 {
     static const char qca1530_property_name[] = "sys.qca1530";
+    // set under gTargetMutex, the only caller
+    static bool waited = false;
     bool res = false;
     int ret, i;
     char buf[PROPERTY_VALUE_MAX];
@@ -136,7 +155,16 @@ static bool is_qca1530(void)
                     sizeof(QCA1530_DETECT_PROGRESS)))
         {
             LOC_LOGV("qca1530: SoC detection is in progress.");
-            sleep(1);
+            if (waited) {
+                break;
+            }
+            if (i + 1 < QCA1530_DETECT_TIMEOUT) {
+                sleep(1);
+            } else {
+                LOC_LOGW("qca1530: SoC detection did not finish in %d s",
+                         QCA1530_DETECT_TIMEOUT);
+                waited = true;
+            }
             continue;
         }
         break;
@@ -146,39 +174,25 @@ static bool is_qca1530(void)
     return res;
 }
 
-/*The character array passed to this function should have length
-  of atleast PROPERTY_VALUE_MAX*/
-void loc_get_target_baseband(char *baseband, int array_length)
+static void loc_target_desc_init(void)
 {
-    if(baseband && (array_length >= PROPERTY_VALUE_MAX)) {
-        property_get("ro.baseband", baseband, "");
-        LOC_LOGD("%s:%d]: Baseband: %s\n", __func__, __LINE__, baseband);
-    }
-    else {
-        LOC_LOGE("%s:%d]: NULL parameter or array length less than PROPERTY_VALUE_MAX\n",
-                 __func__, __LINE__);
-    }
+    property_get("ro.baseband", gTargetDesc.baseband, "");
+    property_get("ro.board.platform", gTargetDesc.platform_name, "");
+
+    char lean_target[PROPERTY_VALUE_MAX];
+    property_get("ro.lean", lean_target, "");
+    gTargetDesc.lean = !(strncmp(lean_target, "true", PROPERTY_VALUE_MAX));
 }
 
-/*The character array passed to this function should have length
-  of atleast PROPERTY_VALUE_MAX*/
-void loc_get_platform_name(char *platform_name, int array_length)
+static inline const loc_target_desc_s_type* loc_get_target_desc(void)
 {
-    if(platform_name && (array_length >= PROPERTY_VALUE_MAX)) {
-        property_get("ro.board.platform", platform_name, "");
-        LOC_LOGD("%s:%d]: Target name: %s\n", __func__, __LINE__, platform_name);
-    }
-    else {
-        LOC_LOGE("%s:%d]: Null parameter or array length less than PROPERTY_VALUE_MAX\n",
-                 __func__, __LINE__);
-    }
+    pthread_once(&gTargetDescOnce, loc_target_desc_init);
+    return &gTargetDesc;
 }
 
-unsigned int loc_get_target(void)
+/* returns TARGET_INVALID if the target cannot be told yet */
+static unsigned int loc_target_detect(void)
 {
-    if (gTarget != (unsigned int)-1)
-        return gTarget;
-
     static const char hw_platform[]      = "/sys/devices/soc0/hw_platform";
     static const char id[]               = "/sys/devices/soc0/soc_id";
     static const char hw_platform_dep[]  =
@@ -189,15 +203,15 @@ unsigned int loc_get_target(void)
     char rd_hw_platform[LINE_LEN];
     char rd_id[LINE_LEN];
     char rd_mdm[LINE_LEN];
-    char baseband[LINE_LEN];
+    const char *baseband = loc_get_target_desc()->baseband;
+    // stays invalid if an MTP/Surf/Liquid board has no /dev/mdm
+    unsigned int target = TARGET_INVALID;
 
+    // a detection that did not finish in time falls through to the board
     if (is_qca1530()) {
-        gTarget = TARGET_QCA1530;
-        goto detected;
+        return TARGET_QCA1530;
     }
 
-    loc_get_target_baseband(baseband, sizeof(baseband));
-
     if (!access(hw_platform, F_OK)) {
         read_a_line(hw_platform, rd_hw_platform, LINE_LEN);
     } else {
@@ -210,16 +224,15 @@ unsigned int loc_get_target(void)
     }
     if( !memcmp(baseband, STR_AUTO, LENGTH(STR_AUTO)) )
     {
-          gTarget = TARGET_AUTO;
-          goto detected;
+          return TARGET_AUTO;
     }
     if( !memcmp(baseband, STR_APQ, LENGTH(STR_APQ)) ){
 
         if( !memcmp(rd_id, MPQ8064_ID_1, LENGTH(MPQ8064_ID_1))
             && IS_STR_END(rd_id[LENGTH(MPQ8064_ID_1)]) )
-            gTarget = TARGET_MPQ;
+            target = TARGET_MPQ;
         else
-            gTarget = TARGET_APQ_SA;
+            target = TARGET_APQ_SA;
     }
     else {
         if( (!memcmp(rd_hw_platform, STR_LIQUID, LENGTH(STR_LIQUID))
@@ -230,20 +243,65 @@ unsigned int loc_get_target(void)
              && IS_STR_END(rd_hw_platform[LENGTH(STR_MTP)]))) {
 
             if (!read_a_line( mdm, rd_mdm, LINE_LEN))
-                gTarget = TARGET_MDM;
+                target = TARGET_MDM;
         }
         else if( (!memcmp(rd_id, MSM8930_ID_1, LENGTH(MSM8930_ID_1))
                    && IS_STR_END(rd_id[LENGTH(MSM8930_ID_1)])) ||
                   (!memcmp(rd_id, MSM8930_ID_2, LENGTH(MSM8930_ID_2))
                    && IS_STR_END(rd_id[LENGTH(MSM8930_ID_2)])) )
-             gTarget = TARGET_MSM_NO_SSC;
+             target = TARGET_MSM_NO_SSC;
         else
-             gTarget = TARGET_UNKNOWN;
+             target = TARGET_UNKNOWN;
     }
+    return target;
+}
 
-detected:
-    LOC_LOGD("HAL: %s returned %d", __FUNCTION__, gTarget);
-    return gTarget;
+/*The character array passed to this function should have length
+  of atleast PROPERTY_VALUE_MAX*/
+void loc_get_target_baseband(char *baseband, int array_length)
+{
+    if(baseband && (array_length >= PROPERTY_VALUE_MAX)) {
+        strlcpy(baseband, loc_get_target_desc()->baseband, array_length);
+        LOC_LOGD("%s:%d]: Baseband: %s\n", __func__, __LINE__, baseband);
+    }
+    else {
+        LOC_LOGE("%s:%d]: NULL parameter or array length less than PROPERTY_VALUE_MAX\n",
+                 __func__, __LINE__);
+    }
+}
+
+/*The character array passed to this function should have length
+  of atleast PROPERTY_VALUE_MAX*/
+void loc_get_platform_name(char *platform_name, int array_length)
+{
+    if(platform_name && (array_length >= PROPERTY_VALUE_MAX)) {
+        strlcpy(platform_name, loc_get_target_desc()->platform_name, array_length);
+        LOC_LOGD("%s:%d]: Target name: %s\n", __func__, __LINE__, platform_name);
+    }
+    else {
+        LOC_LOGE("%s:%d]: Null parameter or array length less than PROPERTY_VALUE_MAX\n",
+                 __func__, __LINE__);
+    }
+}
+
+unsigned int loc_get_target(void)
+{
+    unsigned int target = __atomic_load_n(&gTarget, __ATOMIC_ACQUIRE);
+    if (TARGET_INVALID != target) {
+        return target;
+    }
+
+    // one prober at a time, the others then find its result
+    pthread_mutex_lock(&gTargetMutex);
+    target = gTarget;
+    if (TARGET_INVALID == target) {
+        target = loc_target_detect();
+        __atomic_store_n(&gTarget, target, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&gTargetMutex);
+
+    LOC_LOGD("HAL: %s returned %d", __FUNCTION__, target);
+    return target;
 }
 
 /*Reads the property ro.lean to identify if this is a lean target
@@ -253,9 +311,7 @@ detected:
 */
 int loc_identify_lean_target()
 {
-    int ret = 0;
-    char lean_target[PROPERTY_VALUE_MAX];
-    property_get("ro.lean", lean_target, "");
-    LOC_LOGD("%s:%d]: lean target: %s\n", __func__, __LINE__, lean_target);
-    return !(strncmp(lean_target, "true", PROPERTY_VALUE_MAX));
+    int lean = loc_get_target_desc()->lean;
+    LOC_LOGD("%s:%d]: lean target: %d\n", __func__, __LINE__, lean);
+    return lean;
 }
@@ -0,0 +1,90 @@
+# loc_target query and msg_q benchmarks
+OLD_LOCAL_PATH := $(LOCAL_PATH)
+LOC_UTILS_TEST_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_UTILS_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_SRC_FILES := \
+    loc_target_bench.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_UTILS_TEST_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := \
+    libcutils \
+    libgps.utils
+
+LOCAL_MODULE := loc_target_bench
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+# msg_q over the list recycling its elements through slabs. The list
+# and queue are compiled in here as in the malloc build, so that both
+# see the same flags
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_UTILS_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+
+LOCAL_SRC_FILES := \
+    ../linked_list.c \
+    ../msg_q.c \
+    loc_msg_q_bench.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_UTILS_TEST_PATH)/.. \
+    $(LOC_UTILS_TEST_PATH)/../platform_lib_abstractions
+
+LOCAL_SHARED_LIBRARIES := \
+    libcutils \
+    liblog \
+    libgps.utils
+
+LOCAL_MODULE := loc_msg_q_bench
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+# the same over a list allocating every element on its own
+include $(CLEAR_VARS)
+LOCAL_PATH := $(LOC_UTILS_TEST_PATH)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     -DLIST_SLAB_ELEMENTS=0
+
+LOCAL_SRC_FILES := \
+    ../linked_list.c \
+    ../msg_q.c \
+    loc_msg_q_bench.cpp
+
+LOCAL_C_INCLUDES := \
+    $(LOC_UTILS_TEST_PATH)/.. \
+    $(LOC_UTILS_TEST_PATH)/../platform_lib_abstractions
+
+LOCAL_SHARED_LIBRARIES := \
+    libcutils \
+    liblog \
+    libgps.utils
+
+LOCAL_MODULE := loc_msg_q_bench_malloc
+LOCAL_MODULE_OWNER := qcom
+LOCAL_PRELINK_MODULE := false
+
+include $(BUILD_EXECUTABLE)
+
+LOCAL_PATH := $(OLD_LOCAL_PATH)
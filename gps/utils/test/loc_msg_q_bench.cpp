@@ -0,0 +1,150 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+/* Cost of msg_q send / receive and of the linked_list add / remove under
+   it. Built twice: loc_msg_q_bench with the elements recycled through
+   the list's slabs, loc_msg_q_bench_malloc with LIST_SLAB_ELEMENTS 0,
+   allocating every element on its own; run both to compare.
+   Usage: loc_msg_q_bench [msgs] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "linked_list.h"
+#include "msg_q.h"
+
+#if defined(LIST_SLAB_ELEMENTS) && 0 == LIST_SLAB_ELEMENTS
+#define BENCH_ELEMENTS "malloc per element"
+#else
+#define BENCH_ELEMENTS "slab recycled"
+#endif
+
+static long long nowNsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// add / remove pairs with depth elements kept queued
+static long long benchList(int depth, int pairs)
+{
+    void* list = NULL;
+    void* obj = NULL;
+    linked_list_init(&list);
+    for (int i = 0; i < depth; i++) {
+        linked_list_add(list, (void*)(long)(i + 1), NULL);
+    }
+
+    long long start = nowNsec();
+    for (int i = 0; i < pairs; i++) {
+        linked_list_add(list, (void*)(long)(i + 1), NULL);
+        linked_list_remove(list, &obj);
+    }
+    long long nsec = (nowNsec() - start) / pairs;
+
+    linked_list_destroy(&list);
+    return nsec;
+}
+
+// bursts of burst sends, each followed by as many receives, on one thread
+static long long benchQueueBursts(int burst, int msgs)
+{
+    void* q = NULL;
+    void* obj = NULL;
+    msg_q_init(&q);
+
+    long long start = nowNsec();
+    for (int sent = 0; sent < msgs; sent += burst) {
+        for (int i = 0; i < burst; i++) {
+            msg_q_snd(q, (void*)(long)(i + 1), NULL);
+        }
+        for (int i = 0; i < burst; i++) {
+            msg_q_rcv(q, &obj);
+        }
+    }
+    long long nsec = (nowNsec() - start) / msgs;
+
+    msg_q_destroy(&q);
+    return nsec;
+}
+
+struct BenchProducer {
+    void* q;
+    int msgs;
+};
+
+static void* benchProduce(void* arg)
+{
+    BenchProducer* producer = (BenchProducer*)arg;
+    for (int i = 0; i < producer->msgs; i++) {
+        msg_q_snd(producer->q, (void*)(long)(i + 1), NULL);
+    }
+    return NULL;
+}
+
+// a sender thread streaming to a receiver, as MsgTask is used
+static long long benchQueueThreads(int msgs)
+{
+    BenchProducer producer = { NULL, msgs };
+    void* obj = NULL;
+    pthread_t thread;
+    msg_q_init(&producer.q);
+
+    long long start = nowNsec();
+    pthread_create(&thread, NULL, benchProduce, &producer);
+    for (int i = 0; i < msgs; i++) {
+        msg_q_rcv(producer.q, &obj);
+    }
+    long long nsec = (nowNsec() - start) / msgs;
+
+    pthread_join(thread, NULL);
+    msg_q_destroy(&producer.q);
+    return nsec;
+}
+
+int main(int argc, char** argv)
+{
+    int msgs = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (msgs < 64) {
+        fprintf(stderr, "usage: %s [msgs, at least 64]\n", argv[0]);
+        return 1;
+    }
+
+    printf("list elements: %s\n", BENCH_ELEMENTS);
+    printf("bench: list add / remove, depth 1: %lld ns\n", benchList(1, msgs));
+    printf("bench: list add / remove, depth 64: %lld ns\n", benchList(64, msgs));
+    printf("bench: msg_q send / receive, bursts of 1: %lld ns\n",
+           benchQueueBursts(1, msgs));
+    printf("bench: msg_q send / receive, bursts of 64: %lld ns\n",
+           benchQueueBursts(64, msgs));
+    printf("bench: msg_q send / receive across threads: %lld ns\n",
+           benchQueueThreads(msgs));
+    return 0;
+}
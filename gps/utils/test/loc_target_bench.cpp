@@ -0,0 +1,113 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Cost of the loc_target queries. The first round identifies the target,
+   which is what every query used to cost; the rounds after it are served
+   from the cached descriptor. With "detect", sys.qca1530 is set to
+   "detect" first, as while the SoC is still being detected: the first
+   round waits that detection out, no round after it may wait again.
+   Usage: loc_target_bench [detect] [rounds] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cutils/properties.h>
+#include "loc_target.h"
+
+static long long nowNsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static unsigned int queryAll(void)
+{
+    char baseband[PROPERTY_VALUE_MAX];
+    char platform[PROPERTY_VALUE_MAX];
+
+    loc_get_target_baseband(baseband, sizeof(baseband));
+    loc_get_platform_name(platform, sizeof(platform));
+    return loc_get_target() + loc_identify_lean_target();
+}
+
+int main(int argc, char** argv)
+{
+    static const char qca1530_property_name[] = "sys.qca1530";
+    bool detect = argc > 1 && 0 == strcmp(argv[1], "detect");
+    int arg = detect ? 2 : 1;
+    int rounds = argc > arg ? atoi(argv[arg]) : 10000;
+    if (rounds < 1) {
+        fprintf(stderr, "usage: %s [detect] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    char qca1530[PROPERTY_VALUE_MAX];
+    if (detect) {
+        property_get(qca1530_property_name, qca1530, "");
+        if (0 != property_set(qca1530_property_name, "detect")) {
+            fprintf(stderr, "cannot set %s\n", qca1530_property_name);
+            return 1;
+        }
+    }
+
+    long long start = nowNsec();
+    queryAll();
+    long long firstNsec = nowNsec() - start;
+    if (detect) {
+        // still "detect": had the first round not cached a target, this
+        // one probes again, and must not wait again
+        start = nowNsec();
+        queryAll();
+        long long secondNsec = nowNsec() - start;
+        property_set(qca1530_property_name, qca1530);
+
+        printf("detect: second round %lld us\n", secondNsec / 1000);
+        if (secondNsec >= 1000000000LL) {
+            printf("detect: FAIL, the second round waited for the detection\n");
+            return 1;
+        }
+        printf("detect: PASS\n");
+    }
+
+    volatile unsigned int sink = 0;
+    start = nowNsec();
+    for (int i = 0; i < rounds; i++) {
+        sink += queryAll();
+    }
+    long long cachedNsec = (nowNsec() - start) / rounds;
+
+    unsigned int target = loc_get_target();
+    printf("target %u%s\n", target,
+           (unsigned int)-1 == target ? " (not identified, probed per call)" : "");
+    printf("first round: %lld us\n", firstNsec / 1000);
+    printf("cached rounds: %lld ns each over %d rounds\n", cachedNsec, rounds);
+    return 0;
+}